@@ -25,14 +25,18 @@ LOCAL_MODULE                  := copybit.$(TARGET_BOARD_PLATFORM)
 LOCAL_MODULE_RELATIVE_PATH    := hw
 LOCAL_MODULE_TAGS             := optional
 LOCAL_C_INCLUDES              := $(common_includes) $(kernel_includes)
-LOCAL_SHARED_LIBRARIES        := $(common_libs) libdl libmemalloc
+LOCAL_SHARED_LIBRARIES        := $(common_libs) libdl libmemalloc libsync
 LOCAL_CFLAGS                  := $(common_flags) -DLOG_TAG=\"qdcopybit\" -Wno-sign-conversion
 LOCAL_ADDITIONAL_DEPENDENCIES := $(common_deps)
 LOCAL_CLANG                   := true
 
 ifeq ($(TARGET_USES_C2D_COMPOSITION),true)
     LOCAL_CFLAGS += -DCOPYBIT_Z180=1 -DC2D_SUPPORT_DISPLAY=1
-    LOCAL_SRC_FILES := copybit_c2d.cpp software_converter.cpp
+    LOCAL_SRC_FILES := copybit_c2d.cpp copybit_sw.cpp software_converter.cpp
+    include $(BUILD_SHARED_LIBRARY)
+else ifeq ($(TARGET_USES_SW_COPYBIT),true)
+    LOCAL_CFLAGS += -DCOPYBIT_SW=1
+    LOCAL_SRC_FILES := copybit_sw.cpp
     include $(BUILD_SHARED_LIBRARY)
 else
     ifneq ($(call is-chipset-in-board-platform,msm7630),true)
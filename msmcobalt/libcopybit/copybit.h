@@ -84,6 +84,9 @@ enum {
     COPYBIT_SRC_FORMAT_MODE = 11,
     /* Destination Format Mode */
     COPYBIT_DST_FORMAT_MODE = 12,
+    /* Drop the cached GPU mappings, clients set this before freeing
+     * buffers they have blit */
+    COPYBIT_PURGE_MAPPINGS = 13,
 };
 
 /* values for copybit_set_parameter(COPYBIT_TRANSFORM) */
@@ -298,6 +301,15 @@ struct copybit_device_t {
    */
   int (*clear)(struct copybit_device_t *dev, struct copybit_image_t const *buf,
                struct copybit_rect_t *rect);
+
+  /**
+    * Dump the device state into buff, may be NULL.
+    *
+    * @param dev from open
+    * @param buff is the buffer to print into
+    * @param buff_len is the size of buff
+    */
+  void (*dump)(struct copybit_device_t *dev, char *buff, int buff_len);
 };
 
 
@@ -22,6 +22,7 @@
 #include <sys/prctl.h>
 
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
@@ -32,6 +33,7 @@
 #include <sys/mman.h>
 
 #include <linux/msm_kgsl.h>
+#include <linux/msm_ion.h>
 
 #include <EGL/eglplatform.h>
 #include <cutils/native_handle.h>
@@ -42,8 +44,10 @@
 
 #include "c2d2.h"
 #include "software_converter.h"
+#include "copybit_sw.h"
 
 #include <dlfcn.h>
+#include <algorithm>
 
 using gralloc::IMemAlloc;
 using gralloc::IonController;
@@ -105,10 +109,19 @@ C2D_STATUS (*LINK_c2dFillSurface) ( uint32 surface_id, uint32 fill_color,
 #define MAX_RGB_SURFACES 32       // Max. RGB layers currently supported per draw
 #define MAX_YUV_2_PLANE_SURFACES 4// Max. 2-plane YUV layers currently supported per draw
 #define MAX_YUV_3_PLANE_SURFACES 1// Max. 3-plane YUV layers currently supported per draw
-// +1 for the destination surface. We cannot have multiple destination surfaces.
-#define MAX_SURFACES (MAX_RGB_SURFACES + MAX_YUV_2_PLANE_SURFACES + MAX_YUV_3_PLANE_SURFACES + 1)
 #define NUM_SURFACE_TYPES 3      // RGB_SURFACE + YUV_SURFACE_2_PLANES + YUV_SURFACE_3_PLANES
 #define MAX_BLIT_OBJECT_COUNT 50 // Max. blit objects that can be passed per draw
+// GPU mappings are kept across draws, as clients blit the same buffers
+// every frame. A mapping is dropped when the cache is full, when it has not
+// been used for MAX_MAPPING_IDLE_DRAWS draws, when the client purges it, or
+// when its fd and address turn out to belong to a different buffer.
+#define MAX_MAPPED_BUFFERS 64
+#define MAX_MAPPED_BYTES (256 * 1024 * 1024)
+#define MAX_MAPPING_IDLE_DRAWS 30
+// Unaligned YUV blits go through pooled temp buffers. Sizes are rounded up
+// to a bucket so that nearby resolutions share a buffer.
+#define MAX_TEMP_BUFFERS 4
+#define TEMP_BUFFER_BUCKET_SIZE (256 * 1024)
 
 enum {
     RGB_SURFACE,
@@ -131,6 +144,24 @@ enum eC2DFlags {
 static gralloc::IAllocController* sAlloc = 0;
 /******************************************************************************/
 
+/** GPU address of a buffer mapped inside copybit */
+struct gpu_mapping_t {
+    uintptr_t gpuaddr;     // 0 when the slot is free
+    // Identity of the mapped buffer
+    int fd;
+    uint64_t base;
+    unsigned int size;
+    unsigned int offset;
+    ion_user_handle_t ion_handle; // Import of the buffer, 0 if ION is unavailable
+    uint64_t last_used;    // Draw sequence that last referenced the mapping
+};
+
+/** Temp buffer used to blit YUV buffers that are not 32 aligned */
+struct temp_buffer_t {
+    alloc_data data;       // data.fd is -1 when the slot is free
+    uint64_t last_used;    // Draw sequence that last used the buffer
+};
+
 /** State information for each device instance */
 struct copybit_context_t {
     struct copybit_device_t device;
@@ -142,10 +173,18 @@ struct copybit_context_t {
     C2D_OBJECT_STR blit_list[MAX_BLIT_OBJECT_COUNT]; // Z-ordered list of blit objects
     C2D_DRIVER_INFO c2d_driver_info;
     void *libc2d2;
-    alloc_data temp_src_buffer;
-    alloc_data temp_dst_buffer;
+    temp_buffer_t temp_buffers[MAX_TEMP_BUFFERS];
+    int temp_dst_index;         // Temp buffer holding the destination, or -1
+    uint64_t temp_buffer_allocs;
     unsigned int dst[NUM_SURFACE_TYPES]; // dst surfaces
-    uintptr_t mapped_gpu_addr[MAX_SURFACES]; // GPU addresses mapped inside copybit
+    gpu_mapping_t gpu_mappings[MAX_MAPPED_BUFFERS]; // Cached GPU mappings
+    size_t mapped_bytes;        // Total size of the cached mappings
+    int ion_fd;                 // ION client used to identify mapped buffers
+    uint64_t draw_sequence;      // Sequence of the draw being built
+    uint64_t completed_sequence; // Last draw known to be complete
+    uint64_t mapping_hits;
+    uint64_t mapping_misses;
+    uint64_t mapping_evictions;
     int blit_rgb_count;         // Total RGB surfaces being blit
     int blit_yuv_2_plane_count; // Total 2 plane YUV surfaces being
     int blit_yuv_3_plane_count; // Total 3 plane YUV  surfaces being blit
@@ -213,6 +252,8 @@ struct copybit_module_t HAL_MODULE_INFO_SYM = {
 };
 
 
+static void release_idle_mappings(copybit_context_t* ctx);
+
 /* thread function which waits on the timeStamp and cleans up the surfaces */
 static void* c2d_wait_loop(void* ptr) {
     copybit_context_t* ctx = (copybit_context_t*)(ptr);
@@ -231,13 +272,9 @@ static void* c2d_wait_loop(void* ptr) {
                 ALOGE("%s: LINK_c2dWaitTimeStamp ERROR!!", __FUNCTION__);
             }
             ctx->wait_timestamp = false;
-            // Unmap any mapped addresses.
-            for (int i = 0; i < MAX_SURFACES; i++) {
-                if (ctx->mapped_gpu_addr[i]) {
-                    LINK_c2dUnMapAddr( (void*)ctx->mapped_gpu_addr[i]);
-                    ctx->mapped_gpu_addr[i] = 0;
-                }
-            }
+            // The flushed draw is the one before the draw being built
+            ctx->completed_sequence = ctx->draw_sequence - 1;
+            release_idle_mappings(ctx);
             // Reset the counts after the draw.
             ctx->blit_rgb_count = 0;
             ctx->blit_yuv_2_plane_count = 0;
@@ -341,14 +378,128 @@ int c2diGetBpp(int32 colorformat)
     return c2dBpp;
 }
 
+/* Import a buffer into the ION client of copybit. ION hands out the same
+ * handle for every import of a buffer, so the handle tells buffers apart
+ * even when a freed buffer's fd and address are reused. Returns 0 if the
+ * buffer cannot be imported. */
+static ion_user_handle_t import_ion_handle(copybit_context_t* ctx, int fd)
+{
+    struct ion_fd_data fd_data;
+
+    if (ctx->ion_fd < 0)
+        return 0;
+
+    memset(&fd_data, 0, sizeof(fd_data));
+    fd_data.fd = fd;
+    if (ioctl(ctx->ion_fd, ION_IOC_IMPORT, &fd_data)) {
+        ALOGE("%s: ION_IOC_IMPORT failed with error - %s", __FUNCTION__,
+              strerror(errno));
+        return 0;
+    }
+    return fd_data.handle;
+}
+
+static void free_ion_handle(copybit_context_t* ctx, ion_user_handle_t ion_handle)
+{
+    struct ion_handle_data handle_data;
+
+    if (!ion_handle)
+        return;
+
+    memset(&handle_data, 0, sizeof(handle_data));
+    handle_data.handle = ion_handle;
+    ioctl(ctx->ion_fd, ION_IOC_FREE, &handle_data);
+}
+
+static void unmap_gpu_mapping(copybit_context_t* ctx, gpu_mapping_t &mapping)
+{
+    LINK_c2dUnMapAddr((void*)mapping.gpuaddr);
+    free_ion_handle(ctx, mapping.ion_handle);
+    ctx->mapped_bytes -= mapping.size;
+    ctx->mapping_evictions++;
+    memset(&mapping, 0, sizeof(mapping));
+}
+
+/* A mapping can be dropped once every draw that references it is complete */
+static bool is_mapping_idle(copybit_context_t* ctx, const gpu_mapping_t &mapping)
+{
+    return mapping.gpuaddr && (mapping.last_used <= ctx->completed_sequence);
+}
+
+/* Drop the least recently used idle mapping, returns its slot or -1 if
+ * every mapping is still in use */
+static int evict_lru_mapping(copybit_context_t* ctx)
+{
+    int lru = -1;
+    for (int i = 0; i < MAX_MAPPED_BUFFERS; i++) {
+        if (is_mapping_idle(ctx, ctx->gpu_mappings[i]) && (lru == -1 ||
+            ctx->gpu_mappings[i].last_used < ctx->gpu_mappings[lru].last_used)) {
+            lru = i;
+        }
+    }
+
+    if (lru != -1)
+        unmap_gpu_mapping(ctx, ctx->gpu_mappings[lru]);
+    return lru;
+}
+
+/* Called once a draw is complete, drops the mappings of buffers the client
+ * no longer blits or has released */
+static void release_idle_mappings(copybit_context_t* ctx)
+{
+    for (int i = 0; i < MAX_MAPPED_BUFFERS; i++) {
+        gpu_mapping_t &mapping = ctx->gpu_mappings[i];
+        if (is_mapping_idle(ctx, mapping) &&
+            (mapping.fd == -1 ||
+             mapping.last_used + MAX_MAPPING_IDLE_DRAWS <= ctx->completed_sequence)) {
+            unmap_gpu_mapping(ctx, mapping);
+        }
+    }
+}
+
+/* Forget the mapping of a buffer about to be freed, so that a new buffer
+ * reusing its fd and address cannot match it. A mapping still referenced
+ * by a draw is dropped once the draw completes. */
+static void release_buffer_mapping(copybit_context_t* ctx, int fd, uint64_t base)
+{
+    for (int i = 0; i < MAX_MAPPED_BUFFERS; i++) {
+        gpu_mapping_t &mapping = ctx->gpu_mappings[i];
+        if (!mapping.gpuaddr || mapping.fd != fd || mapping.base != base)
+            continue;
+
+        if (is_mapping_idle(ctx, mapping)) {
+            unmap_gpu_mapping(ctx, mapping);
+        } else {
+            mapping.fd = -1;
+        }
+    }
+}
+
+/* Drop every mapping, for clients about to free buffers they have blit */
+static void purge_mappings(copybit_context_t* ctx)
+{
+    for (int i = 0; i < MAX_MAPPED_BUFFERS; i++) {
+        gpu_mapping_t &mapping = ctx->gpu_mappings[i];
+        if (mapping.gpuaddr)
+            release_buffer_mapping(ctx, mapping.fd, mapping.base);
+    }
+}
+
+static void unmap_all_mappings(copybit_context_t* ctx)
+{
+    for (int i = 0; i < MAX_MAPPED_BUFFERS; i++) {
+        if (ctx->gpu_mappings[i].gpuaddr)
+            unmap_gpu_mapping(ctx, ctx->gpu_mappings[i]);
+    }
+}
+
 static size_t c2d_get_gpuaddr(copybit_context_t* ctx,
-                              struct private_handle_t *handle, int &mapped_idx)
+                              struct private_handle_t *handle)
 {
     uint32 memtype;
     size_t *gpuaddr = 0;
     C2D_STATUS rc;
-    int freeindex = 0;
-    bool mapaddr = false;
+    int freeindex = -1;
 
     if(!handle)
         return 0;
@@ -360,39 +511,68 @@ static size_t c2d_get_gpuaddr(copybit_context_t* ctx,
         return 0;
     }
 
-    // Check for a freeindex in the mapped_gpu_addr list
-    for (freeindex = 0; freeindex < MAX_SURFACES; freeindex++) {
-        if (ctx->mapped_gpu_addr[freeindex] == 0) {
-            // free index is available
-            // map GPU addr and use this as mapped_idx
-            mapaddr = true;
-            break;
+    // The import is kept by a new mapping, or dropped again on a hit
+    ion_user_handle_t ion_handle = import_ion_handle(ctx, handle->fd);
+
+    // Reuse the mapping made for this buffer by an earlier draw
+    for (int i = 0; i < MAX_MAPPED_BUFFERS; i++) {
+        gpu_mapping_t &mapping = ctx->gpu_mappings[i];
+        if (mapping.gpuaddr && mapping.fd == handle->fd &&
+            mapping.base == handle->base && mapping.size == handle->size &&
+            mapping.offset == handle->offset) {
+            if (mapping.ion_handle == ion_handle) {
+                free_ion_handle(ctx, ion_handle);
+                mapping.last_used = ctx->draw_sequence;
+                ctx->mapping_hits++;
+                return mapping.gpuaddr;
+            }
+            // The mapped buffer was freed and its fd and address reused
+            if (is_mapping_idle(ctx, mapping))
+                unmap_gpu_mapping(ctx, mapping);
+            else
+                mapping.fd = -1;
         }
-    }
 
-    if(mapaddr) {
-        rc = LINK_c2dMapAddr(handle->fd, (void*)handle->base, handle->size,
-                             handle->offset, memtype, (void**)&gpuaddr);
+        if (!mapping.gpuaddr && freeindex == -1)
+            freeindex = i;
+    }
 
-        if (rc == C2D_STATUS_OK) {
-            // We have mapped the GPU address inside copybit. We need to unmap
-            // this address after the blit. Store this address
-            ctx->mapped_gpu_addr[freeindex] = (size_t)gpuaddr;
-            mapped_idx = freeindex;
-        }
+    ctx->mapping_misses++;
+    // Make room within the size cap and for the new slot
+    while (ctx->mapped_bytes + handle->size > MAX_MAPPED_BYTES) {
+        int evicted = evict_lru_mapping(ctx);
+        if (evicted == -1)
+            break;
+        if (freeindex == -1)
+            freeindex = evicted;
     }
-    return (size_t)gpuaddr;
-}
+    if (freeindex == -1)
+        freeindex = evict_lru_mapping(ctx);
 
-static void unmap_gpuaddr(copybit_context_t* ctx, int mapped_idx)
-{
-    if (!ctx || (mapped_idx == -1))
-        return;
+    if (freeindex == -1) {
+        ALOGE("%s: no free GPU mapping slot", __FUNCTION__);
+        free_ion_handle(ctx, ion_handle);
+        return 0;
+    }
 
-    if (ctx->mapped_gpu_addr[mapped_idx]) {
-        LINK_c2dUnMapAddr( (void*)ctx->mapped_gpu_addr[mapped_idx]);
-        ctx->mapped_gpu_addr[mapped_idx] = 0;
+    rc = LINK_c2dMapAddr(handle->fd, (void*)handle->base, handle->size,
+                         handle->offset, memtype, (void**)&gpuaddr);
+
+    if (rc == C2D_STATUS_OK) {
+        // Keep the mapping until the buffer goes idle or is purged
+        gpu_mapping_t &mapping = ctx->gpu_mappings[freeindex];
+        mapping.gpuaddr = (uintptr_t)gpuaddr;
+        mapping.fd = handle->fd;
+        mapping.base = handle->base;
+        mapping.size = handle->size;
+        mapping.offset = handle->offset;
+        mapping.ion_handle = ion_handle;
+        mapping.last_used = ctx->draw_sequence;
+        ctx->mapped_bytes += handle->size;
+    } else {
+        free_ion_handle(ctx, ion_handle);
     }
+    return (size_t)gpuaddr;
 }
 
 static int is_supported_rgb_format(int format)
@@ -499,14 +679,13 @@ static int calculate_yuv_offset_and_stride(const bufferInfo& info,
 /** create C2D surface from copybit image */
 static int set_image(copybit_context_t* ctx, uint32 surfaceId,
                       const struct copybit_image_t *rhs,
-                      const eC2DFlags flags, int &mapped_idx)
+                      const eC2DFlags flags)
 {
     struct private_handle_t* handle = (struct private_handle_t*)rhs->handle;
     C2D_SURFACE_TYPE surfaceType;
     int status = COPYBIT_SUCCESS;
     uint64_t gpuaddr = 0;
     int c2d_format;
-    mapped_idx = -1;
 
     if (flags & FLAGS_YUV_DESTINATION) {
         c2d_format = get_c2d_format_for_yuv_destination(rhs->format);
@@ -525,7 +704,7 @@ static int set_image(copybit_context_t* ctx, uint32 surfaceId,
     }
 
     if (handle->gpuaddr == 0) {
-        gpuaddr = c2d_get_gpuaddr(ctx, handle, mapped_idx);
+        gpuaddr = c2d_get_gpuaddr(ctx, handle);
         if(!gpuaddr) {
             ALOGE("%s: c2d_get_gpuaddr failed", __FUNCTION__);
             return COPYBIT_FAILURE;
@@ -558,7 +737,6 @@ static int set_image(copybit_context_t* ctx, uint32 surfaceId,
         if(LINK_c2dUpdateSurface( surfaceId,C2D_TARGET | C2D_SOURCE, surfaceType,
                                   &surfaceDef)) {
             ALOGE("%s: RGB Surface c2dUpdateSurface ERROR", __FUNCTION__);
-            unmap_gpuaddr(ctx, mapped_idx);
             status = COPYBIT_FAILURE;
         }
     } else if (is_supported_yuv_format(rhs->format) == COPYBIT_SUCCESS) {
@@ -576,7 +754,6 @@ static int set_image(copybit_context_t* ctx, uint32 surfaceId,
         status = calculate_yuv_offset_and_stride(info, yuvInfo);
         if(status != COPYBIT_SUCCESS) {
             ALOGE("%s: calculate_yuv_offset_and_stride error", __FUNCTION__);
-            unmap_gpuaddr(ctx, mapped_idx);
         }
 
         surfaceDef.width = rhs->w;
@@ -597,12 +774,10 @@ static int set_image(copybit_context_t* ctx, uint32 surfaceId,
         if(LINK_c2dUpdateSurface( surfaceId,C2D_TARGET | C2D_SOURCE, surfaceType,
                                   &surfaceDef)) {
             ALOGE("%s: YUV Surface c2dUpdateSurface ERROR", __FUNCTION__);
-            unmap_gpuaddr(ctx, mapped_idx);
             status = COPYBIT_FAILURE;
         }
     } else {
         ALOGE("%s: invalid format 0x%x", __FUNCTION__, rhs->format);
-        unmap_gpuaddr(ctx, mapped_idx);
         status = COPYBIT_FAILURE;
     }
 
@@ -652,6 +827,8 @@ static int flush_get_fence_copybit (struct copybit_device_t *dev, int* fd)
         pthread_mutex_unlock(&ctx->wait_cleanup_lock);
         return COPYBIT_FAILURE;
     }
+    // Blits from here on belong to the next draw
+    ctx->draw_sequence++;
     if(LINK_c2dCreateFenceFD(ctx->dst[ctx->dst_surface_type], ctx->time_stamp,
                                                                         fd)) {
         ALOGE("%s: LINK_c2dCreateFenceFD ERROR", __FUNCTION__);
@@ -679,13 +856,9 @@ static int finish_copybit(struct copybit_device_t *dev)
         return COPYBIT_FAILURE;
     }
 
-    // Unmap any mapped addresses.
-    for (int i = 0; i < MAX_SURFACES; i++) {
-        if (ctx->mapped_gpu_addr[i]) {
-            LINK_c2dUnMapAddr( (void*)ctx->mapped_gpu_addr[i]);
-            ctx->mapped_gpu_addr[i] = 0;
-        }
-    }
+    // Everything submitted so far is complete
+    ctx->completed_sequence = ctx->draw_sequence++;
+    release_idle_mappings(ctx);
 
     // Reset the counts after the draw.
     ctx->blit_rgb_count = 0;
@@ -704,7 +877,6 @@ static int clear_copybit(struct copybit_device_t *dev,
 {
     int ret = COPYBIT_SUCCESS;
     int flags = FLAGS_PREMULTIPLIED_ALPHA;
-    int mapped_dst_idx = -1;
     struct copybit_context_t* ctx = (struct copybit_context_t*)dev;
     if (ctx->is_dst_ubwc_format)
         flags |= FLAGS_UBWC_FORMAT_MODE;
@@ -712,10 +884,9 @@ static int clear_copybit(struct copybit_device_t *dev,
     pthread_mutex_lock(&ctx->wait_cleanup_lock);
     if(!ctx->dst_surface_mapped) {
         ret = set_image(ctx, ctx->dst[RGB_SURFACE], buf,
-                        (eC2DFlags)flags, mapped_dst_idx);
+                        (eC2DFlags)flags);
         if(ret) {
             ALOGE("%s: set_image error", __FUNCTION__);
-            unmap_gpuaddr(ctx, mapped_dst_idx);
             pthread_mutex_unlock(&ctx->wait_cleanup_lock);
             return COPYBIT_FAILURE;
         }
@@ -879,6 +1050,9 @@ static int set_parameter_copybit(
         case COPYBIT_DST_FORMAT_MODE:
             ctx->is_dst_ubwc_format = (value == COPYBIT_UBWC_COMPRESSED);
             break;
+        case COPYBIT_PURGE_MAPPINGS:
+            purge_mappings(ctx);
+            break;
         default:
             ALOGE("%s: default case param=0x%x", __FUNCTION__, name);
             status = -EINVAL;
@@ -997,7 +1171,7 @@ static int get_temp_buffer(const bufferInfo& info, alloc_data& data)
     data.base = 0;
     data.fd = -1;
     data.offset = 0;
-    data.size = get_size(info);
+    data.size = ALIGN(get_size(info), TEMP_BUFFER_BUCKET_SIZE);
     data.align = getpagesize();
     data.uncached = true;
     int allocFlags = 0;
@@ -1022,20 +1196,91 @@ static int get_temp_buffer(const bufferInfo& info, alloc_data& data)
 }
 
 /* Function to free the temporary allocated memory.*/
-static void free_temp_buffer(alloc_data &data)
+static void free_temp_buffer(copybit_context_t* ctx, alloc_data &data)
 {
     if (-1 != data.fd) {
+        release_buffer_mapping(ctx, data.fd, (uintptr_t)data.base);
         IMemAlloc* memalloc = sAlloc->getAllocator(data.allocType);
         memalloc->free_buffer(data.base, data.size, 0, data.fd);
+        data.fd = -1;
+        data.base = 0;
+        data.size = 0;
     }
 }
 
+/* A pooled buffer is reused for requests of up to twice its size */
+static bool temp_buffer_fits(const temp_buffer_t &buffer, unsigned int size)
+{
+    return (buffer.data.fd != -1) && (buffer.data.size >= size) &&
+           (buffer.data.size / 2 <= size);
+}
+
+/* Get a temp buffer for info from the pool, other than the one at exclude.
+ * The smallest fitting buffer is reused, else a new one is allocated in a
+ * free slot or in place of the least recently used buffer.
+ *
+ * @return: index of the buffer in the pool, -1 on failure */
+static int acquire_temp_buffer(copybit_context_t* ctx, const bufferInfo& info,
+                               int exclude)
+{
+    unsigned int size = ALIGN(get_size(info), TEMP_BUFFER_BUCKET_SIZE);
+    int index = -1;
+
+    for (int i = 0; i < MAX_TEMP_BUFFERS; i++) {
+        const temp_buffer_t &buffer = ctx->temp_buffers[i];
+        if (i == exclude || !temp_buffer_fits(buffer, size))
+            continue;
+        if (index == -1 || buffer.data.size < ctx->temp_buffers[index].data.size)
+            index = i;
+    }
+
+    if (index == -1) {
+        for (int i = 0; i < MAX_TEMP_BUFFERS; i++) {
+            const temp_buffer_t &buffer = ctx->temp_buffers[i];
+            if (i == exclude)
+                continue;
+            if (buffer.data.fd == -1) {
+                index = i;
+                break;
+            }
+            if (index == -1 || buffer.last_used < ctx->temp_buffers[index].last_used)
+                index = i;
+        }
+
+        free_temp_buffer(ctx, ctx->temp_buffers[index].data);
+        if (COPYBIT_SUCCESS != get_temp_buffer(info, ctx->temp_buffers[index].data)) {
+            ctx->temp_buffers[index].data.fd = -1;
+            return -1;
+        }
+        ctx->temp_buffer_allocs++;
+    }
+
+    if (index == ctx->temp_dst_index)
+        ctx->temp_dst_index = -1;
+    ctx->temp_buffers[index].last_used = ctx->draw_sequence;
+    return index;
+}
+
+/* Point hnd at the pooled temp buffer at index */
+static void set_temp_handle(copybit_context_t* ctx, int index,
+                            private_handle_t *hnd)
+{
+    const alloc_data &data = ctx->temp_buffers[index].data;
+    hnd->fd = data.fd;
+    hnd->size = data.size;
+    hnd->flags = data.allocType;
+    hnd->base = (uintptr_t)(data.base);
+    hnd->offset = data.offset;
+    hnd->gpuaddr = 0;
+}
+
 /* Function to perform the software color conversion. Convert the
  * C2D compatible format to the Android compatible format
  */
 static int copy_image(private_handle_t *src_handle,
                       struct copybit_image_t const *rhs,
-                      eConversionType conversionType)
+                      eConversionType conversionType,
+                      struct copybit_rect_t const *rect)
 {
     if (src_handle->fd == -1) {
         ALOGE("%s: src_handle fd is invalid", __FUNCTION__);
@@ -1050,9 +1295,9 @@ static int copy_image(private_handle_t *src_handle,
         case HAL_PIXEL_FORMAT_YCrCb_420_SP:
             {
                 if (CONVERT_TO_ANDROID_FORMAT == conversionType) {
-                    return convert_yuv_c2d_to_yuv_android(src_handle, rhs);
+                    return convert_yuv_c2d_to_yuv_android(src_handle, rhs, rect);
                 } else {
-                    return convert_yuv_android_to_yuv_c2d(src_handle, rhs);
+                    return convert_yuv_android_to_yuv_c2d(src_handle, rhs, rect);
                 }
 
             } break;
@@ -1064,13 +1309,6 @@ static int copy_image(private_handle_t *src_handle,
     return ret;
 }
 
-static void delete_handle(private_handle_t *handle)
-{
-    if (handle) {
-        delete handle;
-        handle = 0;
-    }
-}
 
 static bool need_to_execute_draw(eC2DFlags flags)
 {
@@ -1097,7 +1335,6 @@ static int stretch_copybit_internal(
     int status = COPYBIT_SUCCESS;
     int flags = 0;
     int src_surface_type;
-    int mapped_src_idx = -1, mapped_dst_idx = -1;
     C2D_OBJECT_STR src_surface;
 
     if (!ctx) {
@@ -1173,38 +1410,34 @@ static int stretch_copybit_internal(
     bool need_temp_dst = need_temp_buffer(dst);
     bufferInfo dst_info;
     populate_buffer_info(dst, dst_info);
-    private_handle_t* dst_hnd = new private_handle_t(-1, 0, 0, 0, dst_info.format,
-                                                     dst_info.width, dst_info.height);
-    if (dst_hnd == NULL) {
-        ALOGE("%s: dst_hnd is null", __FUNCTION__);
-        return COPYBIT_FAILURE;
-    }
+    private_handle_t dst_temp_hnd(-1, 0, 0, 0, dst_info.format,
+                                  dst_info.width, dst_info.height);
+    private_handle_t* dst_hnd = &dst_temp_hnd;
+    int temp_dst_index = -1;
     if (need_temp_dst) {
-        if (get_size(dst_info) != (int) ctx->temp_dst_buffer.size) {
-            free_temp_buffer(ctx->temp_dst_buffer);
-            // Create a temp buffer and set that as the destination.
-            if (COPYBIT_FAILURE == get_temp_buffer(dst_info, ctx->temp_dst_buffer)) {
+        // Keep drawing into the same temp buffer while the destination size
+        // holds, it carries the layers blit so far.
+        temp_dst_index = ctx->temp_dst_index;
+        if (temp_dst_index == -1 ||
+            !temp_buffer_fits(ctx->temp_buffers[temp_dst_index],
+                              ALIGN(get_size(dst_info), TEMP_BUFFER_BUCKET_SIZE))) {
+            temp_dst_index = acquire_temp_buffer(ctx, dst_info, -1);
+            ctx->temp_dst_index = temp_dst_index;
+            if (temp_dst_index == -1) {
                 ALOGE("%s: get_temp_buffer(dst) failed", __FUNCTION__);
-                delete_handle(dst_hnd);
                 return COPYBIT_FAILURE;
             }
         }
-        dst_hnd->fd = ctx->temp_dst_buffer.fd;
-        dst_hnd->size = ctx->temp_dst_buffer.size;
-        dst_hnd->flags = ctx->temp_dst_buffer.allocType;
-        dst_hnd->base = (uintptr_t)(ctx->temp_dst_buffer.base);
-        dst_hnd->offset = ctx->temp_dst_buffer.offset;
-        dst_hnd->gpuaddr = 0;
+        ctx->temp_buffers[temp_dst_index].last_used = ctx->draw_sequence;
+        set_temp_handle(ctx, temp_dst_index, dst_hnd);
         dst_image.handle = dst_hnd;
     }
     if(!ctx->dst_surface_mapped) {
         //map the destination surface to GPU address
         status = set_image(ctx, ctx->dst[ctx->dst_surface_type], &dst_image,
-                           (eC2DFlags)flags, mapped_dst_idx);
+                           (eC2DFlags)flags);
         if(status) {
             ALOGE("%s: dst: set_image error", __FUNCTION__);
-            delete_handle(dst_hnd);
-            unmap_gpuaddr(ctx, mapped_dst_idx);
             return COPYBIT_FAILURE;
         }
         ctx->dst_surface_mapped = true;
@@ -1232,15 +1465,11 @@ static int stretch_copybit_internal(
         } else {
             ALOGE("%s: src number of YUV planes is invalid src format = 0x%x",
                   __FUNCTION__, src->format);
-            delete_handle(dst_hnd);
-            unmap_gpuaddr(ctx, mapped_dst_idx);
             return -EINVAL;
         }
     } else {
         ALOGE("%s: Invalid source surface format 0x%x", __FUNCTION__,
                                                         src->format);
-        delete_handle(dst_hnd);
-        unmap_gpuaddr(ctx, mapped_dst_idx);
         return -EINVAL;
     }
 
@@ -1253,43 +1482,23 @@ static int stretch_copybit_internal(
     bool need_temp_src = need_temp_buffer(src);
     bufferInfo src_info;
     populate_buffer_info(src, src_info);
-    private_handle_t* src_hnd = new private_handle_t(-1, 0, 0, 0, src_info.format,
-                                                 src_info.width, src_info.height);
-    if (NULL == src_hnd) {
-        ALOGE("%s: src_hnd is null", __FUNCTION__);
-        delete_handle(dst_hnd);
-        unmap_gpuaddr(ctx, mapped_dst_idx);
-        return COPYBIT_FAILURE;
-    }
+    private_handle_t src_temp_hnd(-1, 0, 0, 0, src_info.format,
+                                  src_info.width, src_info.height);
+    private_handle_t* src_hnd = &src_temp_hnd;
     if (need_temp_src) {
-        if (get_size(src_info) != (int) ctx->temp_src_buffer.size) {
-            free_temp_buffer(ctx->temp_src_buffer);
-            // Create a temp buffer and set that as the destination.
-            if (COPYBIT_SUCCESS != get_temp_buffer(src_info,
-                                               ctx->temp_src_buffer)) {
-                ALOGE("%s: get_temp_buffer(src) failed", __FUNCTION__);
-                delete_handle(dst_hnd);
-                delete_handle(src_hnd);
-                unmap_gpuaddr(ctx, mapped_dst_idx);
-                return COPYBIT_FAILURE;
-            }
+        int temp_src_index = acquire_temp_buffer(ctx, src_info, temp_dst_index);
+        if (temp_src_index == -1) {
+            ALOGE("%s: get_temp_buffer(src) failed", __FUNCTION__);
+            return COPYBIT_FAILURE;
         }
-        src_hnd->fd = ctx->temp_src_buffer.fd;
-        src_hnd->size = ctx->temp_src_buffer.size;
-        src_hnd->flags = ctx->temp_src_buffer.allocType;
-        src_hnd->base = (uintptr_t)(ctx->temp_src_buffer.base);
-        src_hnd->offset = ctx->temp_src_buffer.offset;
-        src_hnd->gpuaddr = 0;
+        set_temp_handle(ctx, temp_src_index, src_hnd);
         src_image.handle = src_hnd;
 
         // Copy the source.
         status = copy_image((private_handle_t *)src->handle, &src_image,
-                                CONVERT_TO_C2D_FORMAT);
+                                CONVERT_TO_C2D_FORMAT, NULL);
         if (status == COPYBIT_FAILURE) {
             ALOGE("%s:copy_image failed in temp source",__FUNCTION__);
-            delete_handle(dst_hnd);
-            delete_handle(src_hnd);
-            unmap_gpuaddr(ctx, mapped_dst_idx);
             return status;
         }
 
@@ -1299,9 +1508,6 @@ static int stretch_copybit_internal(
                                    src_hnd->offset, src_hnd->fd,
                                    gralloc::CACHE_CLEAN)) {
             ALOGE("%s: clean_buffer failed", __FUNCTION__);
-            delete_handle(dst_hnd);
-            delete_handle(src_hnd);
-            unmap_gpuaddr(ctx, mapped_dst_idx);
             return COPYBIT_FAILURE;
         }
     }
@@ -1310,13 +1516,9 @@ static int stretch_copybit_internal(
     flags |= (ctx->dst_surface_type != RGB_SURFACE) ? FLAGS_YUV_DESTINATION : 0;
     flags |= (ctx->is_src_ubwc_format) ? FLAGS_UBWC_FORMAT_MODE : 0;
     status = set_image(ctx, src_surface.surface_id, &src_image,
-                       (eC2DFlags)flags, mapped_src_idx);
+                       (eC2DFlags)flags);
     if(status) {
         ALOGE("%s: set_image (src) error", __FUNCTION__);
-        delete_handle(dst_hnd);
-        delete_handle(src_hnd);
-        unmap_gpuaddr(ctx, mapped_dst_idx);
-        unmap_gpuaddr(ctx, mapped_src_idx);
         return COPYBIT_FAILURE;
     }
 
@@ -1327,10 +1529,6 @@ static int stretch_copybit_internal(
             src_surface.config_mask &= ~C2D_ALPHA_BLEND_NONE;
             if(!(src_surface.global_alpha)) {
                 // src alpha is zero
-                delete_handle(dst_hnd);
-                delete_handle(src_hnd);
-                unmap_gpuaddr(ctx, mapped_dst_idx);
-                unmap_gpuaddr(ctx, mapped_src_idx);
                 return COPYBIT_FAILURE;
             }
         }
@@ -1350,7 +1548,13 @@ static int stretch_copybit_internal(
     }
 
     struct copybit_rect_t clip;
+    // Bounds of the destination pixels written by this blit
+    struct copybit_rect_t dirty = { dst_rect->r, dst_rect->b, dst_rect->l, dst_rect->t };
     while ((status == 0) && region->next(region, &clip)) {
+        dirty.l = std::min(dirty.l, std::max(clip.l, dst_rect->l));
+        dirty.t = std::min(dirty.t, std::max(clip.t, dst_rect->t));
+        dirty.r = std::max(dirty.r, std::min(clip.r, dst_rect->r));
+        dirty.b = std::max(dirty.b, std::min(clip.b, dst_rect->b));
         set_rects(ctx, &(src_surface), dst_rect, src_rect, &clip);
         if (ctx->blit_count == MAX_BLIT_OBJECT_COUNT) {
             ALOGW("Reached end of blit count");
@@ -1369,14 +1573,12 @@ static int stretch_copybit_internal(
 
     if (need_temp_dst) {
         // copy the temp. destination without the alignment to the actual
-        // destination.
-        status = copy_image(dst_hnd, dst, CONVERT_TO_ANDROID_FORMAT);
+        // destination, only where the blit has drawn. A rotated target
+        // lays the rect out differently, copy all of it then.
+        status = copy_image(dst_hnd, dst, CONVERT_TO_ANDROID_FORMAT,
+                            ctx->trg_transform ? NULL : &dirty);
         if (status == COPYBIT_FAILURE) {
             ALOGE("%s:copy_image failed in temp Dest",__FUNCTION__);
-            delete_handle(dst_hnd);
-            delete_handle(src_hnd);
-            unmap_gpuaddr(ctx, mapped_dst_idx);
-            unmap_gpuaddr(ctx, mapped_src_idx);
             return status;
         }
         // Clean the cache.
@@ -1385,8 +1587,6 @@ static int stretch_copybit_internal(
                                dst_hnd->offset, dst_hnd->fd,
                                gralloc::CACHE_CLEAN);
     }
-    delete_handle(dst_hnd);
-    delete_handle(src_hnd);
 
     ctx->is_premultiplied_alpha = false;
     ctx->fb_width = 0;
@@ -1452,6 +1652,44 @@ static int fill_color(struct copybit_device_t *dev,
     return -EINVAL;
 }
 
+static void dump_copybit(struct copybit_device_t *dev, char *buff, int buff_len)
+{
+    struct copybit_context_t* ctx = (struct copybit_context_t*)dev;
+    if (!ctx || !buff || buff_len <= 0)
+        return;
+
+    pthread_mutex_lock(&ctx->wait_cleanup_lock);
+    int num_mappings = 0;
+    for (int i = 0; i < MAX_MAPPED_BUFFERS; i++) {
+        if (ctx->gpu_mappings[i].gpuaddr)
+            num_mappings++;
+    }
+    uint64_t lookups = ctx->mapping_hits + ctx->mapping_misses;
+    snprintf(buff, (size_t)buff_len,
+             "Copybit C2D GPU mappings: %d/%d (%zu KB) hits %llu misses %llu "
+             "evictions %llu hit rate %llu%%\n",
+             num_mappings, MAX_MAPPED_BUFFERS, ctx->mapped_bytes / 1024,
+             (unsigned long long)ctx->mapping_hits,
+             (unsigned long long)ctx->mapping_misses,
+             (unsigned long long)ctx->mapping_evictions,
+             (unsigned long long)(lookups ? (ctx->mapping_hits * 100 / lookups) : 0));
+
+    int num_temp_buffers = 0;
+    size_t temp_bytes = 0;
+    for (int i = 0; i < MAX_TEMP_BUFFERS; i++) {
+        if (ctx->temp_buffers[i].data.fd != -1) {
+            num_temp_buffers++;
+            temp_bytes += ctx->temp_buffers[i].data.size;
+        }
+    }
+    size_t filled = strlen(buff);
+    snprintf(buff + filled, (size_t)buff_len - filled,
+             "Copybit C2D temp buffers: %d/%d (%zu KB) allocations %llu\n",
+             num_temp_buffers, MAX_TEMP_BUFFERS, temp_bytes / 1024,
+             (unsigned long long)ctx->temp_buffer_allocs);
+    pthread_mutex_unlock(&ctx->wait_cleanup_lock);
+}
+
 /*****************************************************************************/
 
 static void clean_up(copybit_context_t* ctx)
@@ -1460,16 +1698,18 @@ static void clean_up(copybit_context_t* ctx)
     if (!ctx)
         return;
 
-    // stop the wait_cleanup_thread
-    pthread_mutex_lock(&ctx->wait_cleanup_lock);
-    ctx->stop_thread = true;
-    // Signal waiting thread
-    pthread_cond_signal(&ctx->wait_cleanup_cond);
-    pthread_mutex_unlock(&ctx->wait_cleanup_lock);
-    // waits for the cleanup thread to exit
-    pthread_join(ctx->wait_thread_id, &ret);
-    pthread_mutex_destroy(&ctx->wait_cleanup_lock);
-    pthread_cond_destroy (&ctx->wait_cleanup_cond);
+    // stop the wait_cleanup_thread, open fails before starting it
+    if (ctx->wait_thread_id) {
+        pthread_mutex_lock(&ctx->wait_cleanup_lock);
+        ctx->stop_thread = true;
+        // Signal waiting thread
+        pthread_cond_signal(&ctx->wait_cleanup_cond);
+        pthread_mutex_unlock(&ctx->wait_cleanup_lock);
+        // waits for the cleanup thread to exit
+        pthread_join(ctx->wait_thread_id, &ret);
+        pthread_mutex_destroy(&ctx->wait_cleanup_lock);
+        pthread_cond_destroy (&ctx->wait_cleanup_cond);
+    }
 
     for (int i = 0; i < NUM_SURFACE_TYPES; i++) {
         if (ctx->dst[i])
@@ -1492,10 +1732,15 @@ static void clean_up(copybit_context_t* ctx)
     }
 
     if (ctx->libc2d2) {
+        if (LINK_c2dUnMapAddr)
+            unmap_all_mappings(ctx);
         ::dlclose(ctx->libc2d2);
         ALOGV("dlclose(libc2d2)");
     }
 
+    if (ctx->ion_fd >= 0)
+        close(ctx->ion_fd);
+
     free(ctx);
 }
 
@@ -1504,8 +1749,8 @@ static int close_copybit(struct hw_device_t *dev)
 {
     struct copybit_context_t* ctx = (struct copybit_context_t*)dev;
     if (ctx) {
-        free_temp_buffer(ctx->temp_src_buffer);
-        free_temp_buffer(ctx->temp_dst_buffer);
+        for (int i = 0; i < MAX_TEMP_BUFFERS; i++)
+            free_temp_buffer(ctx, ctx->temp_buffers[i].data);
     }
     clean_up(ctx);
     return 0;
@@ -1532,13 +1777,17 @@ static int open_copybit(const struct hw_module_t* module, const char* name,
 
     /* initialize drawstate */
     memset(ctx, 0, sizeof(*ctx));
+    ctx->ion_fd = open("/dev/ion", O_RDONLY);
+    if (ctx->ion_fd < 0) {
+        ALOGW("%s: failed to open /dev/ion, GPU mappings are matched by fd "
+              "and address only", __FUNCTION__);
+    }
     ctx->libc2d2 = ::dlopen("libC2D2.so", RTLD_NOW);
     if (!ctx->libc2d2) {
         ALOGE("FATAL ERROR: could not dlopen libc2d2.so: %s", dlerror());
         clean_up(ctx);
-        status = COPYBIT_FAILURE;
-        *device = NULL;
-        return status;
+        // Without the C2D driver, compose on the CPU instead
+        return open_copybit_sw(module, name, device);
     }
     *(void **)&LINK_c2dCreateSurface = ::dlsym(ctx->libc2d2,
                                                "c2dCreateSurface");
@@ -1571,9 +1820,7 @@ static int open_copybit(const struct hw_module_t* module, const char* name,
         !LINK_c2dFillSurface) {
         ALOGE("%s: dlsym ERROR", __FUNCTION__);
         clean_up(ctx);
-        status = COPYBIT_FAILURE;
-        *device = NULL;
-        return status;
+        return open_copybit_sw(module, name, device);
     }
 
     ctx->device.common.tag = HARDWARE_DEVICE_TAG;
@@ -1589,6 +1836,8 @@ static int open_copybit(const struct hw_module_t* module, const char* name,
     ctx->device.flush_get_fence = flush_get_fence_copybit;
     ctx->device.clear = clear_copybit;
     ctx->device.fill_color = fill_color;
+    ctx->device.dump = dump_copybit;
+    ctx->draw_sequence = 1;
 
     /* Create RGB Surface */
     surfDefinition.buffer = (void*)0xdddddddd;
@@ -1742,13 +1991,12 @@ static int open_copybit(const struct hw_module_t* module, const char* name,
     // Initialize context variables.
     ctx->trg_transform = C2D_TARGET_ROTATE_0;
 
-    ctx->temp_src_buffer.fd = -1;
-    ctx->temp_src_buffer.base = 0;
-    ctx->temp_src_buffer.size = 0;
-
-    ctx->temp_dst_buffer.fd = -1;
-    ctx->temp_dst_buffer.base = 0;
-    ctx->temp_dst_buffer.size = 0;
+    for (int i = 0; i < MAX_TEMP_BUFFERS; i++) {
+        ctx->temp_buffers[i].data.fd = -1;
+        ctx->temp_buffers[i].data.base = 0;
+        ctx->temp_buffers[i].data.size = 0;
+    }
+    ctx->temp_dst_index = -1;
 
     ctx->fb_width = 0;
     ctx->fb_height = 0;
@@ -0,0 +1,926 @@
+/*
+ * Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cutils/log.h>
+#include <sys/resource.h>
+#include <sys/prctl.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <algorithm>
+
+#include <sync/sync.h>
+#include <copybit.h>
+#include <gralloc_priv.h>
+#include <gr.h>
+
+#include "pixel_convert.h"
+#include "copybit_sw.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define COPYBIT_SW_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define COPYBIT_SW_SSE2 1
+#endif
+
+#define COPYBIT_SUCCESS 0
+#define COPYBIT_FAILURE -1
+
+#define MAX_SCALE_FACTOR     (4096)
+#define MAX_DIMENSION        (4096)
+#define MAX_WORKERS          (3)
+// Blits smaller than this are not worth waking the workers up for
+#define MIN_PARALLEL_PIXELS  (64 * 1024)
+
+/******************************************************************************/
+
+/** Pixels of one image as seen by the software blitter */
+struct sw_surface {
+    int format;
+    int width;             // Addressable pixels per row
+    int height;            // Addressable rows
+    uint8_t *base;         // First pixel of an RGB image, luma plane of YUV
+    uint32_t stride;       // Bytes per row of the RGB image or luma plane
+    uint8_t *cb;           // Chroma planes of YUV
+    uint8_t *cr;
+    uint32_t cstride;      // Bytes per chroma row
+    uint32_t chroma_step;  // Bytes between two chroma samples of a row
+};
+
+/** One draw, split in bands of rows over the worker threads */
+struct sw_blit {
+    sw_surface src;
+    sw_surface dst;
+    copybit_rect_t rect;   // Destination pixels to write
+    // Source position of the first pixel of rect and its steps per
+    // destination pixel, all in 16.16 fixed point
+    int64_t sx, sy;
+    int64_t sx_dx, sy_dx;
+    int64_t sx_dy, sy_dy;
+    copybit_rect_t src_clamp;
+    int blending;          // COPYBIT_BLENDING_xxx
+    uint32_t plane_alpha;
+    bool fill;             // Write color instead of sampling src
+    uint32_t color;
+};
+
+struct copybit_sw_context_t;
+
+struct sw_worker {
+    struct copybit_sw_context_t *ctx;
+    pthread_t thread;
+    int index;
+};
+
+/** State information for each device instance */
+struct copybit_sw_context_t {
+    struct copybit_device_t device;
+    pthread_mutex_t lock;        // Serializes the copybit calls
+    int transform;
+    int blend_mode;
+    int plane_alpha;
+    int acquire_fence;
+
+    // Workers sleep on job_cond until job_generation moves, each then
+    // draws its band of job and the last one to finish signals done_cond
+    sw_worker workers[MAX_WORKERS];
+    int num_workers;
+    pthread_mutex_t job_lock;
+    pthread_cond_t job_cond;
+    pthread_cond_t done_cond;
+    const sw_blit *job;
+    uint32_t job_generation;
+    int job_pending;
+    bool stop_workers;
+};
+
+/******************************************************************************/
+
+static inline int clamp_int(int value, int lo, int hi) {
+    return (value < lo) ? lo : ((value > hi) ? hi : value);
+}
+
+static inline uint8_t clamp_u8(int value) {
+    return (uint8_t)clamp_int(value, 0, 255);
+}
+
+/* x / 255 rounded, exact for every product of two 8 bit values */
+static inline uint32_t div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static inline uint32_t pack_rgba(uint32_t r, uint32_t g, uint32_t b,
+                                 uint32_t a) {
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+/* BT.601 limited range YCbCr to RGBA_8888 */
+static inline uint32_t yuv_to_rgba(int y, int cb, int cr) {
+    int c = 298 * (y - 16) + 128;
+    int d = cb - 128;
+    int e = cr - 128;
+    return pack_rgba(clamp_u8((c + 409 * e) >> 8),
+                     clamp_u8((c - 100 * d - 208 * e) >> 8),
+                     clamp_u8((c + 516 * d) >> 8), 0xff);
+}
+
+static int get_rgb_bpp(int format) {
+    switch (format) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+            return 4;
+        case HAL_PIXEL_FORMAT_RGB_888:
+            return 3;
+        case HAL_PIXEL_FORMAT_RGB_565:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+static bool is_supported_yuv_format(int format) {
+    switch (format) {
+        case HAL_PIXEL_FORMAT_YCbCr_420_SP:
+        case HAL_PIXEL_FORMAT_YCrCb_420_SP:
+        case HAL_PIXEL_FORMAT_NV12_ENCODEABLE:
+        case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS:
+        case HAL_PIXEL_FORMAT_YCrCb_420_SP_VENUS:
+        case HAL_PIXEL_FORMAT_YV12:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* Describe the pixels of img, YUV only as a source */
+static int set_surface(struct copybit_image_t const *img, sw_surface *surface,
+                       bool is_source) {
+    private_handle_t *hnd = (private_handle_t *)img->handle;
+    memset(surface, 0, sizeof(*surface));
+    surface->format = img->format;
+    surface->width = (int)(img->w - img->horiz_padding);
+    surface->height = (int)img->h;
+    surface->base = hnd ? (uint8_t *)hnd->base : (uint8_t *)img->base;
+
+    if (hnd && (hnd->flags & private_handle_t::PRIV_FLAGS_UBWC_ALIGNED)) {
+        ALOGE("%s: UBWC buffers are not supported", __FUNCTION__);
+        return -EINVAL;
+    }
+
+    if (!surface->base) {
+        ALOGE("%s: image is not mapped", __FUNCTION__);
+        return -EINVAL;
+    }
+
+    int bpp = get_rgb_bpp(img->format);
+    if (bpp) {
+        // The handle holds the aligned dimensions, which bound the memory
+        uint32_t stride_pixels = hnd ? (uint32_t)hnd->width : img->w;
+        surface->stride = stride_pixels * (uint32_t)bpp;
+        if (hnd) {
+            surface->width = std::min(surface->width, hnd->width);
+            surface->height = std::min(surface->height, hnd->height);
+        }
+        return COPYBIT_SUCCESS;
+    }
+
+    if (is_source && hnd && is_supported_yuv_format(img->format)) {
+        struct android_ycbcr ycbcr;
+        if (getYUVPlaneInfo(hnd, &ycbcr)) {
+            return -EINVAL;
+        }
+        surface->base = (uint8_t *)ycbcr.y;
+        surface->cb = (uint8_t *)ycbcr.cb;
+        surface->cr = (uint8_t *)ycbcr.cr;
+        surface->stride = (uint32_t)ycbcr.ystride;
+        surface->cstride = (uint32_t)ycbcr.cstride;
+        surface->chroma_step = (uint32_t)ycbcr.chroma_step;
+        surface->width = std::min(surface->width, hnd->width);
+        surface->height = std::min(surface->height, hnd->height);
+        return COPYBIT_SUCCESS;
+    }
+
+    ALOGE("%s: unsupported %s format 0x%x", __FUNCTION__,
+          is_source ? "source" : "destination", img->format);
+    return -EINVAL;
+}
+
+/* Convert count pixels of a row to RGBA_8888 */
+static void load_pixels(const sw_surface &surface, const uint8_t *row,
+                        int count, uint32_t *out) {
+    size_t n = (size_t)count;
+    switch (surface.format) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+            memcpy(out, row, n * 4);
+            break;
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+            memcpy(out, row, n * 4);
+            for (size_t i = 0; i < n; i++) {
+                out[i] |= 0xff000000;
+            }
+            break;
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+            for (size_t i = 0; i < n; i++) {
+                const uint8_t *p = row + 4 * i;
+                out[i] = pack_rgba(p[2], p[1], p[0], p[3]);
+            }
+            break;
+        case HAL_PIXEL_FORMAT_RGB_888:
+            qdutils::convertRGB888ToRGBA8888((uint8_t *)out, row, n);
+            break;
+        case HAL_PIXEL_FORMAT_RGB_565:
+            qdutils::convertRGB565ToRGBA8888((uint8_t *)out,
+                                             (const uint16_t *)row, n);
+            break;
+    }
+}
+
+/* Convert count RGBA_8888 pixels into a row of the surface format */
+static void store_pixels(const sw_surface &surface, const uint32_t *in,
+                         int count, uint8_t *row) {
+    size_t n = (size_t)count;
+    switch (surface.format) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+            if ((const void *)in != (const void *)row) {
+                memcpy(row, in, n * 4);
+            }
+            break;
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+            for (size_t i = 0; i < n; i++) {
+                uint8_t *p = row + 4 * i;
+                p[0] = (uint8_t)(in[i] >> 16);
+                p[1] = (uint8_t)(in[i] >> 8);
+                p[2] = (uint8_t)in[i];
+                p[3] = (uint8_t)(in[i] >> 24);
+            }
+            break;
+        case HAL_PIXEL_FORMAT_RGB_888:
+            qdutils::convertRGBA8888ToRGB888(row, (const uint8_t *)in, n);
+            break;
+        case HAL_PIXEL_FORMAT_RGB_565:
+            qdutils::convertRGBA8888ToRGB565((uint16_t *)row,
+                                             (const uint8_t *)in, n);
+            break;
+    }
+}
+
+/* Sample count source pixels for the destination row y starting at x */
+static void fetch_row(const sw_blit &blit, int x, int y, int count,
+                      uint32_t *out) {
+    const sw_surface &src = blit.src;
+    int64_t fx = blit.sx + (x - blit.rect.l) * blit.sx_dx +
+                 (y - blit.rect.t) * blit.sx_dy;
+    int64_t fy = blit.sy + (x - blit.rect.l) * blit.sy_dx +
+                 (y - blit.rect.t) * blit.sy_dy;
+    const copybit_rect_t &c = blit.src_clamp;
+    int bpp = get_rgb_bpp(src.format);
+
+    // Unscaled and unrotated rows are contiguous in the source
+    if (bpp && blit.sx_dx == (1 << 16) && blit.sy_dx == 0) {
+        int ix = (int)(fx >> 16);
+        int iy = clamp_int((int)(fy >> 16), c.t, c.b - 1);
+        if (ix >= c.l && ix + count <= c.r) {
+            load_pixels(src, src.base + (size_t)iy * src.stride +
+                        (size_t)ix * (size_t)bpp, count, out);
+            return;
+        }
+    }
+
+    if (bpp) {
+        for (int i = 0; i < count; i++) {
+            int ix = clamp_int((int)(fx >> 16), c.l, c.r - 1);
+            int iy = clamp_int((int)(fy >> 16), c.t, c.b - 1);
+            load_pixels(src, src.base + (size_t)iy * src.stride +
+                        (size_t)ix * (size_t)bpp, 1, out + i);
+            fx += blit.sx_dx;
+            fy += blit.sy_dx;
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int ix = clamp_int((int)(fx >> 16), c.l, c.r - 1);
+        int iy = clamp_int((int)(fy >> 16), c.t, c.b - 1);
+        size_t coffset = (size_t)(iy / 2) * src.cstride +
+                         (size_t)(ix / 2) * src.chroma_step;
+        out[i] = yuv_to_rgba(src.base[(size_t)iy * src.stride + (size_t)ix],
+                             src.cb[coffset], src.cr[coffset]);
+        fx += blit.sx_dx;
+        fy += blit.sy_dx;
+    }
+}
+
+/* Blend count RGBA_8888 pixels of src over dst. The color factor of the
+ * source is the plane alpha for premultiplied sources and the effective
+ * alpha otherwise, the alpha channel always uses the plane alpha. */
+static void blend_row(uint32_t *dst, const uint32_t *src, int count,
+                      uint32_t plane_alpha, bool premultiplied) {
+    int i = 0;
+#if defined(COPYBIT_SW_NEON)
+    const uint8x8_t pa = vdup_n_u8((uint8_t)plane_alpha);
+    const uint16x8_t round = vdupq_n_u16(128);
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t *)(src + i));
+        uint8x8x4_t d = vld4_u8((const uint8_t *)(dst + i));
+        uint16x8_t t = vaddq_u16(vmull_u8(s.val[3], pa), round);
+        uint8x8_t ea = vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+        uint8x8_t inv = vmvn_u8(ea);
+        uint8x8_t factor = premultiplied ? pa : ea;
+        for (int c = 0; c < 4; c++) {
+            uint16x8_t a = vaddq_u16(vmull_u8(s.val[c], (c == 3) ? pa : factor),
+                                     round);
+            uint16x8_t b = vaddq_u16(vmull_u8(d.val[c], inv), round);
+            d.val[c] = vqadd_u8(vshrn_n_u16(vaddq_u16(a, vshrq_n_u16(a, 8)), 8),
+                                vshrn_n_u16(vaddq_u16(b, vshrq_n_u16(b, 8)), 8));
+        }
+        vst4_u8((uint8_t *)(dst + i), d);
+    }
+#elif defined(COPYBIT_SW_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(128);
+    const __m128i max = _mm_set1_epi16(255);
+    const __m128i pa = _mm_set1_epi16((short)plane_alpha);
+    // Lanes of the color channels, the alpha channel is the fourth of each pixel
+    const __m128i color_lanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    for (; i + 4 <= count; i += 4) {
+        __m128i s8 = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d8 = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i out[2];
+        for (int h = 0; h < 2; h++) {
+            __m128i s = h ? _mm_unpackhi_epi8(s8, zero) : _mm_unpacklo_epi8(s8, zero);
+            __m128i d = h ? _mm_unpackhi_epi8(d8, zero) : _mm_unpacklo_epi8(d8, zero);
+            __m128i sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(sa, pa), round);
+            __m128i ea = _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+            __m128i factor = premultiplied ? pa :
+                    _mm_or_si128(_mm_and_si128(color_lanes, ea),
+                                 _mm_andnot_si128(color_lanes, pa));
+            __m128i a = _mm_add_epi16(_mm_mullo_epi16(s, factor), round);
+            __m128i b = _mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(max, ea)), round);
+            a = _mm_srli_epi16(_mm_add_epi16(a, _mm_srli_epi16(a, 8)), 8);
+            b = _mm_srli_epi16(_mm_add_epi16(b, _mm_srli_epi16(b, 8)), 8);
+            out[h] = _mm_add_epi16(a, b);
+        }
+        // The saturating pack clamps sums of non premultiplied color
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(out[0], out[1]));
+    }
+#endif
+    for (; i < count; i++) {
+        uint32_t s = src[i];
+        uint32_t d = dst[i];
+        uint32_t ea = div255((s >> 24) * plane_alpha);
+        uint32_t factor = premultiplied ? plane_alpha : ea;
+        uint32_t result = 0;
+        for (int c = 0; c < 32; c += 8) {
+            uint32_t sc = (s >> c) & 0xff;
+            uint32_t dc = (d >> c) & 0xff;
+            uint32_t value = div255(sc * ((c == 24) ? plane_alpha : factor)) +
+                             div255(dc * (255 - ea));
+            result |= ((value > 255) ? 255 : value) << c;
+        }
+        dst[i] = result;
+    }
+}
+
+/* Draw the rows of band out of num_bands of the blit */
+static void draw_band(const sw_blit &blit, int band, int num_bands) {
+    int rows = blit.rect.b - blit.rect.t;
+    int top = blit.rect.t + rows * band / num_bands;
+    int bottom = blit.rect.t + rows * (band + 1) / num_bands;
+    int width = blit.rect.r - blit.rect.l;
+    int bpp = get_rgb_bpp(blit.dst.format);
+    bool direct = (blit.dst.format == HAL_PIXEL_FORMAT_RGBA_8888 ||
+                   blit.dst.format == HAL_PIXEL_FORMAT_RGBX_8888);
+    uint32_t src_row[MAX_DIMENSION];
+    uint32_t dst_row[MAX_DIMENSION];
+
+    for (int y = top; y < bottom; y++) {
+        uint8_t *row = blit.dst.base + (size_t)y * blit.dst.stride +
+                       (size_t)blit.rect.l * (size_t)bpp;
+
+        if (blit.fill) {
+            for (int i = 0; i < width; i++) {
+                src_row[i] = blit.color;
+            }
+            store_pixels(blit.dst, src_row, width, row);
+            continue;
+        }
+
+        fetch_row(blit, blit.rect.l, y, width, src_row);
+        if (blit.blending == COPYBIT_BLENDING_NONE) {
+            store_pixels(blit.dst, src_row, width, row);
+            continue;
+        }
+
+        // RGBA destinations are blended in place
+        uint32_t *target = direct ? (uint32_t *)row : dst_row;
+        if (!direct) {
+            load_pixels(blit.dst, row, width, dst_row);
+        }
+        blend_row(target, src_row, width, blit.plane_alpha,
+                  blit.blending == COPYBIT_BLENDING_PREMULT);
+        if (!direct) {
+            store_pixels(blit.dst, dst_row, width, row);
+        }
+    }
+}
+
+static void* sw_worker_loop(void *ptr) {
+    sw_worker *worker = (sw_worker *)ptr;
+    copybit_sw_context_t *ctx = worker->ctx;
+    char thread_name[64] = "copybitSwThr";
+    prctl(PR_SET_NAME, (unsigned long) &thread_name, 0, 0, 0);
+    setpriority(PRIO_PROCESS, 0, HAL_PRIORITY_URGENT_DISPLAY);
+
+    uint32_t generation = 0;
+    pthread_mutex_lock(&ctx->job_lock);
+    while (true) {
+        while (ctx->job_generation == generation && !ctx->stop_workers) {
+            pthread_cond_wait(&ctx->job_cond, &ctx->job_lock);
+        }
+        if (ctx->stop_workers) {
+            break;
+        }
+        generation = ctx->job_generation;
+        const sw_blit *job = ctx->job;
+        pthread_mutex_unlock(&ctx->job_lock);
+
+        // The calling thread draws band 0
+        draw_band(*job, worker->index + 1, ctx->num_workers + 1);
+
+        pthread_mutex_lock(&ctx->job_lock);
+        if (--ctx->job_pending == 0) {
+            pthread_cond_signal(&ctx->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&ctx->job_lock);
+    return NULL;
+}
+
+/* Draw the blit, spread over the workers when it is large enough */
+static void run_blit(copybit_sw_context_t *ctx, const sw_blit &blit) {
+    int pixels = (blit.rect.r - blit.rect.l) * (blit.rect.b - blit.rect.t);
+    if (pixels <= 0) {
+        return;
+    }
+
+    if (!ctx->num_workers || pixels < MIN_PARALLEL_PIXELS) {
+        draw_band(blit, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&ctx->job_lock);
+    ctx->job = &blit;
+    ctx->job_pending = ctx->num_workers;
+    ctx->job_generation++;
+    pthread_cond_broadcast(&ctx->job_cond);
+    pthread_mutex_unlock(&ctx->job_lock);
+
+    draw_band(blit, 0, ctx->num_workers + 1);
+
+    pthread_mutex_lock(&ctx->job_lock);
+    while (ctx->job_pending) {
+        pthread_cond_wait(&ctx->done_cond, &ctx->job_lock);
+    }
+    ctx->job = NULL;
+    pthread_mutex_unlock(&ctx->job_lock);
+}
+
+static bool intersect(copybit_rect_t *out, const copybit_rect_t &a,
+                      const copybit_rect_t &b) {
+    out->l = std::max(a.l, b.l);
+    out->t = std::max(a.t, b.t);
+    out->r = std::min(a.r, b.r);
+    out->b = std::min(a.b, b.b);
+    return (out->l < out->r) && (out->t < out->b);
+}
+
+static void wait_acquire_fence(copybit_sw_context_t *ctx) {
+    // The fence stays owned by the caller, as with the hardware backends
+    if (ctx->acquire_fence >= 0) {
+        if (sync_wait(ctx->acquire_fence, 1000) < 0) {
+            ALOGE("%s: sync_wait error errno = %d", __FUNCTION__, errno);
+        }
+        ctx->acquire_fence = -1;
+    }
+}
+
+/* Source position, in 16.16 fixed point, sampled for the center of the
+ * destination pixel (x, y). The transform flips the source horizontally
+ * and vertically first and then rotates it by 90 degrees clockwise. */
+static void map_to_source(int transform, const copybit_rect_t &dst,
+                          const copybit_rect_t &src, int x, int y,
+                          int64_t *sx, int64_t *sy) {
+    double u = (x + 0.5 - dst.l) / (dst.r - dst.l);
+    double v = (y + 0.5 - dst.t) / (dst.b - dst.t);
+    if (transform & COPYBIT_TRANSFORM_ROT_90) {
+        double t = u;
+        u = v;
+        v = 1.0 - t;
+    }
+    if (transform & COPYBIT_TRANSFORM_FLIP_V) {
+        v = 1.0 - v;
+    }
+    if (transform & COPYBIT_TRANSFORM_FLIP_H) {
+        u = 1.0 - u;
+    }
+    *sx = (int64_t)((src.l + u * (src.r - src.l)) * 65536.0);
+    *sy = (int64_t)((src.t + v * (src.b - src.t)) * 65536.0);
+}
+
+/*****************************************************************************/
+
+/** Set a parameter to value */
+static int set_parameter_copybit(struct copybit_device_t *dev, int name,
+                                 int value)
+{
+    copybit_sw_context_t *ctx = (copybit_sw_context_t *)dev;
+    int status = COPYBIT_SUCCESS;
+    if (!ctx) {
+        ALOGE("%s: null context", __FUNCTION__);
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    switch(name) {
+        case COPYBIT_PLANE_ALPHA:
+            ctx->plane_alpha = clamp_int(value, 0, 255);
+            break;
+        case COPYBIT_BLEND_MODE:
+            ctx->blend_mode = value;
+            break;
+        case COPYBIT_TRANSFORM:
+            ctx->transform = value;
+            break;
+        case COPYBIT_FRAMEBUFFER_WIDTH:
+        case COPYBIT_FRAMEBUFFER_HEIGHT:
+        case COPYBIT_ROTATION_DEG:
+        case COPYBIT_DITHER:
+        case COPYBIT_BLUR:
+        case COPYBIT_BLIT_TO_FRAMEBUFFER:
+        case COPYBIT_SRC_FORMAT_MODE:
+        case COPYBIT_DST_FORMAT_MODE:
+        case COPYBIT_PURGE_MAPPINGS:
+            // Do nothing, UBWC buffers are rejected when blitting and the
+            // CPU path keeps no GPU mappings
+            break;
+        default:
+            ALOGE("%s: default case param=0x%x", __FUNCTION__, name);
+            status = -EINVAL;
+            break;
+    }
+    pthread_mutex_unlock(&ctx->lock);
+    return status;
+}
+
+/** Get a static info value */
+static int get(struct copybit_device_t *dev, int name)
+{
+    if (!dev) {
+        ALOGE("%s: null context error", __FUNCTION__);
+        return -EINVAL;
+    }
+
+    switch(name) {
+        case COPYBIT_MINIFICATION_LIMIT:
+        case COPYBIT_MAGNIFICATION_LIMIT:
+            return MAX_SCALE_FACTOR;
+        case COPYBIT_SCALING_FRAC_BITS:
+            return 16;
+        case COPYBIT_ROTATION_STEP_DEG:
+            return 90;
+        case COPYBIT_UBWC_SUPPORT:
+            return 0;
+        default:
+            ALOGE("%s: default case param=0x%x", __FUNCTION__, name);
+            return -EINVAL;
+    }
+}
+
+static int set_sync_copybit(struct copybit_device_t *dev, int acquireFenceFd)
+{
+    copybit_sw_context_t *ctx = (copybit_sw_context_t *)dev;
+    if (!ctx)
+        return -EINVAL;
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->acquire_fence = acquireFenceFd;
+    pthread_mutex_unlock(&ctx->lock);
+    return 0;
+}
+
+static int stretch_copybit_internal(copybit_sw_context_t *ctx,
+                                    struct copybit_image_t const *dst,
+                                    struct copybit_image_t const *src,
+                                    struct copybit_rect_t const *dst_rect,
+                                    struct copybit_rect_t const *src_rect,
+                                    struct copybit_region_t const *region,
+                                    bool enable_blend)
+{
+    if (src->w > MAX_DIMENSION || src->h > MAX_DIMENSION ||
+        dst->w > MAX_DIMENSION || dst->h > MAX_DIMENSION) {
+        ALOGE("%s: dimension error src %dx%d dst %dx%d", __FUNCTION__,
+              src->w, src->h, dst->w, dst->h);
+        return -EINVAL;
+    }
+
+    if (dst_rect->r <= dst_rect->l || dst_rect->b <= dst_rect->t ||
+        src_rect->r <= src_rect->l || src_rect->b <= src_rect->t) {
+        return COPYBIT_SUCCESS;
+    }
+
+    sw_blit blit;
+    memset(&blit, 0, sizeof(blit));
+    if (set_surface(src, &blit.src, true) || set_surface(dst, &blit.dst, false)) {
+        return -EINVAL;
+    }
+
+    copybit_rect_t src_bounds = { 0, 0, blit.src.width, blit.src.height };
+    copybit_rect_t dst_bounds = { 0, 0, blit.dst.width, blit.dst.height };
+    if (!intersect(&blit.src_clamp, *src_rect, src_bounds)) {
+        return COPYBIT_SUCCESS;
+    }
+
+    blit.plane_alpha = (uint32_t)ctx->plane_alpha;
+    blit.blending = enable_blend ? ctx->blend_mode : COPYBIT_BLENDING_NONE;
+    if (blit.blending != COPYBIT_BLENDING_NONE && !blit.plane_alpha) {
+        // Fully transparent, nothing to draw
+        return COPYBIT_SUCCESS;
+    }
+
+    int64_t x0, y0, x1, y1, x2, y2;
+    map_to_source(ctx->transform, *dst_rect, *src_rect, 0, 0, &x0, &y0);
+    map_to_source(ctx->transform, *dst_rect, *src_rect, 1, 0, &x1, &y1);
+    map_to_source(ctx->transform, *dst_rect, *src_rect, 0, 1, &x2, &y2);
+    blit.sx_dx = x1 - x0;
+    blit.sy_dx = y1 - y0;
+    blit.sx_dy = x2 - x0;
+    blit.sy_dy = y2 - y0;
+
+    wait_acquire_fence(ctx);
+
+    struct copybit_rect_t clip;
+    while (region->next(region, &clip)) {
+        copybit_rect_t rect;
+        if (!intersect(&rect, clip, *dst_rect) ||
+            !intersect(&blit.rect, rect, dst_bounds)) {
+            continue;
+        }
+        map_to_source(ctx->transform, *dst_rect, *src_rect, blit.rect.l,
+                      blit.rect.t, &blit.sx, &blit.sy);
+        run_blit(ctx, blit);
+    }
+
+    return COPYBIT_SUCCESS;
+}
+
+static int stretch_copybit(struct copybit_device_t *dev,
+                           struct copybit_image_t const *dst,
+                           struct copybit_image_t const *src,
+                           struct copybit_rect_t const *dst_rect,
+                           struct copybit_rect_t const *src_rect,
+                           struct copybit_region_t const *region)
+{
+    copybit_sw_context_t *ctx = (copybit_sw_context_t *)dev;
+    if (!ctx || !dst || !src || !dst_rect || !src_rect || !region)
+        return -EINVAL;
+
+    pthread_mutex_lock(&ctx->lock);
+    int status = stretch_copybit_internal(ctx, dst, src, dst_rect, src_rect,
+                                          region, true);
+    // Like C2D, the per layer state does not carry over to the next layer
+    ctx->transform = 0;
+    ctx->blend_mode = COPYBIT_BLENDING_COVERAGE;
+    pthread_mutex_unlock(&ctx->lock);
+    return status;
+}
+
+/** Perform a blit type operation */
+static int blit_copybit(struct copybit_device_t *dev,
+                        struct copybit_image_t const *dst,
+                        struct copybit_image_t const *src,
+                        struct copybit_region_t const *region)
+{
+    copybit_sw_context_t *ctx = (copybit_sw_context_t *)dev;
+    if (!ctx || !dst || !src || !region)
+        return -EINVAL;
+
+    struct copybit_rect_t dr = { 0, 0, (int)dst->w, (int)dst->h };
+    struct copybit_rect_t sr = { 0, 0, (int)src->w, (int)src->h };
+    pthread_mutex_lock(&ctx->lock);
+    int status = stretch_copybit_internal(ctx, dst, src, &dr, &sr, region,
+                                          false);
+    pthread_mutex_unlock(&ctx->lock);
+    return status;
+}
+
+static int fill_rect(copybit_sw_context_t *ctx,
+                     struct copybit_image_t const *dst,
+                     struct copybit_rect_t const *rect, uint32_t color)
+{
+    sw_blit blit;
+    memset(&blit, 0, sizeof(blit));
+    if (set_surface(dst, &blit.dst, false)) {
+        return -EINVAL;
+    }
+
+    copybit_rect_t dst_bounds = { 0, 0, blit.dst.width, blit.dst.height };
+    if (!intersect(&blit.rect, *rect, dst_bounds)) {
+        return COPYBIT_SUCCESS;
+    }
+
+    blit.fill = true;
+    blit.color = color;
+    wait_acquire_fence(ctx);
+    run_blit(ctx, blit);
+    return COPYBIT_SUCCESS;
+}
+
+/** Fill the rect on dst with RGBA color **/
+static int fill_color(struct copybit_device_t *dev,
+                      struct copybit_image_t const *dst,
+                      struct copybit_rect_t const *rect,
+                      uint32_t color)
+{
+    copybit_sw_context_t *ctx = (copybit_sw_context_t *)dev;
+    if (!ctx || !dst || !rect)
+        return -EINVAL;
+
+    pthread_mutex_lock(&ctx->lock);
+    int status = fill_rect(ctx, dst, rect, color);
+    pthread_mutex_unlock(&ctx->lock);
+    return status;
+}
+
+static int clear_copybit(struct copybit_device_t *dev,
+                         struct copybit_image_t const *buf,
+                         struct copybit_rect_t *rect)
+{
+    return fill_color(dev, buf, rect, 0);
+}
+
+static int finish_copybit(struct copybit_device_t *dev)
+{
+    // Every draw completes before its call returns
+    if (!dev)
+        return -EINVAL;
+
+    return 0;
+}
+
+static int flush_get_fence_copybit(struct copybit_device_t *dev, int* fd)
+{
+    if (!dev || !fd)
+        return -EINVAL;
+
+    // Nothing is pending on the CPU path, there is nothing to wait for
+    *fd = -1;
+    return 0;
+}
+
+/*****************************************************************************/
+
+/** Close the copybit device */
+static int close_copybit(struct hw_device_t *dev)
+{
+    copybit_sw_context_t *ctx = (copybit_sw_context_t *)dev;
+    if (!ctx)
+        return 0;
+
+    pthread_mutex_lock(&ctx->job_lock);
+    ctx->stop_workers = true;
+    pthread_cond_broadcast(&ctx->job_cond);
+    pthread_mutex_unlock(&ctx->job_lock);
+    for (int i = 0; i < ctx->num_workers; i++) {
+        pthread_join(ctx->workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&ctx->job_cond);
+    pthread_cond_destroy(&ctx->done_cond);
+    pthread_mutex_destroy(&ctx->job_lock);
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
+    return 0;
+}
+
+/** Open a new instance of a copybit device using name */
+int open_copybit_sw(const struct hw_module_t* module, const char* name,
+                    struct hw_device_t** device)
+{
+    if (strcmp(name, COPYBIT_HARDWARE_COPYBIT0)) {
+        return COPYBIT_FAILURE;
+    }
+
+    copybit_sw_context_t *ctx =
+            (copybit_sw_context_t *)malloc(sizeof(copybit_sw_context_t));
+    if (!ctx) {
+        ALOGE("%s: malloc failed", __FUNCTION__);
+        *device = NULL;
+        return COPYBIT_FAILURE;
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->device.common.tag = HARDWARE_DEVICE_TAG;
+    ctx->device.common.version = 1;
+    ctx->device.common.module = (hw_module_t*)(module);
+    ctx->device.common.close = close_copybit;
+    ctx->device.set_parameter = set_parameter_copybit;
+    ctx->device.get = get;
+    ctx->device.blit = blit_copybit;
+    ctx->device.set_sync = set_sync_copybit;
+    ctx->device.stretch = stretch_copybit;
+    ctx->device.finish = finish_copybit;
+    ctx->device.flush_get_fence = flush_get_fence_copybit;
+    ctx->device.clear = clear_copybit;
+    ctx->device.fill_color = fill_color;
+
+    ctx->plane_alpha = 255;
+    ctx->blend_mode = COPYBIT_BLENDING_COVERAGE;
+    ctx->acquire_fence = -1;
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_mutex_init(&ctx->job_lock, NULL);
+    pthread_cond_init(&ctx->job_cond, NULL);
+    pthread_cond_init(&ctx->done_cond, NULL);
+
+    // The calling thread takes a band as well, leave one core for the rest
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int num_workers = (int)std::min(std::max(cpus - 2, 0L), (long)MAX_WORKERS);
+    for (int i = 0; i < num_workers; i++) {
+        sw_worker *worker = &ctx->workers[ctx->num_workers];
+        worker->ctx = ctx;
+        worker->index = ctx->num_workers;
+        if (pthread_create(&worker->thread, NULL, sw_worker_loop, worker)) {
+            ALOGW("%s: failed to start worker %d", __FUNCTION__, i);
+            break;
+        }
+        ctx->num_workers++;
+    }
+
+    ALOGI("%s: software copybit with %d worker threads", __FUNCTION__,
+          ctx->num_workers);
+    *device = &ctx->device.common;
+    return COPYBIT_SUCCESS;
+}
+
+#if defined(COPYBIT_SW)
+static int open_copybit(const struct hw_module_t* module, const char* name,
+                        struct hw_device_t** device)
+{
+    return open_copybit_sw(module, name, device);
+}
+
+static struct hw_module_methods_t copybit_module_methods = {
+    .open = open_copybit,
+};
+
+/*
+ * The COPYBIT Module
+ */
+struct copybit_module_t HAL_MODULE_INFO_SYM = {
+    .common = {
+        .tag =  HARDWARE_MODULE_TAG,
+        .version_major = 1,
+        .version_minor = 0,
+        .id = COPYBIT_HARDWARE_MODULE_ID,
+        .name = "QCT COPYBIT Software Module",
+        .author = "Qualcomm",
+        .methods =  &copybit_module_methods
+    }
+};
+#endif
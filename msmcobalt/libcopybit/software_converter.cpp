@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include "software_converter.h"
+#include "pixel_convert.h"
 
 /** Convert YV12 to YCrCb_420_SP */
 int convertYV12toYCrCb420SP(const copybit_image_t *src, private_handle_t *yv12_handle)
@@ -60,34 +61,25 @@ int convertYV12toYCrCb420SP(const copybit_image_t *src, private_handle_t *yv12_h
     unsigned char* oldChroma = (unsigned char*)(hnd->base + y_size);
     memcpy((char *)yv12_handle->base,(char *)hnd->base,y_size);
 
-#if defined(__ARM_HAVE_NEON) && !defined(__aarch64__)
-   /* interleave */
+    /* interleave */
     if(!chromaPadding) {
-        unsigned char * t1 = newChroma;
-        unsigned char * t2 = oldChroma;
-        unsigned char * t3 = t2 + chromaSize/2;
-        for(unsigned int i=0; i < (chromaSize/2)>>3; i++) {
-            __asm__ __volatile__ (
-                                    "vld1.u8 d0, [%0]! \n"
-                                    "vld1.u8 d1, [%1]! \n"
-                                    "vst2.u8 {d0, d1}, [%2]! \n"
-                                    :"+r"(t2), "+r"(t3), "+r"(t1)
-                                    :
-                                    :"memory","d0","d1"
-                                 );
+        qdutils::interleaveChroma(newChroma, oldChroma,
+                                  oldChroma + chromaSize/2, chromaSize/2);
+    }
 
+    // With padding and an even width every destination chroma row
+    // interleaves one row of each source chroma plane
+    if(chromaPadding && !(width & 1)) {
+        for(unsigned int r = 0; r < height/2; r++) {
+            qdutils::interleaveChroma(newChroma + r*width,
+                                      oldChroma + r*c_width,
+                                      oldChroma + c_size + r*c_width,
+                                      width/2);
         }
+        return 0;
     }
-#else  //__ARM_HAVE_NEON
-    if(!chromaPadding) {
-        for(unsigned int i = 0; i< chromaSize/2; i++) {
-            newChroma[i*2]   = oldChroma[i];
-            newChroma[i*2+1] = oldChroma[i+chromaSize/2];
-        }
 
-    }
-#endif
-    // If the image is not aligned to 16 pixels,
+    // If the image is not aligned to 16 pixels and has an odd width,
     // convert using the C routine below
     // r1 tracks the row of the source buffer
     // r2 tracks the row of the destination buffer
@@ -126,6 +118,12 @@ int convertYV12toYCrCb420SP(const copybit_image_t *src, private_handle_t *yv12_h
 struct copyInfo{
     int width;
     int height;
+    // Region to copy in pixels, used when partial is set
+    bool partial;
+    int left;
+    int top;
+    int right;
+    int bottom;
     int src_stride;
     int dst_stride;
     size_t src_plane1_offset;
@@ -134,6 +132,19 @@ struct copyInfo{
     size_t dst_plane2_offset;
 };
 
+/* Limit the copy to rect, clipped to the image, or copy all when NULL */
+static void set_copy_region(copyInfo& info, struct copybit_rect_t const *rect)
+{
+    info.partial = (rect != NULL);
+    info.left = info.top = info.right = info.bottom = 0;
+    if (rect) {
+        info.left = (rect->l > 0) ? rect->l : 0;
+        info.top = (rect->t > 0) ? rect->t : 0;
+        info.right = (rect->r < info.width) ? rect->r : info.width;
+        info.bottom = (rect->b < info.height) ? rect->b : info.height;
+    }
+}
+
 /* Internal function to do the actual copy of source to destination */
 static int copy_source_to_destination(const uintptr_t src_base,
                                       const uintptr_t dst_base,
@@ -145,28 +156,45 @@ static int copy_source_to_destination(const uintptr_t src_base,
          return COPYBIT_FAILURE;
     }
 
-    int width = info.width;
-    int height = info.height;
     unsigned char *src = (unsigned char*)src_base;
     unsigned char *dst = (unsigned char*)dst_base;
 
-    // Copy the luma
-    for (int i = 0; i < height; i++) {
-        memcpy(dst, src, width);
-        src += info.src_stride;
-        dst += info.dst_stride;
+    if (info.partial) {
+        // Chroma is subsampled by two, widen the region to even bounds
+        int left = info.left & ~1;
+        int top = info.top & ~1;
+        int right = (info.right + 1) & ~1;
+        int bottom = (info.bottom + 1) & ~1;
+        right = (right < info.width) ? right : info.width;
+        bottom = (bottom < info.height) ? bottom : info.height;
+        if (left >= right || top >= bottom)
+            return 0;
+
+        qdutils::copyPlane(dst + top * info.dst_stride + left, info.dst_stride,
+                           src + top * info.src_stride + left, info.src_stride,
+                           right - left, bottom - top);
+
+        src = (unsigned char*)(src_base + info.src_plane1_offset);
+        dst = (unsigned char*)(dst_base + info.dst_plane1_offset);
+        qdutils::copyPlane(dst + (top / 2) * info.dst_stride + left, info.dst_stride,
+                           src + (top / 2) * info.src_stride + left, info.src_stride,
+                           right - left, (bottom - top + 1) / 2);
+        return 0;
     }
 
-    // Copy plane 1
+    // Copy the luma
+    qdutils::copyPlane(dst, info.dst_stride, src, info.src_stride,
+                       info.width, info.height);
+
+    // Copy plane 1, interleaved chroma rows are as wide as the luma rows.
+    // Rows are copied up to the smaller stride so the padding goes along
+    // without running past the destination row.
     src = (unsigned char*)(src_base + info.src_plane1_offset);
     dst = (unsigned char*)(dst_base + info.dst_plane1_offset);
-    width = width/2;
-    height = height/2;
-    for (int i = 0; i < height; i++) {
-        memcpy(dst, src, info.src_stride);
-        src += info.src_stride;
-        dst += info.dst_stride;
-    }
+    int chroma_width = (info.src_stride < info.dst_stride) ?
+                        info.src_stride : info.dst_stride;
+    qdutils::copyPlane(dst, info.dst_stride, src, info.src_stride,
+                       chroma_width, info.height/2);
     return 0;
 }
 
@@ -176,11 +204,13 @@ static int copy_source_to_destination(const uintptr_t src_base,
  *
  * @param: source buffer handle
  * @param: destination image
+ * @param: region to convert, the whole image when NULL
  *
  * @return: return status
  */
 int convert_yuv_c2d_to_yuv_android(private_handle_t *hnd,
-                                   struct copybit_image_t const *rhs)
+                                   struct copybit_image_t const *rhs,
+                                   struct copybit_rect_t const *rect)
 {
     ALOGD("Enter %s", __FUNCTION__);
     if (!hnd || !rhs) {
@@ -196,6 +226,7 @@ int convert_yuv_c2d_to_yuv_android(private_handle_t *hnd,
     info.height = rhs->h;
     info.src_stride = ALIGN(info.width, 32);
     info.dst_stride = ALIGN(info.width, 16);
+    set_copy_region(info, rect);
     switch(rhs->format) {
         case HAL_PIXEL_FORMAT_YCbCr_420_SP:
         case HAL_PIXEL_FORMAT_YCrCb_420_SP: {
@@ -222,11 +253,13 @@ int convert_yuv_c2d_to_yuv_android(private_handle_t *hnd,
  *
  * @param: source buffer handle
  * @param: destination image
+ * @param: region to convert, the whole image when NULL
  *
  * @return: return status
  */
 int convert_yuv_android_to_yuv_c2d(private_handle_t *hnd,
-                                   struct copybit_image_t const *rhs)
+                                   struct copybit_image_t const *rhs,
+                                   struct copybit_rect_t const *rect)
 {
     if (!hnd || !rhs) {
         ALOGE("%s: invalid inputs hnd=%p rhs=%p", __FUNCTION__, hnd, rhs);
@@ -241,6 +274,7 @@ int convert_yuv_android_to_yuv_c2d(private_handle_t *hnd,
     info.height = rhs->h;
     info.src_stride = ALIGN(hnd->width, 16);
     info.dst_stride = ALIGN(info.width, 32);
+    set_copy_region(info, rect);
     switch(rhs->format) {
         case HAL_PIXEL_FORMAT_YCbCr_420_SP:
         case HAL_PIXEL_FORMAT_YCrCb_420_SP: {
@@ -44,11 +44,13 @@ int convertYV12toYCrCb420SP(const copybit_image_t *src,private_handle_t *yv12_ha
  *
  * @param: source buffer handle
  * @param: destination image
+ * @param: region to convert, the whole image when NULL
  *
  * @return: return status
  */
 int convert_yuv_c2d_to_yuv_android(private_handle_t *hnd,
-                                   struct copybit_image_t const *rhs);
+                                   struct copybit_image_t const *rhs,
+                                   struct copybit_rect_t const *rect);
 
 
 /*
@@ -56,8 +58,10 @@ int convert_yuv_c2d_to_yuv_android(private_handle_t *hnd,
  *
  * @param: source buffer handle
  * @param: destination image
+ * @param: region to convert, the whole image when NULL
  *
  * @return: return status
  */
 int convert_yuv_android_to_yuv_c2d(private_handle_t *hnd,
-                                   struct copybit_image_t const *rhs);
+                                   struct copybit_image_t const *rhs,
+                                   struct copybit_rect_t const *rect);
@@ -80,6 +80,7 @@ ANDROID_SINGLETON_STATIC_INSTANCE(MDPCapabilityInfo);
 
 static void getYuvUBwcWidthHeight(int, int, int, int&, int&);
 static unsigned int getUBwcSize(int, int, int, const int, const int);
+unsigned int getSize(int, int, int, int, const int, const int);
 
 //Common functions
 
@@ -140,6 +141,15 @@ AdrenoMemInfo::AdrenoMemInfo()
        !(strncmp(property, "true", PROPERTY_VALUE_MAX))) {
         gfx_ubwc_disable = 1;
     }
+
+    // Don't add any additional padding if debug.gralloc.map_fb_memory
+    // is enabled
+    map_fb_memory = 0;
+    if((property_get("debug.gralloc.map_fb_memory", property, NULL) > 0) &&
+       (!strncmp(property, "1", PROPERTY_VALUE_MAX ) ||
+       (!strncasecmp(property,"true", PROPERTY_VALUE_MAX )))) {
+        map_fb_memory = 1;
+    }
 }
 
 AdrenoMemInfo::~AdrenoMemInfo()
@@ -228,6 +238,43 @@ bool isUncompressedRgbFormat(int format)
 
 void AdrenoMemInfo::getAlignedWidthAndHeight(int width, int height, int format,
                             int usage, int& aligned_w, int& aligned_h)
+{
+    getBufferSizeAndDimensions(width, height, format, usage, aligned_w,
+                               aligned_h);
+}
+
+unsigned int AdrenoMemInfo::getBufferSizeAndDimensions(int width, int height,
+                            int format, int usage, int& aligned_w,
+                            int& aligned_h)
+{
+    unsigned int w = 0, h = 0, size = 0;
+    if (geometryCache.get(width, height, format, (uint32_t)usage, 0, w, h,
+                          size)) {
+        aligned_w = (int)w;
+        aligned_h = (int)h;
+        return size;
+    }
+
+    size = computeBufferSizeAndDimensions(width, height, format, usage,
+                                          aligned_w, aligned_h);
+    geometryCache.put(width, height, format, (uint32_t)usage, 0,
+                      (unsigned int)aligned_w, (unsigned int)aligned_h, size);
+
+    return size;
+}
+
+unsigned int AdrenoMemInfo::computeBufferSizeAndDimensions(int width,
+                            int height, int format, int usage, int& aligned_w,
+                            int& aligned_h)
+{
+    computeAlignedWidthAndHeight(width, height, format, usage, aligned_w,
+                                 aligned_h);
+    return getSize(format, width, height, usage, aligned_w, aligned_h);
+}
+
+void AdrenoMemInfo::computeAlignedWidthAndHeight(int width, int height,
+                            int format, int usage, int& aligned_w,
+                            int& aligned_h)
 {
     bool ubwc_enabled = isUBwcEnabled(format, usage);
 
@@ -339,12 +386,7 @@ void AdrenoMemInfo::getGpuAlignedWidthHeight(int width, int height, int format,
     aligned_w = ALIGN(width, 32);
     aligned_h = ALIGN(height, 32);
 
-    // Don't add any additional padding if debug.gralloc.map_fb_memory
-    // is enabled
-    char property[PROPERTY_VALUE_MAX];
-    if((property_get("debug.gralloc.map_fb_memory", property, NULL) > 0) &&
-       (!strncmp(property, "1", PROPERTY_VALUE_MAX ) ||
-       (!strncasecmp(property,"true", PROPERTY_VALUE_MAX )))) {
+    if (map_fb_memory) {
         return;
     }
 
@@ -689,36 +731,16 @@ unsigned int getSize(int format, int width, int height, int usage,
 unsigned int getBufferSizeAndDimensions(int width, int height, int format,
         int& alignedw, int &alignedh)
 {
-    unsigned int size;
-
-    AdrenoMemInfo::getInstance().getAlignedWidthAndHeight(width,
-            height,
-            format,
-            0,
-            alignedw,
-            alignedh);
-
-    size = getSize(format, width, height, 0 /* usage */, alignedw, alignedh);
-
-    return size;
+    return AdrenoMemInfo::getInstance().getBufferSizeAndDimensions(width,
+            height, format, 0 /* usage */, alignedw, alignedh);
 }
 
 
 unsigned int getBufferSizeAndDimensions(int width, int height, int format,
         int usage, int& alignedw, int &alignedh)
 {
-    unsigned int size;
-
-    AdrenoMemInfo::getInstance().getAlignedWidthAndHeight(width,
-            height,
-            format,
-            usage,
-            alignedw,
-            alignedh);
-
-    size = getSize(format, width, height, usage, alignedw, alignedh);
-
-    return size;
+    return AdrenoMemInfo::getInstance().getBufferSizeAndDimensions(width,
+            height, format, usage, alignedw, alignedh);
 }
 
 void getBufferAttributes(int width, int height, int format, int usage,
@@ -726,13 +748,8 @@ void getBufferAttributes(int width, int height, int format, int usage,
 {
     tiled = isUBwcEnabled(format, usage) || isMacroTileEnabled(format, usage);
 
-    AdrenoMemInfo::getInstance().getAlignedWidthAndHeight(width,
-            height,
-            format,
-            usage,
-            alignedw,
-            alignedh);
-    size = getSize(format, width, height, usage, alignedw, alignedh);
+    size = AdrenoMemInfo::getInstance().getBufferSizeAndDimensions(width,
+            height, format, usage, alignedw, alignedh);
 }
 
 void getYuvUbwcSPPlaneInfo(uint64_t base, int width, int height,
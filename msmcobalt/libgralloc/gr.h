@@ -29,6 +29,7 @@
 #include <cutils/native_handle.h>
 #include <utils/Singleton.h>
 #include "adreno_utils.h"
+#include "buffer_geometry_cache.h"
 
 /*****************************************************************************/
 
@@ -123,6 +124,27 @@ class AdrenoMemInfo : public android::Singleton <AdrenoMemInfo>
     void getAlignedWidthAndHeight(int width, int height, int format,
                             int usage, int& aligned_w, int& aligned_h);
 
+    /*
+     * Function to compute the buffer size, aligned width and aligned height
+     * based on width, height, format and usage flags. Results are memoized
+     * since they only depend on the inputs and on capabilities queried once.
+     *
+     * @return buffer size, aligned width, aligned height
+     */
+    unsigned int getBufferSizeAndDimensions(int width, int height, int format,
+                            int usage, int& aligned_w, int& aligned_h);
+
+    /*
+     * Function to compute the buffer size, aligned width and aligned height
+     * without the memo, from which getBufferSizeAndDimensions results must
+     * never differ.
+     *
+     * @return buffer size, aligned width, aligned height
+     */
+    unsigned int computeBufferSizeAndDimensions(int width, int height,
+                            int format, int usage, int& aligned_w,
+                            int& aligned_h);
+
     /*
      * Function to compute aligned width and aligned height based on
      * private handle
@@ -170,8 +192,15 @@ class AdrenoMemInfo : public android::Singleton <AdrenoMemInfo>
     ADRENOPIXELFORMAT getGpuPixelFormat(int hal_format);
 
     private:
+        void computeAlignedWidthAndHeight(int width, int height, int format,
+                            int usage, int& aligned_w, int& aligned_h);
+
         // Overriding flag to disable UBWC alloc for graphics stack
         int  gfx_ubwc_disable;
+        // No additional padding when debug.gralloc.map_fb_memory is set
+        int  map_fb_memory;
+        // Memo of getBufferSizeAndDimensions results
+        qdutils::BufferGeometryCache<> geometryCache;
         // Pointer to the padding library.
         void *libadreno_utils;
 
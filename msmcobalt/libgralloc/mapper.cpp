@@ -182,6 +182,7 @@ int gralloc_unregister_buffer(gralloc_module_t const* module,
      * NOTE: the framebuffer is handled differently and is never unmapped.
      * Also base and base_metadata are reset.
      */
+    invalidateMetaDataCache((private_handle_t*)handle);
     return gralloc_unmap(module, handle);
 }
 
@@ -198,6 +199,7 @@ int terminateBuffer(gralloc_module_t const* module,
      * NOTE: the framebuffer is handled differently and is never unmapped.
      * Also base and base_metadata are reset.
      */
+    invalidateMetaDataCache(hnd);
     return gralloc_unmap(module, hnd);
 }
 
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation or the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Checks that memoized getBufferSizeAndDimensions results never differ from
+ * computeBufferSizeAndDimensions over a format x usage x size grid. The grid
+ * is far larger than the cache, and it is walked forward, backward and in
+ * random order, so hits, misses and slot evictions all get compared.
+ *
+ * usage: buffer_geometry_test */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gralloc_priv.h"
+#include "gr.h"
+
+struct GridPoint {
+    int width;
+    int height;
+    int format;
+    int usage;
+};
+
+static const int sFormats[] = {
+    HAL_PIXEL_FORMAT_RGBA_8888,
+    HAL_PIXEL_FORMAT_RGBX_8888,
+    HAL_PIXEL_FORMAT_RGB_888,
+    HAL_PIXEL_FORMAT_RGB_565,
+    HAL_PIXEL_FORMAT_BGRA_8888,
+    HAL_PIXEL_FORMAT_RGBA_5551,
+    HAL_PIXEL_FORMAT_RGBA_4444,
+    HAL_PIXEL_FORMAT_RGBA_1010102,
+    HAL_PIXEL_FORMAT_RGBX_1010102,
+    HAL_PIXEL_FORMAT_RAW10,
+    HAL_PIXEL_FORMAT_RAW16,
+    HAL_PIXEL_FORMAT_RAW_OPAQUE,
+    HAL_PIXEL_FORMAT_BLOB,
+    HAL_PIXEL_FORMAT_YV12,
+    HAL_PIXEL_FORMAT_YCbCr_420_SP,
+    HAL_PIXEL_FORMAT_YCrCb_420_SP,
+    HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS,
+    HAL_PIXEL_FORMAT_YCrCb_420_SP_VENUS,
+    HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS_UBWC,
+    HAL_PIXEL_FORMAT_YCbCr_420_TP10_UBWC,
+    HAL_PIXEL_FORMAT_YCbCr_422_SP,
+    HAL_PIXEL_FORMAT_YCbCr_422_I,
+    HAL_PIXEL_FORMAT_NV21_ZSL,
+};
+
+/* Usage bits that change the geometry: UBWC, macro tiling through texture
+ * and render, video, camera and the secure heaps. */
+static const int sUsages[] = {
+    0,
+    GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN,
+    GRALLOC_USAGE_HW_TEXTURE,
+    GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_COMPOSER,
+    GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_PRIVATE_ALLOC_UBWC,
+    GRALLOC_USAGE_HW_COMPOSER | GRALLOC_USAGE_PRIVATE_ALLOC_UBWC,
+    GRALLOC_USAGE_HW_VIDEO_ENCODER,
+    GRALLOC_USAGE_HW_CAMERA_WRITE | GRALLOC_USAGE_PRIVATE_CAMERA_HEAP,
+    GRALLOC_USAGE_PROTECTED | GRALLOC_USAGE_PRIVATE_MM_HEAP,
+};
+
+static const int sWidths[] = { 1, 7, 64, 130, 720, 1080, 1920, 3840 };
+static const int sHeights[] = { 1, 33, 480, 1080, 2160 };
+
+#define COUNT(array) (sizeof(array) / sizeof(array[0]))
+
+/* Leaves out the sizes gralloc refuses for a format. */
+static bool isValid(const GridPoint& point) {
+    switch (point.format) {
+        case HAL_PIXEL_FORMAT_BLOB:
+        case HAL_PIXEL_FORMAT_RAW_OPAQUE:
+            return point.height == 1;
+        case HAL_PIXEL_FORMAT_YV12:
+            return !(point.width & 1) && !(point.height & 1);
+        case HAL_PIXEL_FORMAT_YCbCr_422_SP:
+        case HAL_PIXEL_FORMAT_YCbCr_422_I:
+            return !(point.width & 1);
+        default:
+            return true;
+    }
+}
+
+static int checkPoint(const GridPoint& point) {
+    AdrenoMemInfo& adreno = AdrenoMemInfo::getInstance();
+    int alignedW = 0, alignedH = 0, expectedW = 0, expectedH = 0;
+
+    unsigned int expected = adreno.computeBufferSizeAndDimensions(point.width,
+            point.height, point.format, point.usage, expectedW, expectedH);
+    unsigned int size = adreno.getBufferSizeAndDimensions(point.width,
+            point.height, point.format, point.usage, alignedW, alignedH);
+
+    if (size != expected || alignedW != expectedW || alignedH != expectedH) {
+        fprintf(stderr, "%dx%d format 0x%x usage 0x%x: memoized %ux%d %u, "
+                "computed %dx%d %u\n", point.width, point.height,
+                point.format, point.usage, alignedW, alignedH, size,
+                expectedW, expectedH, expected);
+        return 1;
+    }
+    return 0;
+}
+
+int main() {
+    std::vector<GridPoint> grid;
+    for (size_t f = 0; f < COUNT(sFormats); f++) {
+        for (size_t u = 0; u < COUNT(sUsages); u++) {
+            for (size_t w = 0; w < COUNT(sWidths); w++) {
+                for (size_t h = 0; h < COUNT(sHeights); h++) {
+                    GridPoint point = { sWidths[w], sHeights[h], sFormats[f],
+                                        sUsages[u] };
+                    if (isValid(point)) {
+                        grid.push_back(point);
+                    }
+                }
+            }
+        }
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < grid.size(); i++) {
+        failures += checkPoint(grid[i]);
+    }
+    for (size_t i = grid.size(); i > 0; i--) {
+        failures += checkPoint(grid[i - 1]);
+    }
+
+    // Repeats now and then, so that some lookups hit a slot just written
+    std::mt19937 engine(1);
+    std::uniform_int_distribution<size_t> pick(0, grid.size() - 1);
+    for (size_t i = 0; i < grid.size() * 4; i++) {
+        size_t index = pick(engine);
+        failures += checkPoint(grid[index]);
+        if (index & 1) {
+            failures += checkPoint(grid[index]);
+        }
+    }
+
+    printf("buffer_geometry_test: %zu grid points, %d failed\n", grid.size(),
+           failures);
+    return failures ? 1 : 0;
+}
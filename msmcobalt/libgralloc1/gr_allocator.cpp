@@ -62,7 +62,7 @@
 
 namespace gralloc1 {
 
-Allocator::Allocator() : ion_allocator_(NULL), adreno_helper_(NULL) {
+Allocator::Allocator() : ion_allocator_(NULL), adreno_helper_(NULL), buffer_pool_(NULL) {
 }
 
 bool Allocator::Init() {
@@ -71,6 +71,8 @@ bool Allocator::Init() {
     return false;
   }
 
+  buffer_pool_ = new BufferPool(ion_allocator_);
+
   adreno_helper_ = new AdrenoMemInfo();
   if (!adreno_helper_->Init()) {
     return false;
@@ -85,6 +87,11 @@ bool Allocator::Init() {
 }
 
 Allocator::~Allocator() {
+  // Pooled buffers are released through the ion allocator, so the pool goes first
+  if (buffer_pool_) {
+    delete buffer_pool_;
+  }
+
   if (ion_allocator_) {
     delete ion_allocator_;
   }
@@ -103,7 +110,17 @@ int Allocator::AllocateMem(AllocData *alloc_data, gralloc1_producer_usage_t prod
   GetIonHeapInfo(prod_usage, cons_usage, &alloc_data->heap_id, &alloc_data->alloc_type,
                  &alloc_data->flags);
 
+  if (buffer_pool_->Get(alloc_data)) {
+    alloc_data->alloc_type |= private_handle_t::PRIV_FLAGS_USES_ION;
+    return 0;
+  }
+
   ret = ion_allocator_->AllocBuffer(alloc_data);
+  if (ret < 0 && buffer_pool_->Trim(0)) {
+    // Memory is tight, hand the pooled buffers back to ION and try once more
+    ret = ion_allocator_->AllocBuffer(alloc_data);
+  }
+
   if (ret >= 0) {
     alloc_data->alloc_type |= private_handle_t::PRIV_FLAGS_USES_ION;
   } else {
@@ -114,6 +131,32 @@ int Allocator::AllocateMem(AllocData *alloc_data, gralloc1_producer_usage_t prod
   return ret;
 }
 
+int Allocator::FreeMem(AllocData *alloc_data, gralloc1_producer_usage_t prod_usage,
+                       gralloc1_consumer_usage_t cons_usage) {
+  alloc_data->uncached = UseUncached(prod_usage);
+  GetIonHeapInfo(prod_usage, cons_usage, &alloc_data->heap_id, &alloc_data->alloc_type,
+                 &alloc_data->flags);
+
+  if (buffer_pool_->Put(*alloc_data)) {
+    return 0;
+  }
+
+  return ion_allocator_->FreeBuffer(alloc_data->base, alloc_data->size, alloc_data->offset,
+                                    alloc_data->fd);
+}
+
+void Allocator::SetBufferPoolBudget(uint64_t budget_bytes) {
+  buffer_pool_->SetBudget(budget_bytes);
+}
+
+void Allocator::TrimBufferPool(uint64_t target_bytes) {
+  buffer_pool_->Trim(target_bytes);
+}
+
+void Allocator::GetBufferPoolStats(gralloc_buffer_pool_stats *stats) {
+  buffer_pool_->GetStats(stats);
+}
+
 // Allocates buffer from width, height and format into a
 // private_handle_t. It is the responsibility of the caller
 // to free the buffer using the FreeBuffer function
@@ -175,6 +218,15 @@ int Allocator::CleanBuffer(void *base, unsigned int size, unsigned int offset, i
   return -EINVAL;
 }
 
+int Allocator::CleanBuffer(void *base, unsigned int offset, int fd, int op,
+                           const CacheRange *ranges, uint32_t num_ranges) {
+  if (ion_allocator_) {
+    return ion_allocator_->CleanBuffer(base, offset, fd, op, ranges, num_ranges);
+  }
+
+  return -EINVAL;
+}
+
 bool Allocator::CheckForBufferSharing(uint32_t num_descriptors, const BufferDescriptor *descriptors,
                                       int *max_index) {
   unsigned int cur_heap_id = 0, prev_heap_id = 0;
@@ -197,8 +249,8 @@ bool Allocator::CheckForBufferSharing(uint32_t num_descriptors, const BufferDesc
     }
 
     // For same format type, find the descriptor with bigger size
-    GetAlignedWidthAndHeight(descriptors[i], &alignedw, &alignedh);
-    unsigned int size = GetSize(descriptors[i], alignedw, alignedh);
+    unsigned int size = 0;
+    GetBufferSizeAndDimensions(descriptors[i], &size, &alignedw, &alignedh);
     if (max_size < size) {
       *max_index = INT(i);
       max_size = size;
@@ -338,15 +390,31 @@ unsigned int Allocator::GetSize(const BufferDescriptor &descriptor, unsigned int
 void Allocator::GetBufferSizeAndDimensions(int width, int height, int format, unsigned int *size,
                                            unsigned int *alignedw, unsigned int *alignedh) {
   BufferDescriptor descriptor = BufferDescriptor(width, height, format);
-  GetAlignedWidthAndHeight(descriptor, alignedw, alignedh);
-
-  *size = GetSize(descriptor, *alignedw, *alignedh);
+  GetBufferSizeAndDimensions(descriptor, size, alignedw, alignedh);
 }
 
 void Allocator::GetBufferSizeAndDimensions(const BufferDescriptor &descriptor, unsigned int *size,
                                            unsigned int *alignedw, unsigned int *alignedh) {
-  GetAlignedWidthAndHeight(descriptor, alignedw, alignedh);
+  int width = descriptor.GetWidth();
+  int height = descriptor.GetHeight();
+  int format = descriptor.GetFormat();
+  gralloc1_producer_usage_t prod_usage = descriptor.GetProducerUsage();
+  gralloc1_consumer_usage_t cons_usage = descriptor.GetConsumerUsage();
+
+  // The geometry only depends on the descriptor and on capabilities fixed at Init
+  if (geometry_cache_.get(width, height, format, prod_usage, cons_usage, *alignedw, *alignedh,
+                          *size)) {
+    return;
+  }
 
+  ComputeBufferSizeAndDimensions(descriptor, size, alignedw, alignedh);
+  geometry_cache_.put(width, height, format, prod_usage, cons_usage, *alignedw, *alignedh, *size);
+}
+
+void Allocator::ComputeBufferSizeAndDimensions(const BufferDescriptor &descriptor,
+                                               unsigned int *size, unsigned int *alignedw,
+                                               unsigned int *alignedh) {
+  ComputeAlignedWidthAndHeight(descriptor, alignedw, alignedh);
   *size = GetSize(descriptor, *alignedw, *alignedh);
 }
 
@@ -362,8 +430,7 @@ void Allocator::GetBufferAttributes(const BufferDescriptor &descriptor, unsigned
     *tiled = true;
   }
 
-  GetAlignedWidthAndHeight(descriptor, alignedw, alignedh);
-  *size = GetSize(descriptor, *alignedw, *alignedh);
+  GetBufferSizeAndDimensions(descriptor, size, alignedw, alignedh);
 }
 
 void Allocator::GetYuvUbwcSPPlaneInfo(uint64_t base, uint32_t width, uint32_t height,
@@ -792,8 +859,111 @@ int Allocator::GetRgbDataAddress(private_handle_t *hnd, void **rgb_data) {
   return err;
 }
 
+uint32_t Allocator::GetCacheRanges(const private_handle_t *hnd, const gralloc1_rect_t &region,
+                                   CacheRange *ranges) {
+  // Fall back to the whole buffer unless both the region and the layout of the format are known
+  ranges[0].offset = 0;
+  ranges[0].length = hnd->size;
+  if (region.left < 0 || region.top < 0 || region.width <= 0 || region.height <= 0 ||
+      region.left + region.width > hnd->width || region.top + region.height > hnd->height) {
+    return 1;
+  }
+
+  unsigned int top = UINT(region.top);
+  unsigned int bottom = UINT(region.top + region.height);
+  uint32_t num_ranges = 0;
+
+  if (gralloc1::IsUncompressedRGBFormat(hnd->format)) {
+    unsigned int stride = UINT(hnd->width) * GetBppForUncompressedRGB(hnd->format);
+    unsigned int data_offset = 0;
+
+    if (hnd->flags & private_handle_t::PRIV_FLAGS_UBWC_ALIGNED) {
+      void *rgb_data = NULL;
+      if (GetRgbDataAddress(const_cast<private_handle_t *>(hnd), &rgb_data)) {
+        return 1;
+      }
+
+      // The meta plane is small, keep all of it. Compressed tiles stay at their uncompressed
+      // position, so the data rows only need to be widened to whole macro tiles.
+      data_offset = UINT(reinterpret_cast<uint64_t>(rgb_data) - hnd->base);
+      ranges[num_ranges].offset = 0;
+      ranges[num_ranges++].length = data_offset;
+      top = top & ~(kUBwcMacroTileHeight - 1);
+      bottom = ALIGN(bottom, kUBwcMacroTileHeight);
+    }
+
+    ranges[num_ranges].offset = data_offset + top * stride;
+    ranges[num_ranges++].length = (bottom - top) * stride;
+  } else if (!(hnd->flags & private_handle_t::PRIV_FLAGS_UBWC_ALIGNED)) {
+    bool subsampled_rows = true;
+    switch (hnd->format) {
+      case HAL_PIXEL_FORMAT_YCbCr_422_SP:
+      case HAL_PIXEL_FORMAT_YCrCb_422_SP:
+        subsampled_rows = false;
+        break;
+      case HAL_PIXEL_FORMAT_YCbCr_420_SP:
+      case HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS:
+      case HAL_PIXEL_FORMAT_NV12_ENCODEABLE:
+      case HAL_PIXEL_FORMAT_YCbCr_420_P010:
+      case HAL_PIXEL_FORMAT_YCrCb_420_SP:
+      case HAL_PIXEL_FORMAT_YCrCb_420_SP_VENUS:
+      case HAL_PIXEL_FORMAT_NV21_ZSL:
+      case HAL_PIXEL_FORMAT_YV12:
+        break;
+      default:
+        // Tiled, packed and raw layouts are not addressable by rows
+        return 1;
+    }
+
+    struct android_ycbcr ycbcr;
+    if (GetYUVPlaneInfo(hnd, &ycbcr)) {
+      return 1;
+    }
+
+    unsigned int ctop = subsampled_rows ? top / 2 : top;
+    unsigned int cbottom = subsampled_rows ? (bottom + 1) / 2 : bottom;
+    uint64_t y_offset = reinterpret_cast<uint64_t>(ycbcr.y) - hnd->base;
+    uint64_t cb_offset = reinterpret_cast<uint64_t>(ycbcr.cb) - hnd->base;
+    uint64_t cr_offset = reinterpret_cast<uint64_t>(ycbcr.cr) - hnd->base;
+
+    ranges[num_ranges].offset = UINT(y_offset + top * ycbcr.ystride);
+    ranges[num_ranges++].length = UINT((bottom - top) * ycbcr.ystride);
+    if (ycbcr.chroma_step == 1) {
+      // Planar, Cb and Cr are separate planes
+      ranges[num_ranges].offset = UINT(cb_offset + ctop * ycbcr.cstride);
+      ranges[num_ranges++].length = UINT((cbottom - ctop) * ycbcr.cstride);
+      ranges[num_ranges].offset = UINT(cr_offset + ctop * ycbcr.cstride);
+      ranges[num_ranges++].length = UINT((cbottom - ctop) * ycbcr.cstride);
+    } else {
+      // Semiplanar, Cb and Cr are interleaved in one plane
+      ranges[num_ranges].offset = UINT(std::min(cb_offset, cr_offset) + ctop * ycbcr.cstride);
+      ranges[num_ranges++].length = UINT((cbottom - ctop) * ycbcr.cstride);
+    }
+  } else {
+    // UBWC YUV interleaves meta and data planes per tile row, keep the whole buffer
+    return 1;
+  }
+
+  // Widen to whole cache lines and keep every range inside the buffer
+  for (uint32_t i = 0; i < num_ranges; i++) {
+    unsigned int start = ranges[i].offset & ~(kCacheLineSize - 1);
+    unsigned int end = ALIGN(ranges[i].offset + ranges[i].length, kCacheLineSize);
+    end = std::min(end, hnd->size);
+    ranges[i].offset = start;
+    ranges[i].length = (start < end) ? (end - start) : 0;
+  }
+
+  return num_ranges;
+}
+
 void Allocator::GetAlignedWidthAndHeight(const BufferDescriptor &descriptor, unsigned int *alignedw,
                                          unsigned int *alignedh) {
+  unsigned int size = 0;
+  GetBufferSizeAndDimensions(descriptor, &size, alignedw, alignedh);
+}
+
+void Allocator::ComputeAlignedWidthAndHeight(const BufferDescriptor &descriptor,
+                                             unsigned int *alignedw, unsigned int *alignedh) {
   int width = descriptor.GetWidth();
   int height = descriptor.GetHeight();
   int format = descriptor.GetFormat();
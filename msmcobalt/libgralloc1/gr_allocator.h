@@ -40,11 +40,15 @@
 #include "gr_buf_descriptor.h"
 #include "gr_adreno_info.h"
 #include "gr_ion_alloc.h"
+#include "gr_buffer_pool.h"
+#include "buffer_geometry_cache.h"
 
 namespace gralloc1 {
 
 class Allocator {
  public:
+  static const uint32_t kMaxCacheRanges = 3;
+
   Allocator();
   ~Allocator();
   bool Init();
@@ -52,8 +56,16 @@ class Allocator {
   int MapBuffer(void **base, unsigned int size, unsigned int offset, int fd);
   int FreeBuffer(void *base, unsigned int size, unsigned int offset, int fd);
   int CleanBuffer(void *base, unsigned int size, unsigned int offset, int fd, int op);
+  int CleanBuffer(void *base, unsigned int offset, int fd, int op, const CacheRange *ranges,
+                  uint32_t num_ranges);
   int AllocateMem(AllocData *data, gralloc1_producer_usage_t prod_usage,
                   gralloc1_consumer_usage_t cons_usage);
+  // Returns memory obtained through AllocateMem, keeping it for reuse when the pool allows
+  int FreeMem(AllocData *data, gralloc1_producer_usage_t prod_usage,
+              gralloc1_consumer_usage_t cons_usage);
+  void SetBufferPoolBudget(uint64_t budget_bytes);
+  void TrimBufferPool(uint64_t target_bytes);
+  void GetBufferPoolStats(gralloc_buffer_pool_stats *stats);
   bool IsMacroTileEnabled(int format, gralloc1_producer_usage_t prod_usage,
                           gralloc1_consumer_usage_t cons_usage);
   // @return : index of the descriptor with maximum buffer size req
@@ -66,12 +78,19 @@ class Allocator {
                                   unsigned int *alignedw, unsigned int *alignedh);
   void GetBufferSizeAndDimensions(int width, int height, int format, unsigned int *size,
                                   unsigned int *alignedw, unsigned int *alignedh);
+  // Same as GetBufferSizeAndDimensions, bypassing the geometry cache
+  void ComputeBufferSizeAndDimensions(const BufferDescriptor &d, unsigned int *size,
+                                      unsigned int *alignedw, unsigned int *alignedh);
   void GetAlignedWidthAndHeight(const BufferDescriptor &d, unsigned int *aligned_w,
                                 unsigned int *aligned_h);
   void GetBufferAttributes(const BufferDescriptor &d, unsigned int *alignedw,
                            unsigned int *alignedh, int *tiled, unsigned int *size);
   int GetYUVPlaneInfo(const private_handle_t *hnd, struct android_ycbcr *ycbcr);
   int GetRgbDataAddress(private_handle_t *hnd, void **rgb_data);
+  // Byte ranges of hnd that hold the pixels of region, one per plane, at most kMaxCacheRanges.
+  // An empty or out of bounds region, or a layout that cannot be split, yields the whole buffer.
+  uint32_t GetCacheRanges(const private_handle_t *hnd, const gralloc1_rect_t &region,
+                          CacheRange *ranges);
   bool UseUncached(gralloc1_producer_usage_t usage);
   bool IsUBwcFormat(int format);
   bool IsUBwcSupported(int format);
@@ -91,11 +110,18 @@ class Allocator {
                            unsigned int alignedh);
   void GetIonHeapInfo(gralloc1_producer_usage_t prod_usage, gralloc1_consumer_usage_t cons_usage,
                       unsigned int *ion_heap_id, unsigned int *alloc_type, unsigned int *ion_flags);
+  void ComputeAlignedWidthAndHeight(const BufferDescriptor &d, unsigned int *aligned_w,
+                                    unsigned int *aligned_h);
+
+  static const unsigned int kCacheLineSize = 64;
+  static const unsigned int kUBwcMacroTileHeight = 16;
 
   bool gpu_support_macrotile = false;
   bool display_support_macrotile = false;
   IonAlloc *ion_allocator_ = NULL;
   AdrenoMemInfo *adreno_helper_ = NULL;
+  BufferPool *buffer_pool_ = NULL;
+  qdutils::BufferGeometryCache<> geometry_cache_;
 };
 
 }  // namespace gralloc1
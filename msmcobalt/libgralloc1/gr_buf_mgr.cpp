@@ -17,6 +17,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <utility>
 
 #include "qd_utils.h"
@@ -45,7 +46,11 @@ BufferManager::BufferManager() {
     ubwc_for_fb_ = true;
   }
 
-  handles_map_.clear();
+  // Budget in MB of the pool recycling released ION buffers, pooling is off when not set
+  if ((property_get("debug.gralloc.buffer_pool_size_mb", property, NULL) > 0) &&
+      (atoi(property) > 0)) {
+    buffer_pool_size_ = static_cast<uint64_t>(atoi(property)) * SZ_1M;
+  }
 }
 
 BufferManager::~BufferManager() {
@@ -56,8 +61,13 @@ BufferManager::~BufferManager() {
 
 bool BufferManager::Init() {
   allocator_ = new Allocator();
+  if (!allocator_->Init()) {
+    return false;
+  }
+
+  allocator_->SetBufferPoolBudget(buffer_pool_size_);
 
-  return allocator_->Init();
+  return true;
 }
 
 gralloc1_error_t BufferManager::AllocateBuffers(uint32_t num_descriptors,
@@ -81,7 +91,8 @@ gralloc1_error_t BufferManager::AllocateBuffers(uint32_t num_descriptors,
     return status;
   }
 
-  if (shared && (max_buf_index >= 0)) {
+  bool backstore_shared = shared && (max_buf_index >= 0);
+  if (backstore_shared) {
     // Allocate one and duplicate/copy the handles for each descriptor
     if (AllocateBuffer(descriptors[max_buf_index], &out_buffers[max_buf_index])) {
       return GRALLOC1_ERROR_NO_RESOURCES;
@@ -93,12 +104,6 @@ gralloc1_error_t BufferManager::AllocateBuffers(uint32_t num_descriptors,
       // Need to revisit if there is a need for own metadata memory
       if (i != UINT(max_buf_index)) {
         CreateSharedHandle(out_buffers[max_buf_index], descriptors[i], &out_buffers[i]);
-
-        // since we just created handle out of existing handle add it to map
-        locker_.lock();
-        handles_map_.insert(std::pair<private_handle_t const *, int>(
-            reinterpret_cast<private_handle_t const *>(out_buffers[i]), 1));
-        locker_.unlock();
       }
     }
   } else {
@@ -106,11 +111,31 @@ gralloc1_error_t BufferManager::AllocateBuffers(uint32_t num_descriptors,
     // Allocate seperate buffer for each descriptor
     for (i = 0; i < num_descriptors; i++) {
       if (AllocateBuffer(descriptors[i], &out_buffers[i])) {
+        // Release what was allocated so far, the client gets all buffers or none
+        for (uint32_t j = 0; j < i; j++) {
+          FreeBuffer(reinterpret_cast<private_handle_t const *>(out_buffers[j]), false);
+          out_buffers[j] = NULL;
+        }
         return GRALLOC1_ERROR_NO_RESOURCES;
       }
     }
   }
 
+  // Register the handles only now that the whole request succeeded. The backing memory of a
+  // shared set outlives any single handle of the set, so it is never recycled. Neither is a
+  // buffer that may have been passed to another process, which could still map it when the
+  // memory is handed to the next owner.
+  for (i = 0; i < num_descriptors; i++) {
+    private_handle_t const *hnd = reinterpret_cast<private_handle_t const *>(out_buffers[i]);
+    HandleInfo info;
+    info.recyclable = (!backstore_shared || (num_descriptors == 1)) &&
+                      (descriptors[i].GetProducerUsage() &
+                       GRALLOC1_PRODUCER_USAGE_PRIVATE_PROCESS_LOCAL);
+    HandleShard &shard = GetShard(hnd);
+    std::unique_lock<std::mutex> lock = LockShard(&shard);
+    shard.handles.insert(std::make_pair(hnd, info));
+  }
+
   // Allocation is successful. If backstore is not shared inform the client.
   if (!shared) {
     return GRALLOC1_ERROR_NOT_SHARED;
@@ -142,7 +167,43 @@ void BufferManager::CreateSharedHandle(buffer_handle_t inbuffer, const BufferDes
   *outbuffer = out_hnd;
 }
 
-gralloc1_error_t BufferManager::FreeBuffer(private_handle_t const *hnd) {
+BufferManager::HandleShard &BufferManager::GetShard(private_handle_t const *hnd) {
+  // Handles are heap allocated, drop the low bits that are the same for all of them
+  uintptr_t key = reinterpret_cast<uintptr_t>(hnd);
+  key = (key >> 4) ^ (key >> 12);
+
+  return handle_shards_[key % kHandleShards];
+}
+
+std::unique_lock<std::mutex> BufferManager::LockShard(HandleShard *shard) {
+  std::unique_lock<std::mutex> lock(shard->lock, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    lock.lock();
+    lock_contention_count_++;
+  }
+
+  return lock;
+}
+
+void BufferManager::GetHandleStats(gralloc_handle_stats *stats) {
+  stats->handle_count = 0;
+  for (uint32_t i = 0; i < kHandleShards; i++) {
+    std::unique_lock<std::mutex> lock(handle_shards_[i].lock);
+    stats->handle_count += static_cast<uint32_t>(handle_shards_[i].handles.size());
+  }
+  stats->shard_count = kHandleShards;
+  stats->lock_contention_count = lock_contention_count_;
+  stats->cache_maintenance_bytes = cache_maintenance_bytes_;
+}
+
+gralloc1_error_t BufferManager::FreeBuffer(private_handle_t const *hnd, bool recyclable) {
+  // A later handle may reuse this handle's address and metadata fd
+  invalidateMetaDataCache(const_cast<private_handle_t *>(hnd));
+
+  if (recyclable) {
+    return RecycleBuffer(hnd);
+  }
+
   if (allocator_->FreeBuffer(reinterpret_cast<void *>(hnd->base), hnd->size, hnd->offset,
                              hnd->fd) != 0) {
     return GRALLOC1_ERROR_BAD_HANDLE;
@@ -161,6 +222,39 @@ gralloc1_error_t BufferManager::FreeBuffer(private_handle_t const *hnd) {
   return GRALLOC1_ERROR_NONE;
 }
 
+// Returns the buffer and metadata memory to the allocator with the same attributes they were
+// allocated with, so that the allocator can keep them for a later allocation of the same kind.
+gralloc1_error_t BufferManager::RecycleBuffer(private_handle_t const *hnd) {
+  gralloc1_producer_usage_t prod_usage = hnd->GetProducerUsage();
+  gralloc1_consumer_usage_t cons_usage = hnd->GetConsumerUsage();
+
+  AllocData data;
+  data.base = reinterpret_cast<void *>(hnd->base - hnd->offset);
+  data.fd = hnd->fd;
+  data.offset = hnd->offset;
+  data.size = hnd->size;
+  data.align = (unsigned int)GetDataAlignment(hnd->format, prod_usage, cons_usage);
+  if (allocator_->FreeMem(&data, prod_usage, cons_usage) != 0) {
+    return GRALLOC1_ERROR_BAD_HANDLE;
+  }
+
+  AllocData e_data;
+  e_data.base = reinterpret_cast<void *>(hnd->base_metadata - hnd->offset_metadata);
+  e_data.fd = hnd->fd_metadata;
+  e_data.offset = hnd->offset_metadata;
+  e_data.size = ALIGN((unsigned int)sizeof(MetaData_t), PAGE_SIZE);
+  e_data.align = (unsigned int)getpagesize();
+  if (allocator_->FreeMem(&e_data, GRALLOC1_PRODUCER_USAGE_NONE,
+                          GRALLOC1_CONSUMER_USAGE_NONE) != 0) {
+    return GRALLOC1_ERROR_BAD_HANDLE;
+  }
+
+  private_handle_t *handle = const_cast<private_handle_t *>(hnd);
+  delete handle;
+
+  return GRALLOC1_ERROR_NONE;
+}
+
 gralloc1_error_t BufferManager::MapBuffer(private_handle_t const *handle) {
   private_handle_t *hnd = const_cast<private_handle_t *>(handle);
 
@@ -181,50 +275,86 @@ gralloc1_error_t BufferManager::MapBuffer(private_handle_t const *handle) {
 }
 
 gralloc1_error_t BufferManager::RetainBuffer(private_handle_t const *hnd) {
-  locker_.lock();
+  HandleShard &shard = GetShard(hnd);
+  std::unique_lock<std::mutex> lock = LockShard(&shard);
 
   // find if this handle is already in map
-  auto it = handles_map_.find(hnd);
-  if (it != handles_map_.end()) {
+  auto it = shard.handles.find(hnd);
+  if (it != shard.handles.end()) {
     // It's already in map, Just increment refcnt
     // No need to mmap the memory.
-    it->second = it->second + 1;
+    it->second.ref_count++;
   } else {
     // not present in the map. mmap and then add entry to map
     if (MapBuffer(hnd) == GRALLOC1_ERROR_NONE) {
-      handles_map_.insert(std::pair<private_handle_t const *, int>(hnd, 1));
+      shard.handles.insert(std::make_pair(hnd, HandleInfo()));
     }
   }
 
-  locker_.unlock();
   return GRALLOC1_ERROR_NONE;
 }
 
 gralloc1_error_t BufferManager::ReleaseBuffer(private_handle_t const *hnd) {
-  locker_.lock();
+  HandleShard &shard = GetShard(hnd);
+  HandleInfo info;
+  {
+    std::unique_lock<std::mutex> lock = LockShard(&shard);
+
+    // find if this handle is already in map
+    auto it = shard.handles.find(hnd);
+    if (it == shard.handles.end()) {
+      // Corrupt handle or map.
+      return GRALLOC1_ERROR_BAD_HANDLE;
+    }
 
-  // find if this handle is already in map
-  auto it = handles_map_.find(hnd);
-  if (it == handles_map_.end()) {
-    // Corrupt handle or map.
-    locker_.unlock();
+    if (--it->second.ref_count) {
+      return GRALLOC1_ERROR_NONE;
+    }
+
+    info = it->second;
+    shard.handles.erase(it);
+  }
+
+  // No other reference is left, unmap and free without holding the shard lock
+  FreeBuffer(hnd, info.recyclable);
+
+  return GRALLOC1_ERROR_NONE;
+}
+
+static void UnionRegion(const gralloc1_rect_t &region, gralloc1_rect_t *out) {
+  if (out->width <= 0 || out->height <= 0) {
+    *out = region;
+    return;
+  }
+
+  int32_t right = std::max(out->left + out->width, region.left + region.width);
+  int32_t bottom = std::max(out->top + out->height, region.top + region.height);
+  out->left = std::min(out->left, region.left);
+  out->top = std::min(out->top, region.top);
+  out->width = right - out->left;
+  out->height = bottom - out->top;
+}
+
+gralloc1_error_t BufferManager::MaintainCache(private_handle_t const *hnd,
+                                              const gralloc1_rect_t &region, int op) {
+  CacheRange ranges[Allocator::kMaxCacheRanges];
+  uint32_t num_ranges = allocator_->GetCacheRanges(hnd, region, ranges);
+  if (allocator_->CleanBuffer(reinterpret_cast<void *>(hnd->base), hnd->offset, hnd->fd, op,
+                              ranges, num_ranges)) {
     return GRALLOC1_ERROR_BAD_HANDLE;
-  } else {
-    it->second = it->second - 1;
   }
 
-  if (!it->second) {
-    handles_map_.erase(it);
-    FreeBuffer(hnd);
+  for (uint32_t i = 0; i < num_ranges; i++) {
+    cache_maintenance_bytes_ += ranges[i].length;
   }
 
-  locker_.unlock();
   return GRALLOC1_ERROR_NONE;
 }
 
 gralloc1_error_t BufferManager::LockBuffer(const private_handle_t *hnd,
                                            gralloc1_producer_usage_t prod_usage,
-                                           gralloc1_consumer_usage_t cons_usage) {
+                                           gralloc1_consumer_usage_t cons_usage,
+                                           const gralloc1_rect_t &region) {
   gralloc1_error_t err = GRALLOC1_ERROR_NONE;
 
   // If buffer is not meant for CPU return err
@@ -232,27 +362,42 @@ gralloc1_error_t BufferManager::LockBuffer(const private_handle_t *hnd,
     return GRALLOC1_ERROR_BAD_VALUE;
   }
 
+  HandleShard &shard = GetShard(hnd);
   if (hnd->base == 0) {
-    // we need to map for real
-    locker_.lock();
-    err = MapBuffer(hnd);
-    locker_.unlock();
+    // we need to map for real, unless another thread did while we waited for the lock
+    std::unique_lock<std::mutex> lock = LockShard(&shard);
+    if (hnd->base == 0) {
+      err = MapBuffer(hnd);
+    }
   }
 
   // Invalidate if CPU reads in software and there are non-CPU
   // writers. No need to do this for the metadata buffer as it is
-  // only read/written in software.
+  // only read/written in software. Only the bytes backing the
+  // locked region are invalidated.
   if (!err && (hnd->flags & private_handle_t::PRIV_FLAGS_USES_ION) &&
       (hnd->flags & private_handle_t::PRIV_FLAGS_CACHED)) {
-    if (allocator_->CleanBuffer(reinterpret_cast<void *>(hnd->base), hnd->size, hnd->offset,
-                                hnd->fd, CACHE_INVALIDATE)) {
+    if (MaintainCache(hnd, region, CACHE_INVALIDATE) != GRALLOC1_ERROR_NONE) {
       return GRALLOC1_ERROR_BAD_HANDLE;
     }
   }
 
-  // Mark the buffer to be flushed after CPU write.
+  // Mark the buffer to be flushed after CPU write and remember what was written.
   if (!err && CpuCanWrite(prod_usage)) {
+    std::unique_lock<std::mutex> lock = LockShard(&shard);
     private_handle_t *handle = const_cast<private_handle_t *>(hnd);
+    auto it = shard.handles.find(hnd);
+    if (it != shard.handles.end()) {
+      // An empty region stands for the whole buffer, which absorbs any other region
+      gralloc1_rect_t *dirty_region = &it->second.dirty_region;
+      bool whole_buffer = (handle->flags & private_handle_t::PRIV_FLAGS_NEEDS_FLUSH) &&
+                          (dirty_region->width <= 0 || dirty_region->height <= 0);
+      if (whole_buffer || region.width <= 0 || region.height <= 0) {
+        *dirty_region = {0, 0, 0, 0};
+      } else {
+        UnionRegion(region, dirty_region);
+      }
+    }
     handle->flags |= private_handle_t::PRIV_FLAGS_NEEDS_FLUSH;
   }
 
@@ -261,19 +406,31 @@ gralloc1_error_t BufferManager::LockBuffer(const private_handle_t *hnd,
 
 gralloc1_error_t BufferManager::UnlockBuffer(const private_handle_t *handle) {
   gralloc1_error_t status = GRALLOC1_ERROR_NONE;
-
-  locker_.lock();
   private_handle_t *hnd = const_cast<private_handle_t *>(handle);
+  bool needs_flush = false;
+  // An empty region flushes the whole buffer, e.g. for handles unknown to this process
+  gralloc1_rect_t dirty_region = {0, 0, 0, 0};
+
+  {
+    HandleShard &shard = GetShard(hnd);
+    std::unique_lock<std::mutex> lock = LockShard(&shard);
+    if (hnd->flags & private_handle_t::PRIV_FLAGS_NEEDS_FLUSH) {
+      hnd->flags &= ~private_handle_t::PRIV_FLAGS_NEEDS_FLUSH;
+      needs_flush = true;
+    }
 
-  if (hnd->flags & private_handle_t::PRIV_FLAGS_NEEDS_FLUSH) {
-    if (allocator_->CleanBuffer(reinterpret_cast<void *>(hnd->base), hnd->size, hnd->offset,
-                                hnd->fd, CACHE_CLEAN) != 0) {
-      status = GRALLOC1_ERROR_BAD_HANDLE;
+    auto it = shard.handles.find(hnd);
+    if (it != shard.handles.end()) {
+      dirty_region = it->second.dirty_region;
+      it->second.dirty_region = {0, 0, 0, 0};
     }
-    hnd->flags &= ~private_handle_t::PRIV_FLAGS_NEEDS_FLUSH;
   }
 
-  locker_.unlock();
+  // The cache clean ioctl can take a while on large buffers, keep it outside the shard lock
+  if (needs_flush && MaintainCache(hnd, dirty_region, CACHE_CLEAN) != GRALLOC1_ERROR_NONE) {
+    status = GRALLOC1_ERROR_BAD_HANDLE;
+  }
+
   return status;
 }
 
@@ -396,14 +553,19 @@ int BufferManager::AllocateBuffer(unsigned int size, int aligned_w, int aligned_
 
   err =
       allocator_->AllocateMem(&e_data, GRALLOC1_PRODUCER_USAGE_NONE, GRALLOC1_CONSUMER_USAGE_NONE);
-  ALOGE_IF(err, "gralloc failed for e_daata error=%s", strerror(-err));
+  if (err) {
+    ALOGE("gralloc failed for e_daata error=%s", strerror(-err));
+    allocator_->FreeBuffer(data.base, data.size, data.offset, data.fd);
+    *handle = 0;
+    return err;
+  }
 
   flags = GetHandleFlags(format, prod_usage, cons_usage);
   flags |= data.alloc_type;
 
-  // Create handle
+  // Create handle, a recycled buffer may be slightly larger than requested
   uint64_t eBaseAddr = (uint64_t)(e_data.base) + e_data.offset;
-  private_handle_t *hnd = new private_handle_t(data.fd, size, flags, bufferType, format, aligned_w,
+  private_handle_t *hnd = new private_handle_t(data.fd, data.size, flags, bufferType, format, aligned_w,
                                                aligned_h, e_data.fd, e_data.offset, eBaseAddr,
                                                unaligned_w, unaligned_h, prod_usage, cons_usage);
 
@@ -413,13 +575,9 @@ int BufferManager::AllocateBuffer(unsigned int size, int aligned_w, int aligned_
 
   setMetaData(hnd, UPDATE_COLOR_SPACE, reinterpret_cast<void *>(&colorSpace));
 
+  // The caller adds the handle to the map once the whole allocation request succeeded
   *handle = hnd;
 
-  // we have just allocated the buffer & mmapped. Add to map
-  locker_.lock();
-  handles_map_.insert(std::pair<private_handle_t const *, int>(hnd, 1));
-  locker_.unlock();
-
   return err;
 }
 
@@ -636,6 +794,28 @@ gralloc1_error_t BufferManager::Perform(int operation, va_list args) {
       }
     } break;
 
+    case GRALLOC_MODULE_PERFORM_GET_BUFFER_POOL_STATS: {
+      gralloc_buffer_pool_stats *stats = va_arg(args, gralloc_buffer_pool_stats *);
+      if (!stats) {
+        return GRALLOC1_ERROR_BAD_VALUE;
+      }
+      allocator_->GetBufferPoolStats(stats);
+    } break;
+
+    case GRALLOC_MODULE_PERFORM_GET_HANDLE_STATS: {
+      gralloc_handle_stats *stats = va_arg(args, gralloc_handle_stats *);
+      if (!stats) {
+        return GRALLOC1_ERROR_BAD_VALUE;
+      }
+      GetHandleStats(stats);
+    } break;
+
+    case GRALLOC_MODULE_PERFORM_TRIM_BUFFER_POOL: {
+      // Releases pooled buffers until at most target_bytes remain pooled, 0 empties the pool
+      uint64_t target_bytes = va_arg(args, uint64_t);
+      allocator_->TrimBufferPool(target_bytes);
+    } break;
+
     default:
       break;
   }
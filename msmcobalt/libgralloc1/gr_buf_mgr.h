@@ -21,6 +21,7 @@
 #define __GR_BUF_MGR_H__
 
 #include <pthread.h>
+#include <atomic>
 #include <unordered_map>
 #include <mutex>
 
@@ -39,13 +40,16 @@ class BufferManager {
   gralloc1_error_t RetainBuffer(private_handle_t const *hnd);
   gralloc1_error_t ReleaseBuffer(private_handle_t const *hnd);
   gralloc1_error_t LockBuffer(const private_handle_t *hnd, gralloc1_producer_usage_t prod_usage,
-                              gralloc1_consumer_usage_t cons_usage);
+                              gralloc1_consumer_usage_t cons_usage, const gralloc1_rect_t &region);
   gralloc1_error_t UnlockBuffer(const private_handle_t *hnd);
   gralloc1_error_t Perform(int operation, va_list args);
 
  private:
   gralloc1_error_t MapBuffer(private_handle_t const *hnd);
-  gralloc1_error_t FreeBuffer(private_handle_t const *hnd);
+  gralloc1_error_t FreeBuffer(private_handle_t const *hnd, bool recyclable);
+  gralloc1_error_t RecycleBuffer(private_handle_t const *hnd);
+  gralloc1_error_t MaintainCache(private_handle_t const *hnd, const gralloc1_rect_t &region,
+                                 int op);
   int GetBufferType(int format);
   int AllocateBuffer(const BufferDescriptor &descriptor, buffer_handle_t *handle,
                      unsigned int bufferSize = 0);
@@ -59,12 +63,37 @@ class BufferManager {
                      gralloc1_consumer_usage_t cons_usage);
   void CreateSharedHandle(buffer_handle_t inbuffer, const BufferDescriptor &descriptor,
                           buffer_handle_t *out_buffer);
+  void GetHandleStats(gralloc_handle_stats *stats);
+
+  struct HandleInfo {
+    int ref_count = 1;
+    // The memory was allocated here for GRALLOC1_PRODUCER_USAGE_PRIVATE_PROCESS_LOCAL and is not
+    // shared with another handle, so it may be recycled through the allocator buffer pool once
+    // the handle is freed.
+    bool recyclable = false;
+    // Union of the regions locked for CPU write since the last unlock, flushed on unlock
+    gralloc1_rect_t dirty_region = {0, 0, 0, 0};
+  };
+
+  // Handles are spread over shards by address so that threads working on different buffers
+  // rarely wait on each other. Cache maintenance and unmapping happen outside the shard locks.
+  struct HandleShard {
+    std::mutex lock;
+    std::unordered_map<private_handle_t const *, HandleInfo> handles = {};
+  };
+
+  static const uint32_t kHandleShards = 16;
+
+  HandleShard &GetShard(private_handle_t const *hnd);
+  std::unique_lock<std::mutex> LockShard(HandleShard *shard);
 
   bool map_fb_mem_ = false;
   bool ubwc_for_fb_ = false;
   Allocator *allocator_ = NULL;
-  std::mutex locker_;
-  std::unordered_map<private_handle_t const *, int> handles_map_ = {};
+  HandleShard handle_shards_[kHandleShards];
+  std::atomic<uint64_t> lock_contention_count_ = {0};
+  std::atomic<uint64_t> cache_maintenance_bytes_ = {0};
+  uint64_t buffer_pool_size_ = 0;
 };
 
 }  // namespace gralloc1
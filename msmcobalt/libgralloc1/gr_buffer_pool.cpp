@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2016, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define DEBUG 0
+#include <cutils/log.h>
+#include <string.h>
+
+#include "gr_buffer_pool.h"
+
+namespace gralloc1 {
+
+void BufferPool::SetBudget(uint64_t budget_bytes) {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    budget_bytes_ = budget_bytes;
+  }
+
+  Trim(budget_bytes);
+}
+
+bool BufferPool::Get(AllocData *data) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (!budget_bytes_) {
+    return false;
+  }
+
+  // Pick the smallest pooled buffer that is large enough and within the size slack
+  auto best = entries_.end();
+  unsigned int max_size = data->size + data->size / kSizeSlack;
+  for (auto it = entries_.begin(); it != entries_.end(); it++) {
+    if (it->heap_id != data->heap_id || it->flags != data->flags ||
+        it->uncached != data->uncached || it->align < data->align) {
+      continue;
+    }
+
+    if (it->size < data->size || it->size > max_size) {
+      continue;
+    }
+
+    if (best == entries_.end() || it->size < best->size) {
+      best = it;
+    }
+  }
+
+  if (best == entries_.end()) {
+    misses_++;
+    return false;
+  }
+
+  data->base = best->base;
+  data->fd = best->fd;
+  data->offset = best->offset;
+  data->size = best->size;
+  pooled_bytes_ -= best->size;
+  entries_.erase(best);
+  hits_++;
+  ALOGD_IF(DEBUG, "%s: Reusing buffer base:%p size:%u fd:%d", __FUNCTION__, data->base,
+           data->size, data->fd);
+
+  return true;
+}
+
+bool BufferPool::Put(const AllocData &data) {
+  if (!IsPoolable(data)) {
+    return false;
+  }
+
+  // The next owner must not see the previous contents. Write them back so that no dirty line
+  // of the old contents reaches memory after the buffer has been handed out again.
+  memset(data.base, 0, data.size);
+  if (!data.uncached) {
+    ion_allocator_->CleanBuffer(data.base, data.size, data.offset, data.fd, CACHE_CLEAN);
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  entries_.push_front(data);
+  pooled_bytes_ += data.size;
+  while (pooled_bytes_ > budget_bytes_ || entries_.size() > kMaxEntries) {
+    EvictOldest();
+  }
+
+  return true;
+}
+
+bool BufferPool::Trim(uint64_t target_bytes) {
+  std::lock_guard<std::mutex> lock(lock_);
+  bool trimmed = false;
+  while (!entries_.empty() && pooled_bytes_ > target_bytes) {
+    EvictOldest();
+    trimmed = true;
+  }
+
+  return trimmed;
+}
+
+void BufferPool::GetStats(gralloc_buffer_pool_stats *stats) {
+  std::lock_guard<std::mutex> lock(lock_);
+  stats->hits = hits_;
+  stats->misses = misses_;
+  stats->evictions = evictions_;
+  stats->pooled_bytes = pooled_bytes_;
+  stats->budget_bytes = budget_bytes_;
+  stats->pooled_count = static_cast<uint32_t>(entries_.size());
+}
+
+bool BufferPool::IsPoolable(const AllocData &data) {
+  if (!data.base || (data.flags & ION_SECURE)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(lock_);
+  return data.size <= budget_bytes_;
+}
+
+void BufferPool::EvictOldest() {
+  AllocData &data = entries_.back();
+  ion_allocator_->FreeBuffer(data.base, data.size, data.offset, data.fd);
+  pooled_bytes_ -= data.size;
+  entries_.pop_back();
+  evictions_++;
+}
+
+}  // namespace gralloc1
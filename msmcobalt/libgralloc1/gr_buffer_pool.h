@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2016, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GR_BUFFER_POOL_H__
+#define __GR_BUFFER_POOL_H__
+
+#include <list>
+#include <mutex>
+
+#include "gralloc_priv.h"
+#include "gr_ion_alloc.h"
+
+namespace gralloc1 {
+
+// Holds ION buffers released by this process so that a later allocation from the same heap with
+// the same flags and a close enough size can reuse the fd and mapping instead of going through
+// ION_IOC_ALLOC and mmap again. Only buffers that never left this process are put here, as
+// another process could still hold a dup of the fd or a mapping of an exported buffer and would
+// see the next owner's frames. Secure buffers are never pooled and every pooled buffer is zeroed
+// before it is handed out again.
+class BufferPool {
+ public:
+  explicit BufferPool(IonAlloc *ion_allocator) : ion_allocator_(ion_allocator) {}
+  ~BufferPool() { Trim(0); }
+  void SetBudget(uint64_t budget_bytes);
+  bool Get(AllocData *data);
+  bool Put(const AllocData &data);
+  bool Trim(uint64_t target_bytes);
+  void GetStats(gralloc_buffer_pool_stats *stats);
+
+ private:
+  static const unsigned int kMaxEntries = 32;
+  // A pooled buffer may be at most 1/kSizeSlack larger than the requested size
+  static const unsigned int kSizeSlack = 8;
+
+  bool IsPoolable(const AllocData &data);
+  void EvictOldest();
+
+  IonAlloc *ion_allocator_ = NULL;
+  std::mutex lock_;
+  std::list<AllocData> entries_ = {};  // Most recently released first
+  uint64_t budget_bytes_ = 0;
+  uint64_t pooled_bytes_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t evictions_ = 0;
+};
+
+}  // namespace gralloc1
+
+#endif  // __GR_BUFFER_POOL_H__
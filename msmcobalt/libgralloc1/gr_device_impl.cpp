@@ -395,12 +395,12 @@ gralloc1_error_t GrallocImpl::LockBuffer(gralloc1_device_t *device, buffer_handl
     return GRALLOC1_ERROR_BAD_VALUE;
   }
 
-  // currently we ignore the region/rect client wants to lock
+  // The region limits the cache maintenance done for the CPU access
   if (region == NULL) {
     return GRALLOC1_ERROR_BAD_VALUE;
   }
 
-  status = dev->buf_mgr_->LockBuffer(hnd, prod_usage, cons_usage);
+  status = dev->buf_mgr_->LockBuffer(hnd, prod_usage, cons_usage, *region);
 
   *out_data = reinterpret_cast<void *>(hnd->base);
 
@@ -159,6 +159,14 @@ int IonAlloc::UnmapBuffer(void *base, unsigned int size, unsigned int /*offset*/
 }
 
 int IonAlloc::CleanBuffer(void *base, unsigned int size, unsigned int offset, int fd, int op) {
+  CacheRange range;
+  range.length = size;
+
+  return CleanBuffer(base, offset, fd, op, &range, 1);
+}
+
+int IonAlloc::CleanBuffer(void *base, unsigned int offset, int fd, int op,
+                          const CacheRange *ranges, uint32_t num_ranges) {
   ATRACE_CALL();
   ATRACE_INT("operation id", op);
   struct ion_flush_data flush_data;
@@ -175,10 +183,6 @@ int IonAlloc::CleanBuffer(void *base, unsigned int size, unsigned int offset, in
 
   handle_data.handle = fd_data.handle;
   flush_data.handle = fd_data.handle;
-  flush_data.vaddr = base;
-  // offset and length are unsigned int
-  flush_data.offset = offset;
-  flush_data.length = size;
 
   struct ion_custom_data d;
   switch (op) {
@@ -194,11 +198,22 @@ int IonAlloc::CleanBuffer(void *base, unsigned int size, unsigned int offset, in
   }
 
   d.arg = (unsigned long)(&flush_data);  // NOLINT
-  if (ioctl(ion_dev_fd_, INT(ION_IOC_CUSTOM), &d)) {
-    err = -errno;
-    ALOGE("%s: ION_IOC_CLEAN_INV_CACHES failed with error - %s", __FUNCTION__, strerror(errno));
-    ioctl(ion_dev_fd_, INT(ION_IOC_FREE), &handle_data);
-    return err;
+  // One import serves all the ranges, each range is flushed with its own ioctl
+  for (uint32_t i = 0; i < num_ranges; i++) {
+    if (!ranges[i].length) {
+      continue;
+    }
+
+    flush_data.vaddr = reinterpret_cast<uint8_t *>(base) + ranges[i].offset;
+    // offset and length are unsigned int
+    flush_data.offset = offset + ranges[i].offset;
+    flush_data.length = ranges[i].length;
+    if (ioctl(ion_dev_fd_, INT(ION_IOC_CUSTOM), &d)) {
+      err = -errno;
+      ALOGE("%s: ION_IOC_CLEAN_INV_CACHES failed with error - %s", __FUNCTION__, strerror(errno));
+      ioctl(ion_dev_fd_, INT(ION_IOC_FREE), &handle_data);
+      return err;
+    }
   }
 
   ioctl(ion_dev_fd_, INT(ION_IOC_FREE), &handle_data);
@@ -55,6 +55,12 @@ struct AllocData {
   unsigned int alloc_type = 0x0;
 };
 
+// Byte range of a buffer, relative to its base, that needs CPU cache maintenance
+struct CacheRange {
+  unsigned int offset = 0;
+  unsigned int length = 0;
+};
+
 class IonAlloc {
  public:
   IonAlloc() { ion_dev_fd_ = FD_INIT; }
@@ -67,6 +73,8 @@ class IonAlloc {
   int MapBuffer(void **base, unsigned int size, unsigned int offset, int fd);
   int UnmapBuffer(void *base, unsigned int size, unsigned int offset);
   int CleanBuffer(void *base, unsigned int size, unsigned int offset, int fd, int op);
+  int CleanBuffer(void *base, unsigned int offset, int fd, int op, const CacheRange *ranges,
+                  uint32_t num_ranges);
 
  private:
   const char *kIonDevice = "/dev/ion";
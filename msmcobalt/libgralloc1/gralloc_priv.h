@@ -54,6 +54,10 @@ inline unsigned int roundUpToPageSize(unsigned int x) {
 
 #define GRALLOC1_PRODUCER_USAGE_PRIVATE_CAMERA_ZSL GRALLOC1_PRODUCER_USAGE_PRIVATE_7
 
+/* Buffer never leaves the allocating process, neither its handle nor a dup of its fds.
+ * Only such buffers are recycled through the gralloc buffer pool once freed */
+#define GRALLOC1_PRODUCER_USAGE_PRIVATE_PROCESS_LOCAL GRALLOC1_PRODUCER_USAGE_PRIVATE_8
+
 /* Buffer content should be displayed on a primary display only */
 #define GRALLOC1_CONSUMER_USAGE_PRIVATE_INTERNAL_ONLY GRALLOC1_CONSUMER_USAGE_PRIVATE_1
 
@@ -81,6 +85,9 @@ inline unsigned int roundUpToPageSize(unsigned int x) {
 #define GRALLOC_MODULE_PERFORM_GET_IGC 11
 #define GRALLOC_MODULE_PERFORM_SET_IGC 12
 #define GRALLOC_MODULE_PERFORM_SET_SINGLE_BUFFER_MODE 13
+#define GRALLOC_MODULE_PERFORM_GET_BUFFER_POOL_STATS 14
+#define GRALLOC_MODULE_PERFORM_TRIM_BUFFER_POOL 15
+#define GRALLOC_MODULE_PERFORM_GET_HANDLE_STATS 16
 
 // OEM specific HAL formats
 #define HAL_PIXEL_FORMAT_RGBA_5551 6
@@ -170,4 +177,22 @@ enum {
 
 enum { BUFFER_TYPE_UI = 0, BUFFER_TYPE_VIDEO };
 
+/* Counters of the ION buffer recycling pool, see GRALLOC_MODULE_PERFORM_GET_BUFFER_POOL_STATS */
+struct gralloc_buffer_pool_stats {
+  uint64_t hits;          // Allocations served from the pool
+  uint64_t misses;        // Allocations that went to ION
+  uint64_t evictions;     // Pooled buffers returned to ION to honour the budget or a trim
+  uint64_t pooled_bytes;  // Bytes currently held by the pool
+  uint64_t budget_bytes;  // Maximum bytes the pool may hold, 0 when pooling is disabled
+  uint32_t pooled_count;  // Buffers currently held by the pool
+};
+
+/* Counters of the gralloc handle registry, see GRALLOC_MODULE_PERFORM_GET_HANDLE_STATS */
+struct gralloc_handle_stats {
+  uint64_t lock_contention_count;    // Registry lock acquisitions that had to wait
+  uint64_t cache_maintenance_bytes;  // Bytes cleaned or invalidated on CPU lock and unlock
+  uint32_t handle_count;             // Handles currently registered in this process
+  uint32_t shard_count;              // Number of independently locked registry shards
+};
+
 #endif  // __GRALLOC_PRIV_H__
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2016, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Checks that memoized Allocator::GetBufferSizeAndDimensions results never differ from
+// Allocator::ComputeBufferSizeAndDimensions over a format x usage x size grid. The grid is far
+// larger than the geometry cache and is walked forward, backward and in random order, so hits,
+// misses and slot evictions all get compared.
+//
+// usage: gralloc1_buffer_geometry_test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <random>
+#include <vector>
+
+#include "gr_allocator.h"
+#include "gr_buf_descriptor.h"
+#include "gralloc_priv.h"
+
+using gralloc1::Allocator;
+
+struct Usage {
+  uint64_t producer;
+  uint64_t consumer;
+};
+
+static const int kFormats[] = {
+  HAL_PIXEL_FORMAT_RGBA_8888,
+  HAL_PIXEL_FORMAT_RGBX_8888,
+  HAL_PIXEL_FORMAT_RGB_565,
+  HAL_PIXEL_FORMAT_BGRA_8888,
+  HAL_PIXEL_FORMAT_BGR_565,
+  HAL_PIXEL_FORMAT_RGBA_1010102,
+  HAL_PIXEL_FORMAT_RGBX_1010102,
+  HAL_PIXEL_FORMAT_RAW10,
+  HAL_PIXEL_FORMAT_RAW16,
+  HAL_PIXEL_FORMAT_RAW_OPAQUE,
+  HAL_PIXEL_FORMAT_BLOB,
+  HAL_PIXEL_FORMAT_YV12,
+  HAL_PIXEL_FORMAT_YCbCr_420_888,
+  HAL_PIXEL_FORMAT_YCbCr_420_SP,
+  HAL_PIXEL_FORMAT_YCrCb_420_SP,
+  HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS,
+  HAL_PIXEL_FORMAT_YCrCb_420_SP_VENUS,
+  HAL_PIXEL_FORMAT_YCbCr_420_SP_VENUS_UBWC,
+  HAL_PIXEL_FORMAT_YCbCr_420_TP10_UBWC,
+  HAL_PIXEL_FORMAT_YCbCr_420_P010,
+  HAL_PIXEL_FORMAT_YCbCr_422_SP,
+  HAL_PIXEL_FORMAT_YCbCr_422_I,
+  HAL_PIXEL_FORMAT_NV12_ENCODEABLE,
+  HAL_PIXEL_FORMAT_NV21_ZSL,
+  HAL_PIXEL_FORMAT_IMPLEMENTATION_DEFINED,
+};
+
+// Usage bits that change the geometry: UBWC, macro tiling, video, camera and the secure heaps.
+// Implementation defined formats resolve to a different format for most of them.
+static const Usage kUsages[] = {
+  { GRALLOC1_PRODUCER_USAGE_NONE, GRALLOC1_CONSUMER_USAGE_NONE },
+  { GRALLOC1_PRODUCER_USAGE_CPU_READ_OFTEN | GRALLOC1_PRODUCER_USAGE_CPU_WRITE_OFTEN,
+    GRALLOC1_CONSUMER_USAGE_NONE },
+  { GRALLOC1_PRODUCER_USAGE_GPU_RENDER_TARGET, GRALLOC1_CONSUMER_USAGE_GPU_TEXTURE },
+  { GRALLOC1_PRODUCER_USAGE_GPU_RENDER_TARGET, GRALLOC1_CONSUMER_USAGE_HWCOMPOSER },
+  { GRALLOC1_PRODUCER_USAGE_PRIVATE_ALLOC_UBWC, GRALLOC1_CONSUMER_USAGE_GPU_TEXTURE },
+  { GRALLOC1_PRODUCER_USAGE_PRIVATE_ALLOC_UBWC, GRALLOC1_CONSUMER_USAGE_HWCOMPOSER },
+  { GRALLOC1_PRODUCER_USAGE_NONE, GRALLOC1_CONSUMER_USAGE_VIDEO_ENCODER },
+  { GRALLOC1_PRODUCER_USAGE_CAMERA, GRALLOC1_CONSUMER_USAGE_CAMERA },
+  { GRALLOC1_PRODUCER_USAGE_PROTECTED | GRALLOC1_PRODUCER_USAGE_PRIVATE_MM_HEAP,
+    GRALLOC1_CONSUMER_USAGE_PRIVATE_SECURE_DISPLAY },
+};
+
+static const int kWidths[] = { 1, 7, 64, 130, 720, 1080, 1920, 3840 };
+static const int kHeights[] = { 1, 33, 480, 1080, 2160 };
+
+// Leaves out the sizes gralloc refuses for a format.
+static bool IsValid(int format, int width, int height) {
+  switch (format) {
+    case HAL_PIXEL_FORMAT_BLOB:
+    case HAL_PIXEL_FORMAT_RAW_OPAQUE:
+      return height == 1;
+    case HAL_PIXEL_FORMAT_YV12:
+      return !(width & 1) && !(height & 1);
+    case HAL_PIXEL_FORMAT_YCbCr_422_SP:
+    case HAL_PIXEL_FORMAT_YCbCr_422_I:
+      return !(width & 1);
+    default:
+      return true;
+  }
+}
+
+static int CheckDescriptor(Allocator *allocator, const BufferDescriptor &descriptor) {
+  unsigned int size = 0, aligned_w = 0, aligned_h = 0;
+  unsigned int expected_size = 0, expected_w = 0, expected_h = 0;
+
+  allocator->ComputeBufferSizeAndDimensions(descriptor, &expected_size, &expected_w, &expected_h);
+  allocator->GetBufferSizeAndDimensions(descriptor, &size, &aligned_w, &aligned_h);
+
+  if (size != expected_size || aligned_w != expected_w || aligned_h != expected_h) {
+    fprintf(stderr, "%dx%d format 0x%x usage 0x%llx/0x%llx: memoized %ux%u %u, computed %ux%u %u\n",
+            descriptor.GetWidth(), descriptor.GetHeight(), descriptor.GetFormat(),
+            static_cast<unsigned long long>(descriptor.GetProducerUsage()),
+            static_cast<unsigned long long>(descriptor.GetConsumerUsage()), aligned_w, aligned_h,
+            size, expected_w, expected_h, expected_size);
+    return 1;
+  }
+
+  return 0;
+}
+
+int main() {
+  Allocator allocator;
+  if (!allocator.Init()) {
+    fprintf(stderr, "Failed to initialize the allocator\n");
+    return 1;
+  }
+
+  std::vector<BufferDescriptor> grid;
+  for (int format : kFormats) {
+    for (const Usage &usage : kUsages) {
+      for (int width : kWidths) {
+        for (int height : kHeights) {
+          if (IsValid(format, width, height)) {
+            grid.push_back(BufferDescriptor(
+                width, height, format, static_cast<gralloc1_producer_usage_t>(usage.producer),
+                static_cast<gralloc1_consumer_usage_t>(usage.consumer)));
+          }
+        }
+      }
+    }
+  }
+
+  int failures = 0;
+  for (size_t i = 0; i < grid.size(); i++) {
+    failures += CheckDescriptor(&allocator, grid[i]);
+  }
+  for (size_t i = grid.size(); i > 0; i--) {
+    failures += CheckDescriptor(&allocator, grid[i - 1]);
+  }
+
+  // Repeats now and then, so that some lookups hit a slot just written
+  std::mt19937 engine(1);
+  std::uniform_int_distribution<size_t> pick(0, grid.size() - 1);
+  for (size_t i = 0; i < grid.size() * 4; i++) {
+    size_t index = pick(engine);
+    failures += CheckDescriptor(&allocator, grid[index]);
+    if (index & 1) {
+      failures += CheckDescriptor(&allocator, grid[index]);
+    }
+  }
+
+  printf("gralloc1_buffer_geometry_test: %zu grid points, %d failed\n", grid.size(), failures);
+  return failures ? 1 : 0;
+}
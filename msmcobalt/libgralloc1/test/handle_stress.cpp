@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2016, The Linux Foundation. All rights reserved.
+
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Stresses the gralloc1 handle registry from several threads. Each thread retains a random buffer
+// out of a shared set, optionally locks and unlocks a small region of it for CPU write, and
+// releases it. Reports the throughput and the registry counters read through
+// GRALLOC_MODULE_PERFORM_GET_HANDLE_STATS, and fails if a call fails or a handle leaks.
+//
+// usage: gralloc1_handle_stress [-t <threads>] [-b <buffers>] [-n <iterations>] [-l]
+
+#include <hardware/hardware.h>
+#include <hardware/gralloc1.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gr_priv_handle.h"
+#include "gralloc_priv.h"
+
+struct Gralloc1 {
+  gralloc1_device_t *device = NULL;
+  GRALLOC1_PFN_CREATE_DESCRIPTOR create_descriptor = NULL;
+  GRALLOC1_PFN_DESTROY_DESCRIPTOR destroy_descriptor = NULL;
+  GRALLOC1_PFN_SET_DIMENSIONS set_dimensions = NULL;
+  GRALLOC1_PFN_SET_FORMAT set_format = NULL;
+  GRALLOC1_PFN_SET_PRODUCER_USAGE set_producer_usage = NULL;
+  GRALLOC1_PFN_SET_CONSUMER_USAGE set_consumer_usage = NULL;
+  GRALLOC1_PFN_ALLOCATE allocate = NULL;
+  GRALLOC1_PFN_RETAIN retain = NULL;
+  GRALLOC1_PFN_RELEASE release = NULL;
+  GRALLOC1_PFN_LOCK lock = NULL;
+  GRALLOC1_PFN_UNLOCK unlock = NULL;
+  GRALLOC1_PFN_PERFORM perform = NULL;
+};
+
+struct Options {
+  uint32_t threads = 8;
+  uint32_t buffers = 64;
+  uint32_t iterations = 100000;
+  bool cpu_lock = false;
+};
+
+static const uint32_t kBufferWidth = 256;
+static const uint32_t kBufferHeight = 256;
+static const int32_t kLockSize = 16;
+
+template <typename T>
+static bool GetFunction(gralloc1_device_t *device, gralloc1_function_descriptor_t descriptor,
+                        T *function) {
+  *function = reinterpret_cast<T>(device->getFunction(device, descriptor));
+  return *function != NULL;
+}
+
+static bool OpenGralloc1(Gralloc1 *gralloc) {
+  const hw_module_t *module = NULL;
+  if (hw_get_module(GRALLOC_HARDWARE_MODULE_ID, &module) ||
+      gralloc1_open(module, &gralloc->device)) {
+    fprintf(stderr, "Failed to open the gralloc1 device\n");
+    return false;
+  }
+
+  gralloc1_device_t *device = gralloc->device;
+  if (!GetFunction(device, GRALLOC1_FUNCTION_CREATE_DESCRIPTOR, &gralloc->create_descriptor) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_DESTROY_DESCRIPTOR, &gralloc->destroy_descriptor) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_SET_DIMENSIONS, &gralloc->set_dimensions) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_SET_FORMAT, &gralloc->set_format) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_SET_PRODUCER_USAGE, &gralloc->set_producer_usage) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_SET_CONSUMER_USAGE, &gralloc->set_consumer_usage) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_ALLOCATE, &gralloc->allocate) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_RETAIN, &gralloc->retain) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_RELEASE, &gralloc->release) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_LOCK, &gralloc->lock) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_UNLOCK, &gralloc->unlock) ||
+      !GetFunction(device, GRALLOC1_FUNCTION_PERFORM, &gralloc->perform)) {
+    fprintf(stderr, "gralloc1 device lacks a required function\n");
+    return false;
+  }
+
+  return true;
+}
+
+static bool AllocateBuffers(const Gralloc1 &gralloc, uint32_t count,
+                            std::vector<buffer_handle_t> *buffers) {
+  gralloc1_device_t *device = gralloc.device;
+  gralloc1_buffer_descriptor_t descriptor = 0;
+  if (gralloc.create_descriptor(device, &descriptor) != GRALLOC1_ERROR_NONE) {
+    return false;
+  }
+
+  gralloc1_producer_usage_t prod_usage = static_cast<gralloc1_producer_usage_t>(
+      GRALLOC1_PRODUCER_USAGE_CPU_READ_OFTEN | GRALLOC1_PRODUCER_USAGE_CPU_WRITE_OFTEN);
+  bool ok = gralloc.set_dimensions(device, descriptor, kBufferWidth, kBufferHeight) ==
+                GRALLOC1_ERROR_NONE &&
+            gralloc.set_format(device, descriptor, HAL_PIXEL_FORMAT_RGBA_8888) ==
+                GRALLOC1_ERROR_NONE &&
+            gralloc.set_producer_usage(device, descriptor, prod_usage) == GRALLOC1_ERROR_NONE &&
+            gralloc.set_consumer_usage(device, descriptor, GRALLOC1_CONSUMER_USAGE_NONE) ==
+                GRALLOC1_ERROR_NONE;
+
+  // One at a time, so that a failure leaves only the buffers allocated so far to free
+  for (uint32_t i = 0; ok && i < count; i++) {
+    buffer_handle_t buffer = NULL;
+    ok = gralloc.allocate(device, 1, &descriptor, &buffer) == GRALLOC1_ERROR_NONE;
+    if (ok) {
+      buffers->push_back(buffer);
+    }
+  }
+
+  gralloc.destroy_descriptor(device, descriptor);
+
+  return ok;
+}
+
+static bool GetHandleStats(const Gralloc1 &gralloc, gralloc_handle_stats *stats) {
+  return gralloc.perform(gralloc.device, GRALLOC_MODULE_PERFORM_GET_HANDLE_STATS, stats) ==
+         GRALLOC1_ERROR_NONE;
+}
+
+static void StressThread(const Gralloc1 &gralloc, const Options &options,
+                         const std::vector<buffer_handle_t> &buffers, uint32_t seed,
+                         std::atomic<bool> *start, std::atomic<uint64_t> *errors) {
+  gralloc1_device_t *device = gralloc.device;
+  gralloc1_producer_usage_t prod_usage = GRALLOC1_PRODUCER_USAGE_CPU_WRITE_OFTEN;
+  std::mt19937 engine(seed);
+  std::uniform_int_distribution<size_t> pick(0, buffers.size() - 1);
+  std::uniform_int_distribution<int32_t> offset(0, kBufferWidth - kLockSize);
+  uint64_t failed = 0;
+
+  while (!start->load()) {
+    std::this_thread::yield();
+  }
+
+  for (uint32_t i = 0; i < options.iterations; i++) {
+    buffer_handle_t buffer = buffers[pick(engine)];
+
+    if (gralloc.retain(device, buffer) != GRALLOC1_ERROR_NONE) {
+      failed++;
+      continue;
+    }
+
+    if (options.cpu_lock) {
+      gralloc1_rect_t region = {offset(engine), offset(engine), kLockSize, kLockSize};
+      void *data = NULL;
+      if (gralloc.lock(device, buffer, prod_usage, GRALLOC1_CONSUMER_USAGE_NONE, &region, &data,
+                       -1) == GRALLOC1_ERROR_NONE) {
+        int32_t release_fence = -1;
+        if (gralloc.unlock(device, buffer, &release_fence) != GRALLOC1_ERROR_NONE) {
+          failed++;
+        }
+        if (release_fence >= 0) {
+          close(release_fence);
+        }
+      } else {
+        failed++;
+      }
+    }
+
+    if (gralloc.release(device, buffer) != GRALLOC1_ERROR_NONE) {
+      failed++;
+    }
+  }
+
+  *errors += failed;
+}
+
+static void Usage(const char *name) {
+  fprintf(stderr, "usage: %s [-t <threads>] [-b <buffers>] [-n <iterations>] [-l]\n", name);
+  fprintf(stderr, "  -t  threads retaining and releasing buffers (default 8)\n");
+  fprintf(stderr, "  -b  buffers shared by the threads, 1 for a single hot handle (default 64)\n");
+  fprintf(stderr, "  -n  iterations per thread (default 100000)\n");
+  fprintf(stderr, "  -l  lock and unlock a region of the buffer for CPU write on each iteration\n");
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:b:n:l")) != -1) {
+    switch (opt) {
+      case 't':
+        options.threads = static_cast<uint32_t>(atoi(optarg));
+        break;
+      case 'b':
+        options.buffers = static_cast<uint32_t>(atoi(optarg));
+        break;
+      case 'n':
+        options.iterations = static_cast<uint32_t>(atoi(optarg));
+        break;
+      case 'l':
+        options.cpu_lock = true;
+        break;
+      default:
+        Usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (!options.threads || !options.buffers) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  Gralloc1 gralloc;
+  if (!OpenGralloc1(&gralloc)) {
+    return 1;
+  }
+
+  int status = 1;
+  std::vector<buffer_handle_t> buffers;
+  gralloc_handle_stats before = {}, after = {};
+  if (!AllocateBuffers(gralloc, options.buffers, &buffers)) {
+    fprintf(stderr, "Failed to allocate %u buffers\n", options.buffers);
+  } else if (!GetHandleStats(gralloc, &before)) {
+    fprintf(stderr, "gralloc1 device does not report handle stats\n");
+  } else {
+    std::atomic<bool> start(false);
+    std::atomic<uint64_t> errors(0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < options.threads; i++) {
+      threads.push_back(std::thread(StressThread, std::cref(gralloc), std::cref(options),
+                                    std::cref(buffers), i + 1, &start, &errors));
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start = true;
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    GetHandleStats(gralloc, &after);
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    uint64_t iterations = uint64_t(options.threads) * options.iterations;
+    // Retain and release, plus lock and unlock, each take a shard lock once
+    uint64_t acquisitions = iterations * (options.cpu_lock ? 4 : 2);
+    uint64_t contended = after.lock_contention_count - before.lock_contention_count;
+
+    printf("threads %u, buffers %u, iterations %" PRIu64 "%s, %u shards\n", options.threads,
+           options.buffers, iterations, options.cpu_lock ? " with CPU lock" : "",
+           after.shard_count);
+    printf("  %.3f s, %.0f iterations/s, %.0f ns per iteration per thread\n", seconds,
+           double(iterations) / seconds, seconds * 1e9 * options.threads / double(iterations));
+    printf("  contended shard locks %" PRIu64 " of %" PRIu64 " (%.2f%%)\n", contended,
+           acquisitions, 100.0 * double(contended) / double(acquisitions));
+    printf("  cache maintenance %" PRIu64 " bytes\n",
+           after.cache_maintenance_bytes - before.cache_maintenance_bytes);
+    printf("  handles registered %u before, %u after, %" PRIu64 " failed calls\n",
+           before.handle_count, after.handle_count, errors.load());
+
+    status = (errors.load() || after.handle_count != before.handle_count) ? 1 : 0;
+  }
+
+  for (buffer_handle_t buffer : buffers) {
+    gralloc.release(gralloc.device, buffer);
+  }
+  gralloc1_close(gralloc.device);
+
+  return status;
+}
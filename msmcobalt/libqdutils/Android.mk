@@ -9,7 +9,8 @@ LOCAL_C_INCLUDES              := $(common_includes) $(kernel_includes)
 LOCAL_CFLAGS                  := $(common_flags) -DLOG_TAG=\"qdutils\" -Wno-sign-conversion
 LOCAL_ADDITIONAL_DEPENDENCIES := $(common_deps)
 LOCAL_COPY_HEADERS_TO         := $(common_header_export_path)
-LOCAL_COPY_HEADERS            := display_config.h
+LOCAL_COPY_HEADERS            := display_config.h buffer_geometry_cache.h \
+                                 pixel_convert.h
 LOCAL_SRC_FILES               := profiler.cpp \
                                  qd_utils.cpp \
                                  display_config.cpp
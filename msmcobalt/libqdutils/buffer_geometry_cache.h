@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation or the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _BUFFER_GEOMETRY_CACHE_H
+#define _BUFFER_GEOMETRY_CACHE_H
+
+#include <stdint.h>
+#include <atomic>
+
+namespace qdutils {
+
+/* Memo of buffer geometry computations, keyed on width, height, format and
+ * usage. Both gralloc generations use it in front of their aligned width,
+ * height and size calculation, which otherwise runs the format switches,
+ * the UBWC meta plane math and the libadreno_utils calls on every query.
+ *
+ * The cache is a small direct mapped table of seqlock protected slots, so
+ * lookups never block. A writer that finds its slot being written by
+ * another thread drops its result, the next query simply computes again.
+ * Only results that are a pure function of the key may be stored. */
+template <unsigned int SLOTS = 64>
+class BufferGeometryCache {
+    public:
+    bool get(int width, int height, int format, uint64_t usage,
+             uint64_t usageExt, unsigned int& alignedW,
+             unsigned int& alignedH, unsigned int& size) {
+        const Slot& slot = mSlots[index(width, height, format, usage,
+                                        usageExt)];
+        uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        // 0 is a slot never written, odd is a write in progress
+        if (!seq || (seq & 1)) {
+            return false;
+        }
+
+        bool match = slot.width.load(std::memory_order_relaxed) == width &&
+                slot.height.load(std::memory_order_relaxed) == height &&
+                slot.format.load(std::memory_order_relaxed) == format &&
+                slot.usage.load(std::memory_order_relaxed) == usage &&
+                slot.usageExt.load(std::memory_order_relaxed) == usageExt;
+        unsigned int w = slot.alignedW.load(std::memory_order_relaxed);
+        unsigned int h = slot.alignedH.load(std::memory_order_relaxed);
+        unsigned int s = slot.size.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!match || slot.seq.load(std::memory_order_relaxed) != seq) {
+            return false;
+        }
+
+        alignedW = w;
+        alignedH = h;
+        size = s;
+        return true;
+    }
+
+    void put(int width, int height, int format, uint64_t usage,
+             uint64_t usageExt, unsigned int alignedW, unsigned int alignedH,
+             unsigned int size) {
+        Slot& slot = mSlots[index(width, height, format, usage, usageExt)];
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        if ((seq & 1) || !slot.seq.compare_exchange_strong(seq, seq + 1,
+                std::memory_order_relaxed)) {
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.width.store(width, std::memory_order_relaxed);
+        slot.height.store(height, std::memory_order_relaxed);
+        slot.format.store(format, std::memory_order_relaxed);
+        slot.usage.store(usage, std::memory_order_relaxed);
+        slot.usageExt.store(usageExt, std::memory_order_relaxed);
+        slot.alignedW.store(alignedW, std::memory_order_relaxed);
+        slot.alignedH.store(alignedH, std::memory_order_relaxed);
+        slot.size.store(size, std::memory_order_relaxed);
+
+        // Skip 0 on wrap around, it marks a slot that holds no entry
+        uint32_t next = seq + 2;
+        slot.seq.store(next ? next : 2, std::memory_order_release);
+    }
+
+    private:
+    struct Slot {
+        std::atomic<uint32_t> seq{0};
+        std::atomic<int> width{0};
+        std::atomic<int> height{0};
+        std::atomic<int> format{0};
+        std::atomic<uint64_t> usage{0};
+        std::atomic<uint64_t> usageExt{0};
+        std::atomic<unsigned int> alignedW{0};
+        std::atomic<unsigned int> alignedH{0};
+        std::atomic<unsigned int> size{0};
+    };
+
+    static unsigned int index(int width, int height, int format,
+                              uint64_t usage, uint64_t usageExt) {
+        uint64_t hash = (uint32_t)width;
+        hash = hash * 31 + (uint32_t)height;
+        hash = hash * 31 + (uint32_t)format;
+        hash = hash * 31 + usage;
+        hash = hash * 31 + usageExt;
+        hash ^= hash >> 29;
+        hash *= 0xbf58476d1ce4e5b9ULL;
+        hash ^= hash >> 32;
+        return (unsigned int)(hash % SLOTS);
+    }
+
+    Slot mSlots[SLOTS];
+};
+
+}; //namespace qdutils
+#endif
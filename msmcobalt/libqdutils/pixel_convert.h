@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation or the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PIXEL_CONVERT_H
+#define _PIXEL_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define QDUTILS_PIXEL_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define QDUTILS_PIXEL_SSE2 1
+#endif
+
+namespace qdutils {
+
+/* Pixel conversion and copy routines shared by copybit and the display
+ * dump paths. Each routine runs a vector loop where the target provides
+ * one (NEON on arm and arm64, SSE2 on x86) and finishes the tail, or the
+ * whole job on other targets, with the equivalent scalar loop. Buffers do
+ * not need any particular alignment and must not overlap. */
+
+/* Copies rows of widthBytes bytes between two planes of different strides.
+ * Equal strides covering the rows collapse into a single copy. */
+inline void copyPlane(uint8_t *dst, size_t dstStride, const uint8_t *src,
+                      size_t srcStride, size_t widthBytes, size_t rows) {
+    if (dstStride == srcStride && widthBytes == srcStride) {
+        memcpy(dst, src, widthBytes * rows);
+        return;
+    }
+
+    for (size_t i = 0; i < rows; i++) {
+        memcpy(dst, src, widthBytes);
+        dst += dstStride;
+        src += srcStride;
+    }
+}
+
+/* Interleaves two chroma planes into one semiplanar row, first[i] lands at
+ * dst[2 * i] and second[i] at dst[2 * i + 1]. YV12 to NV21 passes the Cr
+ * plane first, YV12 to NV12 the Cb plane. */
+inline void interleaveChroma(uint8_t *dst, const uint8_t *first,
+                             const uint8_t *second, size_t count) {
+    size_t i = 0;
+#if defined(QDUTILS_PIXEL_NEON)
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x2_t uv;
+        uv.val[0] = vld1q_u8(first + i);
+        uv.val[1] = vld1q_u8(second + i);
+        vst2q_u8(dst + 2 * i, uv);
+    }
+#elif defined(QDUTILS_PIXEL_SSE2)
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(first + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(second + i));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(a, b));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i + 16),
+                         _mm_unpackhi_epi8(a, b));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[2 * i] = first[i];
+        dst[2 * i + 1] = second[i];
+    }
+}
+
+/* Splits one semiplanar chroma row into two planes, the inverse of
+ * interleaveChroma. */
+inline void deinterleaveChroma(uint8_t *first, uint8_t *second,
+                               const uint8_t *src, size_t count) {
+    size_t i = 0;
+#if defined(QDUTILS_PIXEL_NEON)
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x2_t uv = vld2q_u8(src + 2 * i);
+        vst1q_u8(first + i, uv.val[0]);
+        vst1q_u8(second + i, uv.val[1]);
+    }
+#elif defined(QDUTILS_PIXEL_SSE2)
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    for (; i + 16 <= count; i += 16) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src + 2 * i + 16));
+        _mm_storeu_si128((__m128i *)(first + i),
+                         _mm_packus_epi16(_mm_and_si128(lo, lowBytes),
+                                          _mm_and_si128(hi, lowBytes)));
+        _mm_storeu_si128((__m128i *)(second + i),
+                         _mm_packus_epi16(_mm_srli_epi16(lo, 8),
+                                          _mm_srli_epi16(hi, 8)));
+    }
+#endif
+    for (; i < count; i++) {
+        first[i] = src[2 * i];
+        second[i] = src[2 * i + 1];
+    }
+}
+
+/* Converts a YV12 frame (Y, then Cr, then Cb plane) into a semiplanar one.
+ * Chroma strides are in bytes of one chroma plane row, cbFirst selects NV12
+ * over NV21 ordering of the destination chroma. */
+inline void convertYV12ToSemiPlanar(uint8_t *dst, size_t dstStride,
+                                    size_t dstChromaOffset,
+                                    const uint8_t *src, size_t srcStride,
+                                    size_t srcCStride, size_t width,
+                                    size_t height, bool cbFirst) {
+    const uint8_t *srcCr = src + srcStride * height;
+    const uint8_t *srcCb = srcCr + srcCStride * (height / 2);
+    uint8_t *dstC = dst + dstChromaOffset;
+
+    copyPlane(dst, dstStride, src, srcStride, width, height);
+    for (size_t i = 0; i < height / 2; i++) {
+        interleaveChroma(dstC + i * dstStride,
+                         cbFirst ? srcCb + i * srcCStride : srcCr + i * srcCStride,
+                         cbFirst ? srcCr + i * srcCStride : srcCb + i * srcCStride,
+                         width / 2);
+    }
+}
+
+/* Converts a semiplanar frame into YV12, the inverse of
+ * convertYV12ToSemiPlanar. */
+inline void convertSemiPlanarToYV12(uint8_t *dst, size_t dstStride,
+                                    size_t dstCStride, const uint8_t *src,
+                                    size_t srcStride, size_t srcChromaOffset,
+                                    size_t width, size_t height,
+                                    bool cbFirst) {
+    uint8_t *dstCr = dst + dstStride * height;
+    uint8_t *dstCb = dstCr + dstCStride * (height / 2);
+    const uint8_t *srcC = src + srcChromaOffset;
+
+    copyPlane(dst, dstStride, src, srcStride, width, height);
+    for (size_t i = 0; i < height / 2; i++) {
+        deinterleaveChroma(cbFirst ? dstCb + i * dstCStride : dstCr + i * dstCStride,
+                           cbFirst ? dstCr + i * dstCStride : dstCb + i * dstCStride,
+                           srcC + i * srcStride, width / 2);
+    }
+}
+
+/* Drops the alpha channel, RGBA_8888 to RGB_888. */
+inline void convertRGBA8888ToRGB888(uint8_t *dst, const uint8_t *src,
+                                    size_t pixels) {
+    size_t i = 0;
+#if defined(QDUTILS_PIXEL_NEON)
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x4_t rgba = vld4q_u8(src + 4 * i);
+        uint8x16x3_t rgb;
+        rgb.val[0] = rgba.val[0];
+        rgb.val[1] = rgba.val[1];
+        rgb.val[2] = rgba.val[2];
+        vst3q_u8(dst + 3 * i, rgb);
+    }
+#endif
+    // SSE2 has no byte shuffle, x86 stays on the scalar loop
+    for (; i < pixels; i++) {
+        dst[3 * i] = src[4 * i];
+        dst[3 * i + 1] = src[4 * i + 1];
+        dst[3 * i + 2] = src[4 * i + 2];
+    }
+}
+
+/* Adds an opaque alpha channel, RGB_888 to RGBA_8888. */
+inline void convertRGB888ToRGBA8888(uint8_t *dst, const uint8_t *src,
+                                    size_t pixels) {
+    size_t i = 0;
+#if defined(QDUTILS_PIXEL_NEON)
+    for (; i + 16 <= pixels; i += 16) {
+        uint8x16x3_t rgb = vld3q_u8(src + 3 * i);
+        uint8x16x4_t rgba;
+        rgba.val[0] = rgb.val[0];
+        rgba.val[1] = rgb.val[1];
+        rgba.val[2] = rgb.val[2];
+        rgba.val[3] = vdupq_n_u8(0xff);
+        vst4q_u8(dst + 4 * i, rgba);
+    }
+#endif
+    for (; i < pixels; i++) {
+        dst[4 * i] = src[3 * i];
+        dst[4 * i + 1] = src[3 * i + 1];
+        dst[4 * i + 2] = src[3 * i + 2];
+        dst[4 * i + 3] = 0xff;
+    }
+}
+
+/* Truncates RGBA_8888 to RGB_565, red in the top bits of each pixel. */
+inline void convertRGBA8888ToRGB565(uint16_t *dst, const uint8_t *src,
+                                    size_t pixels) {
+    size_t i = 0;
+#if defined(QDUTILS_PIXEL_NEON)
+    for (; i + 8 <= pixels; i += 8) {
+        uint8x8x4_t rgba = vld4_u8(src + 4 * i);
+        uint16x8_t r = vshlq_n_u16(vmovl_u8(vshr_n_u8(rgba.val[0], 3)), 11);
+        uint16x8_t g = vshlq_n_u16(vmovl_u8(vshr_n_u8(rgba.val[1], 2)), 5);
+        uint16x8_t b = vmovl_u8(vshr_n_u8(rgba.val[2], 3));
+        vst1q_u16(dst + i, vorrq_u16(vorrq_u16(r, g), b));
+    }
+#elif defined(QDUTILS_PIXEL_SSE2)
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16((short)0x8000);
+    for (; i + 8 <= pixels; i += 8) {
+        __m128i px[2];
+        for (int j = 0; j < 2; j++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + 4 * i + 16 * j));
+            __m128i r = _mm_srli_epi32(_mm_and_si128(v, byteMask), 3);
+            __m128i g = _mm_srli_epi32(
+                    _mm_and_si128(_mm_srli_epi32(v, 8), byteMask), 2);
+            __m128i b = _mm_srli_epi32(
+                    _mm_and_si128(_mm_srli_epi32(v, 16), byteMask), 3);
+            // Bias into the signed range so the saturating pack keeps values
+            px[j] = _mm_sub_epi32(_mm_or_si128(_mm_or_si128(
+                    _mm_slli_epi32(r, 11), _mm_slli_epi32(g, 5)), b), bias32);
+        }
+        _mm_storeu_si128((__m128i *)(dst + i),
+                         _mm_add_epi16(_mm_packs_epi32(px[0], px[1]), bias16));
+    }
+#endif
+    for (; i < pixels; i++) {
+        dst[i] = (uint16_t)(((src[4 * i] >> 3) << 11) |
+                            ((src[4 * i + 1] >> 2) << 5) |
+                            (src[4 * i + 2] >> 3));
+    }
+}
+
+/* Expands RGB_565 to opaque RGBA_8888, replicating the top bits of each
+ * channel into the bits it lacks so that full intensity stays 0xff. */
+inline void convertRGB565ToRGBA8888(uint8_t *dst, const uint16_t *src,
+                                    size_t pixels) {
+    size_t i = 0;
+#if defined(QDUTILS_PIXEL_NEON)
+    for (; i + 8 <= pixels; i += 8) {
+        uint16x8_t p = vld1q_u16(src + i);
+        uint8x8_t r = vmovn_u16(vshrq_n_u16(p, 11));
+        uint8x8_t g = vmovn_u16(vandq_u16(vshrq_n_u16(p, 5), vdupq_n_u16(0x3f)));
+        uint8x8_t b = vmovn_u16(vandq_u16(p, vdupq_n_u16(0x1f)));
+        uint8x8x4_t rgba;
+        rgba.val[0] = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+        rgba.val[1] = vorr_u8(vshl_n_u8(g, 2), vshr_n_u8(g, 4));
+        rgba.val[2] = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+        rgba.val[3] = vdup_n_u8(0xff);
+        vst4_u8(dst + 4 * i, rgba);
+    }
+#elif defined(QDUTILS_PIXEL_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask5 = _mm_set1_epi32(0x1f);
+    const __m128i mask6 = _mm_set1_epi32(0x3f);
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    for (; i + 8 <= pixels; i += 8) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i px[2] = { _mm_unpacklo_epi16(p, zero),
+                          _mm_unpackhi_epi16(p, zero) };
+        for (int j = 0; j < 2; j++) {
+            __m128i r = _mm_srli_epi32(px[j], 11);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(px[j], 5), mask6);
+            __m128i b = _mm_and_si128(px[j], mask5);
+            r = _mm_or_si128(_mm_slli_epi32(r, 3), _mm_srli_epi32(r, 2));
+            g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 4));
+            b = _mm_or_si128(_mm_slli_epi32(b, 3), _mm_srli_epi32(b, 2));
+            __m128i rgba = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                    _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+            _mm_storeu_si128((__m128i *)(dst + 4 * i + 16 * j), rgba);
+        }
+    }
+#endif
+    for (; i < pixels; i++) {
+        uint8_t r = (uint8_t)(src[i] >> 11);
+        uint8_t g = (uint8_t)((src[i] >> 5) & 0x3f);
+        uint8_t b = (uint8_t)(src[i] & 0x1f);
+        dst[4 * i] = (uint8_t)((r << 3) | (r >> 2));
+        dst[4 * i + 1] = (uint8_t)((g << 2) | (g >> 4));
+        dst[4 * i + 2] = (uint8_t)((b << 3) | (b >> 2));
+        dst[4 * i + 3] = 0xff;
+    }
+}
+
+}; //namespace qdutils
+#endif
@@ -29,6 +29,7 @@
 
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 #include <sys/mman.h>
 #include <cutils/log.h>
 #include <gralloc_priv.h>
@@ -36,6 +37,84 @@
 #include <inttypes.h>
 #include "qdMetaData.h"
 
+/* Handles mapped by gralloc carry the metadata address in base_metadata.
+ * Metadata of other handles is mapped once and retained in a process-wide
+ * cache, which unmaps the least recently used mapping when it is full. A
+ * cached mapping may be unmapped by another thread, so cache lookups and the
+ * accesses through them are done under sMetaDataLock. Entries are matched on
+ * the handle address and its metadata fd. A freed handle's address and fd may
+ * be reused, so gralloc drops a handle's entry with invalidateMetaDataCache()
+ * before the handle is freed or unregistered. */
+#define METADATA_CACHE_SIZE 32
+
+struct MetaDataMapping {
+    private_handle_t *handle;
+    int fd;
+    void *base;
+    uint64_t lastUse;
+};
+
+static pthread_mutex_t sMetaDataLock = PTHREAD_MUTEX_INITIALIZER;
+static MetaDataMapping sMetaDataCache[METADATA_CACHE_SIZE];
+static uint64_t sMetaDataUseCount = 0;
+
+class MetaDataAccess {
+  public:
+    explicit MetaDataAccess(bool locked) : mLocked(locked) {
+        if (mLocked)
+            pthread_mutex_lock(&sMetaDataLock);
+    }
+    ~MetaDataAccess() {
+        if (mLocked)
+            pthread_mutex_unlock(&sMetaDataLock);
+    }
+  private:
+    bool mLocked;
+};
+
+static bool isMapped(private_handle_t *handle) {
+    return handle->base_metadata != 0;
+}
+
+/* Must be called under sMetaDataLock, unless the handle is mapped */
+static MetaData_t *getMetaDataAddr(private_handle_t *handle) {
+    if (isMapped(handle)) {
+        return reinterpret_cast <MetaData_t *>(handle->base_metadata);
+    }
+
+    MetaDataMapping *lru = &sMetaDataCache[0];
+    sMetaDataUseCount++;
+    for (int i = 0; i < METADATA_CACHE_SIZE; i++) {
+        MetaDataMapping *entry = &sMetaDataCache[i];
+        if (entry->base && entry->handle == handle &&
+                entry->fd == handle->fd_metadata) {
+            entry->lastUse = sMetaDataUseCount;
+            return reinterpret_cast <MetaData_t *>(entry->base);
+        }
+        if (entry->lastUse < lru->lastUse) {
+            lru = entry;
+        }
+    }
+
+    unsigned long size = ROUND_UP_PAGESIZE(sizeof(MetaData_t));
+    void *base = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED,
+        handle->fd_metadata, 0);
+    if (base == reinterpret_cast<void*>(MAP_FAILED)) {
+        ALOGE("%s: mmap() failed: error is %s!", __func__, strerror(errno));
+        return NULL;
+    }
+
+    if (lru->base && munmap(lru->base, size))
+        ALOGE("%s: failed to unmap ptr %p, err %d", __func__, lru->base,
+                                                                        errno);
+    lru->handle = handle;
+    lru->fd = handle->fd_metadata;
+    lru->base = base;
+    lru->lastUse = sMetaDataUseCount;
+
+    return reinterpret_cast <MetaData_t *>(base);
+}
+
 int setMetaData(private_handle_t *handle, DispParamType paramType,
                                                     void *param) {
     if (private_handle_t::validate(handle)) {
@@ -46,18 +125,15 @@ int setMetaData(private_handle_t *handle, DispParamType paramType,
         ALOGE("%s: Bad fd for extra data!", __func__);
         return -1;
     }
-    unsigned long size = ROUND_UP_PAGESIZE(sizeof(MetaData_t));
-    void *base = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED,
-        handle->fd_metadata, 0);
-    if (base == reinterpret_cast<void*>(MAP_FAILED)) {
-        ALOGE("%s: mmap() failed: error is %s!", __func__, strerror(errno));
+    MetaDataAccess access(!isMapped(handle));
+    MetaData_t *data = getMetaDataAddr(handle);
+    if (!data) {
         return -1;
     }
-    MetaData_t *data = reinterpret_cast <MetaData_t *>(base);
     // If parameter is NULL reset the specific MetaData Key
     if (!param) {
        data->operation &= ~paramType;
-       return munmap(base, size);
+       return 0;
     }
 
     data->operation |= paramType;
@@ -99,9 +175,6 @@ int setMetaData(private_handle_t *handle, DispParamType paramType,
             ALOGE("Unknown paramType %d", paramType);
             break;
     }
-    if(munmap(base, size))
-        ALOGE("%s: failed to unmap ptr %p, err %d", __func__, (void*)base,
-                                                                        errno);
     return 0;
 }
 
@@ -115,14 +188,11 @@ int clearMetaData(private_handle_t *handle, DispParamType paramType) {
         return -1;
     }
 
-    unsigned long size = ROUND_UP_PAGESIZE(sizeof(MetaData_t));
-    void *base = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED,
-        handle->fd_metadata, 0);
-    if (base == reinterpret_cast<void*>(MAP_FAILED)) {
-        ALOGE("%s: mmap() failed: error is %s!", __func__, strerror(errno));
+    MetaDataAccess access(!isMapped(handle));
+    MetaData_t *data = getMetaDataAddr(handle);
+    if (!data) {
         return -1;
     }
-    MetaData_t *data = reinterpret_cast <MetaData_t *>(base);
     data->operation &= ~paramType;
     switch (paramType) {
         case SET_S3D_COMP:
@@ -133,9 +203,6 @@ int clearMetaData(private_handle_t *handle, DispParamType paramType) {
             ALOGE("Unknown paramType %d", paramType);
             break;
     }
-    if(munmap(base, size))
-        ALOGE("%s: failed to unmap ptr %p, err %d", __func__, (void*)base,
-                                                                        errno);
     return 0;
 }
 
@@ -153,15 +220,12 @@ int getMetaData(private_handle_t *handle, DispFetchParamType paramType,
         ALOGE("%s: input param is null!", __func__);
         return -1;
     }
-    unsigned long size = ROUND_UP_PAGESIZE(sizeof(MetaData_t));
-    void *base = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED,
-        handle->fd_metadata, 0);
-    if (base == reinterpret_cast<void*>(MAP_FAILED)) {
-        ALOGE("%s: mmap() failed: error is %s!", __func__, strerror(errno));
+    MetaDataAccess access(!isMapped(handle));
+    MetaData_t *data = getMetaDataAddr(handle);
+    if (!data) {
         return -1;
     }
 
-    MetaData_t *data = reinterpret_cast <MetaData_t *>(base);
     switch (paramType) {
         case GET_PP_PARAM_INTERLACED:
             *((int32_t *)param) = data->interlaced;
@@ -200,9 +264,30 @@ int getMetaData(private_handle_t *handle, DispFetchParamType paramType,
             ALOGE("Unknown paramType %d", paramType);
             break;
     }
-    if(munmap(base, size))
-        ALOGE("%s: failed to unmap ptr %p, err %d", __func__, (void*)base,
-                                                                        errno);
+    return 0;
+}
+
+int getMetaDataBulk(struct private_handle_t *handle, struct MetaData_t *data) {
+    if (!handle) {
+        ALOGE("%s: Private handle is null!", __func__);
+        return -1;
+    }
+    if (handle->fd_metadata == -1) {
+        ALOGE("%s: Bad fd for extra data!", __func__);
+        return -1;
+    }
+    if (!data) {
+        ALOGE("%s: input data is null!", __func__);
+        return -1;
+    }
+
+    MetaDataAccess access(!isMapped(handle));
+    MetaData_t *src = getMetaDataAddr(handle);
+    if (!src) {
+        return -1;
+    }
+
+    *data = *src;
     return 0;
 }
 
@@ -220,29 +305,35 @@ int copyMetaData(struct private_handle_t *src, struct private_handle_t *dst) {
         return -1;
     }
 
-    unsigned long size = ROUND_UP_PAGESIZE(sizeof(MetaData_t));
-
-    void *base_src = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED,
-        src->fd_metadata, 0);
-    if (base_src == reinterpret_cast<void*>(MAP_FAILED)) {
-        ALOGE("%s: src mmap() failed: error is %s!", __func__, strerror(errno));
+    MetaDataAccess access(!isMapped(src) || !isMapped(dst));
+    MetaData_t *data_src = getMetaDataAddr(src);
+    if (!data_src) {
         return -1;
     }
-
-    void *base_dst = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED,
-        dst->fd_metadata, 0);
-    if (base_dst == reinterpret_cast<void*>(MAP_FAILED)) {
-        ALOGE("%s: dst mmap() failed: error is %s!", __func__, strerror(errno));
+    MetaData_t *data_dst = getMetaDataAddr(dst);
+    if (!data_dst) {
         return -1;
     }
 
-    memcpy(base_dst, base_src, size);
+    *data_dst = *data_src;
+    return 0;
+}
 
-    if(munmap(base_src, size))
-        ALOGE("%s: failed to unmap src ptr %p, err %d", __func__, (void*)base_src,
-                                                                        errno);
-    if(munmap(base_dst, size))
-        ALOGE("%s: failed to unmap src ptr %p, err %d", __func__, (void*)base_dst,
+void invalidateMetaDataCache(struct private_handle_t *handle) {
+    if (!handle) {
+        return;
+    }
+
+    MetaDataAccess access(true);
+    unsigned long size = ROUND_UP_PAGESIZE(sizeof(MetaData_t));
+    for (int i = 0; i < METADATA_CACHE_SIZE; i++) {
+        MetaDataMapping *entry = &sMetaDataCache[i];
+        if (!entry->base || entry->handle != handle) {
+            continue;
+        }
+        if (munmap(entry->base, size))
+            ALOGE("%s: failed to unmap ptr %p, err %d", __func__, entry->base,
                                                                         errno);
-    return 0;
+        memset(entry, 0, sizeof(*entry));
+    }
 }
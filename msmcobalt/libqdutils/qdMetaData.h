@@ -131,10 +131,19 @@ int setMetaData(struct private_handle_t *handle, enum DispParamType paramType,
 int getMetaData(struct private_handle_t *handle, enum DispFetchParamType paramType,
         void *param);
 
+/* Reads all of the metadata in one call. Fields which are set are flagged in
+ * data->operation. */
+int getMetaDataBulk(struct private_handle_t *handle, struct MetaData_t *data);
+
 int copyMetaData(struct private_handle_t *src, struct private_handle_t *dst);
 
 int clearMetaData(struct private_handle_t *handle, enum DispParamType paramType);
 
+/* Drops the metadata mapping cached for a handle. Gralloc calls this before
+ * freeing or unregistering a handle, as a later handle may reuse its address
+ * and metadata fd. */
+void invalidateMetaDataCache(struct private_handle_t *handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation or the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Measures the throughput of the pixel_convert.h routines against the one
+ * pixel at a time loops copybit used before them, on 1080p frames.
+ *
+ * usage: pixel_convert_benchmark [<iterations>] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "pixel_convert.h"
+#include "pixel_convert_reference.h"
+
+static const size_t kWidth = 1920;
+static const size_t kHeight = 1080;
+static const size_t kPixels = kWidth * kHeight;
+
+static uint64_t getTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Reports the bytes read and written per second, and the speedup of the
+ * vector path over the reference. */
+static void report(const char *name, size_t bytes, int iterations,
+                   uint64_t vectorNs, uint64_t referenceNs) {
+    double total = (double)bytes * iterations * 1000.0;
+    printf("%-26s %8.0f MB/s  reference %8.0f MB/s  %5.2fx\n", name,
+           total / (double)vectorNs, total / (double)referenceNs,
+           (double)referenceNs / (double)vectorNs);
+}
+
+#define BENCHMARK(name, bytes, iterations, vectorCall, referenceCall) \
+    do { \
+        uint64_t start = getTimeNs(); \
+        for (int i = 0; i < (iterations); i++) { \
+            vectorCall; \
+        } \
+        uint64_t vectorNs = getTimeNs() - start; \
+        start = getTimeNs(); \
+        for (int i = 0; i < (iterations); i++) { \
+            referenceCall; \
+        } \
+        report(name, bytes, iterations, vectorNs, getTimeNs() - start); \
+    } while (0)
+
+int main(int argc, char **argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 100;
+    std::vector<uint8_t> src(kPixels * 4);
+    std::vector<uint8_t> dst(kPixels * 4);
+    for (size_t i = 0; i < src.size(); i++) {
+        src[i] = (uint8_t)(rand() & 0xff);
+    }
+
+    uint8_t *s = &src[0];
+    uint8_t *d = &dst[0];
+    uint16_t *d16 = (uint16_t *)&dst[0];
+    const uint16_t *s16 = (const uint16_t *)&src[0];
+
+#if defined(QDUTILS_PIXEL_NEON)
+    printf("vector path: NEON\n");
+#elif defined(QDUTILS_PIXEL_SSE2)
+    printf("vector path: SSE2\n");
+#else
+    printf("vector path: none, both columns run scalar loops\n");
+#endif
+
+    BENCHMARK("YV12 to NV21 1080p", kPixels * 3, iterations,
+              qdutils::convertYV12ToSemiPlanar(d, kWidth, kPixels, s, kWidth,
+                                               kWidth / 2, kWidth, kHeight,
+                                               false),
+              reference::convertYV12ToSemiPlanar(d, kWidth, kPixels, s,
+                                                 kWidth, kWidth / 2, kWidth,
+                                                 kHeight, false));
+    BENCHMARK("interleaveChroma", kPixels * 4, iterations,
+              qdutils::interleaveChroma(d, s, s + kPixels, kPixels),
+              reference::interleaveChroma(d, s, s + kPixels, kPixels));
+    BENCHMARK("deinterleaveChroma", kPixels * 4, iterations,
+              qdutils::deinterleaveChroma(d, d + kPixels, s, kPixels),
+              reference::deinterleaveChroma(d, d + kPixels, s, kPixels));
+    BENCHMARK("RGBA8888 to RGB888", kPixels * 7, iterations,
+              qdutils::convertRGBA8888ToRGB888(d, s, kPixels),
+              reference::convertRGBA8888ToRGB888(d, s, kPixels));
+    BENCHMARK("RGB888 to RGBA8888", kPixels * 7, iterations,
+              qdutils::convertRGB888ToRGBA8888(d, s, kPixels),
+              reference::convertRGB888ToRGBA8888(d, s, kPixels));
+    BENCHMARK("RGBA8888 to RGB565", kPixels * 6, iterations,
+              qdutils::convertRGBA8888ToRGB565(d16, s, kPixels),
+              reference::convertRGBA8888ToRGB565(d16, s, kPixels));
+    BENCHMARK("RGB565 to RGBA8888", kPixels * 6, iterations,
+              qdutils::convertRGB565ToRGBA8888(d, s16, kPixels),
+              reference::convertRGB565ToRGBA8888(d, s16, kPixels));
+
+    // Keeps the conversions from being optimized away
+    unsigned checksum = 0;
+    for (size_t i = 0; i < dst.size(); i += 4096) {
+        checksum += dst[i];
+    }
+    printf("checksum %u\n", checksum);
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation or the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _PIXEL_CONVERT_REFERENCE_H
+#define _PIXEL_CONVERT_REFERENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* One pixel at a time versions of the pixel_convert.h routines, the way
+ * copybit converted before them. The test holds the vector paths to their
+ * output and the benchmark measures the vector paths against them. */
+namespace reference {
+
+inline void interleaveChroma(uint8_t *dst, const uint8_t *first,
+                             const uint8_t *second, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[2 * i] = first[i];
+        dst[2 * i + 1] = second[i];
+    }
+}
+
+inline void deinterleaveChroma(uint8_t *first, uint8_t *second,
+                               const uint8_t *src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        first[i] = src[2 * i];
+        second[i] = src[2 * i + 1];
+    }
+}
+
+inline void convertRGBA8888ToRGB888(uint8_t *dst, const uint8_t *src,
+                                    size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        dst[3 * i] = src[4 * i];
+        dst[3 * i + 1] = src[4 * i + 1];
+        dst[3 * i + 2] = src[4 * i + 2];
+    }
+}
+
+inline void convertRGB888ToRGBA8888(uint8_t *dst, const uint8_t *src,
+                                    size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        dst[4 * i] = src[3 * i];
+        dst[4 * i + 1] = src[3 * i + 1];
+        dst[4 * i + 2] = src[3 * i + 2];
+        dst[4 * i + 3] = 0xff;
+    }
+}
+
+inline void convertRGBA8888ToRGB565(uint16_t *dst, const uint8_t *src,
+                                    size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        dst[i] = (uint16_t)(((src[4 * i] >> 3) << 11) |
+                            ((src[4 * i + 1] >> 2) << 5) |
+                            (src[4 * i + 2] >> 3));
+    }
+}
+
+inline void convertRGB565ToRGBA8888(uint8_t *dst, const uint16_t *src,
+                                    size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        uint8_t r = (uint8_t)(src[i] >> 11);
+        uint8_t g = (uint8_t)((src[i] >> 5) & 0x3f);
+        uint8_t b = (uint8_t)(src[i] & 0x1f);
+        dst[4 * i] = (uint8_t)((r << 3) | (r >> 2));
+        dst[4 * i + 1] = (uint8_t)((g << 2) | (g >> 4));
+        dst[4 * i + 2] = (uint8_t)((b << 3) | (b >> 2));
+        dst[4 * i + 3] = 0xff;
+    }
+}
+
+/* YV12 to semiplanar as copybit's software converter did it, pixel by
+ * pixel for the chroma planes. */
+inline void convertYV12ToSemiPlanar(uint8_t *dst, size_t dstStride,
+                                    size_t dstChromaOffset,
+                                    const uint8_t *src, size_t srcStride,
+                                    size_t srcCStride, size_t width,
+                                    size_t height, bool cbFirst) {
+    const uint8_t *srcCr = src + srcStride * height;
+    const uint8_t *srcCb = srcCr + srcCStride * (height / 2);
+
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            dst[y * dstStride + x] = src[y * srcStride + x];
+        }
+    }
+    for (size_t y = 0; y < height / 2; y++) {
+        uint8_t *dstC = dst + dstChromaOffset + y * dstStride;
+        for (size_t x = 0; x < width / 2; x++) {
+            uint8_t cr = srcCr[y * srcCStride + x];
+            uint8_t cb = srcCb[y * srcCStride + x];
+            dstC[2 * x] = cbFirst ? cb : cr;
+            dstC[2 * x + 1] = cbFirst ? cr : cb;
+        }
+    }
+}
+
+}; //namespace reference
+#endif
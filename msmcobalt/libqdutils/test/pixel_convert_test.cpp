@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2016, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation or the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Checks the vector paths of pixel_convert.h against one pixel at a time
+ * reference loops for every length from 0 to a maximum, at every
+ * misalignment of source and destination within 16 bytes. Destinations are
+ * compared whole, so a write past the end of a row fails as well.
+ *
+ * usage: pixel_convert_test [<max length>] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "pixel_convert.h"
+#include "pixel_convert_reference.h"
+
+static const size_t kAlignments = 16;
+static const uint8_t kGuard = 0xa5;
+
+static int sFailures = 0;
+
+static void fillRandom(std::vector<uint8_t> &buffer) {
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = (uint8_t)(rand() & 0xff);
+    }
+}
+
+static void check(const char *name, size_t length, size_t srcOffset,
+                  size_t dstOffset, const std::vector<uint8_t> &actual,
+                  const std::vector<uint8_t> &expected) {
+    if (actual == expected) {
+        return;
+    }
+
+    size_t byte = 0;
+    while (actual[byte] == expected[byte]) {
+        byte++;
+    }
+    fprintf(stderr, "%s: length %zu, src offset %zu, dst offset %zu: byte %zu "
+            "is 0x%02x, expected 0x%02x\n", name, length, srcOffset, dstOffset,
+            byte, actual[byte], expected[byte]);
+    sFailures++;
+}
+
+/* Runs a routine taking one source and one destination of the given bytes
+ * per element against its reference. Element sizes of two keep 16-bit
+ * buffers aligned to their element. */
+template <typename Dst, typename Src>
+static void testConversion(const char *name, size_t maxLength, size_t srcSize,
+                           size_t dstSize,
+                           void (*convert)(Dst *, const Src *, size_t),
+                           void (*convertReference)(Dst *, const Src *,
+                                                    size_t)) {
+    for (size_t length = 0; length <= maxLength; length++) {
+        for (size_t offset = 0; offset < kAlignments; offset += sizeof(Src)) {
+            size_t dstOffset = (offset * 3) % kAlignments / sizeof(Dst) *
+                               sizeof(Dst);
+            std::vector<uint8_t> src(length * srcSize + kAlignments);
+            std::vector<uint8_t> actual(length * dstSize + 2 * kAlignments,
+                                        kGuard);
+            std::vector<uint8_t> expected(actual);
+            fillRandom(src);
+
+            convert((Dst *)&actual[dstOffset], (const Src *)&src[offset],
+                    length);
+            convertReference((Dst *)&expected[dstOffset],
+                             (const Src *)&src[offset], length);
+            check(name, length, offset, dstOffset, actual, expected);
+        }
+    }
+}
+
+static void testInterleave(size_t maxLength) {
+    for (size_t length = 0; length <= maxLength; length++) {
+        for (size_t offset = 0; offset < kAlignments; offset++) {
+            size_t dstOffset = (offset * 5) % kAlignments;
+            std::vector<uint8_t> first(length + kAlignments);
+            std::vector<uint8_t> second(length + kAlignments);
+            std::vector<uint8_t> actual(2 * length + 2 * kAlignments, kGuard);
+            std::vector<uint8_t> expected(actual);
+            fillRandom(first);
+            fillRandom(second);
+
+            qdutils::interleaveChroma(&actual[dstOffset], &first[offset],
+                                      &second[kAlignments - 1 - offset],
+                                      length);
+            reference::interleaveChroma(&expected[dstOffset], &first[offset],
+                                        &second[kAlignments - 1 - offset],
+                                        length);
+            check("interleaveChroma", length, offset, dstOffset, actual,
+                  expected);
+        }
+    }
+}
+
+static void testDeinterleave(size_t maxLength) {
+    for (size_t length = 0; length <= maxLength; length++) {
+        for (size_t offset = 0; offset < kAlignments; offset++) {
+            size_t dstOffset = (offset * 5) % kAlignments;
+            std::vector<uint8_t> src(2 * length + kAlignments);
+            std::vector<uint8_t> actual(2 * length + 3 * kAlignments, kGuard);
+            std::vector<uint8_t> expected(actual);
+            size_t secondOffset = length + 2 * kAlignments - 1 - dstOffset;
+            fillRandom(src);
+
+            qdutils::deinterleaveChroma(&actual[dstOffset],
+                                        &actual[secondOffset], &src[offset],
+                                        length);
+            reference::deinterleaveChroma(&expected[dstOffset],
+                                          &expected[secondOffset],
+                                          &src[offset], length);
+            check("deinterleaveChroma", length, offset, dstOffset, actual,
+                  expected);
+        }
+    }
+}
+
+/* Whole frames with row padding on both sides, both chroma orders, and the
+ * way back to YV12 which has to restore the source. */
+static void testFrames(size_t maxWidth) {
+    const size_t heights[] = { 0, 2, 6, 16 };
+    for (size_t width = 0; width <= maxWidth; width += 2) {
+        for (size_t h = 0; h < sizeof(heights) / sizeof(heights[0]); h++) {
+            size_t height = heights[h];
+            size_t srcStride = width + 6;
+            size_t srcCStride = width / 2 + 10;
+            size_t dstStride = (width + 31) & ~(size_t)31;
+            size_t dstChromaOffset = dstStride * height + 64;
+            std::vector<uint8_t> src(srcStride * height +
+                                     srcCStride * height);
+            fillRandom(src);
+
+            for (int cbFirst = 0; cbFirst < 2; cbFirst++) {
+                std::vector<uint8_t> actual(dstChromaOffset +
+                                            dstStride * height / 2, kGuard);
+                std::vector<uint8_t> expected(actual);
+                qdutils::convertYV12ToSemiPlanar(&actual[0], dstStride,
+                        dstChromaOffset, &src[0], srcStride, srcCStride,
+                        width, height, cbFirst);
+                reference::convertYV12ToSemiPlanar(&expected[0], dstStride,
+                        dstChromaOffset, &src[0], srcStride, srcCStride,
+                        width, height, cbFirst);
+                check(cbFirst ? "convertYV12ToSemiPlanar NV12" :
+                      "convertYV12ToSemiPlanar NV21", width, 0, 0, actual,
+                      expected);
+
+                std::vector<uint8_t> restored(src.size());
+                std::vector<uint8_t> original(src.size());
+                qdutils::convertSemiPlanarToYV12(&restored[0], srcStride,
+                        srcCStride, &actual[0], dstStride, dstChromaOffset,
+                        width, height, cbFirst);
+                // Only the pixels, not the row padding, make the round trip
+                qdutils::copyPlane(&original[0], srcStride, &src[0], srcStride,
+                                   width, height);
+                for (size_t i = 0; i < height; i++) {
+                    size_t row = srcStride * height + i * srcCStride;
+                    memcpy(&original[row], &src[row], width / 2);
+                }
+                check("convertSemiPlanarToYV12", width, 0, 0, restored,
+                      original);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t maxLength = (argc > 1) ? strtoul(argv[1], NULL, 0) : 256;
+    srand(1);
+
+    testInterleave(maxLength);
+    testDeinterleave(maxLength);
+    testConversion<uint8_t, uint8_t>("convertRGBA8888ToRGB888", maxLength, 4,
+            3, qdutils::convertRGBA8888ToRGB888,
+            reference::convertRGBA8888ToRGB888);
+    testConversion<uint8_t, uint8_t>("convertRGB888ToRGBA8888", maxLength, 3,
+            4, qdutils::convertRGB888ToRGBA8888,
+            reference::convertRGB888ToRGBA8888);
+    testConversion<uint16_t, uint8_t>("convertRGBA8888ToRGB565", maxLength, 4,
+            2, qdutils::convertRGBA8888ToRGB565,
+            reference::convertRGBA8888ToRGB565);
+    testConversion<uint8_t, uint16_t>("convertRGB565ToRGBA8888", maxLength, 2,
+            4, qdutils::convertRGB565ToRGBA8888,
+            reference::convertRGB565ToRGBA8888);
+    testFrames(maxLength / 2);
+
+#if defined(QDUTILS_PIXEL_NEON)
+    const char *path = "NEON";
+#elif defined(QDUTILS_PIXEL_SSE2)
+    const char *path = "SSE2";
+#else
+    const char *path = "scalar";
+#endif
+    printf("pixel_convert_test: %s, lengths 0 to %zu, %d failed\n", path,
+           maxLength, sFailures);
+    return sFailures ? 1 : 0;
+}
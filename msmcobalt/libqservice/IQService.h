@@ -74,6 +74,7 @@ public:
         GET_BW_TRANSACTION_STATUS = 32, //Client can query BW transaction status.
         SET_LAYER_MIXER_RESOLUTION = 33, // Enables client to set layer mixer resolution.
         SET_COLOR_MODE = 34, // Overrides the QDCM mode on the display
+        GET_FRAME_TIMING = 35, // Get per display frame timing histograms, optionally reset them
         COMMAND_LIST_END = 400,
     };
 
@@ -121,6 +121,17 @@ class BufferAllocator {
   */
   virtual uint32_t GetBufferSize(BufferInfo *buffer_info) = 0;
 
+
+  /*! @brief Method to release buffers retained for reuse.
+
+    @details An implementation may keep buffers released through FreeBuffer so that a later
+    AllocateBuffer with the same configuration is served without a new allocation. This method
+    returns all such buffers to the system.
+
+    @return \link DisplayError \endlink
+  */
+  virtual DisplayError PurgeBuffers() { return kErrorNone; }
+
  protected:
   virtual ~BufferAllocator() { }
 };
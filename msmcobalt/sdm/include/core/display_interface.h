@@ -165,6 +165,17 @@ struct DisplayEventVSync {
   int64_t timestamp = 0;    //!< System monotonic clock timestamp in nanoseconds.
 };
 
+/*! @brief This structure defines the vsync timing measured from recent hardware vsync events.
+
+  @sa DisplayInterface::GetVSyncTiming
+*/
+struct DisplayVSyncTiming {
+  int64_t last_timestamp = 0;   //!< Timestamp of the most recent vsync in nanoseconds.
+  uint32_t period_ns = 0;       //!< Measured vsync period in nanoseconds.
+  uint32_t jitter_ns = 0;       //!< Mean deviation of vsync intervals from the period.
+  uint32_t sample_count = 0;    //!< Number of vsync intervals used for the measurement.
+};
+
 /*! @brief The structure defines the user input for detail enhancer module.
 
   @sa DisplayInterface::SetDetailEnhancerData
@@ -364,6 +375,18 @@ class DisplayInterface {
   */
   virtual DisplayError GetVSyncState(bool *enabled) = 0;
 
+  /*! @brief Method to get the vsync timing measured from recent hardware vsync events.
+
+    @details The next vsync can be predicted as last_timestamp plus a multiple of period_ns. If
+    too few vsync events have been received, sample_count is zero and period_ns holds the
+    nominal period of the active configuration.
+
+    @param[out] timing \link DisplayVSyncTiming \endlink
+
+    @return \link DisplayError \endlink
+  */
+  virtual DisplayError GetVSyncTiming(DisplayVSyncTiming *timing) = 0;
+
   /*! @brief Method to set current state of the display device.
 
     @param[in] state \link DisplayState \endlink
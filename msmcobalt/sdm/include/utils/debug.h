@@ -77,6 +77,8 @@ class Debug {
   static bool IsUbwcTiledFrameBuffer();
   static bool IsAVRDisabled();
   static bool IsExtAnimDisabled();
+  static bool IsCompositionCacheDisabled();
+  static bool IsValidateReuseEnabled();
   static bool GetProperty(const char *property_name, char *value);
   static bool SetProperty(const char *property_name, const char *value);
 
@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __FRAME_TIMING_H__
+#define __FRAME_TIMING_H__
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+
+namespace sdm {
+
+// Stages of a composition cycle which are timed for each display.
+enum FrameTimingStage {
+  kFrameTimingBuildLayerStack,    // Client translating its layers into the layer stack.
+  kFrameTimingPrepare,            // CompManager::Prepare().
+  kFrameTimingStrategy,           // One strategy attempt along with its resource allocation.
+  kFrameTimingStrategyAttempts,   // Number of strategies attempted for a frame, not a duration.
+  kFrameTimingRotatorPrepare,     // Rotator Prepare().
+  kFrameTimingValidate,           // Driver validate ioctl.
+  kFrameTimingCommit,             // Driver commit ioctl.
+  kFrameTimingFenceDup,           // Release fence duplication for the committed layers.
+  kFrameTimingPostCommit,         // CompManager::PostCommit().
+  kFrameTimingMax,
+};
+
+// Always-on registry of frame timing histograms, which are shared by all users in the process.
+// Values are recorded in microseconds into log-linear buckets with relaxed atomics, hence
+// recording neither locks nor allocates. Each power of two range is split into four linear
+// sub-buckets, which bounds the reported percentiles to within 25% of the recorded values.
+class FrameTiming {
+ public:
+  static void Record(uint32_t display, FrameTimingStage stage, uint64_t value);
+  static void Reset();
+  // Writes a null terminated summary with count, p50, p99 and max for every recorded stage.
+  static void GetDump(char *buffer, uint32_t length);
+
+  static uint64_t GetTimeUs() {
+    struct timespec ts = {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000) + static_cast<uint64_t>(ts.tv_nsec / 1000);
+  }
+
+ private:
+  static const uint32_t kMaxDisplays = 3;
+  static const uint32_t kSubBucketBits = 2;
+  static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+  static const uint32_t kMaxValueBits = 24;  // Values of 2^24us and above share the last bucket.
+  // Values below kSubBuckets get a bucket each, every power of two above gets kSubBuckets.
+  static const uint32_t kNumBuckets = kSubBuckets * (kMaxValueBits - kSubBucketBits + 1);
+
+  struct Histogram {
+    std::atomic<uint64_t> buckets[kNumBuckets];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+  };
+
+  static uint32_t GetBucket(uint64_t value);
+  static uint64_t GetBucketUpperBound(uint32_t bucket);
+  static uint64_t GetPercentile(const uint64_t *buckets, uint64_t count, uint32_t percent);
+
+  static Histogram histograms_[kMaxDisplays][kFrameTimingMax];
+};
+
+// Records the time spent in the enclosing scope.
+class FrameTimingScope {
+ public:
+  FrameTimingScope(uint32_t display, FrameTimingStage stage)
+    : display_(display), stage_(stage), start_us_(FrameTiming::GetTimeUs()) { }
+  ~FrameTimingScope() {
+    FrameTiming::Record(display_, stage_, FrameTiming::GetTimeUs() - start_us_);
+  }
+
+ private:
+  uint32_t display_;
+  FrameTimingStage stage_;
+  uint64_t start_us_;
+};
+
+#define FRAME_TIMING_SCOPE(display, stage) FrameTimingScope frame_timing_scope(display, stage)
+
+}  // namespace sdm
+
+#endif  // __FRAME_TIMING_H__
+
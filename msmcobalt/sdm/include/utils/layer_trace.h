@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __LAYER_TRACE_H__
+#define __LAYER_TRACE_H__
+
+#include <stdint.h>
+#include <core/sdm_types.h>
+#include <core/layer_stack.h>
+#include <vector>
+
+namespace sdm {
+
+// Points of a composition cycle at which a timestamp is recorded in the trace.
+enum LayerTraceStage {
+  kTraceStageBuild,     // Client started translating its layers into the layer stack.
+  kTraceStagePrepare,   // Prepare() on the layer stack has returned.
+  kTraceStageCommit,    // Commit() on the layer stack has returned.
+  kTraceStageMax,
+};
+
+// On-disk layout of a layer stack trace. The file starts with a LayerTraceHeader followed by
+// max_frames fixed size slots. Each slot holds a LayerTraceFrameRecord followed by layer_count
+// LayerTraceLayerRecords. Slots are reused in a ring once max_frames frames have been written.
+struct LayerTraceHeader {
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint32_t max_frames = 0;      // Number of slots in the ring.
+  uint32_t slot_size = 0;       // Size of a slot in bytes.
+  uint64_t frame_count = 0;     // Total number of frames written, including overwritten ones.
+};
+
+struct LayerTraceFrameRecord {
+  uint64_t frame_index = 0;
+  uint64_t timestamp_ns[kTraceStageMax] = {};   // CLOCK_MONOTONIC, 0 if the stage was not run.
+  int32_t error[kTraceStageMax] = {};           // DisplayError returned by the stage.
+  uint32_t stack_flags = 0;
+  uint32_t layer_count = 0;
+  uint32_t output_format = 0;                   // Valid only if has_output_buffer is set.
+  uint32_t output_width = 0;
+  uint32_t output_height = 0;
+  uint32_t has_output_buffer = 0;
+};
+
+struct LayerTraceLayerRecord {
+  LayerRect src_rect;
+  LayerRect dst_rect;
+  LayerRect dirty_rects[4];         // Union of all dirty rects in the last entry when overflown.
+  uint32_t dirty_count = 0;
+  uint32_t visible_count = 0;
+  uint32_t composition = 0;
+  uint32_t blending = 0;
+  float rotation = 0.0f;
+  uint32_t flip_flags = 0;
+  uint32_t layer_flags = 0;
+  uint32_t plane_alpha = 0;
+  uint32_t frame_rate = 0;
+  uint32_t solid_fill_color = 0;
+  uint32_t has_buffer = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t unaligned_width = 0;
+  uint32_t unaligned_height = 0;
+  uint32_t format = 0;
+  uint32_t csc = 0;
+  uint32_t igc = 0;
+  uint32_t buffer_flags = 0;
+  uint32_t s3d_format = 0;
+  uint64_t buffer_id = 0;
+};
+
+// Writes the layer stack of every composition cycle of a display into a binary ring file.
+class LayerTraceWriter {
+ public:
+  static const uint32_t kMaxLayers = 32;
+
+  ~LayerTraceWriter() { Deinit(); }
+  DisplayError Init(const char *path, uint32_t max_frames);
+  void Deinit();
+  bool IsEnabled() { return (fd_ >= 0); }
+  void MarkStage(LayerTraceStage stage, DisplayError error = kErrorNone);
+  DisplayError Write(const LayerStack &layer_stack);
+
+ private:
+  int fd_ = -1;
+  LayerTraceHeader header_;
+  LayerTraceFrameRecord frame_;
+  std::vector<LayerTraceLayerRecord> layers_;
+};
+
+// A frame read back from a trace file. layer_stack points into layers and buffers, so that the
+// frame can be fed to Prepare()/Commit() as is. Buffer file descriptors and fences are invalid.
+struct LayerTraceFrame {
+  LayerTraceFrameRecord record;
+  LayerStack layer_stack;
+  std::vector<Layer> layers;
+  std::vector<LayerBuffer> buffers;
+  LayerBuffer output_buffer;
+  std::vector<LayerComposition> compositions;   // Composition decided when the trace was taken.
+};
+
+class LayerTraceReader {
+ public:
+  ~LayerTraceReader() { Close(); }
+  DisplayError Open(const char *path);
+  void Close();
+  uint32_t GetFrameCount();
+  DisplayError ReadFrame(uint32_t index, LayerTraceFrame *frame);   // index 0 is the oldest frame
+
+ private:
+  int fd_ = -1;
+  LayerTraceHeader header_;
+};
+
+}  // namespace sdm
+
+#endif  // __LAYER_TRACE_H__
+
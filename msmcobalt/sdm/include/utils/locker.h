@@ -124,7 +124,7 @@ class Locker {
     Locker &locker_;
   };
 
-  Locker() : sequence_wait_(0) {
+  Locker() : sequence_wait_(0), contention_count_(0) {
     pthread_mutex_init(&mutex_, 0);
     pthread_cond_init(&condition_, 0);
   }
@@ -134,7 +134,12 @@ class Locker {
     pthread_cond_destroy(&condition_);
   }
 
-  void Lock() { pthread_mutex_lock(&mutex_); }
+  void Lock() {
+    if (pthread_mutex_trylock(&mutex_) != 0) {
+      pthread_mutex_lock(&mutex_);
+      contention_count_++;
+    }
+  }
   void Unlock() { pthread_mutex_unlock(&mutex_); }
   void Signal() { pthread_cond_signal(&condition_); }
   void Broadcast() { pthread_cond_broadcast(&condition_); }
@@ -149,6 +154,7 @@ class Locker {
     ts.tv_nsec %= 1000000000L;
     return pthread_cond_timedwait(&condition_, &mutex_, &ts);
   }
+  uint64_t GetContentionCount() { return contention_count_; }
 
  private:
   pthread_mutex_t mutex_;
@@ -158,6 +164,7 @@ class Locker {
                         // so that capturing a transitionary snapshot of context is prevented.
                         // If flag is set to -1, these routines will exit without doing any
                         // further processing.
+  uint64_t contention_count_;  // Number of Lock() calls that found the mutex already held.
 };
 
 }  // namespace sdm
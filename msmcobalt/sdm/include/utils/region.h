@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __REGION_H__
+#define __REGION_H__
+
+#include <stdint.h>
+#include <core/layer_stack.h>
+#include <vector>
+
+namespace sdm {
+
+// Rectangle of a region in whole pixels, right and bottom exclusive. Four packed 32-bit words, so
+// that a rect list is a flat array which loops over all rects can process in vector registers.
+struct RegionRect {
+  int32_t left = 0;
+  int32_t top = 0;
+  int32_t right = 0;
+  int32_t bottom = 0;
+
+  RegionRect() { }
+  RegionRect(int32_t l, int32_t t, int32_t r, int32_t b) : left(l), top(t), right(r), bottom(b) { }
+
+  bool operator==(const RegionRect &rect) const {
+    return (left == rect.left && top == rect.top && right == rect.right && bottom == rect.bottom);
+  }
+};
+
+// Area made of any number of rectangles, held as a banded rect list like Android's Region. Rects
+// are sorted top to bottom into bands of equal top and bottom, and left to right within a band.
+// Rects of a band neither overlap nor touch, and vertically adjacent bands with the same spans are
+// merged. Hence two regions covering the same pixels hold the same rect list.
+class Region {
+ public:
+  Region() { }
+  // Rects of fractional coordinates are grown to whole pixels, so that no covered pixel is lost.
+  explicit Region(const LayerRect &rect);
+  explicit Region(const LayerRectArray &rect_array);
+
+  bool IsEmpty() const { return rects_.empty(); }
+  bool IsCongruent(const Region &region) const { return rects_ == region.rects_; }
+  uint32_t GetCount() const { return static_cast<uint32_t>(rects_.size()); }
+  const RegionRect *GetRects() const { return rects_.data(); }
+  void GetLayerRects(std::vector<LayerRect> *rects) const;
+  LayerRect GetBounds() const;
+  uint64_t GetArea() const;
+  void Clear() { rects_.clear(); }
+
+  void Union(const Region &region);
+  void Union(const LayerRect &rect) { Union(Region(rect)); }
+  void Intersect(const Region &region);
+  void Intersect(const LayerRect &rect) { Intersect(Region(rect)); }
+  void Subtract(const Region &region);
+  void Subtract(const LayerRect &rect) { Subtract(Region(rect)); }
+  void Translate(int32_t x_offset, int32_t y_offset);
+  // Flips and then rotates clockwise by 90 degrees within a width x height domain, as a layer
+  // transform maps its source onto the destination.
+  void Transform(const LayerTransform &transform, int32_t width, int32_t height);
+
+ private:
+  enum Operation {
+    kOperationUnion,
+    kOperationIntersect,
+    kOperationSubtract,
+  };
+
+  static bool IsInside(Operation operation, bool in_first, bool in_second);
+  static void Combine(const Region &first, const Region &second, Operation operation,
+                      Region *result);
+  static void CombineSpans(const RegionRect *first, uint32_t first_count,
+                           const RegionRect *second, uint32_t second_count, Operation operation,
+                           int32_t top, int32_t bottom, std::vector<RegionRect> *rects);
+  static uint32_t GetBandEnd(const std::vector<RegionRect> &rects, uint32_t band_begin);
+  static uint32_t CoalesceBand(std::vector<RegionRect> *rects, uint32_t last_band,
+                               uint32_t band_begin);
+
+  std::vector<RegionRect> rects_;
+};
+
+}  // namespace sdm
+
+#endif  // __REGION_H__
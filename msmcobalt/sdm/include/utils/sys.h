@@ -31,6 +31,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <pthread.h>
 #include <fstream>
 
@@ -65,6 +67,11 @@ class Sys {
   typedef ssize_t (*read)(int, void *, size_t);
   typedef ssize_t (*write)(int, const void *, size_t);
   typedef int (*eventfd)(unsigned int, int);
+  typedef int (*epoll_create1)(int);
+  typedef int (*epoll_ctl)(int, int, int, struct epoll_event *);
+  typedef int (*epoll_wait)(int, struct epoll_event *, int, int);
+  typedef int (*timerfd_create)(int, int);
+  typedef int (*timerfd_settime)(int, int, const struct itimerspec *, struct itimerspec *);
 
   static bool getline_(fstream &fs, std::string &line);  // NOLINT
 
@@ -80,6 +87,11 @@ class Sys {
   static read read_;
   static write write_;
   static eventfd eventfd_;
+  static epoll_create1 epoll_create1_;
+  static epoll_ctl epoll_ctl_;
+  static epoll_wait epoll_wait_;
+  static timerfd_create timerfd_create_;
+  static timerfd_settime timerfd_settime_;
 };
 
 class DynLib {
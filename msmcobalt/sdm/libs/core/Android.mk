@@ -17,6 +17,8 @@ LOCAL_SRC_FILES               := core_interface.cpp \
                                  display_virtual.cpp \
                                  comp_manager.cpp \
                                  strategy.cpp \
+                                 strategy_default.cpp \
+                                 partial_update_default.cpp \
                                  resource_default.cpp \
                                  dump_impl.cpp \
                                  color_manager.cpp \
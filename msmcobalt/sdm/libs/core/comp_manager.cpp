@@ -22,8 +22,10 @@
 * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <inttypes.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/frame_timing.h>
 #include <core/buffer_allocator.h>
 
 #include "comp_manager.h"
@@ -33,6 +35,18 @@
 
 namespace sdm {
 
+// 64-bit FNV-1a, used to fingerprint the layer stack attributes which decide the composition.
+static const uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ULL;
+static const uint64_t kFnvPrime = 0x100000001b3ULL;
+
+template <class T>
+static inline void HashValue(const T &value, uint64_t *hash) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+  for (size_t i = 0; i < sizeof(T); i++) {
+    *hash = (*hash ^ bytes[i]) * kFnvPrime;
+  }
+}
+
 DisplayError CompManager::Init(const HWResourceInfo &hw_res_info,
                                ExtensionInterface *extension_intf,
                                BufferSyncHandler *buffer_sync_handler) {
@@ -53,6 +67,7 @@ DisplayError CompManager::Init(const HWResourceInfo &hw_res_info,
 
   hw_res_info_ = hw_res_info;
   extension_intf_ = extension_intf;
+  disable_comp_cache_ = Debug::IsCompositionCacheDisabled();
 
   return error;
 }
@@ -164,16 +179,31 @@ DisplayError CompManager::ReconfigureDisplay(Handle comp_handle,
                                              const HWPanelInfo &hw_panel_info,
                                              const HWMixerAttributes &mixer_attributes,
                                              const DisplayConfigVariableInfo &fb_config) {
-  SCOPE_LOCK(locker_);
-
   DisplayError error = kErrorNone;
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(comp_handle);
 
-  error = resource_intf_->ReconfigureDisplay(display_comp_ctx->display_resource_ctx,
-                                             display_attributes, hw_panel_info, mixer_attributes);
-  if (error != kErrorNone) {
-    return error;
+  SCOPE_LOCK(display_comp_ctx->locker);
+  display_comp_ctx->cache.valid = false;
+
+  {
+    SCOPE_LOCK(locker_);
+    error = resource_intf_->ReconfigureDisplay(display_comp_ctx->display_resource_ctx,
+                                               display_attributes, hw_panel_info,
+                                               mixer_attributes);
+    if (error != kErrorNone) {
+      return error;
+    }
+
+    // For HDMI S3D mode, set max_layers_ to 0 so that primary display would fall back
+    // to GPU composition to release pipes for HDMI.
+    if (display_comp_ctx->display_type == kHDMI) {
+      if (hw_panel_info.s3d_mode != kS3DModeNone) {
+        max_layers_ = 0;
+      } else {
+        max_layers_ = kMaxSDELayers;
+      }
+    }
   }
 
   if (display_comp_ctx->strategy) {
@@ -188,16 +218,6 @@ DisplayError CompManager::ReconfigureDisplay(Handle comp_handle,
     }
   }
 
-  // For HDMI S3D mode, set max_layers_ to 0 so that primary display would fall back
-  // to GPU composition to release pipes for HDMI.
-  if (display_comp_ctx->display_type == kHDMI) {
-    if (hw_panel_info.s3d_mode != kS3DModeNone) {
-      max_layers_ = 0;
-    } else {
-      max_layers_ = kMaxSDELayers;
-    }
-  }
-
   return error;
 }
 
@@ -206,9 +226,12 @@ void CompManager::PrepareStrategyConstraints(Handle comp_handle, HWLayers *hw_la
                              reinterpret_cast<DisplayCompositionContext *>(comp_handle);
   StrategyConstraints *constraints = &display_comp_ctx->constraints;
 
-  constraints->safe_mode = safe_mode_;
+  {
+    SCOPE_LOCK(locker_);
+    constraints->safe_mode = safe_mode_;
+    constraints->max_layers = max_layers_;
+  }
   constraints->use_cursor = false;
-  constraints->max_layers = max_layers_;
 
   // Limit 2 layer SDE Comp if its not a Primary Display
   if (!display_comp_ctx->is_primary_panel) {
@@ -234,40 +257,54 @@ void CompManager::PrepareStrategyConstraints(Handle comp_handle, HWLayers *hw_la
 }
 
 void CompManager::PrePrepare(Handle display_ctx, HWLayers *hw_layers) {
-  SCOPE_LOCK(locker_);
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+  SCOPE_LOCK(display_comp_ctx->locker);
   display_comp_ctx->strategy->Start(&hw_layers->info, &display_comp_ctx->max_strategies,
                                     display_comp_ctx->partial_update_enable);
   display_comp_ctx->remaining_strategies = display_comp_ctx->max_strategies;
 }
 
 DisplayError CompManager::Prepare(Handle display_ctx, HWLayers *hw_layers) {
-  SCOPE_LOCK(locker_);
-
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
   Handle &display_resource_ctx = display_comp_ctx->display_resource_ctx;
 
+  SCOPE_LOCK(display_comp_ctx->locker);
+  FRAME_TIMING_SCOPE(display_comp_ctx->display_type, kFrameTimingPrepare);
+
   DisplayError error = kErrorUndefined;
 
   PrepareStrategyConstraints(display_ctx, hw_layers);
 
-  // Select a composition strategy, and try to allocate resources for it.
-  resource_intf_->Start(display_resource_ctx);
+  // Reuse the composition of the last committed frame, if the layer stack has not changed since.
+  if (display_comp_ctx->remaining_strategies == display_comp_ctx->max_strategies) {
+    display_comp_ctx->cache_hit = ReplayComposition(display_ctx, hw_layers);
+    if (display_comp_ctx->cache_hit) {
+      return kErrorNone;
+    }
+  }
 
+  // Select a composition strategy, and try to allocate resources for it. Strategy selection only
+  // touches this display, so displays pick their strategies concurrently. Resources are
+  // arbitrated across displays from Start() to Stop() of each attempt; an attempt which fails to
+  // acquire them leaves nothing reserved.
   bool exit = false;
   uint32_t &count = display_comp_ctx->remaining_strategies;
   for (; !exit && count > 0; count--) {
+    FRAME_TIMING_SCOPE(display_comp_ctx->display_type, kFrameTimingStrategy);
     error = display_comp_ctx->strategy->GetNextStrategy(&display_comp_ctx->constraints);
     if (error != kErrorNone) {
-      // Composition strategies exhausted. Resource Manager could not allocate resources even for
-      // GPU composition. This will never happen.
+      // Composition strategies exhausted. Resource Manager could not allocate resources even
+      // for GPU composition. This will never happen.
       exit = true;
     }
 
     if (!exit) {
+      SCOPE_LOCK(locker_);
+      resource_intf_->Start(display_resource_ctx);
       error = resource_intf_->Acquire(display_resource_ctx, hw_layers);
+      resource_intf_->Stop(display_resource_ctx);
       // Exit if successfully allocated resource, else try next strategy.
       exit = (error == kErrorNone);
     }
@@ -277,88 +314,122 @@ DisplayError CompManager::Prepare(Handle display_ctx, HWLayers *hw_layers) {
     DLOGE("Composition strategies exhausted for display = %d", display_comp_ctx->display_type);
   }
 
-  resource_intf_->Stop(display_resource_ctx);
-
   return error;
 }
 
 DisplayError CompManager::PostPrepare(Handle display_ctx, HWLayers *hw_layers) {
-  SCOPE_LOCK(locker_);
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
   Handle &display_resource_ctx = display_comp_ctx->display_resource_ctx;
 
+  SCOPE_LOCK(display_comp_ctx->locker);
   DisplayError error = kErrorNone;
-  error = resource_intf_->PostPrepare(display_resource_ctx, hw_layers);
-  if (error != kErrorNone) {
-    return error;
+  {
+    SCOPE_LOCK(locker_);
+    error = resource_intf_->PostPrepare(display_resource_ctx, hw_layers);
+    if (error != kErrorNone) {
+      return error;
+    }
   }
 
   display_comp_ctx->strategy->Stop();
 
+  uint32_t attempts = 0;
+  if (!display_comp_ctx->cache_hit) {
+    attempts = display_comp_ctx->max_strategies - display_comp_ctx->remaining_strategies;
+  }
+  FrameTiming::Record(display_comp_ctx->display_type, kFrameTimingStrategyAttempts, attempts);
+
   return kErrorNone;
 }
 
-DisplayError CompManager::ReConfigure(Handle display_ctx, HWLayers *hw_layers) {
-  SCOPE_LOCK(locker_);
+bool CompManager::IsCompositionReplayed(Handle display_ctx) {
+  DisplayCompositionContext *display_comp_ctx =
+                             reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+  SCOPE_LOCK(display_comp_ctx->locker);
+
+  return display_comp_ctx->cache_hit;
+}
 
+DisplayError CompManager::ReConfigure(Handle display_ctx, HWLayers *hw_layers) {
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
   Handle &display_resource_ctx = display_comp_ctx->display_resource_ctx;
 
   DisplayError error = kErrorUndefined;
-  resource_intf_->Start(display_resource_ctx);
-  error = resource_intf_->Acquire(display_resource_ctx, hw_layers);
 
-  if (error != kErrorNone) {
-    DLOGE("Reconfigure failed for display = %d", display_comp_ctx->display_type);
-  }
+  SCOPE_LOCK(display_comp_ctx->locker);
+  // Resources are reallocated for the attributes of current frame, which are not part of the cache.
+  display_comp_ctx->cache.valid = false;
+  display_comp_ctx->cache_hit = false;
+  display_comp_ctx->update_cache = false;
 
-  resource_intf_->Stop(display_resource_ctx);
-  if (error != kErrorNone) {
-      error = resource_intf_->PostPrepare(display_resource_ctx, hw_layers);
+  {
+    SCOPE_LOCK(locker_);
+    resource_intf_->Start(display_resource_ctx);
+    error = resource_intf_->Acquire(display_resource_ctx, hw_layers);
+
+    if (error != kErrorNone) {
+      DLOGE("Reconfigure failed for display = %d", display_comp_ctx->display_type);
+    }
+
+    resource_intf_->Stop(display_resource_ctx);
+    if (error != kErrorNone) {
+        error = resource_intf_->PostPrepare(display_resource_ctx, hw_layers);
+    }
   }
 
   return error;
 }
 
 DisplayError CompManager::PostCommit(Handle display_ctx, HWLayers *hw_layers) {
-  SCOPE_LOCK(locker_);
-
   DisplayError error = kErrorNone;
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
-  configured_displays_[display_comp_ctx->display_type] = 1;
-  if (configured_displays_ == registered_displays_) {
-    safe_mode_ = false;
-  }
 
-  error = resource_intf_->PostCommit(display_comp_ctx->display_resource_ctx, hw_layers);
-  if (error != kErrorNone) {
-    return error;
+  SCOPE_LOCK(display_comp_ctx->locker);
+  FRAME_TIMING_SCOPE(display_comp_ctx->display_type, kFrameTimingPostCommit);
+  {
+    SCOPE_LOCK(locker_);
+    configured_displays_[display_comp_ctx->display_type] = 1;
+    if (configured_displays_ == registered_displays_) {
+      safe_mode_ = false;
+    }
+
+    error = resource_intf_->PostCommit(display_comp_ctx->display_resource_ctx, hw_layers);
+    if (error != kErrorNone) {
+      return error;
+    }
+
+    DLOGV_IF(kTagCompManager, "registered display bit mask 0x%x, configured display bit mask " \
+             "0x%x, display type %d", registered_displays_, configured_displays_,
+             display_comp_ctx->display_type);
   }
 
   display_comp_ctx->idle_fallback = false;
 
-  DLOGV_IF(kTagCompManager, "registered display bit mask 0x%x, configured display bit mask 0x%x, " \
-           "display type %d", registered_displays_, configured_displays_,
-           display_comp_ctx->display_type);
+  if (display_comp_ctx->update_cache) {
+    CacheComposition(display_ctx, hw_layers);
+    display_comp_ctx->update_cache = false;
+  }
 
   return kErrorNone;
 }
 
 void CompManager::Purge(Handle display_ctx) {
-  SCOPE_LOCK(locker_);
-
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
 
-  resource_intf_->Purge(display_comp_ctx->display_resource_ctx);
+  SCOPE_LOCK(display_comp_ctx->locker);
+  {
+    SCOPE_LOCK(locker_);
+    resource_intf_->Purge(display_comp_ctx->display_resource_ctx);
+  }
+  display_comp_ctx->cache.valid = false;
+  display_comp_ctx->update_cache = false;
 }
 
 void CompManager::ProcessIdleTimeout(Handle display_ctx) {
-  SCOPE_LOCK(locker_);
-
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
 
@@ -366,47 +437,187 @@ void CompManager::ProcessIdleTimeout(Handle display_ctx) {
     return;
   }
 
+  SCOPE_LOCK(display_comp_ctx->locker);
+
   display_comp_ctx->idle_fallback = true;
+  display_comp_ctx->cache.valid = false;
 }
 
 void CompManager::ProcessThermalEvent(Handle display_ctx, int64_t thermal_level) {
-  SCOPE_LOCK(locker_);
-
   DisplayCompositionContext *display_comp_ctx =
           reinterpret_cast<DisplayCompositionContext *>(display_ctx);
 
+  SCOPE_LOCK(display_comp_ctx->locker);
+
   if (thermal_level >= kMaxThermalLevel) {
     display_comp_ctx->fallback_ = true;
   } else {
     display_comp_ctx->fallback_ = false;
   }
+  display_comp_ctx->cache.valid = false;
 }
 
 DisplayError CompManager::SetMaxMixerStages(Handle display_ctx, uint32_t max_mixer_stages) {
-  SCOPE_LOCK(locker_);
-
   DisplayError error = kErrorNone;
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
 
   if (display_comp_ctx) {
-    error = resource_intf_->SetMaxMixerStages(display_comp_ctx->display_resource_ctx,
-                                              max_mixer_stages);
+    SCOPE_LOCK(display_comp_ctx->locker);
+    {
+      SCOPE_LOCK(locker_);
+      error = resource_intf_->SetMaxMixerStages(display_comp_ctx->display_resource_ctx,
+                                                max_mixer_stages);
+    }
+    display_comp_ctx->cache.valid = false;
   }
 
   return error;
 }
 
-void CompManager::ControlPartialUpdate(Handle display_ctx, bool enable) {
-  SCOPE_LOCK(locker_);
+bool CompManager::ReplayComposition(Handle display_ctx, HWLayers *hw_layers) {
+  DisplayCompositionContext *display_comp_ctx =
+                             reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+  CompositionCache &cache = display_comp_ctx->cache;
+  const StrategyConstraints &constraints = display_comp_ctx->constraints;
+  HWLayersInfo &hw_layers_info = hw_layers->info;
+  LayerStack *layer_stack = hw_layers_info.stack;
+  std::vector<Layer *> &layers = layer_stack->layers;
+
+  if (disable_comp_cache_) {
+    display_comp_ctx->update_cache = false;
+    return false;
+  }
+
+  uint64_t layer_stack_hash = GetLayerStackHash(*hw_layers);
+  const HWLayersInfo &cached_info = cache.hw_layers.info;
+  bool hit = cache.valid && (cache.layer_stack_hash == layer_stack_hash) &&
+             (cache.compositions.size() == layers.size()) &&
+             (cache.constraints.safe_mode == constraints.safe_mode) &&
+             (cache.constraints.use_cursor == constraints.use_cursor) &&
+             (cache.constraints.max_layers == constraints.max_layers) &&
+             (cached_info.left_partial_update == hw_layers_info.left_partial_update) &&
+             (cached_info.right_partial_update == hw_layers_info.right_partial_update);
+
+  // Cache entry stays valid only if this frame gets committed. On a miss, the new composition is
+  // validated with the driver, which overwrites the configuration retained for the cached one.
+  display_comp_ctx->update_cache = true;
+  cache.valid = false;
+
+  if (!hit) {
+    cache.layer_stack_hash = layer_stack_hash;
+    cache.constraints = constraints;
+    return false;
+  }
+
+  HWAVRInfo hw_avr_info = hw_layers->hw_avr_info;
+  *hw_layers = cache.hw_layers;
+  hw_layers->info.stack = layer_stack;
+  hw_layers->hw_avr_info = hw_avr_info;
 
+  for (uint32_t i = 0; i < layers.size(); i++) {
+    layers.at(i)->composition = cache.compositions.at(i);
+  }
+
+  DLOGV_IF(kTagCompManager, "Composition replayed for display %d, SDE layer count %d",
+           display_comp_ctx->display_type, hw_layers->info.count);
+
+  return true;
+}
+
+void CompManager::CacheComposition(Handle display_ctx, HWLayers *hw_layers) {
+  DisplayCompositionContext *display_comp_ctx =
+                             reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+  CompositionCache &cache = display_comp_ctx->cache;
+  std::vector<Layer *> &layers = hw_layers->info.stack->layers;
+
+  if (display_comp_ctx->cache_hit) {
+    cache.valid = true;
+    return;
+  }
+
+  // Rotator sessions are prepared with the buffers of each frame, hence can not be replayed.
+  for (uint32_t i = 0; i < hw_layers->info.count; i++) {
+    if (hw_layers->config[i].hw_rotator_session.hw_block_count) {
+      return;
+    }
+  }
+
+  cache.hw_layers = *hw_layers;
+  cache.hw_layers.info.stack = NULL;
+  cache.hw_layers.info.sync_handle = -1;
+
+  cache.compositions.resize(layers.size());
+  for (uint32_t i = 0; i < layers.size(); i++) {
+    cache.compositions.at(i) = layers.at(i)->composition;
+  }
+
+  cache.valid = true;
+}
+
+uint64_t CompManager::GetLayerStackHash(const HWLayers &hw_layers) {
+  const LayerStack *layer_stack = hw_layers.info.stack;
+  uint64_t hash = kFnvOffsetBasis;
+
+  // Flags which do not alter the composition of an unchanged layer stack are left out.
+  LayerStackFlags stack_flags = layer_stack->flags;
+  stack_flags.geometry_changed = 0;
+  stack_flags.attributes_changed = 0;
+  HashValue(stack_flags.flags, &hash);
+  HashValue(hw_layers.hw_avr_info.enable, &hash);
+  HashValue(hw_layers.hw_avr_info.mode, &hash);
+
+  for (const Layer *layer : layer_stack->layers) {
+    const LayerBuffer *input_buffer = layer->input_buffer;
+    bool gpu_target = (layer->composition == kCompositionGPUTarget);
+
+    HashValue(gpu_target, &hash);
+    HashValue(layer->src_rect, &hash);
+    HashValue(layer->dst_rect, &hash);
+    HashValue(layer->transform.rotation, &hash);
+    HashValue(layer->transform.flip_horizontal, &hash);
+    HashValue(layer->transform.flip_vertical, &hash);
+    HashValue(layer->blending, &hash);
+    HashValue(layer->plane_alpha, &hash);
+    HashValue(layer->solid_fill_color, &hash);
+    HashValue(layer->flags.flags, &hash);
+    if (input_buffer) {
+      HashValue(input_buffer->width, &hash);
+      HashValue(input_buffer->height, &hash);
+      HashValue(input_buffer->unaligned_width, &hash);
+      HashValue(input_buffer->unaligned_height, &hash);
+      HashValue(input_buffer->format, &hash);
+      HashValue(input_buffer->csc, &hash);
+      HashValue(input_buffer->igc, &hash);
+      HashValue(input_buffer->flags.flags, &hash);
+      HashValue(input_buffer->s3d_format, &hash);
+    }
+  }
+
+  const LayerBuffer *output_buffer = layer_stack->output_buffer;
+  if (output_buffer) {
+    HashValue(output_buffer->width, &hash);
+    HashValue(output_buffer->height, &hash);
+    HashValue(output_buffer->format, &hash);
+    HashValue(output_buffer->csc, &hash);
+    HashValue(output_buffer->flags.flags, &hash);
+  }
+
+  return hash;
+}
+
+void CompManager::ControlPartialUpdate(Handle display_ctx, bool enable) {
   DisplayCompositionContext *display_comp_ctx =
                              reinterpret_cast<DisplayCompositionContext *>(display_ctx);
+
+  SCOPE_LOCK(display_comp_ctx->locker);
   display_comp_ctx->partial_update_enable = enable;
 }
 
 void CompManager::AppendDump(char *buffer, uint32_t length) {
   SCOPE_LOCK(locker_);
+  DumpImpl::AppendString(buffer, length, "\nresource lock contention: %" PRIu64,
+                         locker_.GetContentionCount());
 }
 
 DisplayError CompManager::ValidateScaling(const LayerRect &crop, const LayerRect &dst,
@@ -447,9 +658,10 @@ bool CompManager::SupportLayerAsCursor(Handle comp_handle, HWLayers *hw_layers)
     return supported;
   }
   Layer *cursor_layer = layer_stack->layers.at(UINT32(gpu_index) - 1);
-  if (cursor_layer->flags.cursor && resource_intf_->ValidateCursorConfig(display_resource_ctx,
-                                    cursor_layer, true) == kErrorNone) {
-    supported = true;
+  if (cursor_layer->flags.cursor) {
+    SCOPE_LOCK(locker_);
+    supported = (resource_intf_->ValidateCursorConfig(display_resource_ctx, cursor_layer,
+                                                      true) == kErrorNone);
   }
 
   return supported;
@@ -29,6 +29,7 @@
 #include <private/extension_interface.h>
 #include <utils/locker.h>
 #include <bitset>
+#include <vector>
 
 #include "strategy.h"
 #include "resource_default.h"
@@ -54,6 +55,7 @@ class CompManager : public DumpImpl {
   void PrePrepare(Handle display_ctx, HWLayers *hw_layers);
   DisplayError Prepare(Handle display_ctx, HWLayers *hw_layers);
   DisplayError PostPrepare(Handle display_ctx, HWLayers *hw_layers);
+  bool IsCompositionReplayed(Handle display_ctx);
   DisplayError ReConfigure(Handle display_ctx, HWLayers *hw_layers);
   DisplayError PostCommit(Handle display_ctx, HWLayers *hw_layers);
   void Purge(Handle display_ctx);
@@ -76,8 +78,24 @@ class CompManager : public DumpImpl {
   static const int kMaxThermalLevel = 3;
 
   void PrepareStrategyConstraints(Handle display_ctx, HWLayers *hw_layers);
+  bool ReplayComposition(Handle display_ctx, HWLayers *hw_layers);
+  void CacheComposition(Handle display_ctx, HWLayers *hw_layers);
+  uint64_t GetLayerStackHash(const HWLayers &hw_layers);
 
+  // Composition of the last committed frame. HWDevice retains the driver configuration of the last
+  // validated frame, so a layer stack which hashes the same can be committed again as is.
+  struct CompositionCache {
+    bool valid = false;
+    uint64_t layer_stack_hash = 0;
+    StrategyConstraints constraints;
+    HWLayers hw_layers;
+    std::vector<LayerComposition> compositions;
+  };
+
+  // Per display state is guarded by the display's own lock, so that displays prepare and commit
+  // concurrently. locker_ is taken after it, only around state and resources shared by displays.
   struct DisplayCompositionContext {
+    Locker locker;
     Strategy *strategy = NULL;
     StrategyConstraints constraints;
     Handle display_resource_ctx = NULL;
@@ -90,6 +108,9 @@ class CompManager : public DumpImpl {
     // Using primary panel flag of hw panel to configure Constraints. We do not need other hw
     // panel parameters for now.
     bool is_primary_panel = false;
+    CompositionCache cache;
+    bool cache_hit = false;         // Composition of the current frame is replayed from the cache
+    bool update_cache = false;      // Cache the composition of the current frame on commit
   };
 
   Locker locker_;
@@ -103,6 +124,7 @@ class CompManager : public DumpImpl {
   HWResourceInfo hw_res_info_;
   ExtensionInterface *extension_intf_ = NULL;
   uint32_t max_layers_ = kMaxSDELayers;
+  bool disable_comp_cache_ = false;
 };
 
 }  // namespace sdm
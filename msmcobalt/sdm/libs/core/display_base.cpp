@@ -26,6 +26,7 @@
 #include <utils/constants.h>
 #include <utils/debug.h>
 #include <utils/formats.h>
+#include <utils/frame_timing.h>
 #include <utils/rect.h>
 #include <string>
 #include <vector>
@@ -237,10 +238,17 @@ DisplayError DisplayBase::Prepare(LayerStack *layer_stack) {
       break;
     }
 
+    // Composition of the last committed frame is reused, driver already holds its configuration.
+    if (comp_manager_->IsCompositionReplayed(display_comp_ctx_)) {
+      pending_commit_ = true;
+      break;
+    }
+
     if (IsRotationRequired(&hw_layers_)) {
       if (!rotator_intf_) {
         continue;
       }
+      FRAME_TIMING_SCOPE(display_type_, kFrameTimingRotatorPrepare);
       error = rotator_intf_->Prepare(display_rotator_ctx_, &hw_layers_);
     } else {
       // Release all the previous rotator sessions.
@@ -412,6 +420,26 @@ DisplayError DisplayBase::GetVSyncState(bool *enabled) {
   return kErrorNone;
 }
 
+DisplayError DisplayBase::GetVSyncTiming(DisplayVSyncTiming *timing) {
+  if (!timing) {
+    return kErrorParameters;
+  }
+
+  // Measured timing is read without the display lock, so that a vsync consumer does not contend
+  // with an ongoing Prepare() or Commit().
+  *timing = {};
+  if (hw_events_intf_ && hw_events_intf_->GetVSyncTiming(timing) == kErrorNone &&
+      timing->sample_count) {
+    return kErrorNone;
+  }
+
+  lock_guard<recursive_mutex> obj(recursive_mutex_);
+  timing->period_ns = display_attributes_.vsync_period_ns;
+  timing->sample_count = 0;
+
+  return kErrorNone;
+}
+
 DisplayError DisplayBase::SetDisplayState(DisplayState state) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
   DisplayError error = kErrorNone;
@@ -525,6 +553,14 @@ void DisplayBase::AppendDump(char *buffer, uint32_t length) {
 
   DisplayConfigVariableInfo &info = attrib;
 
+  DisplayVSyncTiming vsync_timing;
+  if (hw_events_intf_ && hw_events_intf_->GetVSyncTiming(&vsync_timing) == kErrorNone &&
+      vsync_timing.sample_count) {
+    DumpImpl::AppendString(buffer, length, "\nvsync period: %u ns, jitter: %u ns, samples: %u",
+                           vsync_timing.period_ns, vsync_timing.jitter_ns,
+                           vsync_timing.sample_count);
+  }
+
   uint32_t num_hw_layers = 0;
   if (hw_layers_.info.stack) {
     num_hw_layers = hw_layers_.info.count;
@@ -836,6 +872,10 @@ DisplayError DisplayBase::SetVSyncState(bool enable) {
     error = hw_intf_->SetVSyncState(enable);
     if (error == kErrorNone) {
       vsync_enable_ = enable;
+      // Bridges the latency of the hardware vsync to turn back on with predicted vsync.
+      if (hw_events_intf_) {
+        hw_events_intf_->SetVSyncState(enable, display_attributes_.vsync_period_ns);
+      }
     }
   }
   return error;
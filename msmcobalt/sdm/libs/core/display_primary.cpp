@@ -144,6 +144,9 @@ DisplayError DisplayPrimary::SetDisplayState(DisplayState state) {
   // Set vsync enable state to false, as driver disables vsync during display power off.
   if (state == kStateOff) {
     vsync_enable_ = false;
+    if (hw_events_intf_) {
+      hw_events_intf_->SetVSyncState(false, 0);
+    }
   }
 
   return kErrorNone;
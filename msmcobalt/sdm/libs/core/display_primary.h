@@ -64,7 +64,7 @@ class DisplayPrimary : public DisplayBase, HWEventHandler {
 
   uint32_t idle_timeout_ms_ = 0;
   std::vector<const char *> event_list_ = {"vsync_event", "show_blank_event", "idle_notify",
-                                           "msm_fb_thermal_level", "thread_exit"};
+                                           "msm_fb_thermal_level"};
   bool avr_prop_disabled_ = false;
 };
 
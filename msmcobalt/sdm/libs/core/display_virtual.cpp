@@ -28,6 +28,7 @@
 #include "display_virtual.h"
 #include "hw_interface.h"
 #include "hw_info_interface.h"
+#include "hw_events_interface.h"
 
 #define __CLASS__ "DisplayVirtual"
 
@@ -54,9 +55,17 @@ DisplayError DisplayVirtual::Init() {
   error = DisplayBase::Init();
   if (error != kErrorNone) {
     HWInterface::Destroy(hw_intf_);
+    return error;
   }
 
-  return error;
+  // Vsync is generated in software, a display without it is still usable.
+  if (HWEventsInterface::Create(INT(display_type_), this, &event_list_, &hw_events_intf_) !=
+      kErrorNone) {
+    DLOGW("Failed to create hardware events interface, vsync is not supported");
+    hw_events_intf_ = NULL;
+  }
+
+  return kErrorNone;
 }
 
 DisplayError DisplayVirtual::GetNumVariableInfoConfigs(uint32_t *count) {
@@ -130,6 +139,40 @@ DisplayError DisplayVirtual::SetActiveConfig(DisplayConfigVariableInfo *variable
   return kErrorNone;
 }
 
+DisplayError DisplayVirtual::SetVSyncState(bool enable) {
+  lock_guard<recursive_mutex> obj(recursive_mutex_);
+  if (!hw_events_intf_) {
+    return kErrorNotSupported;
+  }
+
+  if (vsync_enable_ == enable) {
+    return kErrorNone;
+  }
+
+  // Virtual display attributes carry the frame rate only.
+  uint32_t period_ns = display_attributes_.vsync_period_ns;
+  if (!period_ns && display_attributes_.fps) {
+    period_ns = UINT32(1000000000 / display_attributes_.fps);
+  }
+
+  DisplayError error = hw_events_intf_->SetVSyncState(enable, period_ns);
+  if (error == kErrorNone) {
+    vsync_enable_ = enable;
+  }
+
+  return error;
+}
+
+DisplayError DisplayVirtual::VSync(int64_t timestamp) {
+  if (vsync_enable_) {
+    DisplayEventVSync vsync;
+    vsync.timestamp = timestamp;
+    event_handler_->VSync(vsync);
+  }
+
+  return kErrorNone;
+}
+
 DisplayError DisplayVirtual::Prepare(LayerStack *layer_stack) {
   lock_guard<recursive_mutex> obj(recursive_mutex_);
 
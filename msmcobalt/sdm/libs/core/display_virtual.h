@@ -26,6 +26,8 @@
 #define __DISPLAY_VIRTUAL_H__
 
 #include <private/hw_info_types.h>
+#include <vector>
+
 #include "display_base.h"
 #include "dump_impl.h"
 
@@ -33,7 +35,7 @@ namespace sdm {
 
 class HWVirtualInterface;
 
-class DisplayVirtual : public DisplayBase {
+class DisplayVirtual : public DisplayBase, HWEventHandler {
  public:
   DisplayVirtual(DisplayEventHandler *event_handler, HWInfoInterface *hw_info_intf,
                  BufferSyncHandler *buffer_sync_handler, CompManager *comp_manager,
@@ -50,9 +52,7 @@ class DisplayVirtual : public DisplayBase {
   virtual DisplayError SetMixerResolution(uint32_t width, uint32_t height) {
     return kErrorNotSupported;
   }
-  virtual DisplayError SetVSyncState(bool enable) {
-    return kErrorNotSupported;
-  }
+  virtual DisplayError SetVSyncState(bool enable);
   virtual DisplayError SetRefreshRate(uint32_t refresh_rate) {
     return kErrorNotSupported;
   }
@@ -67,6 +67,17 @@ class DisplayVirtual : public DisplayBase {
     // on virtual display is functional.
     return kErrorNone;
   }
+
+  // Implement the HWEventHandlers
+  virtual DisplayError VSync(int64_t timestamp);
+  virtual DisplayError Blank(bool blank) { return kErrorNone; }
+  virtual void IdleTimeout() { }
+  virtual void ThermalEvent(int64_t thermal_level) { }
+  virtual void CECMessage(char *message) { }
+
+ private:
+  // No event nodes, the events interface only generates vsync for the virtual display.
+  std::vector<const char *> event_list_ = {};
 };
 
 }  // namespace sdm
@@ -42,6 +42,7 @@
 #include <linux/fb.h>
 #include <utils/constants.h>
 #include <utils/debug.h>
+#include <utils/frame_timing.h>
 #include <utils/sys.h>
 #include <vector>
 #include <algorithm>
@@ -144,6 +145,8 @@ DisplayError HWDevice::Init() {
     return kErrorResources;
   }
 
+  validate_reuse_ = Debug::IsValidateReuseEnabled();
+
   return HWScale::Create(&hw_scale_, hw_resource_.has_qseed3);
 }
 
@@ -193,6 +196,8 @@ DisplayError HWDevice::GetConfigIndex(uint32_t mode, uint32_t *index) {
 DisplayError HWDevice::PowerOn() {
   DTRACE_SCOPED();
 
+  validated_config_.clear();
+
   if (Sys::ioctl_(device_fd_, FBIOBLANK, FB_BLANK_UNBLANK) < 0) {
     if (errno == ESHUTDOWN) {
       DLOGI_IF(kTagDriverConfig, "Driver is processing shutdown sequence");
@@ -382,7 +387,21 @@ DisplayError HWDevice::Validate(HWLayers *hw_layers) {
   mdp_commit.dest_scaler_cnt = UINT32(hw_layer_info.dest_scale_info_map.size());
 
   mdp_commit.flags |= MDP_VALIDATE_LAYER;
-  if (Sys::ioctl_(device_fd_, INT(MSMFB_ATOMIC_COMMIT), &mdp_disp_commit_) < 0) {
+
+  // Driver retains the last validated configuration. A frame which programs the same pipes the
+  // same way, only with new buffers, needs no validation again.
+  bool reusable = validate_reuse_ && GetValidateConfig(mdp_commit, &validate_config_);
+  if (reusable && !validated_config_.empty() && (validate_config_ == validated_config_)) {
+    DLOGV_IF(kTagDriverConfig, "Validated configuration reused, SDE layer count %d",
+             mdp_layer_count);
+    return kErrorNone;
+  }
+
+  validated_config_.clear();
+  uint64_t start_us = FrameTiming::GetTimeUs();
+  int status = Sys::ioctl_(device_fd_, INT(MSMFB_ATOMIC_COMMIT), &mdp_disp_commit_);
+  FrameTiming::Record(device_type_, kFrameTimingValidate, FrameTiming::GetTimeUs() - start_us);
+  if (status < 0) {
     if (errno == ESHUTDOWN) {
       DLOGI_IF(kTagDriverConfig, "Driver is processing shutdown sequence");
       return kErrorShutDown;
@@ -392,9 +411,56 @@ DisplayError HWDevice::Validate(HWLayers *hw_layers) {
     return kErrorHardware;
   }
 
+  if (reusable) {
+    validated_config_.swap(validate_config_);
+  }
+
   return kErrorNone;
 }
 
+bool HWDevice::GetValidateConfig(const mdp_layer_commit_v1 &mdp_commit,
+                                 std::vector<uint8_t> *config) {
+  // Output buffers, destination scalers and IGC tables are programmed through data which is not
+  // captured here, such configurations are always validated.
+  if (device_type_ == kDeviceVirtual || mdp_commit.dest_scaler_cnt ||
+      (mdp_commit.flags & MDP_COMMIT_CWB_EN)) {
+    return false;
+  }
+
+  auto append = [config](const void *data, size_t size) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+    config->insert(config->end(), bytes, bytes + size);
+  };
+
+  uint32_t flags = mdp_commit.flags & UINT32(~MDP_COMMIT_WAIT_FOR_FINISH);
+  size_t scale_data_size = hw_scale_->GetScaleDataSize();
+
+  config->clear();
+  append(&flags, sizeof(flags));
+  append(&mdp_commit.left_roi, sizeof(mdp_commit.left_roi));
+  append(&mdp_commit.right_roi, sizeof(mdp_commit.right_roi));
+  append(&mdp_commit.input_layer_cnt, sizeof(mdp_commit.input_layer_cnt));
+
+  for (uint32_t i = 0; i < mdp_commit.input_layer_cnt; i++) {
+    mdp_input_layer mdp_layer = mdp_in_layers_[i];
+    if (mdp_layer.pp_info) {
+      return false;
+    }
+
+    // Buffers and fences are set on each commit, error code is written by the driver.
+    memset(mdp_layer.buffer.planes, 0, sizeof(mdp_layer.buffer.planes));
+    mdp_layer.buffer.plane_count = 0;
+    mdp_layer.buffer.fence = -1;
+    mdp_layer.error_code = 0;
+    append(&mdp_layer, sizeof(mdp_layer));
+    if (mdp_layer.scale) {
+      append(mdp_layer.scale, scale_data_size);
+    }
+  }
+
+  return true;
+}
+
 void HWDevice::DumpLayerCommit(const mdp_layer_commit &layer_commit) {
   const mdp_layer_commit_v1 &mdp_commit = layer_commit.commit_v1;
   const mdp_input_layer *mdp_layers = mdp_commit.input_layers;
@@ -504,7 +570,11 @@ DisplayError HWDevice::Commit(HWLayers *hw_layers) {
   if (synchronous_commit_) {
     mdp_commit.flags |= MDP_COMMIT_WAIT_FOR_FINISH;
   }
-  if (Sys::ioctl_(device_fd_, INT(MSMFB_ATOMIC_COMMIT), &mdp_disp_commit_) < 0) {
+  uint64_t start_us = FrameTiming::GetTimeUs();
+  int status = Sys::ioctl_(device_fd_, INT(MSMFB_ATOMIC_COMMIT), &mdp_disp_commit_);
+  FrameTiming::Record(device_type_, kFrameTimingCommit, FrameTiming::GetTimeUs() - start_us);
+  if (status < 0) {
+    validated_config_.clear();
     if (errno == ESHUTDOWN) {
       DLOGI_IF(kTagDriverConfig, "Driver is processing shutdown sequence");
       return kErrorShutDown;
@@ -525,6 +595,7 @@ DisplayError HWDevice::Commit(HWLayers *hw_layers) {
   // MDP returns only one release fence for the entire layer stack. Duplicate this fence into all
   // layers being composed by MDP.
 
+  start_us = FrameTiming::GetTimeUs();
   std::vector<uint32_t> fence_dup_flag;
   fence_dup_flag.clear();
 
@@ -549,6 +620,7 @@ DisplayError HWDevice::Commit(HWLayers *hw_layers) {
   fence_dup_flag.clear();
 
   hw_layer_info.sync_handle = Sys::dup_(mdp_commit.release_fence);
+  FrameTiming::Record(device_type_, kFrameTimingFenceDup, FrameTiming::GetTimeUs() - start_us);
 
   DLOGI_IF(kTagDriverConfig, "*************************** %s Commit Input ************************",
            device_name_);
@@ -564,12 +636,14 @@ DisplayError HWDevice::Commit(HWLayers *hw_layers) {
     // panel info.
     PopulateHWPanelInfo();
     synchronous_commit_ = false;
+    mdp_commit.flags &= UINT32(~MDP_COMMIT_WAIT_FOR_FINISH);
   }
 
   return kErrorNone;
 }
 
 DisplayError HWDevice::Flush() {
+  validated_config_.clear();
   ResetDisplayParams();
   mdp_layer_commit_v1 &mdp_commit = mdp_disp_commit_.commit_v1;
   mdp_commit.input_layer_cnt = 0;
@@ -1094,6 +1168,8 @@ void HWDevice::SetIGC(const LayerBuffer *layer_buffer, uint32_t index) {
 DisplayError HWDevice::SetCursorPosition(HWLayers *hw_layers, int x, int y) {
   DTRACE_SCOPED();
 
+  validated_config_.clear();
+
   HWLayersInfo &hw_layer_info = hw_layers->info;
   uint32_t count = hw_layer_info.count;
   uint32_t cursor_index = count - 1;
@@ -1215,6 +1291,8 @@ DisplayError HWDevice::SetS3DMode(HWS3DMode s3d_mode) {
 }
 
 DisplayError HWDevice::SetScaleLutConfig(HWScaleLutInfo *lut_info) {
+  validated_config_.clear();
+
   mdp_scale_luts_info mdp_lut_info = {};
   mdp_set_cfg cfg = {};
 
@@ -1254,6 +1332,8 @@ DisplayError HWDevice::SetScaleLutConfig(HWScaleLutInfo *lut_info) {
 }
 
 DisplayError HWDevice::SetMixerAttributes(const HWMixerAttributes &mixer_attributes) {
+  validated_config_.clear();
+
   if (!hw_resource_.hw_dest_scalar_info.count) {
     return kErrorNotSupported;
   }
@@ -127,6 +127,7 @@ class HWDevice : public HWInterface {
   void ResetDisplayParams();
   void SetCSC(const LayerCSC source, mdp_color_space *color_space);
   void SetIGC(const LayerBuffer *layer_buffer, uint32_t index);
+  bool GetValidateConfig(const mdp_layer_commit_v1 &mdp_commit, std::vector<uint8_t> *config);
 
   bool EnableHotPlugDetection(int enable);
   ssize_t SysFsWrite(const char* file_node, const char* value, ssize_t length);
@@ -152,6 +153,9 @@ class HWDevice : public HWInterface {
   HWDisplayAttributes display_attributes_ = {};
   HWMixerAttributes mixer_attributes_ = {};
   std::vector<mdp_destination_scaler_data> mdp_dest_scalar_data_;
+  bool validate_reuse_ = false;
+  std::vector<uint8_t> validate_config_;   // Configuration of the frame being validated
+  std::vector<uint8_t> validated_config_;  // Configuration retained by the driver, empty if unknown
 };
 
 }  // namespace sdm
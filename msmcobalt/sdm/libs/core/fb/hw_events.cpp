@@ -30,11 +30,13 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/resource.h>
 #include <sys/prctl.h>
+#include <time.h>
+#include <utils/constants.h>
 #include <utils/debug.h>
 #include <utils/sys.h>
 #include <pthread.h>
@@ -77,67 +79,163 @@ DisplayError HWEventsInterface::Destroy(HWEventsInterface *intf) {
   return kErrorNone;
 }
 
-pollfd HWEvents::InitializePollFd(HWEventData *event_data) {
-  char node_path[kMaxStringLength] = {0};
-  char data[kMaxStringLength] = {0};
-  pollfd poll_fd = {0};
-  poll_fd.fd = -1;
-
-  if (!strncmp(event_data->event_name, "thread_exit", strlen("thread_exit"))) {
-    // Create an eventfd to be used to unblock the poll system call when
-    // a thread is exiting.
-    poll_fd.fd = Sys::eventfd_(0, 0);
-    poll_fd.events |= POLLIN;
-    exit_fd_ = poll_fd.fd;
-  } else {
-    snprintf(node_path, sizeof(node_path), "%s%d/%s", fb_path_, fb_num_, event_data->event_name);
-    poll_fd.fd = Sys::open_(node_path, O_RDONLY);
-    poll_fd.events |= POLLPRI | POLLERR;
+HWEventLoop *HWEventLoop::GetInstance() {
+  // Never destroyed, the event thread lives for the lifetime of the process once started.
+  static HWEventLoop *event_loop = new HWEventLoop();
+
+  return event_loop;
+}
+
+DisplayError HWEventLoop::Start() {
+  epoll_fd_ = Sys::epoll_create1_(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    DLOGE("epoll_create1 failed, error = %s", strerror(errno));
+    return kErrorResources;
   }
 
-  if (poll_fd.fd < 0) {
-    DLOGW("open failed for display=%d event=%s, error=%s", fb_num_, event_data->event_name,
-          strerror(errno));
-    return poll_fd;
+  if (pthread_create(&event_thread_, NULL, &EventThread, this) != 0) {
+    DLOGE("Failed to start SDM_EventThread");
+    Sys::close_(epoll_fd_);
+    epoll_fd_ = -1;
+    return kErrorResources;
   }
 
-  // Read once on all fds to clear data on all fds.
-  Sys::pread_(poll_fd.fd, data , kMaxStringLength, 0);
+  thread_started_ = true;
 
-  return poll_fd;
+  return kErrorNone;
 }
 
-DisplayError HWEvents::SetEventParser(const char *event_name, HWEventData *event_data) {
-  DisplayError error = kErrorNone;
+DisplayError HWEventLoop::AddSource(int fd, uint32_t epoll_events, HWEvents *hw_events,
+                                    uint32_t index) {
+  SCOPE_LOCK(locker_);
+
+  if (!thread_started_) {
+    DisplayError error = Start();
+    if (error != kErrorNone) {
+      return error;
+    }
+  }
+
+  uint64_t source_id = next_source_id_++;
+  struct epoll_event event = {};
+  event.events = epoll_events;
+  event.data.u64 = source_id;
+
+  if (Sys::epoll_ctl_(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+    DLOGW("epoll_ctl failed for fd = %d, error = %s", fd, strerror(errno));
+    return kErrorResources;
+  }
+
+  Source &source = sources_[source_id];
+  source.fd = fd;
+  source.hw_events = hw_events;
+  source.index = index;
+
+  return kErrorNone;
+}
+
+void HWEventLoop::RemoveSource(int fd) {
+  SCOPE_LOCK(locker_);
+
+  for (auto it = sources_.begin(); it != sources_.end(); it++) {
+    if (it->second.fd == fd) {
+      uint64_t source_id = it->first;
+      Sys::epoll_ctl_(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+      sources_.erase(it);
+
+      // Wait for an event of this source already being dispatched, unless this is called from
+      // that dispatch.
+      while (dispatching_ && dispatch_source_id_ == source_id &&
+             !pthread_equal(pthread_self(), event_thread_)) {
+        locker_.Wait();
+      }
+      break;
+    }
+  }
+}
+
+void* HWEventLoop::EventThread(void *context) {
+  if (context) {
+    return reinterpret_cast<HWEventLoop *>(context)->EventHandler();
+  }
+
+  return NULL;
+}
+
+void* HWEventLoop::EventHandler() {
+  struct epoll_event events[kMaxEpollEvents];
+
+  prctl(PR_SET_NAME, "SDM_EventThread", 0, 0, 0);
+  setpriority(PRIO_PROCESS, 0, kThreadPriorityUrgent);
+
+  while (true) {
+    int count = Sys::epoll_wait_(epoll_fd_, events, kMaxEpollEvents, -1);
+    if (count < 0) {
+      if (errno != EINTR) {
+        DLOGW("epoll_wait failed. error = %s", strerror(errno));
+      }
+      continue;
+    }
+
+    for (int i = 0; i < count; i++) {
+      Source source;
+      {
+        SCOPE_LOCK(locker_);
+        // A source removed after epoll_wait() returned is no longer in the map and is skipped.
+        auto it = sources_.find(events[i].data.u64);
+        if (it == sources_.end()) {
+          continue;
+        }
+        source = it->second;
+        dispatch_source_id_ = it->first;
+        dispatching_ = true;
+      }
+
+      // Display callbacks take display locks, which may be held by a thread removing a source.
+      // Hence the event is handled without the loop lock.
+      source.hw_events->HandleEvent(source.index);
+
+      SCOPE_LOCK(locker_);
+      dispatching_ = false;
+      locker_.Broadcast();
+    }
+  }
+
+  return NULL;
+}
 
+HWEvents::HWEventType HWEvents::GetEventType(const char *event_name) {
   if (!strncmp(event_name, "vsync_event", strlen("vsync_event"))) {
-    event_data->event_parser = &HWEvents::HandleVSync;
+    return kEventVSync;
   } else if (!strncmp(event_name, "show_blank_event", strlen("show_blank_event"))) {
-    event_data->event_parser = &HWEvents::HandleBlank;
+    return kEventBlank;
   } else if (!strncmp(event_name, "idle_notify", strlen("idle_notify"))) {
-    event_data->event_parser = &HWEvents::HandleIdleTimeout;
+    return kEventIdleTimeout;
   } else if (!strncmp(event_name, "msm_fb_thermal_level", strlen("msm_fb_thermal_level"))) {
-    event_data->event_parser = &HWEvents::HandleThermal;
+    return kEventThermal;
   } else if (!strncmp(event_name, "cec/rd_msg", strlen("cec/rd_msg"))) {
-    event_data->event_parser = &HWEvents::HandleCECMessage;
-  } else if (!strncmp(event_name, "thread_exit", strlen("thread_exit"))) {
-    event_data->event_parser = &HWEvents::HandleThreadExit;
-  } else {
-    error = kErrorParameters;
+    return kEventCECMessage;
   }
 
-  return error;
+  return kEventUnknown;
 }
 
-void HWEvents::PopulateHWEventData() {
-  for (uint32_t i = 0; i < event_list_->size(); i++) {
-    const char *event_name = event_list_->at(i);
-    HWEventData event_data;
-    event_data.event_name = event_name;
-    SetEventParser(event_name, &event_data);
-    poll_fds_[i] = InitializePollFd(&event_data);
-    event_data_list_.push_back(event_data);
+int HWEvents::InitializeEventFd(const HWEventData &event_data) {
+  char node_path[kMaxStringLength] = {0};
+  char data[kMaxStringLength] = {0};
+
+  snprintf(node_path, sizeof(node_path), "%s%d/%s", fb_path_, fb_num_, event_data.event_name);
+  int fd = Sys::open_(node_path, O_RDONLY);
+  if (fd < 0) {
+    DLOGW("open failed for display=%d event=%s, error=%s", fb_num_, event_data.event_name,
+          strerror(errno));
+    return -1;
   }
+
+  // Read once to clear any pending notification.
+  Sys::pread_(fd, data, kMaxStringLength, 0);
+
+  return fd;
 }
 
 DisplayError HWEvents::Init(int fb_num, HWEventHandler *event_handler,
@@ -147,110 +245,358 @@ DisplayError HWEvents::Init(int fb_num, HWEventHandler *event_handler,
 
   event_handler_ = event_handler;
   fb_num_ = fb_num;
-  event_list_ = event_list;
-  poll_fds_.resize(event_list_->size());
-  event_thread_name_ += " - " + std::to_string(fb_num_);
 
-  PopulateHWEventData();
+  for (const char *event_name : *event_list) {
+    HWEventData event_data;
+    event_data.event_name = event_name;
+    event_data.event_type = GetEventType(event_name);
+    if (event_data.event_type == kEventUnknown) {
+      DLOGW("Unknown event %s on display %d", event_name, fb_num_);
+      continue;
+    }
+    event_data.fd = InitializeEventFd(event_data);
+    event_data_list_.push_back(event_data);
+    hw_vsync_ |= (event_data.event_type == kEventVSync && event_data.fd >= 0);
+  }
 
-  if (pthread_create(&event_thread_, NULL, &DisplayEventThread, this) < 0) {
-    DLOGE("Failed to start %s, error = %s", event_thread_name_.c_str());
-    return kErrorResources;
+  // Sources are added once the list is complete, as HandleEvent() may run right away.
+  HWEventLoop *event_loop = HWEventLoop::GetInstance();
+  for (uint32_t i = 0; i < event_data_list_.size(); i++) {
+    int fd = event_data_list_[i].fd;
+    if (fd >= 0 && event_loop->AddSource(fd, EPOLLPRI | EPOLLERR, this, i) != kErrorNone) {
+      Deinit();
+      return kErrorResources;
+    }
+  }
+
+  // Without the vsync timer, vsync is only delivered as the hardware reports it.
+  vsync_timer_fd_ = Sys::timerfd_create_(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (vsync_timer_fd_ < 0) {
+    DLOGW("timerfd_create failed for display %d, error = %s", fb_num_, strerror(errno));
+  } else if (event_loop->AddSource(vsync_timer_fd_, EPOLLIN, this, kVSyncTimerIndex) !=
+             kErrorNone) {
+    Sys::close_(vsync_timer_fd_);
+    vsync_timer_fd_ = -1;
   }
 
   return kErrorNone;
 }
 
 DisplayError HWEvents::Deinit() {
-  exit_threads_ = true;
-  Sys::pthread_cancel_(event_thread_);
-
-  uint64_t exit_value = 1;
-  ssize_t write_size = Sys::write_(exit_fd_, &exit_value, sizeof(uint64_t));
-  if (write_size != sizeof(uint64_t))
-    DLOGW("Error triggering exit_fd_ (%d). write size = %d, error = %s", exit_fd_, write_size,
-          strerror(errno));
+  HWEventLoop *event_loop = HWEventLoop::GetInstance();
 
-  pthread_join(event_thread_, NULL);
+  for (HWEventData &event_data : event_data_list_) {
+    if (event_data.fd >= 0) {
+      event_loop->RemoveSource(event_data.fd);
+      Sys::close_(event_data.fd);
+      event_data.fd = -1;
+    }
+  }
 
-  for (uint32_t i = 0; i < event_list_->size(); i++) {
-    Sys::close_(poll_fds_[i].fd);
-    poll_fds_[i].fd = -1;
+  if (vsync_timer_fd_ >= 0) {
+    event_loop->RemoveSource(vsync_timer_fd_);
+    Sys::close_(vsync_timer_fd_);
+    vsync_timer_fd_ = -1;
   }
 
   return kErrorNone;
 }
 
-void* HWEvents::DisplayEventThread(void *context) {
-  if (context) {
-    return reinterpret_cast<HWEvents *>(context)->DisplayEventHandler();
+void HWEvents::HandleEvent(uint32_t index) {
+  if (index == kVSyncTimerIndex) {
+    HandleVSyncTimer();
+    return;
   }
 
-  return NULL;
+  const HWEventData &event_data = event_data_list_[index];
+  char data[kMaxStringLength];
+
+  ssize_t length = Sys::pread_(event_data.fd, data, kMaxStringLength - 1, 0);
+  if (length <= 0) {
+    return;
+  }
+  data[length] = '\0';
+
+  switch (event_data.event_type) {
+  case kEventVSync:
+    HandleVSync(data);
+    break;
+  case kEventIdleTimeout:
+    event_handler_->IdleTimeout();
+    break;
+  case kEventThermal:
+    HandleThermal(data);
+    break;
+  case kEventCECMessage:
+    event_handler_->CECMessage(data);
+    break;
+  default:
+    break;
+  }
 }
 
-void* HWEvents::DisplayEventHandler() {
-  char data[kMaxStringLength] = {0};
+int64_t HWEvents::ParseValue(const char *data, const char *prefix) {
+  size_t prefix_length = strlen(prefix);
+  if (strncmp(data, prefix, prefix_length)) {
+    return 0;
+  }
 
-  prctl(PR_SET_NAME, event_thread_name_.c_str(), 0, 0, 0);
-  setpriority(PRIO_PROCESS, 0, kThreadPriorityUrgent);
+  // Node values are plain decimal; parse them in place rather than through strtoll().
+  int64_t value = 0;
+  for (const char *digit = data + prefix_length; *digit >= '0' && *digit <= '9'; digit++) {
+    value = (value * 10) + (*digit - '0');
+  }
 
-  while (!exit_threads_) {
-    int error = Sys::poll_(poll_fds_.data(), UINT32(event_list_->size()), -1);
+  return value;
+}
 
-    if (error <= 0) {
-      DLOGW("poll failed. error = %s", strerror(errno));
-      continue;
+void HWEvents::HandleVSync(const char *data) {
+  int64_t timestamp = ParseValue(data, "VSYNC=");
+
+  uint32_t count = vsync_count_.load(std::memory_order_relaxed);
+  vsync_history_[count & (kVSyncHistorySize - 1)].store(timestamp, std::memory_order_relaxed);
+  vsync_count_.store(count + 1, std::memory_order_release);
+
+  bool reported = false;
+  {
+    SCOPE_LOCK(vsync_locker_);
+    if (vsync_predicting_) {
+      // Hardware vsync has resumed and takes over from the timer. A vsync of this period which
+      // was already predicted is not reported again.
+      vsync_predicting_ = false;
+      ArmVSyncTimer(0, 0);
+      reported = (last_predicted_timestamp_ &&
+                  llabs(timestamp - last_predicted_timestamp_) < predicted_period_ / 2);
     }
+  }
+
+  // Handler is called without the lock, it may turn vsync off from the callback.
+  if (!reported) {
+    event_handler_->VSync(timestamp);
+  }
+}
 
-    for (uint32_t event = 0; event < event_list_->size(); event++) {
-      pollfd &poll_fd = poll_fds_[event];
+void HWEvents::HandleVSyncTimer() {
+  uint64_t expirations = 0;
+  int64_t timestamp = 0;
 
-      if (!strncmp(event_list_->at(event), "thread_exit", strlen("thread_exit"))) {
-        if ((poll_fd.revents & POLLIN) && (Sys::read_(poll_fd.fd, data, kMaxStringLength) > 0)) {
-          (this->*(event_data_list_[event]).event_parser)(data);
-        }
-      } else {
-        if ((poll_fd.revents & POLLPRI) &&
-                (Sys::pread_(poll_fd.fd, data, kMaxStringLength, 0) > 0)) {
-          (this->*(event_data_list_[event]).event_parser)(data);
-        }
-      }
-    }
+  if (Sys::read_(vsync_timer_fd_, &expirations, sizeof(expirations)) != sizeof(expirations) ||
+      !expirations) {
+    return;
   }
 
-  pthread_exit(0);
+  {
+    SCOPE_LOCK(vsync_locker_);
+    if (!vsync_predicting_) {
+      return;
+    }
 
-  return NULL;
+    // Report the modeled vsync time rather than the wakeup time. Expirations missed by a late
+    // wakeup are skipped, as the hardware would not report them either.
+    timestamp = predicted_timestamp_ + INT64(expirations - 1) * predicted_period_;
+    predicted_timestamp_ = timestamp + predicted_period_;
+    last_predicted_timestamp_ = timestamp;
+  }
+
+  event_handler_->VSync(timestamp);
 }
 
-void HWEvents::HandleVSync(char *data) {
-  int64_t timestamp = 0;
-  if (!strncmp(data, "VSYNC=", strlen("VSYNC="))) {
-    timestamp = strtoll(data + strlen("VSYNC="), NULL, 0);
+bool HWEvents::ArmVSyncTimer(int64_t next, int64_t period) {
+  struct itimerspec timer_spec = {};
+
+  // A zero expiry disarms the timer and drops any pending expiration.
+  timer_spec.it_value.tv_sec = next / kNanoSecondsPerSecond;
+  timer_spec.it_value.tv_nsec = next % kNanoSecondsPerSecond;
+  timer_spec.it_interval.tv_sec = period / kNanoSecondsPerSecond;
+  timer_spec.it_interval.tv_nsec = period % kNanoSecondsPerSecond;
+
+  if (Sys::timerfd_settime_(vsync_timer_fd_, TFD_TIMER_ABSTIME, &timer_spec, NULL) < 0) {
+    DLOGW("timerfd_settime failed for display %d, error = %s", fb_num_, strerror(errno));
+    return false;
   }
 
-  event_handler_->VSync(timestamp);
+  return true;
 }
 
-void HWEvents::HandleIdleTimeout(char *data) {
-  event_handler_->IdleTimeout();
+DisplayError HWEvents::SetVSyncState(bool enable, uint32_t period_ns) {
+  SCOPE_LOCK(vsync_locker_);
+
+  if (vsync_timer_fd_ < 0) {
+    return hw_vsync_ ? kErrorNone : kErrorNotSupported;
+  }
+
+  if (vsync_predicting_) {
+    vsync_predicting_ = false;
+    ArmVSyncTimer(0, 0);
+  }
+
+  if (!enable) {
+    return kErrorNone;
+  }
+
+  struct timespec time_now = {};
+  clock_gettime(CLOCK_MONOTONIC, &time_now);
+  int64_t now = (INT64(time_now.tv_sec) * kNanoSecondsPerSecond) + time_now.tv_nsec;
+
+  int64_t timestamps[kVSyncHistorySize];
+  uint32_t count = GetVSyncHistory(timestamps);
+  int64_t next = 0;
+  int64_t period = 0;
+  if (!PredictVSync(timestamps, count, now, &next, &period)) {
+    if (hw_vsync_) {
+      // Nothing to predict from, the hardware establishes the phase with its first vsync.
+      return kErrorNone;
+    }
+
+    // Any phase is as good as another without hardware vsync, start right away.
+    next = now;
+    period = period_ns ? period_ns : kDefaultVSyncPeriodNs;
+  }
+
+  if (!ArmVSyncTimer(next, period)) {
+    return hw_vsync_ ? kErrorNone : kErrorResources;
+  }
+
+  vsync_predicting_ = true;
+  predicted_timestamp_ = next;
+  predicted_period_ = period;
+  last_predicted_timestamp_ = 0;
+
+  return kErrorNone;
 }
 
-void HWEvents::HandleThermal(char *data) {
-  int64_t thermal_level = 0;
-  if (!strncmp(data, "thermal_level=", strlen("thermal_level="))) {
-    thermal_level = strtoll(data + strlen("thermal_level="), NULL, 0);
+bool HWEvents::PredictVSync(const int64_t *timestamps, uint32_t count, int64_t now,
+                            int64_t *next, int64_t *period) {
+  if (count < kMinPredictionSamples || count > kVSyncHistorySize) {
+    return false;
+  }
+
+  int64_t intervals[kVSyncHistorySize];
+  uint32_t num_intervals = count - 1;
+  for (uint32_t i = 0; i < num_intervals; i++) {
+    intervals[i] = timestamps[i + 1] - timestamps[i];
+  }
+  std::nth_element(intervals, intervals + num_intervals / 2, intervals + num_intervals);
+  int64_t median = intervals[num_intervals / 2];
+  if (median <= 0) {
+    return false;
+  }
+
+  // Model only the latest run of vsyncs without a gap. A line fitted through all of it measures
+  // the period and phase far more precisely than the last interval and timestamp do.
+  uint32_t first = count - 1;
+  while (first > 0 && llabs(timestamps[first] - timestamps[first - 1] - median) < median / 2) {
+    first--;
+  }
+
+  uint32_t last = count - 1;
+  int64_t num_samples = last - first + 1;
+  if (num_samples < kMinPredictionSamples) {
+    return false;
+  }
+
+  int64_t sum_x = 0, sum_xx = 0, sum_y = 0, sum_xy = 0;
+  for (uint32_t i = first; i <= last; i++) {
+    int64_t x = i - first;
+    int64_t y = timestamps[i] - timestamps[first];
+    sum_x += x;
+    sum_xx += x * x;
+    sum_y += y;
+    sum_xy += x * y;
   }
 
+  int64_t model_period = ((num_samples * sum_xy) - (sum_x * sum_y)) /
+                         ((num_samples * sum_xx) - (sum_x * sum_x));
+  if (model_period <= 0) {
+    return false;
+  }
+
+  if ((now - timestamps[last]) / model_period > kMaxPredictionPeriods) {
+    // The error of the period accumulates over every vsync since the last one.
+    return false;
+  }
+
+  int64_t anchor = timestamps[first] + ((sum_y - (model_period * sum_x)) / num_samples) +
+                   (model_period * (last - first));
+
+  *next = anchor + ((std::max(now - anchor, INT64(0)) / model_period) + 1) * model_period;
+  *period = model_period;
+
+  return true;
+}
+
+void HWEvents::HandleThermal(const char *data) {
+  int64_t thermal_level = ParseValue(data, "thermal_level=");
+
   DLOGI("Received thermal notification with thermal level = %d", thermal_level);
 
   event_handler_->ThermalEvent(thermal_level);
 }
 
-void HWEvents::HandleCECMessage(char *data) {
-  event_handler_->CECMessage(data);
+uint32_t HWEvents::GetVSyncHistory(int64_t *timestamps) {
+  uint32_t num_timestamps = 0;
+
+  // The writer only overwrites the oldest entry, so a snapshot taken while a vsync arrives is
+  // retried; a stale entry that slips through shows up as an out of range interval.
+  for (int retry = 0; retry < 3; retry++) {
+    uint32_t count = vsync_count_.load(std::memory_order_acquire);
+    num_timestamps = std::min(count, UINT32(kVSyncHistorySize));
+    for (uint32_t i = 0; i < num_timestamps; i++) {
+      uint32_t index = (count - num_timestamps + i) & (kVSyncHistorySize - 1);
+      timestamps[i] = vsync_history_[index].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (vsync_count_.load(std::memory_order_relaxed) == count) {
+      break;
+    }
+  }
+
+  return num_timestamps;
 }
 
-}  // namespace sdm
+DisplayError HWEvents::GetVSyncTiming(DisplayVSyncTiming *timing) {
+  int64_t timestamps[kVSyncHistorySize];
+  uint32_t num_timestamps = GetVSyncHistory(timestamps);
+
+  if (num_timestamps < 2) {
+    return kErrorNotSupported;
+  }
 
+  int64_t intervals[kVSyncHistorySize];
+  uint32_t num_intervals = 0;
+  for (uint32_t i = 1; i < num_timestamps; i++) {
+    if (timestamps[i] > timestamps[i - 1]) {
+      intervals[num_intervals++] = timestamps[i] - timestamps[i - 1];
+    }
+  }
+
+  if (!num_intervals) {
+    return kErrorNotSupported;
+  }
+
+  // The median is not skewed by the gaps left while vsync was disabled. Only intervals within
+  // half a period of it contribute to the jitter.
+  int64_t sorted[kVSyncHistorySize];
+  std::copy(intervals, intervals + num_intervals, sorted);
+  std::nth_element(sorted, sorted + num_intervals / 2, sorted + num_intervals);
+  int64_t period = sorted[num_intervals / 2];
+
+  int64_t deviation = 0;
+  uint32_t num_samples = 0;
+  for (uint32_t i = 0; i < num_intervals; i++) {
+    int64_t delta = llabs(intervals[i] - period);
+    if (delta < period / 2) {
+      deviation += delta;
+      num_samples++;
+    }
+  }
+
+  timing->last_timestamp = timestamps[num_timestamps - 1];
+  timing->period_ns = UINT32(period);
+  timing->jitter_ns = num_samples ? UINT32(deviation / num_samples) : 0;
+  timing->sample_count = num_samples;
+
+  return kErrorNone;
+}
+
+}  // namespace sdm
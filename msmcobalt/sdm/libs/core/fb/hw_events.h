@@ -25,7 +25,9 @@
 #ifndef __HW_EVENTS_H__
 #define __HW_EVENTS_H__
 
-#include <sys/poll.h>
+#include <sys/epoll.h>
+#include <utils/locker.h>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
@@ -38,47 +40,112 @@ namespace sdm {
 
 using std::vector;
 
+class HWEvents;
+
+// Single epoll thread which waits on the event nodes of all displays. Each registered node is
+// identified by a source id carried in the epoll data, so that a wakeup is dispatched to its
+// display without comparing node names. Events are dispatched without the loop lock, as display
+// callbacks take display locks. RemoveSource() waits for a dispatch of its node in progress on
+// another thread, so once it returns, no further event is delivered for that node.
+class HWEventLoop {
+ public:
+  static HWEventLoop *GetInstance();
+
+  DisplayError AddSource(int fd, uint32_t epoll_events, HWEvents *hw_events, uint32_t index);
+  void RemoveSource(int fd);
+
+ private:
+  static const int kMaxEpollEvents = 16;
+
+  struct Source {
+    int fd = -1;
+    HWEvents *hw_events = NULL;
+    uint32_t index = 0;
+  };
+
+  HWEventLoop() { }
+  DisplayError Start();
+  static void* EventThread(void *context);
+  void* EventHandler();
+
+  Locker locker_;
+  std::map<uint64_t, Source> sources_;
+  uint64_t next_source_id_ = 0;
+  int epoll_fd_ = -1;
+  pthread_t event_thread_;
+  bool thread_started_ = false;
+  bool dispatching_ = false;         // An event is being handled by the event thread
+  uint64_t dispatch_source_id_ = 0;  // Source of the event being handled
+};
+
 class HWEvents : public HWEventsInterface {
  public:
   DisplayError Init(int fb_num, HWEventHandler *event_handler,
                     vector<const char *> *event_list);
   DisplayError Deinit();
+  virtual DisplayError GetVSyncTiming(DisplayVSyncTiming *timing);
+  virtual DisplayError SetVSyncState(bool enable, uint32_t period_ns);
+
+  void HandleEvent(uint32_t index);
+
+  // Predicts the first vsync after now and the vsync period from consecutive hardware vsync
+  // timestamps, oldest first. Returns false if they are too few or too old to model the phase.
+  static bool PredictVSync(const int64_t *timestamps, uint32_t count, int64_t now, int64_t *next,
+                           int64_t *period);
 
  private:
   static const int kMaxStringLength = 1024;
+  static const uint32_t kVSyncHistorySize = 32;  // Power of two.
+  static const uint32_t kVSyncTimerIndex = 0xFFFFFFFF;
+  static const uint32_t kMinPredictionSamples = 4;
+  static const int64_t kMaxPredictionPeriods = 600;
+  static const int64_t kDefaultVSyncPeriodNs = 16666667;
+  static const int64_t kNanoSecondsPerSecond = 1000000000;
 
-  typedef void (HWEvents::*EventParser)(char *);
+  enum HWEventType {
+    kEventVSync,
+    kEventBlank,
+    kEventIdleTimeout,
+    kEventThermal,
+    kEventCECMessage,
+    kEventUnknown,
+  };
 
   struct HWEventData {
     const char* event_name = NULL;
-    EventParser event_parser = NULL;
+    HWEventType event_type = kEventUnknown;
+    int fd = -1;
   };
 
-  static void* DisplayEventThread(void *context);
-  void* DisplayEventHandler();
-  void HandleVSync(char *data);
-  void HandleBlank(char *data) { }
-  void HandleIdleTimeout(char *data);
-  void HandleThermal(char *data);
-  void HandleCECMessage(char *data);
-  void HandleThreadExit(char *data) { }
-  void PopulateHWEventData();
-  DisplayError SetEventParser(const char *event_name, HWEventData *event_data);
-  pollfd InitializePollFd(HWEventData *event_data);
+  static HWEventType GetEventType(const char *event_name);
+  static int64_t ParseValue(const char *data, const char *prefix);
+  int InitializeEventFd(const HWEventData &event_data);
+  void HandleVSync(const char *data);
+  void HandleVSyncTimer();
+  void HandleThermal(const char *data);
+  uint32_t GetVSyncHistory(int64_t *timestamps);
+  bool ArmVSyncTimer(int64_t next, int64_t period);
 
   HWEventHandler *event_handler_ = NULL;
-  vector<const char *> *event_list_ = NULL;
   vector<HWEventData> event_data_list_ = {};
-  vector<pollfd> poll_fds_;
-  pthread_t event_thread_;
-  std::string event_thread_name_ = "SDM_EventThread";
-  bool exit_threads_ = false;
   const char* fb_path_ = "/sys/devices/virtual/graphics/fb";
   int fb_num_ = -1;
-  int exit_fd_ = -1;
+
+  // Ring of the latest vsync timestamps. It is written by the event thread only and read without
+  // a lock; vsync_count_ is published after the entry, so a reader detects a concurrent update.
+  std::atomic<int64_t> vsync_history_[kVSyncHistorySize] = {};
+  std::atomic<uint32_t> vsync_count_ = {0};
+
+  // Software vsync, generated by a timer in place of the hardware vsync node.
+  Locker vsync_locker_;
+  int vsync_timer_fd_ = -1;
+  bool hw_vsync_ = false;              // Display has a vsync node
+  bool vsync_predicting_ = false;      // Timer is armed until hardware vsync resumes
+  int64_t predicted_timestamp_ = 0;    // Next vsync the timer reports
+  int64_t predicted_period_ = 0;
+  int64_t last_predicted_timestamp_ = 0;
 };
 
 }  // namespace sdm
 
 #endif  // __HW_EVENTS_H__
-
@@ -238,6 +238,8 @@ DisplayError HWHDMI::GetDisplayAttributes(uint32_t index,
 DisplayError HWHDMI::SetDisplayAttributes(uint32_t index) {
   DTRACE_SCOPED();
 
+  validated_config_.clear();
+
   if (index > hdmi_modes_.size()) {
     return kErrorNotSupported;
   }
@@ -625,6 +627,8 @@ bool HWHDMI::IsSupportedS3DMode(HWS3DMode s3d_mode) {
 }
 
 DisplayError HWHDMI::SetS3DMode(HWS3DMode s3d_mode) {
+  validated_config_.clear();
+
   if (!IsSupportedS3DMode(s3d_mode)) {
     DLOGW("S3D mode is not supported s3d_mode = %d", s3d_mode);
     return kErrorNotSupported;
@@ -798,6 +802,8 @@ DisplayError HWHDMI::SetRefreshRate(uint32_t refresh_rate) {
     return error;
   }
 
+  validated_config_.clear();
+
   error = GetDynamicFrameRateMode(refresh_rate, &mode, &data, &config_index);
   if (error != kErrorNone) {
     return error;
@@ -252,6 +252,8 @@ DisplayError HWPrimary::PopulateDisplayAttributes() {
 }
 
 DisplayError HWPrimary::SetDisplayAttributes(uint32_t index) {
+  validated_config_.clear();
+
   DisplayError ret = kErrorNone;
 
   if (!IsResolutionSwitchEnabled()) {
@@ -295,6 +297,8 @@ DisplayError HWPrimary::SetRefreshRate(uint32_t refresh_rate) {
     return kErrorNone;
   }
 
+  validated_config_.clear();
+
   snprintf(node_path, sizeof(node_path), "%s%d/dynamic_fps", fb_path_, fb_node_index_);
 
   int fd = Sys::open_(node_path, O_WRONLY);
@@ -471,6 +475,8 @@ DisplayError HWPrimary::SetVSyncState(bool enable) {
 }
 
 DisplayError HWPrimary::SetDisplayMode(const HWDisplayMode hw_display_mode) {
+  validated_config_.clear();
+
   uint32_t mode = kModeDefault;
 
   switch (hw_display_mode) {
@@ -626,6 +632,8 @@ DisplayError HWPrimary::SetPPFeatures(PPFeaturesConfig *feature_list) {
 }
 
 DisplayError HWPrimary::SetMixerAttributes(const HWMixerAttributes &mixer_attributes) {
+  validated_config_.clear();
+
   if (IsResolutionSwitchEnabled()) {
     return kErrorNotSupported;
   }
@@ -42,6 +42,7 @@ class HWScale {
   virtual void SetHWScaleData(const HWScaleData &scale, uint32_t index,
                               mdp_layer_commit_v1 *mdp_commit, HWSubBlockType sub_block_type) = 0;
   virtual void* GetScaleDataRef(uint32_t index, HWSubBlockType sub_block_type) = 0;
+  virtual size_t GetScaleDataSize() = 0;
   virtual void DumpScaleData(void *mdp_scale) = 0;
   virtual void ResetScaleParams() = 0;
  protected:
@@ -53,6 +54,7 @@ class HWScaleV1 : public HWScale {
   virtual void SetHWScaleData(const HWScaleData &scale, uint32_t index,
                               mdp_layer_commit_v1 *mdp_commit, HWSubBlockType sub_block_type);
   virtual void* GetScaleDataRef(uint32_t index, HWSubBlockType sub_block_type);
+  virtual size_t GetScaleDataSize() { return sizeof(mdp_scale_data); }
   virtual void DumpScaleData(void *mdp_scale);
   virtual void ResetScaleParams() { scale_data_v1_ = {}; }
 
@@ -66,6 +68,7 @@ class HWScaleV2 : public HWScale {
   virtual void SetHWScaleData(const HWScaleData &scale, uint32_t index,
                               mdp_layer_commit_v1 *mdp_commit, HWSubBlockType sub_block_type);
   virtual void* GetScaleDataRef(uint32_t index, HWSubBlockType sub_block_type);
+  virtual size_t GetScaleDataSize() { return sizeof(mdp_scale_data_v2); }
   virtual void DumpScaleData(void *mdp_scale);
   virtual void ResetScaleParams() { scale_data_v2_ = {}; dest_scale_data_v2_ = {}; }
 
@@ -25,6 +25,7 @@
 #ifndef __HW_EVENTS_INTERFACE_H__
 #define __HW_EVENTS_INTERFACE_H__
 
+#include <core/display_interface.h>
 #include <private/hw_info_types.h>
 #include <inttypes.h>
 #include <utility>
@@ -37,6 +38,12 @@ class HWEventsInterface {
   static DisplayError Create(int fb_num, HWEventHandler *event_handler,
                              std::vector<const char *> *event_list, HWEventsInterface **intf);
   static DisplayError Destroy(HWEventsInterface *intf);
+  virtual DisplayError GetVSyncTiming(DisplayVSyncTiming *timing) = 0;
+
+  // Starts or stops vsync delivery. Until the first hardware vsync arrives after enable, or for
+  // as long as the display has no vsync node, vsync is predicted from recent hardware timestamps
+  // or, when there are none, generated every period_ns.
+  virtual DisplayError SetVSyncState(bool enable, uint32_t period_ns) = 0;
 
  protected:
   virtual ~HWEventsInterface() { }
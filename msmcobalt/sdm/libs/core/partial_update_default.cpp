@@ -0,0 +1,333 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/rect.h>
+#include <algorithm>
+
+#include "partial_update_default.h"
+
+#define __CLASS__ "PartialUpdateDefault"
+
+namespace sdm {
+
+PartialUpdateDefault::PartialUpdateDefault(const HWResourceInfo &hw_resource_info,
+                                           const HWPanelInfo &hw_panel_info,
+                                           const HWMixerAttributes &mixer_attributes,
+                                           const DisplayConfigVariableInfo &fb_config)
+  : hw_resource_info_(hw_resource_info) {
+  Reconfigure(hw_panel_info, mixer_attributes, fb_config);
+}
+
+void PartialUpdateDefault::Reconfigure(const HWPanelInfo &hw_panel_info,
+                                       const HWMixerAttributes &mixer_attributes,
+                                       const DisplayConfigVariableInfo &fb_config) {
+  hw_panel_info_ = hw_panel_info;
+  mixer_attributes_ = mixer_attributes;
+  fb_config_ = fb_config;
+
+  float mixer_width = FLOAT(mixer_attributes_.width);
+  float mixer_height = FLOAT(mixer_attributes_.height);
+
+  // Same split decision as the full frame ROI of the strategy.
+  split_display_ = !hw_resource_info_.is_src_split &&
+                   ((mixer_attributes_.width > hw_resource_info_.max_mixer_width) ||
+                    (hw_panel_info_.is_primary_panel && hw_panel_info_.split_info.right_split));
+
+  if (split_display_) {
+    float split_left = FLOAT(mixer_attributes_.split_left);
+    left_bounds_ = LayerRect(0.0f, 0.0f, split_left, mixer_height);
+    right_bounds_ = LayerRect(split_left, 0.0f, mixer_width, mixer_height);
+  } else {
+    left_bounds_ = LayerRect(0.0f, 0.0f, mixer_width, mixer_height);
+    right_bounds_ = LayerRect();
+  }
+
+  full_frame_pending_ = true;
+  layer_states_.clear();
+}
+
+void PartialUpdateDefault::ControlPartialUpdate(bool enable) {
+  enable_ = enable;
+}
+
+DisplayError PartialUpdateDefault::GenerateROI(HWLayersInfo *hw_layers_info) {
+  if (!enable_) {
+    // Caller updates the full frame, which is the reference for the next frame.
+    SaveLayerStates(*hw_layers_info);
+    full_frame_pending_ = false;
+    return kErrorNotSupported;
+  }
+
+  // Changes are collected against the last frame, before its layer states are replaced.
+  bool partial = !full_frame_pending_ && GetDirtyRegion(*hw_layers_info);
+  SaveLayerStates(*hw_layers_info);
+  full_frame_pending_ = false;
+
+  if (!partial) {
+    SetFullFrame(hw_layers_info);
+    return kErrorNone;
+  }
+
+  LayerRect left_roi = GetHalfROI(left_bounds_);
+  LayerRect right_roi = split_display_ ? GetHalfROI(right_bounds_) : LayerRect();
+
+  if (IsValid(left_roi) && IsValid(right_roi)) {
+    // Both interfaces of a split panel transfer the same lines.
+    left_roi.top = right_roi.top = std::min(left_roi.top, right_roi.top);
+    left_roi.bottom = right_roi.bottom = std::max(left_roi.bottom, right_roi.bottom);
+
+    // Panel can only take an ROI spanning across the split as a single one.
+    if (hw_panel_info_.needs_roi_merge) {
+      left_roi.right = left_bounds_.right;
+      right_roi.left = right_bounds_.left;
+    }
+  }
+
+  float roi_area = ((left_roi.right - left_roi.left) * (left_roi.bottom - left_roi.top)) +
+                   ((right_roi.right - right_roi.left) * (right_roi.bottom - right_roi.top));
+  float mixer_area = FLOAT(mixer_attributes_.width) * FLOAT(mixer_attributes_.height);
+
+  // A frame without changes still needs a valid ROI, and a large ROI does not save enough
+  // bandwidth to be worth its per frame overhead on the panel.
+  if ((!IsValid(left_roi) && !IsValid(right_roi)) ||
+      (roi_area * 100.0f) >= (mixer_area * FLOAT(kMaxROIAreaPercent))) {
+    SetFullFrame(hw_layers_info);
+    return kErrorNone;
+  }
+
+  hw_layers_info->left_partial_update = left_roi;
+  hw_layers_info->right_partial_update = right_roi;
+
+  Log(kTagNone, "PU left ROI", left_roi);
+  Log(kTagNone, "PU right ROI", right_roi);
+
+  return kErrorNone;
+}
+
+bool PartialUpdateDefault::GetDirtyRegion(const HWLayersInfo &hw_layers_info) {
+  const LayerStack *stack = hw_layers_info.stack;
+
+  // Content of skip layers is unknown, cursor moves asynchronously to the frames, and
+  // concurrent writeback captures the whole mixer output.
+  if (stack->flags.skip_present || stack->flags.cursor_present || stack->output_buffer) {
+    return false;
+  }
+
+  // Layers are tracked by index, the area of a layer which has been added or removed is unknown.
+  if (layer_states_.size() != hw_layers_info.app_layer_count) {
+    return false;
+  }
+
+  dirty_region_.Clear();
+  for (uint32_t i = 0; i < hw_layers_info.app_layer_count; i++) {
+    if (!AddLayer(*stack->layers.at(i), &layer_states_[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool PartialUpdateDefault::AddLayer(const Layer &layer, const LayerState *last_state) {
+  if (layer.flags.skip) {
+    return false;
+  }
+
+  if (last_state->src_rect != layer.src_rect || last_state->dst_rect != layer.dst_rect ||
+      last_state->transform != layer.transform || last_state->blending != layer.blending ||
+      last_state->plane_alpha != layer.plane_alpha ||
+      last_state->solid_fill != layer.flags.solid_fill ||
+      (layer.flags.solid_fill && last_state->solid_fill_color != layer.solid_fill_color)) {
+    // Both the area the layer leaves and the area it enters change.
+    AddRect(last_state->dst_rect);
+    AddRect(layer.dst_rect);
+    return true;
+  }
+
+  if (layer.flags.solid_fill) {
+    return true;
+  }
+
+  int buffer_fd = layer.input_buffer ? layer.input_buffer->planes[0].fd : -1;
+  if (!layer.flags.updating) {
+    // A layer which is not updating keeps its buffer, a different one may differ anywhere.
+    if (buffer_fd != last_state->buffer_fd) {
+      AddRect(layer.dst_rect);
+    }
+    return true;
+  }
+
+  if (layer.dirty_regions.empty()) {
+    AddRect(layer.dst_rect);
+    return true;
+  }
+
+  for (const LayerRect &dirty_rect : layer.dirty_regions) {
+    LayerRect dst_rect;
+    if (MapDirtyRect(layer, dirty_rect, &dst_rect)) {
+      AddRect(dst_rect);
+    }
+  }
+
+  return true;
+}
+
+// Maps a dirty rect of the layer buffer onto the display, through the crop, flips, rotation and
+// scaling of the layer.
+bool PartialUpdateDefault::MapDirtyRect(const Layer &layer, const LayerRect &dirty_rect,
+                                        LayerRect *out_rect) {
+  const LayerRect &crop = layer.src_rect;
+  LayerRect dirty = Intersection(dirty_rect, crop);
+  if (!IsValid(dirty)) {
+    return false;
+  }
+
+  float crop_width = crop.right - crop.left;
+  float crop_height = crop.bottom - crop.top;
+  LayerRect rect(dirty.left - crop.left, dirty.top - crop.top, dirty.right - crop.left,
+                 dirty.bottom - crop.top);
+  LayerRect domain(0.0f, 0.0f, crop_width, crop_height);
+
+  if (layer.transform.flip_horizontal) {
+    rect = LayerRect(crop_width - rect.right, rect.top, crop_width - rect.left, rect.bottom);
+  }
+  if (layer.transform.flip_vertical) {
+    rect = LayerRect(rect.left, crop_height - rect.bottom, rect.right, crop_height - rect.top);
+  }
+  if (layer.transform.rotation == 90.0f) {
+    rect = LayerRect(crop_height - rect.bottom, rect.left, crop_height - rect.top, rect.right);
+    domain = LayerRect(0.0f, 0.0f, crop_height, crop_width);
+  }
+
+  MapRect(domain, layer.dst_rect, rect, out_rect);
+
+  // Scaler filter taps reach one pixel into the neighbourhood of the changed pixels.
+  if ((domain.right != (layer.dst_rect.right - layer.dst_rect.left)) ||
+      (domain.bottom != (layer.dst_rect.bottom - layer.dst_rect.top))) {
+    out_rect->left -= 1.0f;
+    out_rect->top -= 1.0f;
+    out_rect->right += 1.0f;
+    out_rect->bottom += 1.0f;
+  }
+
+  *out_rect = Intersection(*out_rect, layer.dst_rect);
+
+  return IsValid(*out_rect);
+}
+
+void PartialUpdateDefault::AddRect(const LayerRect &rect) {
+  LayerRect src_domain = LayerRect(0.0f, 0.0f, FLOAT(fb_config_.x_pixels),
+                                   FLOAT(fb_config_.y_pixels));
+  LayerRect dst_domain = LayerRect(0.0f, 0.0f, FLOAT(mixer_attributes_.width),
+                                   FLOAT(mixer_attributes_.height));
+  LayerRect mixer_rect = rect;
+
+  if (src_domain != dst_domain) {
+    MapRect(src_domain, dst_domain, rect, &mixer_rect);
+  }
+
+  dirty_region_.Union(mixer_rect);
+}
+
+void PartialUpdateDefault::SaveLayerStates(const HWLayersInfo &hw_layers_info) {
+  layer_states_.resize(hw_layers_info.app_layer_count);
+
+  for (uint32_t i = 0; i < hw_layers_info.app_layer_count; i++) {
+    const Layer *layer = hw_layers_info.stack->layers.at(i);
+    LayerState &state = layer_states_[i];
+    state.src_rect = layer->src_rect;
+    state.dst_rect = layer->dst_rect;
+    state.transform = layer->transform;
+    state.blending = layer->blending;
+    state.plane_alpha = layer->plane_alpha;
+    state.solid_fill = layer->flags.solid_fill;
+    state.solid_fill_color = layer->solid_fill_color;
+    state.buffer_fd = layer->input_buffer ? layer->input_buffer->planes[0].fd : -1;
+  }
+}
+
+// Bounding box of the dirty region within the mixer area of one ROI, aligned to the panel.
+LayerRect PartialUpdateDefault::GetHalfROI(const LayerRect &bounds) {
+  const RegionRect *rects = dirty_region_.GetRects();
+  LayerRect roi;
+
+  for (uint32_t i = 0; i < dirty_region_.GetCount(); i++) {
+    LayerRect rect = Intersection(LayerRect(FLOAT(rects[i].left), FLOAT(rects[i].top),
+                                            FLOAT(rects[i].right), FLOAT(rects[i].bottom)),
+                                  bounds);
+    roi = Union(roi, rect);
+  }
+
+  if (!IsValid(roi)) {
+    return LayerRect();
+  }
+
+  return AlignROI(roi, bounds);
+}
+
+LayerRect PartialUpdateDefault::AlignROI(const LayerRect &roi, const LayerRect &bounds) {
+  int left_align = std::max(hw_panel_info_.left_align, 1);
+  int width_align = std::max(hw_panel_info_.width_align, 1);
+  int top_align = std::max(hw_panel_info_.top_align, 1);
+  int height_align = std::max(hw_panel_info_.height_align, 1);
+
+  // Panel restrictions apply to the coordinates of the interface which transfers the ROI.
+  int bounds_width = INT(bounds.right - bounds.left);
+  int bounds_height = INT(bounds.bottom - bounds.top);
+  int left = INT(roi.left - bounds.left);
+  int top = INT(roi.top - bounds.top);
+  int right = INT(roi.right - bounds.left);
+  int bottom = INT(roi.bottom - bounds.top);
+
+  left = (left / left_align) * left_align;
+  top = (top / top_align) * top_align;
+
+  int width = std::max(right - left, hw_panel_info_.min_roi_width);
+  int height = std::max(bottom - top, hw_panel_info_.min_roi_height);
+  width = std::min(((width + width_align - 1) / width_align) * width_align, bounds_width);
+  height = std::min(((height + height_align - 1) / height_align) * height_align, bounds_height);
+
+  // An ROI grown past the edge ends at the edge instead, its start moved back on the grid.
+  if (left + width > bounds_width) {
+    left = std::max(((bounds_width - width) / left_align) * left_align, 0);
+    width = bounds_width - left;
+  }
+  if (top + height > bounds_height) {
+    top = std::max(((bounds_height - height) / top_align) * top_align, 0);
+    height = bounds_height - top;
+  }
+
+  return LayerRect(bounds.left + FLOAT(left), bounds.top + FLOAT(top),
+                   bounds.left + FLOAT(left + width), bounds.top + FLOAT(top + height));
+}
+
+void PartialUpdateDefault::SetFullFrame(HWLayersInfo *hw_layers_info) {
+  hw_layers_info->left_partial_update = left_bounds_;
+  hw_layers_info->right_partial_update = right_bounds_;
+}
+
+}  // namespace sdm
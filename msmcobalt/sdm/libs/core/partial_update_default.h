@@ -0,0 +1,90 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef __PARTIAL_UPDATE_DEFAULT_H__
+#define __PARTIAL_UPDATE_DEFAULT_H__
+
+#include <core/display_interface.h>
+#include <private/partial_update_interface.h>
+#include <utils/region.h>
+#include <vector>
+
+namespace sdm {
+
+// In-tree partial update used when the extension is not available. The ROI of a frame covers the
+// dirty regions of the updating layers and the old and new area of the layers whose geometry has
+// changed, aligned to the panel restrictions. The full frame is updated whenever the changed area
+// can not be determined, or when the ROI would cover most of the panel anyway.
+class PartialUpdateDefault : public PartialUpdateInterface {
+ public:
+  PartialUpdateDefault(const HWResourceInfo &hw_resource_info, const HWPanelInfo &hw_panel_info,
+                       const HWMixerAttributes &mixer_attributes,
+                       const DisplayConfigVariableInfo &fb_config);
+
+  virtual DisplayError GenerateROI(HWLayersInfo *hw_layers_info);
+  virtual void ControlPartialUpdate(bool enable);
+  void Reconfigure(const HWPanelInfo &hw_panel_info, const HWMixerAttributes &mixer_attributes,
+                   const DisplayConfigVariableInfo &fb_config);
+
+ private:
+  static const uint32_t kMaxROIAreaPercent = 80;
+
+  // Layer properties which decide where a layer shows up on the panel.
+  struct LayerState {
+    LayerRect src_rect = {};
+    LayerRect dst_rect = {};
+    LayerTransform transform = {};
+    LayerBlending blending = kBlendingPremultiplied;
+    uint8_t plane_alpha = 0xff;
+    bool solid_fill = false;
+    uint32_t solid_fill_color = 0;
+    int buffer_fd = -1;
+  };
+
+  bool GetDirtyRegion(const HWLayersInfo &hw_layers_info);
+  bool AddLayer(const Layer &layer, const LayerState *last_state);
+  void AddRect(const LayerRect &rect);
+  bool MapDirtyRect(const Layer &layer, const LayerRect &dirty_rect, LayerRect *out_rect);
+  void SaveLayerStates(const HWLayersInfo &hw_layers_info);
+  LayerRect AlignROI(const LayerRect &roi, const LayerRect &bounds);
+  LayerRect GetHalfROI(const LayerRect &bounds);
+  void SetFullFrame(HWLayersInfo *hw_layers_info);
+
+  HWResourceInfo hw_resource_info_;
+  HWPanelInfo hw_panel_info_;
+  HWMixerAttributes mixer_attributes_ = {};
+  DisplayConfigVariableInfo fb_config_ = {};
+  bool split_display_ = false;
+  LayerRect left_bounds_ = {};      // Mixer area driven by the left ROI.
+  LayerRect right_bounds_ = {};     // Mixer area driven by the right ROI, empty if not split.
+  bool enable_ = true;
+  bool full_frame_pending_ = true;  // Panel content is unknown, e.g. after a reconfiguration.
+  std::vector<LayerState> layer_states_;  // Layer properties of the last frame, by layer index.
+  Region dirty_region_;             // Changed area of the frame in mixer coordinates.
+};
+
+}  // namespace sdm
+
+#endif  // __PARTIAL_UPDATE_DEFAULT_H__
@@ -40,7 +40,8 @@ namespace sdm {
 DisplayError ResourceDefault::Init(const HWResourceInfo &hw_res_info) {
   DisplayError error = kErrorNone;
 
-  num_pipe_ = hw_res_info.num_vig_pipe + hw_res_info.num_rgb_pipe + hw_res_info.num_dma_pipe;
+  num_pipe_ = hw_res_info.num_vig_pipe + hw_res_info.num_rgb_pipe + hw_res_info.num_dma_pipe +
+              hw_res_info.num_cursor_pipe;
 
   if (!num_pipe_) {
     DLOGE("Number of H/W pipes is Zero!");
@@ -50,12 +51,13 @@ DisplayError ResourceDefault::Init(const HWResourceInfo &hw_res_info) {
   src_pipes_.resize(num_pipe_);
   hw_res_info_ = hw_res_info;
 
-  // Priority order of pipes: VIG, RGB, DMA
+  // Priority order of pipes: VIG, RGB, DMA, Cursor
   uint32_t vig_index = 0;
   uint32_t rgb_index = hw_res_info_.num_vig_pipe;
   uint32_t dma_index = rgb_index + hw_res_info_.num_rgb_pipe;
+  uint32_t cursor_index = dma_index + hw_res_info_.num_dma_pipe;
 
-  for (uint32_t i = 0; i < num_pipe_; i++) {
+  for (uint32_t i = 0; i < hw_res_info_.hw_pipes.size(); i++) {
     const HWPipeCaps &pipe_caps = hw_res_info_.hw_pipes.at(i);
     if (pipe_caps.type == kPipeTypeVIG) {
       src_pipes_[vig_index].type = kPipeTypeVIG;
@@ -72,6 +74,11 @@ DisplayError ResourceDefault::Init(const HWResourceInfo &hw_res_info) {
       src_pipes_[dma_index].index = i;
       src_pipes_[dma_index].mdss_pipe_id = pipe_caps.id;
       dma_index++;
+    } else if (pipe_caps.type == kPipeTypeCursor) {
+      src_pipes_[cursor_index].type = kPipeTypeCursor;
+      src_pipes_[cursor_index].index = i;
+      src_pipes_[cursor_index].mdss_pipe_id = pipe_caps.id;
+      cursor_index++;
     }
   }
 
@@ -79,8 +86,9 @@ DisplayError ResourceDefault::Init(const HWResourceInfo &hw_res_info) {
     src_pipes_[i].priority = INT(i);
   }
 
-  DLOGI("hw_rev=%x, DMA=%d RGB=%d VIG=%d", hw_res_info_.hw_revision, hw_res_info_.num_dma_pipe,
-    hw_res_info_.num_rgb_pipe, hw_res_info_.num_vig_pipe);
+  DLOGI("hw_rev=%x, DMA=%d RGB=%d VIG=%d Cursor=%d", hw_res_info_.hw_revision,
+    hw_res_info_.num_dma_pipe, hw_res_info_.num_rgb_pipe, hw_res_info_.num_vig_pipe,
+    hw_res_info_.num_cursor_pipe);
 
   if (hw_res_info_.max_scale_down < 1 || hw_res_info_.max_scale_up < 1) {
     DLOGE("Max scaling setting is invalid! max_scale_down = %d, max_scale_up = %d",
@@ -194,101 +202,112 @@ DisplayError ResourceDefault::Acquire(Handle display_ctx, HWLayers *hw_layers) {
   DisplayError error = kErrorNone;
   const struct HWLayersInfo &layer_info = hw_layers->info;
   HWBlockType hw_block_id = display_resource_ctx->hw_block_id;
+  uint32_t max_mixer_stages = display_resource_ctx->max_mixer_stages;
 
   DLOGV_IF(kTagResources, "==== Resource reserving start: hw_block = %d ====", hw_block_id);
 
-  if (layer_info.count > 1) {
-    DLOGV_IF(kTagResources, "More than one FB layers");
+  if (!layer_info.count) {
+    DLOGV_IF(kTagResources, "No layers to be programmed");
+    return kErrorParameters;
+  }
+
+  if (max_mixer_stages && (layer_info.count > max_mixer_stages)) {
+    DLOGV_IF(kTagResources, "Layer count %d exceeds max mixer stages %d", layer_info.count,
+             max_mixer_stages);
     return kErrorResources;
   }
 
-  Layer *layer = layer_info.stack->layers.at(layer_info.index[0]);
+  // Release the pipes reserved for the previously tried strategy.
+  ReleasePipes(hw_block_id);
 
-  if (layer->composition != kCompositionGPUTarget) {
-    DLOGV_IF(kTagResources, "Not an FB layer");
-    return kErrorParameters;
-  }
+  for (uint32_t i = 0; i < layer_info.count; i++) {
+    Layer *layer = layer_info.stack->layers.at(layer_info.index[i]);
 
-  error = Config(display_resource_ctx, hw_layers);
-  if (error != kErrorNone) {
-    DLOGV_IF(kTagResources, "Resource config failed");
-    return error;
-  }
+    error = Config(display_resource_ctx, hw_layers, i);
+    if (error != kErrorNone) {
+      DLOGV_IF(kTagResources, "Resource config failed for layer %d", layer_info.index[i]);
+      goto CleanupOnError;
+    }
 
-  for (uint32_t i = 0; i < num_pipe_; i++) {
-    if (src_pipes_[i].hw_block_id == hw_block_id && src_pipes_[i].owner == kPipeOwnerUserMode) {
-      src_pipes_[i].ResetState();
+    error = AssignPipes(hw_block_id, layer, &hw_layers->config[i]);
+    if (error != kErrorNone) {
+      goto CleanupOnError;
     }
   }
 
-  uint32_t left_index = num_pipe_;
-  uint32_t right_index = num_pipe_;
-  bool need_scale = false;
+  DLOGV_IF(kTagResources, "Pipes acquired for %d layers, hw_block = %d", layer_info.count,
+           hw_block_id);
 
-  struct HWLayerConfig &layer_config = hw_layers->config[0];
+  return kErrorNone;
 
-  HWPipeInfo *left_pipe = &layer_config.left_pipe;
-  HWPipeInfo *right_pipe = &layer_config.right_pipe;
+CleanupOnError:
+  DLOGV_IF(kTagResources, "Resource reserving failed! hw_block = %d", hw_block_id);
+  ReleasePipes(hw_block_id);
 
-  // left pipe is needed
-  if (left_pipe->valid) {
-    need_scale = IsScalingNeeded(left_pipe);
-    left_index = GetPipe(hw_block_id, need_scale);
-    if (left_index >= num_pipe_) {
-      DLOGV_IF(kTagResources, "Get left pipe failed: hw_block_id = %d, need_scale = %d",
-               hw_block_id, need_scale);
-      ResourceStateLog();
-      goto CleanupOnError;
-    }
-  }
+  return error;
+}
 
-  error = SetDecimationFactor(left_pipe);
-  if (error != kErrorNone) {
-    goto CleanupOnError;
-  }
+DisplayError ResourceDefault::AssignPipes(HWBlockType hw_block_id, const Layer *layer,
+                                          HWLayerConfig *layer_config) {
+  DisplayError error = kErrorNone;
+  HWPipeInfo *pipes[2] = { &layer_config->left_pipe, &layer_config->right_pipe };
+  uint32_t pipe_index[2] = { num_pipe_, num_pipe_ };
+  bool is_cursor = (layer->composition == kCompositionHWCursor);
+  bool is_yuv = !layer->flags.solid_fill && !IS_RGB_FORMAT(layer->input_buffer->format);
+
+  for (uint32_t i = 0; i < 2; i++) {
+    HWPipeInfo *pipe = pipes[i];
+    if (!pipe->valid) {
+      continue;
+    }
 
-  if (!right_pipe->valid) {
-    // assign single pipe
-    if (left_index < num_pipe_) {
-      left_pipe->pipe_id = src_pipes_[left_index].mdss_pipe_id;
+    bool need_scale = IsScalingNeeded(pipe);
+    if (is_cursor) {
+      pipe_index[i] = NextPipe(kPipeTypeCursor, hw_block_id);
+    } else {
+      pipe_index[i] = GetPipe(hw_block_id, is_yuv, need_scale);
     }
-    DLOGV_IF(kTagResources, "1 pipe acquired for FB layer, left_pipe = %x", left_pipe->pipe_id);
-    return kErrorNone;
-  }
 
-  need_scale = IsScalingNeeded(right_pipe);
+    if (pipe_index[i] >= num_pipe_) {
+      DLOGV_IF(kTagResources, "Get %s pipe failed: hw_block_id = %d, need_scale = %d, yuv = %d",
+               i ? "right" : "left", hw_block_id, need_scale, is_yuv);
+      ResourceStateLog();
+      return kErrorResources;
+    }
 
-  right_index = GetPipe(hw_block_id, need_scale);
-  if (right_index >= num_pipe_) {
-    DLOGV_IF(kTagResources, "Get right pipe failed: hw_block_id = %d, need_scale = %d", hw_block_id,
-             need_scale);
-    ResourceStateLog();
-    goto CleanupOnError;
+    error = SetDecimationFactor(pipe);
+    if (error != kErrorNone) {
+      return error;
+    }
   }
 
-  if (src_pipes_[right_index].priority < src_pipes_[left_index].priority) {
-    // Swap pipe based on priority
-    std::swap(left_index, right_index);
+  // Swap pipe based on priority, only if both the pipes have the same capabilities.
+  if (pipes[0]->valid && pipes[1]->valid &&
+      (src_pipes_[pipe_index[0]].type == src_pipes_[pipe_index[1]].type) &&
+      (src_pipes_[pipe_index[1]].priority < src_pipes_[pipe_index[0]].priority)) {
+    std::swap(pipe_index[0], pipe_index[1]);
   }
 
-  // assign dual pipes
-  left_pipe->pipe_id = src_pipes_[left_index].mdss_pipe_id;
-  right_pipe->pipe_id = src_pipes_[right_index].mdss_pipe_id;
-
-  error = SetDecimationFactor(right_pipe);
-  if (error != kErrorNone) {
-    goto CleanupOnError;
+  for (uint32_t i = 0; i < 2; i++) {
+    if (pipes[i]->valid) {
+      SourcePipe &src_pipe = src_pipes_[pipe_index[i]];
+      pipes[i]->pipe_id = src_pipe.mdss_pipe_id;
+      pipes[i]->sub_block_type = GetSubBlockType(src_pipe.type);
+    }
   }
 
-  DLOGV_IF(kTagResources, "2 pipes acquired for FB layer, left_pipe = %x, right_pipe = %x",
-           left_pipe->pipe_id,  right_pipe->pipe_id);
+  DLOGV_IF(kTagResources, "Pipes acquired, left_pipe = %x, right_pipe = %x",
+           pipes[0]->valid ? pipes[0]->pipe_id : 0, pipes[1]->valid ? pipes[1]->pipe_id : 0);
 
   return kErrorNone;
+}
 
-CleanupOnError:
-  DLOGV_IF(kTagResources, "Resource reserving failed! hw_block = %d", hw_block_id);
-
-  return kErrorResources;
+void ResourceDefault::ReleasePipes(HWBlockType hw_block_id) {
+  for (uint32_t i = 0; i < num_pipe_; i++) {
+    if (src_pipes_[i].hw_block_id == hw_block_id && src_pipes_[i].owner == kPipeOwnerUserMode) {
+      src_pipes_[i].ResetState();
+    }
+  }
 }
 
 DisplayError ResourceDefault::PostPrepare(Handle display_ctx, HWLayers *hw_layers) {
@@ -309,12 +328,23 @@ DisplayError ResourceDefault::PostCommit(Handle display_ctx, HWLayers *hw_layers
   // handoff pipes which are used by splash screen
   if ((frame_count == 0) && (hw_block_id == kHWPrimary)) {
     for (uint32_t i = 0; i < num_pipe_; i++) {
-      if (src_pipes_[i].hw_block_id == hw_block_id && src_pipes_[i].owner == kPipeOwnerKernelMode) {
+      if (src_pipes_[i].owner == kPipeOwnerKernelMode) {
         src_pipes_[i].owner = kPipeOwnerUserMode;
       }
     }
   }
 
+  // Pipes which are not part of this commit are unstaged by the driver and can be used by any
+  // display from now on.
+  for (uint32_t i = 0; i < num_pipe_; i++) {
+    SourcePipe &src_pipe = src_pipes_[i];
+    if (src_pipe.hw_block_id == hw_block_id) {
+      src_pipe.staged_hw_block_id = hw_block_id;
+    } else if (src_pipe.staged_hw_block_id == hw_block_id) {
+      src_pipe.staged_hw_block_id = kHWBlockMax;
+    }
+  }
+
   if (hw_layers->info.sync_handle >= 0)
     Sys::close_(hw_layers->info.sync_handle);
 
@@ -330,9 +360,10 @@ void ResourceDefault::Purge(Handle display_ctx) {
                           reinterpret_cast<DisplayResourceContext *>(display_ctx);
   HWBlockType hw_block_id = display_resource_ctx->hw_block_id;
 
+  ReleasePipes(hw_block_id);
   for (uint32_t i = 0; i < num_pipe_; i++) {
-    if (src_pipes_[i].hw_block_id == hw_block_id && src_pipes_[i].owner == kPipeOwnerUserMode) {
-      src_pipes_[i].ResetState();
+    if (src_pipes_[i].staged_hw_block_id == hw_block_id) {
+      src_pipes_[i].staged_hw_block_id = kHWBlockMax;
     }
   }
   DLOGV_IF(kTagResources, "display id = %d", display_resource_ctx->hw_block_id);
@@ -340,6 +371,10 @@ void ResourceDefault::Purge(Handle display_ctx) {
 
 DisplayError ResourceDefault::SetMaxMixerStages(Handle display_ctx, uint32_t max_mixer_stages) {
   SCOPE_LOCK(locker_);
+  DisplayResourceContext *display_resource_ctx =
+                          reinterpret_cast<DisplayResourceContext *>(display_ctx);
+
+  display_resource_ctx->max_mixer_stages = max_mixer_stages;
 
   return kErrorNone;
 }
@@ -349,11 +384,14 @@ uint32_t ResourceDefault::SearchPipe(HWBlockType hw_block_id, SourcePipe *src_pi
   uint32_t index = num_pipe_;
   SourcePipe *src_pipe;
 
-  // search the pipe being used
+  // search the pipe being used, a pipe staged on another block can not be used until that block
+  // commits without it.
   for (uint32_t i = 0; i < num_pipe; i++) {
     src_pipe = &src_pipes[i];
-    if (src_pipe->owner == kPipeOwnerUserMode && src_pipe->hw_block_id == kHWBlockMax) {
-      index = src_pipe->index;
+    if (src_pipe->owner == kPipeOwnerUserMode && src_pipe->hw_block_id == kHWBlockMax &&
+        (src_pipe->staged_hw_block_id == kHWBlockMax ||
+         src_pipe->staged_hw_block_id == hw_block_id)) {
+      index = UINT32(src_pipe - &src_pipes_[0]);
       src_pipe->hw_block_id = hw_block_id;
       break;
     }
@@ -375,6 +413,11 @@ uint32_t ResourceDefault::NextPipe(PipeType type, HWBlockType hw_block_id) {
     src_pipes = &src_pipes_[hw_res_info_.num_vig_pipe];
     num_pipe = hw_res_info_.num_rgb_pipe;
     break;
+  case kPipeTypeCursor:
+    src_pipes = &src_pipes_[hw_res_info_.num_vig_pipe + hw_res_info_.num_rgb_pipe +
+                            hw_res_info_.num_dma_pipe];
+    num_pipe = hw_res_info_.num_cursor_pipe;
+    break;
   case kPipeTypeDMA:
   default:
     src_pipes = &src_pipes_[hw_res_info_.num_vig_pipe + hw_res_info_.num_rgb_pipe];
@@ -385,9 +428,14 @@ uint32_t ResourceDefault::NextPipe(PipeType type, HWBlockType hw_block_id) {
   return SearchPipe(hw_block_id, src_pipes, num_pipe);
 }
 
-uint32_t ResourceDefault::GetPipe(HWBlockType hw_block_id, bool need_scale) {
+uint32_t ResourceDefault::GetPipe(HWBlockType hw_block_id, bool is_yuv, bool need_scale) {
   uint32_t index = num_pipe_;
 
+  // YUV formats can be fetched only by VIG pipes
+  if (is_yuv) {
+    return NextPipe(kPipeTypeVIG, hw_block_id);
+  }
+
   // The default behavior is to assume RGB and VG pipes have scalars
   if (!need_scale) {
     index = NextPipe(kPipeTypeDMA, hw_block_id);
@@ -404,6 +452,16 @@ uint32_t ResourceDefault::GetPipe(HWBlockType hw_block_id, bool need_scale) {
   return index;
 }
 
+HWSubBlockType ResourceDefault::GetSubBlockType(PipeType pipe_type) {
+  switch (pipe_type) {
+  case kPipeTypeVIG:     return kHWVIGPipe;
+  case kPipeTypeRGB:     return kHWRGBPipe;
+  case kPipeTypeDMA:     return kHWDMAPipe;
+  case kPipeTypeCursor:  return kHWCursorPipe;
+  default:               return kHWSubBlockMax;
+  }
+}
+
 bool ResourceDefault::IsScalingNeeded(const HWPipeInfo *pipe_info) {
   const LayerRect &src_roi = pipe_info->src_roi;
   const LayerRect &dst_roi = pipe_info->dst_roi;
@@ -499,22 +557,31 @@ DisplayError ResourceDefault::DisplaySplitConfig(DisplayResourceContext *display
 }
 
 DisplayError ResourceDefault::Config(DisplayResourceContext *display_resource_ctx,
-                                HWLayers *hw_layers) {
+                                     HWLayers *hw_layers, uint32_t index) {
   HWLayersInfo &layer_info = hw_layers->info;
   DisplayError error = kErrorNone;
-  Layer *layer = layer_info.stack->layers.at(layer_info.index[0]);
+  Layer *layer = layer_info.stack->layers.at(layer_info.index[index]);
+  HWMixerAttributes &mixer_attributes = display_resource_ctx->mixer_attributes;
 
   error = ValidateLayerParams(layer);
   if (error != kErrorNone) {
     return error;
   }
 
-  struct HWLayerConfig *layer_config = &hw_layers->config[0];
+  struct HWLayerConfig *layer_config = &hw_layers->config[index];
   HWPipeInfo &left_pipe = layer_config->left_pipe;
   HWPipeInfo &right_pipe = layer_config->right_pipe;
 
-  LayerRect src_rect = layer->src_rect;
-  LayerRect dst_rect = layer->dst_rect;
+  LayerRect src_rect = layer_info.updated_src_rect[index];
+  LayerRect dst_rect = layer_info.updated_dst_rect[index];
+  LayerRect scissor = LayerRect(0.0f, 0.0f, FLOAT(mixer_attributes.width),
+                                FLOAT(mixer_attributes.height));
+
+  // Layers can be partially outside the mixer, crop them to the mixer boundaries.
+  if (!CalculateCropRects(scissor, &src_rect, &dst_rect)) {
+    Log(kTagResources, "Layer is outside the mixer", dst_rect);
+    return kErrorNotSupported;
+  }
 
   error = ValidateDimensions(src_rect, dst_rect);
   if (error != kErrorNone) {
@@ -528,7 +595,14 @@ DisplayError ResourceDefault::Config(DisplayResourceContext *display_resource_ct
     return error;
   }
 
-  if (hw_res_info_.is_src_split) {
+  if (layer->composition == kCompositionHWCursor) {
+    // Cursor is always fetched by a single pipe.
+    left_pipe.Reset();
+    right_pipe.Reset();
+    left_pipe.src_roi = src_rect;
+    left_pipe.dst_roi = dst_rect;
+    left_pipe.valid = true;
+  } else if (hw_res_info_.is_src_split) {
     error = SrcSplitConfig(display_resource_ctx, src_rect, dst_rect, layer_config);
   } else {
     error = DisplaySplitConfig(display_resource_ctx, src_rect, dst_rect, layer_config);
@@ -543,18 +617,20 @@ DisplayError ResourceDefault::Config(DisplayResourceContext *display_resource_ct
     return error;
   }
 
-  // set z_order, left_pipe should always be valid
-  left_pipe.z_order = 0;
+  // Layers are staged in the order of hardware layer index.
+  left_pipe.z_order = index;
+  right_pipe.z_order = index;
 
-  DLOGV_IF(kTagResources, "==== FB layer Config ====");
+  DLOGV_IF(kTagResources, "==== Layer %d Config ====", layer_info.index[index]);
   Log(kTagResources, "input layer src_rect", layer->src_rect);
   Log(kTagResources, "input layer dst_rect", layer->dst_rect);
   Log(kTagResources, "cropped src_rect", src_rect);
   Log(kTagResources, "cropped dst_rect", dst_rect);
-  Log(kTagResources, "left pipe src", layer_config->left_pipe.src_roi);
-  Log(kTagResources, "left pipe dst", layer_config->left_pipe.dst_roi);
+  if (left_pipe.valid) {
+    Log(kTagResources, "left pipe src", layer_config->left_pipe.src_roi);
+    Log(kTagResources, "left pipe dst", layer_config->left_pipe.dst_roi);
+  }
   if (right_pipe.valid) {
-    right_pipe.z_order = 0;
     Log(kTagResources, "right pipe src", layer_config->right_pipe.src_roi);
     Log(kTagResources, "right pipe dst", layer_config->right_pipe.dst_roi);
   }
@@ -842,12 +918,19 @@ void ResourceDefault::SplitRect(const LayerRect &src_rect, const LayerRect &dst_
 DisplayError ResourceDefault::AlignPipeConfig(const Layer *layer, HWPipeInfo *left_pipe,
                                               HWPipeInfo *right_pipe) {
   DisplayError error = kErrorNone;
+  bool ubwc_tiled = IsUBWCFormat(layer->input_buffer->format);
+
+  // Layer can be entirely on the right mixer in case of display split.
   if (!left_pipe->valid) {
-    DLOGE_IF(kTagResources, "left_pipe should not be invalid");
-    return kErrorNotSupported;
+    if (!right_pipe->valid) {
+      DLOGE_IF(kTagResources, "Both left_pipe and right_pipe are invalid");
+      return kErrorNotSupported;
+    }
+
+    error = ValidatePipeParams(right_pipe, ubwc_tiled);
+    goto PipeConfigExit;
   }
 
-  bool ubwc_tiled = IsUBWCFormat(layer->input_buffer->format);
   error = ValidatePipeParams(left_pipe, ubwc_tiled);
   if (error != kErrorNone) {
     goto PipeConfigExit;
@@ -888,12 +971,66 @@ DisplayError ResourceDefault::CalculateDecimation(float downscale, uint8_t *deci
 
 DisplayError ResourceDefault::ValidateCursorConfig(Handle display_ctx, const Layer *layer,
                                                    bool is_top) {
-  return kErrorNotSupported;
+  if (!is_top || !hw_res_info_.num_cursor_pipe || !layer->input_buffer) {
+    return kErrorNotSupported;
+  }
+
+  const LayerRect &src = layer->src_rect;
+  const LayerRect &dst = layer->dst_rect;
+  float src_width = src.right - src.left;
+  float src_height = src.bottom - src.top;
+  float max_cursor_size = FLOAT(hw_res_info_.max_cursor_size);
+
+  // Cursor pipe does not have a scaler.
+  if (!IsValid(src) || (src_width != (dst.right - dst.left)) ||
+      (src_height != (dst.bottom - dst.top))) {
+    return kErrorNotSupported;
+  }
+
+  if (src_width > max_cursor_size || src_height > max_cursor_size) {
+    DLOGV_IF(kTagResources, "Cursor size %.0fx%.0f exceeds max cursor size %d", src_width,
+             src_height, hw_res_info_.max_cursor_size);
+    return kErrorNotSupported;
+  }
+
+  FormatsMap::const_iterator it = hw_res_info_.supported_formats_map.find(kHWCursorPipe);
+  if (it == hw_res_info_.supported_formats_map.end() ||
+      std::find(it->second.begin(), it->second.end(), layer->input_buffer->format) ==
+      it->second.end()) {
+    DLOGV_IF(kTagResources, "Cursor format %d is not supported", layer->input_buffer->format);
+    return kErrorNotSupported;
+  }
+
+  return kErrorNone;
 }
 
 DisplayError ResourceDefault::ValidateCursorPosition(Handle display_ctx, HWLayers *hw_layers,
                                                      int x, int y) {
-  return kErrorNotSupported;
+  SCOPE_LOCK(locker_);
+  DisplayResourceContext *display_resource_ctx =
+                          reinterpret_cast<DisplayResourceContext *>(display_ctx);
+  HWMixerAttributes &mixer_attributes = display_resource_ctx->mixer_attributes;
+  HWLayersInfo &layer_info = hw_layers->info;
+
+  if (!layer_info.use_hw_cursor || !layer_info.count) {
+    return kErrorNotSupported;
+  }
+
+  // Cursor layer is always the top most hardware layer.
+  HWPipeInfo &left_pipe = hw_layers->config[layer_info.count - 1].left_pipe;
+  float width = left_pipe.dst_roi.right - left_pipe.dst_roi.left;
+  float height = left_pipe.dst_roi.bottom - left_pipe.dst_roi.top;
+  LayerRect dst_roi = LayerRect(FLOAT(x), FLOAT(y), FLOAT(x) + width, FLOAT(y) + height);
+
+  // Async position update can not crop the cursor, let next Prepare handle it.
+  if (x < 0 || y < 0 || dst_roi.right > FLOAT(mixer_attributes.width) ||
+      dst_roi.bottom > FLOAT(mixer_attributes.height)) {
+    return kErrorNotSupported;
+  }
+
+  left_pipe.dst_roi = dst_roi;
+
+  return kErrorNone;
 }
 
 DisplayError ResourceDefault::SetMaxBandwidthMode(HWBwModes mode) {
@@ -79,11 +79,13 @@ class ResourceDefault : public ResourceInterface {
     PipeOwner owner;
     uint32_t mdss_pipe_id;
     uint32_t index;
-    HWBlockType hw_block_id;
+    HWBlockType hw_block_id;         // Block which reserved the pipe for the frame being prepared
+    HWBlockType staged_hw_block_id;  // Block on which the pipe is staged by the last commit
     int priority;
 
     SourcePipe() : type(kPipeTypeUnused), owner(kPipeOwnerUserMode), mdss_pipe_id(0),
-                  index(0), hw_block_id(kHWBlockMax), priority(0) { }
+                  index(0), hw_block_id(kHWBlockMax), staged_hw_block_id(kHWBlockMax),
+                  priority(0) { }
 
     inline void ResetState() { hw_block_id = kHWBlockMax;}
   };
@@ -93,8 +95,9 @@ class ResourceDefault : public ResourceInterface {
     HWBlockType hw_block_id;
     uint64_t frame_count;
     HWMixerAttributes mixer_attributes;
+    uint32_t max_mixer_stages;
 
-    DisplayResourceContext() : hw_block_id(kHWBlockMax), frame_count(0) { }
+    DisplayResourceContext() : hw_block_id(kHWBlockMax), frame_count(0), max_mixer_stages(0) { }
   };
 
   struct HWBlockContext {
@@ -104,9 +107,14 @@ class ResourceDefault : public ResourceInterface {
 
   uint32_t NextPipe(PipeType pipe_type, HWBlockType hw_block_id);
   uint32_t SearchPipe(HWBlockType hw_block_id, SourcePipe *src_pipes, uint32_t num_pipe);
-  uint32_t GetPipe(HWBlockType hw_block_id, bool need_scale);
+  uint32_t GetPipe(HWBlockType hw_block_id, bool is_yuv, bool need_scale);
+  HWSubBlockType GetSubBlockType(PipeType pipe_type);
   bool IsScalingNeeded(const HWPipeInfo *pipe_info);
-  DisplayError Config(DisplayResourceContext *display_resource_ctx, HWLayers *hw_layers);
+  DisplayError Config(DisplayResourceContext *display_resource_ctx, HWLayers *hw_layers,
+                      uint32_t index);
+  DisplayError AssignPipes(HWBlockType hw_block_id, const Layer *layer,
+                           HWLayerConfig *layer_config);
+  void ReleasePipes(HWBlockType hw_block_id);
   DisplayError DisplaySplitConfig(DisplayResourceContext *display_resource_ctx,
                                  const LayerRect &src_rect, const LayerRect &dst_rect,
                                  HWLayerConfig *layer_config);
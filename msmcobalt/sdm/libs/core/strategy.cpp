@@ -36,7 +36,10 @@ Strategy::Strategy(ExtensionInterface *extension_intf, DisplayType type,
                    const HWMixerAttributes &mixer_attributes,
                    const HWDisplayAttributes &display_attributes,
                    const DisplayConfigVariableInfo &fb_config)
-  : extension_intf_(extension_intf), display_type_(type), hw_resource_info_(hw_resource_info),
+  : extension_intf_(extension_intf),
+    strategy_default_(type, hw_resource_info, hw_panel_info, mixer_attributes, fb_config),
+    partial_update_default_(hw_resource_info, hw_panel_info, mixer_attributes, fb_config),
+    display_type_(type), hw_resource_info_(hw_resource_info),
     hw_panel_info_(hw_panel_info), mixer_attributes_(mixer_attributes),
     display_attributes_(display_attributes), fb_config_(fb_config) {
 }
@@ -56,13 +59,18 @@ DisplayError Strategy::Init() {
     error = extension_intf_->CreatePartialUpdate(display_type_, hw_resource_info_, hw_panel_info_,
                                                  mixer_attributes_, display_attributes_,
                                                  &partial_update_intf_);
+  } else {
+    strategy_intf_ = &strategy_default_;
+    if (IsPartialUpdateSupported()) {
+      partial_update_intf_ = &partial_update_default_;
+    }
   }
 
   return kErrorNone;
 }
 
 DisplayError Strategy::Deinit() {
-  if (strategy_intf_) {
+  if (extension_intf_ && strategy_intf_) {
     if (partial_update_intf_) {
       extension_intf_->DestroyPartialUpdate(partial_update_intf_);
     }
@@ -132,6 +140,7 @@ DisplayError Strategy::GetNextStrategy(StrategyConstraints *constraints) {
   LayerStack *layer_stack = hw_layers_info_->stack;
   uint32_t &hw_layer_count = hw_layers_info_->count;
   hw_layer_count = 0;
+  hw_layers_info_->use_hw_cursor = false;
 
   for (uint32_t i = 0; i < hw_layers_info_->app_layer_count; i++) {
     layer_stack->layers.at(i)->composition = kCompositionGPU;
@@ -184,7 +193,10 @@ DisplayError Strategy::Reconfigure(const HWPanelInfo &hw_panel_info,
   mixer_attributes_ = mixer_attributes;
 
   if (!extension_intf_) {
-    return kErrorNone;
+    partial_update_default_.Reconfigure(hw_panel_info_, mixer_attributes, fb_config);
+    partial_update_intf_ = IsPartialUpdateSupported() ? &partial_update_default_ : NULL;
+    return strategy_default_.Reconfigure(hw_panel_info_.mode, hw_panel_info_.s3d_mode,
+                                         mixer_attributes, fb_config);
   }
 
   // TODO(user): PU Intf will not be created for video mode panels, hence re-evaluate if
@@ -202,4 +214,11 @@ DisplayError Strategy::Reconfigure(const HWPanelInfo &hw_panel_info,
                                      fb_config);
 }
 
+// Partial update only saves panel bandwidth on a command mode panel, which retains the content
+// outside of the ROI.
+bool Strategy::IsPartialUpdateSupported() {
+  return (display_type_ == kPrimary && hw_panel_info_.partial_update &&
+          hw_panel_info_.mode == kModeCommand);
+}
+
 }  // namespace sdm
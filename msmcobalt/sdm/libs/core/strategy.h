@@ -28,6 +28,9 @@
 #include <core/display_interface.h>
 #include <private/extension_interface.h>
 
+#include "strategy_default.h"
+#include "partial_update_default.h"
+
 namespace sdm {
 
 class Strategy {
@@ -51,8 +54,11 @@ class Strategy {
 
  private:
   void GenerateROI();
+  bool IsPartialUpdateSupported();
 
   ExtensionInterface *extension_intf_ = NULL;
+  StrategyDefault strategy_default_;
+  PartialUpdateDefault partial_update_default_;
   StrategyInterface *strategy_intf_ = NULL;
   PartialUpdateInterface *partial_update_intf_ = NULL;
   DisplayType display_type_;
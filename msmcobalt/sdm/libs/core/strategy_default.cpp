@@ -0,0 +1,340 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/rect.h>
+#include <algorithm>
+
+#include "strategy_default.h"
+
+#define __CLASS__ "StrategyDefault"
+
+namespace sdm {
+
+StrategyDefault::StrategyDefault(DisplayType type, const HWResourceInfo &hw_resource_info,
+                                 const HWPanelInfo &hw_panel_info,
+                                 const HWMixerAttributes &mixer_attributes,
+                                 const DisplayConfigVariableInfo &fb_config)
+  : display_type_(type), hw_resource_info_(hw_resource_info), hw_panel_info_(hw_panel_info),
+    mixer_attributes_(mixer_attributes), fb_config_(fb_config) {
+}
+
+DisplayError StrategyDefault::Start(HWLayersInfo *hw_layers_info, uint32_t *max_attempts) {
+  hw_layers_info_ = hw_layers_info;
+  next_strategy_ = kStrategyFullSDE;
+  load_based_sde_count_ = 0;
+  tried_batches_.clear();
+
+  // Each load based attempt moves one more layer into the GPU batch, one more attempt is reserved
+  // for the GPU composition which is tried by the caller once all strategies are exhausted.
+  *max_attempts = kStrategyMax + hw_layers_info_->app_layer_count + 1;
+
+  return kErrorNone;
+}
+
+DisplayError StrategyDefault::GetNextStrategy(StrategyConstraints *constraints) {
+  while (next_strategy_ < kStrategyMax) {
+    StrategyType strategy = next_strategy_;
+    bool success = false;
+
+    switch (strategy) {
+    case kStrategyFullSDE:
+      success = TryFullSDE(*constraints);
+      next_strategy_ = kStrategyCacheBased;
+      break;
+
+    case kStrategyCacheBased:
+      success = TryCacheBased(*constraints);
+      next_strategy_ = kStrategyVideoOnly;
+      break;
+
+    case kStrategyVideoOnly:
+      success = TryVideoOnly(*constraints);
+      next_strategy_ = kStrategyLoadBased;
+      break;
+
+    case kStrategyLoadBased:
+      // Stays on this strategy until all SDE batch sizes are exhausted.
+      success = TryLoadBased(*constraints);
+      if (!success) {
+        next_strategy_ = kStrategyMax;
+      }
+      break;
+
+    default:
+      next_strategy_ = kStrategyMax;
+      break;
+    }
+
+    if (success) {
+      DLOGV_IF(kTagStrategy, "Selected %s composition for display %d, sde layer count %d",
+               GetName(strategy), display_type_, hw_layers_info_->count);
+      return kErrorNone;
+    }
+  }
+
+  return kErrorUndefined;
+}
+
+DisplayError StrategyDefault::Stop() {
+  return kErrorNone;
+}
+
+DisplayError StrategyDefault::Reconfigure(HWDisplayMode mode, HWS3DMode s3d_mode,
+                                          const HWMixerAttributes &mixer_attributes,
+                                          const DisplayConfigVariableInfo &fb_config) {
+  hw_panel_info_.mode = mode;
+  hw_panel_info_.s3d_mode = s3d_mode;
+  mixer_attributes_ = mixer_attributes;
+  fb_config_ = fb_config;
+
+  return kErrorNone;
+}
+
+bool StrategyDefault::TryFullSDE(const StrategyConstraints &constraints) {
+  // Safe mode expects minimum number of pipes to be used.
+  if (constraints.safe_mode) {
+    return false;
+  }
+
+  return ApplyGPUBatch(GPUBatch(-1, -1), constraints);
+}
+
+bool StrategyDefault::TryCacheBased(const StrategyConstraints &constraints) {
+  if (constraints.safe_mode) {
+    return false;
+  }
+
+  // Club all non updating layers along with the layers which can not be handled by SDE into the
+  // GPU batch, so that GPU target buffer can be reused across frames.
+  LayerStack *layer_stack = hw_layers_info_->stack;
+  int32_t app_layer_count = INT32(hw_layers_info_->app_layer_count);
+  GPUBatch batch(-1, -1);
+
+  for (int32_t i = 0; i < app_layer_count; i++) {
+    Layer *layer = layer_stack->layers.at(UINT32(i));
+    if (!layer->flags.updating || !IsSDESupported(layer)) {
+      batch.first = (batch.first < 0) ? i : batch.first;
+      batch.second = i;
+    }
+  }
+
+  if (batch.first < 0 || (batch.first == 0 && batch.second == (app_layer_count - 1))) {
+    return false;
+  }
+
+  return ApplyGPUBatch(batch, constraints);
+}
+
+bool StrategyDefault::TryVideoOnly(const StrategyConstraints &constraints) {
+  if (!hw_layers_info_->stack->flags.video_present) {
+    return false;
+  }
+
+  LayerStack *layer_stack = hw_layers_info_->stack;
+  int32_t app_layer_count = INT32(hw_layers_info_->app_layer_count);
+  GPUBatch batch(-1, -1);
+
+  for (int32_t i = 0; i < app_layer_count; i++) {
+    Layer *layer = layer_stack->layers.at(UINT32(i));
+    if (!layer->input_buffer || !layer->input_buffer->flags.video || !IsSDESupported(layer)) {
+      batch.first = (batch.first < 0) ? i : batch.first;
+      batch.second = i;
+    }
+  }
+
+  if (batch.first == 0 && batch.second == (app_layer_count - 1)) {
+    return false;
+  }
+
+  return ApplyGPUBatch(batch, constraints);
+}
+
+bool StrategyDefault::TryLoadBased(const StrategyConstraints &constraints) {
+  if (constraints.safe_mode) {
+    return false;
+  }
+
+  uint32_t app_layer_count = hw_layers_info_->app_layer_count;
+  if (!load_based_sde_count_) {
+    // First attempt, one blending stage is reserved for the GPU target layer.
+    uint32_t max_layers = std::min(constraints.max_layers, UINT32(kMaxSDELayers));
+    if (max_layers < 2) {
+      return false;
+    }
+
+    uint32_t sde_count = max_layers - 1;
+    for (uint32_t i = 0; i < app_layer_count; i++) {
+      if (!IsSDESupported(hw_layers_info_->stack->layers.at(i))) {
+        sde_count = std::min(sde_count, i);
+        break;
+      }
+    }
+
+    // GPU batch should at least have two layers for this mode to be justified.
+    if (app_layer_count < 2) {
+      return false;
+    }
+    load_based_sde_count_ = std::min(sde_count, app_layer_count - 2);
+  }
+
+  // Try with successively smaller SDE batch sizes until we succeed or reach zero.
+  while (load_based_sde_count_) {
+    GPUBatch batch(INT32(load_based_sde_count_), INT32(app_layer_count) - 1);
+    load_based_sde_count_--;
+    if (ApplyGPUBatch(batch, constraints)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool StrategyDefault::ApplyGPUBatch(const GPUBatch &batch, const StrategyConstraints &constraints) {
+  LayerStack *layer_stack = hw_layers_info_->stack;
+  uint32_t app_layer_count = hw_layers_info_->app_layer_count;
+  uint32_t max_layers = std::min(constraints.max_layers, UINT32(kMaxSDELayers));
+  bool gpu_batch = (batch.first >= 0);
+  uint32_t sde_layer_count = gpu_batch ? 1 : 0;
+
+  // GPU batch can not be staged without a GPU target layer.
+  if (gpu_batch && !hw_layers_info_->gpu_target_index) {
+    return false;
+  }
+
+  if (IsTried(batch)) {
+    return false;
+  }
+  tried_batches_.push_back(batch);
+
+  for (uint32_t i = 0; i < app_layer_count; i++) {
+    Layer *layer = layer_stack->layers.at(i);
+    bool in_batch = gpu_batch && (INT32(i) >= batch.first) && (INT32(i) <= batch.second);
+
+    if (in_batch) {
+      // GPU can not read secure buffers.
+      if (layer->input_buffer && layer->input_buffer->flags.secure) {
+        return false;
+      }
+      continue;
+    }
+
+    if (!IsSDESupported(layer)) {
+      return false;
+    }
+    sde_layer_count++;
+  }
+
+  if (!sde_layer_count || sde_layer_count > max_layers) {
+    return false;
+  }
+
+  uint32_t &hw_layer_count = hw_layers_info_->count;
+  hw_layer_count = 0;
+  hw_layers_info_->use_hw_cursor = false;
+
+  // Hardware layers are programmed in z order, GPU target takes the position of its batch.
+  for (uint32_t i = 0; i < app_layer_count; i++) {
+    Layer *layer = layer_stack->layers.at(i);
+
+    if (gpu_batch && INT32(i) == batch.first) {
+      Layer *gpu_target_layer = layer_stack->layers.at(hw_layers_info_->gpu_target_index);
+      hw_layers_info_->updated_src_rect[hw_layer_count] = gpu_target_layer->src_rect;
+      MapToMixer(gpu_target_layer->dst_rect, &hw_layers_info_->updated_dst_rect[hw_layer_count]);
+      hw_layers_info_->updating[hw_layer_count] = true;
+      hw_layers_info_->index[hw_layer_count++] = hw_layers_info_->gpu_target_index;
+    }
+
+    if (gpu_batch && (INT32(i) >= batch.first) && (INT32(i) <= batch.second)) {
+      layer->composition = kCompositionGPU;
+      continue;
+    }
+
+    layer->composition = kCompositionSDE;
+    // Cursor pipe can only be used for the top most layer.
+    if (constraints.use_cursor && layer->flags.cursor && (i == app_layer_count - 1)) {
+      layer->composition = kCompositionHWCursor;
+      hw_layers_info_->use_hw_cursor = true;
+    }
+
+    hw_layers_info_->updated_src_rect[hw_layer_count] = layer->src_rect;
+    MapToMixer(layer->dst_rect, &hw_layers_info_->updated_dst_rect[hw_layer_count]);
+    hw_layers_info_->updating[hw_layer_count] = layer->flags.updating;
+    hw_layers_info_->index[hw_layer_count++] = i;
+  }
+
+  return true;
+}
+
+bool StrategyDefault::IsSDESupported(const Layer *layer) {
+  const LayerBuffer *input_buffer = layer->input_buffer;
+
+  if (layer->flags.skip || !input_buffer) {
+    return false;
+  }
+
+  if (!layer->flags.solid_fill && input_buffer->format == kFormatInvalid) {
+    return false;
+  }
+
+  // Rotation needs an inline or offline rotator, which is not available without extension.
+  if (layer->transform.rotation != 0.0f) {
+    return false;
+  }
+
+  if (input_buffer->s3d_format != kS3dFormatNone) {
+    return false;
+  }
+
+  return (IsValid(layer->src_rect) && IsValid(layer->dst_rect));
+}
+
+bool StrategyDefault::IsTried(const GPUBatch &batch) {
+  return (std::find(tried_batches_.begin(), tried_batches_.end(), batch) != tried_batches_.end());
+}
+
+void StrategyDefault::MapToMixer(const LayerRect &rect, LayerRect *out_rect) {
+  LayerRect src_domain = (LayerRect){0.0f, 0.0f, FLOAT(fb_config_.x_pixels),
+                                     FLOAT(fb_config_.y_pixels)};
+  LayerRect dst_domain = (LayerRect){0.0f, 0.0f, FLOAT(mixer_attributes_.width),
+                                     FLOAT(mixer_attributes_.height)};
+
+  *out_rect = rect;
+  if (src_domain != dst_domain) {
+    MapRect(src_domain, dst_domain, rect, out_rect);
+  }
+}
+
+const char *StrategyDefault::GetName(StrategyType strategy) {
+  switch (strategy) {
+  case kStrategyFullSDE:      return "full SDE";
+  case kStrategyCacheBased:   return "cache based";
+  case kStrategyVideoOnly:    return "video only";
+  case kStrategyLoadBased:    return "load based";
+  default:                    return "unknown";
+  }
+}
+
+}  // namespace sdm
@@ -0,0 +1,86 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __STRATEGY_DEFAULT_H__
+#define __STRATEGY_DEFAULT_H__
+
+#include <core/display_interface.h>
+#include <private/strategy_interface.h>
+#include <utility>
+#include <vector>
+
+namespace sdm {
+
+// In-tree composition strategy used when the strategy extension is not available. It tries to
+// offload as many application layers as possible on SDE pipes and combines the remaining layers
+// into a single contiguous GPU batch which is staged through the GPU target layer.
+class StrategyDefault : public StrategyInterface {
+ public:
+  StrategyDefault(DisplayType type, const HWResourceInfo &hw_resource_info,
+                  const HWPanelInfo &hw_panel_info, const HWMixerAttributes &mixer_attributes,
+                  const DisplayConfigVariableInfo &fb_config);
+
+  virtual DisplayError Start(HWLayersInfo *hw_layers_info, uint32_t *max_attempts);
+  virtual DisplayError GetNextStrategy(StrategyConstraints *constraints);
+  virtual DisplayError Stop();
+  virtual DisplayError Reconfigure(HWDisplayMode mode, HWS3DMode s3d_mode,
+                                   const HWMixerAttributes &mixer_attributes,
+                                   const DisplayConfigVariableInfo &fb_config);
+
+ private:
+  enum StrategyType {
+    kStrategyFullSDE,     // All application layers on SDE, GPU target is not used.
+    kStrategyCacheBased,  // Non updating layers on GPU, updating layers on SDE.
+    kStrategyVideoOnly,   // Video layers on SDE, rest of the layers on GPU.
+    kStrategyLoadBased,   // Bottom most layers on SDE, top most layers on GPU.
+    kStrategyMax,
+  };
+
+  // Contiguous range of application layers [first, last] composed by GPU.
+  typedef std::pair<int32_t, int32_t> GPUBatch;
+
+  bool TryFullSDE(const StrategyConstraints &constraints);
+  bool TryCacheBased(const StrategyConstraints &constraints);
+  bool TryVideoOnly(const StrategyConstraints &constraints);
+  bool TryLoadBased(const StrategyConstraints &constraints);
+  bool ApplyGPUBatch(const GPUBatch &batch, const StrategyConstraints &constraints);
+  bool IsSDESupported(const Layer *layer);
+  bool IsTried(const GPUBatch &batch);
+  void MapToMixer(const LayerRect &rect, LayerRect *out_rect);
+  const char *GetName(StrategyType strategy);
+
+  DisplayType display_type_;
+  HWResourceInfo hw_resource_info_;
+  HWPanelInfo hw_panel_info_;
+  HWMixerAttributes mixer_attributes_ = {};
+  DisplayConfigVariableInfo fb_config_ = {};
+  HWLayersInfo *hw_layers_info_ = NULL;
+  StrategyType next_strategy_ = kStrategyMax;
+  uint32_t load_based_sde_count_ = 0;
+  std::vector<GPUBatch> tried_batches_;
+};
+
+}  // namespace sdm
+
+#endif  // __STRATEGY_DEFAULT_H__
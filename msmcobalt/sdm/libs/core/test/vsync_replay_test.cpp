@@ -0,0 +1,227 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Replays hardware vsync timestamps through HWEvents::PredictVSync and measures how far predicted
+// vsyncs are from the actual ones, both within a run of vsyncs and across the gaps left while vsync
+// was disabled, which is when software vsync stands in for the hardware. Timestamps are read from
+// a capture of the vsync_event node if one is given, else several traces are generated from seeded
+// panel models with varying refresh rate, jitter, interrupt latency spikes and dropped vsyncs.
+//
+// usage: vsync_replay_test [<timestamp file>]
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utils/constants.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "fb/hw_events.h"
+
+using namespace sdm;  // NOLINT
+
+static const uint32_t kHistorySize = 32;
+static const uint32_t kHorizons[] = { 1, 8, 60, 300 };  // Vsyncs ahead of the last timestamp.
+static const uint32_t kNumHorizons = sizeof(kHorizons) / sizeof(kHorizons[0]);
+static const uint32_t kNumSeeds = 8;
+static const uint32_t kTraceLength = 3000;
+
+struct ErrorStats {
+  uint32_t count = 0;
+  uint32_t misses = 0;         // No prediction, or one nearer to another vsync.
+  int64_t total_error = 0;
+  int64_t max_error = 0;
+
+  void Add(int64_t error) {
+    count++;
+    total_error += error;
+    max_error = std::max(max_error, error);
+  }
+};
+
+// Accepts the vsync_event node content, "VSYNC=<timestamp>", or a bare timestamp per line.
+static bool ReadTimestamps(const char *path, std::vector<int64_t> *timestamps) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+
+  char line[128];
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    const char *value = strncmp(line, "VSYNC=", 6) ? line : (line + 6);
+    timestamps->push_back(strtoll(value, NULL, 0));
+  }
+  fclose(file);
+
+  return true;
+}
+
+// Generates a trace of a panel refreshing at 59 to 61 Hz. Each vsync is reported after a normally
+// distributed interrupt latency, with an occasional spike of up to 2 ms, and now and then a vsync
+// is dropped. Vsync is disabled for 2 to 420 periods between runs of 40 to 600 vsyncs.
+static void GenerateTimestamps(uint32_t seed, std::vector<int64_t> *timestamps) {
+  std::mt19937_64 engine(seed);
+  std::uniform_real_distribution<double> refresh_rate(59.0, 61.0);
+  std::normal_distribution<double> latency(60000.0, 15000.0);
+  std::uniform_int_distribution<int64_t> spike(200000, 2000000);
+  std::uniform_int_distribution<uint32_t> run_length(40, 600);
+  std::uniform_int_distribution<uint32_t> gap_length(2, 420);
+  std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+  double period = 1e9 / refresh_rate(engine);
+  double vsync = 1e11;  // Time of the hardware vsync, in ns since boot
+  uint32_t run_left = run_length(engine);
+
+  while (timestamps->size() < kTraceLength) {
+    vsync += period;
+    if (!run_left) {
+      vsync += period * gap_length(engine);
+      run_left = run_length(engine);
+    }
+    run_left--;
+
+    if (chance(engine) < 0.002) {
+      continue;
+    }
+
+    int64_t delay = std::max(int64_t(latency(engine)), int64_t(0));
+    if (chance(engine) < 0.005) {
+      delay += spike(engine);
+    }
+    timestamps->push_back(int64_t(vsync) + delay);
+  }
+}
+
+// Predicts the vsync at index target from the history ending at index last, as seen half a period
+// before it. Returns the absolute error, or -1 if the prediction lands on another vsync.
+static int64_t Predict(const std::vector<int64_t> &timestamps, size_t last, size_t target,
+                       int64_t nominal_period) {
+  size_t count = std::min(last + 1, size_t(kHistorySize));
+  const int64_t *history = &timestamps[last + 1 - count];
+  int64_t now = timestamps[target] - nominal_period / 2;
+  int64_t next = 0, period = 0;
+
+  if (!HWEvents::PredictVSync(history, UINT32(count), now, &next, &period)) {
+    return -1;
+  }
+
+  int64_t error = llabs(next - timestamps[target]);
+  return (error < nominal_period / 2) ? error : -1;
+}
+
+static void Report(const char *name, const ErrorStats &stats) {
+  printf("%-22s %6u predictions  mean %7.1f us  max %7.1f us  misses %u\n", name, stats.count,
+         stats.count ? FLOAT(stats.total_error / stats.count) / 1000.0f : 0.0f,
+         FLOAT(stats.max_error) / 1000.0f, stats.misses);
+}
+
+// Returns the number of vsyncs which were not predicted, or predicted nearer to another vsync.
+static uint32_t Replay(const char *name, const std::vector<int64_t> &timestamps) {
+  std::vector<int64_t> intervals;
+  for (size_t i = 1; i < timestamps.size(); i++) {
+    intervals.push_back(timestamps[i] - timestamps[i - 1]);
+  }
+  std::nth_element(intervals.begin(), intervals.begin() + intervals.size() / 2, intervals.end());
+  int64_t period = intervals[intervals.size() / 2];
+
+  // A run ends where the next interval is a gap, i.e. where vsync was disabled.
+  std::vector<size_t> run_ends;
+  for (size_t i = 1; i < timestamps.size(); i++) {
+    if (timestamps[i] - timestamps[i - 1] > period + period / 2) {
+      run_ends.push_back(i - 1);
+    }
+  }
+  run_ends.push_back(timestamps.size() - 1);
+
+  ErrorStats horizon_stats[kNumHorizons];
+  ErrorStats resync_stats;
+  size_t run_begin = 0;
+  for (size_t run_end : run_ends) {
+    for (size_t last = run_begin + kHistorySize - 1; last <= run_end; last++) {
+      for (uint32_t h = 0; h < kNumHorizons; h++) {
+        if (last + kHorizons[h] > run_end) {
+          break;
+        }
+        int64_t error = Predict(timestamps, last, last + kHorizons[h], period);
+        if (error < 0) {
+          horizon_stats[h].misses++;
+        } else {
+          horizon_stats[h].Add(error);
+        }
+      }
+    }
+
+    // The first hardware vsync after vsync is enabled again, predicted from before the gap.
+    if (run_end + 1 < timestamps.size() && run_end + 1 >= run_begin + kHistorySize) {
+      int64_t error = Predict(timestamps, run_end, run_end + 1, period);
+      if (error < 0) {
+        resync_stats.misses++;
+      } else {
+        resync_stats.Add(error);
+      }
+    }
+    run_begin = run_end + 1;
+  }
+
+  printf("%s: %zu timestamps, %zu runs, period %.1f us\n", name, timestamps.size(),
+         run_ends.size(), FLOAT(period) / 1000.0f);
+  uint32_t misses = resync_stats.misses;
+  for (uint32_t h = 0; h < kNumHorizons; h++) {
+    char name[32];
+    snprintf(name, sizeof(name), "%u vsync(s) ahead", kHorizons[h]);
+    Report(name, horizon_stats[h]);
+    misses += horizon_stats[h].misses;
+  }
+  Report("across disabled gaps", resync_stats);
+
+  return misses;
+}
+
+int main(int argc, char **argv) {
+  uint32_t misses = 0;
+
+  if (argc > 1) {
+    std::vector<int64_t> timestamps;
+    if (!ReadTimestamps(argv[1], &timestamps) || timestamps.size() < kHistorySize * 2) {
+      fprintf(stderr, "Failed to read vsync timestamps from %s\n", argv[1]);
+      return 1;
+    }
+    misses = Replay(argv[1], timestamps);
+  } else {
+    for (uint32_t seed = 1; seed <= kNumSeeds; seed++) {
+      std::vector<int64_t> timestamps;
+      char name[32];
+      GenerateTimestamps(seed, &timestamps);
+      snprintf(name, sizeof(name), "seed %u", seed);
+      misses += Replay(name, timestamps);
+    }
+  }
+
+  return misses ? 1 : 0;
+}
@@ -15,7 +15,7 @@ LOCAL_CLANG                   := true
 
 LOCAL_SHARED_LIBRARIES        := libsdmcore libqservice libbinder libhardware libhardware_legacy \
                                  libutils libcutils libsync libmemalloc libqdutils libdl \
-                                 libpowermanager libsdmutils libc++
+                                 libpowermanager libsdmutils libc++ libz
 
 LOCAL_SRC_FILES               := hwc_session.cpp \
                                  hwc_display.cpp \
@@ -26,6 +26,7 @@ LOCAL_SRC_FILES               := hwc_session.cpp \
                                  hwc_debugger.cpp \
                                  hwc_buffer_allocator.cpp \
                                  hwc_buffer_sync_handler.cpp \
+                                 hwc_frame_dumper.cpp \
                                  hwc_color_manager.cpp \
                                  blit_engine_c2d.cpp \
                                  cpuhint.cpp
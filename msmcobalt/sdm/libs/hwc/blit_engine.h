@@ -59,6 +59,7 @@ class BlitEngine {
   virtual void PostCommit(LayerStack *layer_stack) = 0;
   virtual bool BlitActive() = 0;
   virtual void SetFrameDumpConfig(uint32_t count) = 0;
+  virtual void GetDump(char *buffer, uint32_t length) = 0;
 };
 
 }  // namespace sdm
@@ -166,6 +166,11 @@ int BlitEngineC2d::AllocateBlitTargetBuffers(uint32_t width, uint32_t height, ui
 }
 
 void BlitEngineC2d::FreeBlitTargetBuffers() {
+  if (blit_engine_c2d_ && blit_target_buffer_[0]) {
+    // Copybit keeps the target buffers mapped across frames, drop them first
+    blit_engine_c2d_->set_parameter(blit_engine_c2d_, COPYBIT_PURGE_MAPPINGS, 0);
+  }
+
   for (uint32_t i = 0; i < kNumBlitTargetBuffers; i++) {
     private_handle_t **target_buffer = &blit_target_buffer_[i];
     if (*target_buffer) {
@@ -251,6 +256,12 @@ void BlitEngineC2d::SetFrameDumpConfig(uint32_t count) {
   dump_frame_index_ = 0;
 }
 
+void BlitEngineC2d::GetDump(char *buffer, uint32_t length) {
+  if (blit_engine_c2d_ && blit_engine_c2d_->dump && length) {
+    blit_engine_c2d_->dump(blit_engine_c2d_, buffer, INT(length));
+  }
+}
+
 int BlitEngineC2d::Prepare(LayerStack *layer_stack) {
   blit_target_start_index_ = 0;
 
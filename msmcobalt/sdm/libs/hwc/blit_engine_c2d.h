@@ -79,6 +79,7 @@ class BlitEngineC2d : public BlitEngine {
   virtual void PostCommit(LayerStack *layer_stack);
   virtual bool BlitActive();
   virtual void SetFrameDumpConfig(uint32_t count);
+  virtual void GetDump(char *buffer, uint32_t length);
 
 
  private:
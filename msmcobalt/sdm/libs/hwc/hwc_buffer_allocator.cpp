@@ -27,6 +27,11 @@
 * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <pthread.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
 #include <gralloc_priv.h>
 #include <memalloc.h>
 #include <gr.h>
@@ -42,6 +47,20 @@
 
 namespace sdm {
 
+Locker HWCBufferAllocator::pool_locker_;
+std::vector<HWCBufferAllocator::PooledBuffer> HWCBufferAllocator::pool_;
+uint32_t HWCBufferAllocator::pool_bytes_ = 0;
+uint64_t HWCBufferAllocator::pool_hits_ = 0;
+uint64_t HWCBufferAllocator::pool_misses_ = 0;
+uint64_t HWCBufferAllocator::pool_releases_ = 0;
+bool HWCBufferAllocator::trim_thread_started_ = false;
+
+static uint64_t GetTimeMs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return UINT64(ts.tv_sec) * 1000 + UINT64(ts.tv_nsec / 1000000);
+}
+
 HWCBufferAllocator::HWCBufferAllocator() {
   alloc_controller_ = gralloc::IAllocController::getInstance();
 }
@@ -89,17 +108,24 @@ DisplayError HWCBufferAllocator::AllocateBuffer(BufferInfo *buffer_info) {
 
   buffer_size = ROUND_UP(buffer_size, data.align) * buffer_config.buffer_count;
 
-  data.base = 0;
-  data.fd = -1;
-  data.offset = 0;
-  data.size = buffer_size;
-  data.uncached = !buffer_config.cache;
-
-  error = alloc_controller_->allocate(data, alloc_flags);
-  if (error != 0) {
-    DLOGE("Error allocating memory size %d uncached %d", data.size, data.uncached);
-    delete meta_buffer_info;
-    return kErrorMemory;
+  PooledBuffer pooled_buffer;
+  if (AcquirePooledBuffer(buffer_size, alloc_flags, &pooled_buffer)) {
+    data.fd = pooled_buffer.fd;
+    data.base = pooled_buffer.base_addr;
+    data.allocType = pooled_buffer.alloc_type;
+  } else {
+    data.base = 0;
+    data.fd = -1;
+    data.offset = 0;
+    data.size = buffer_size;
+    data.uncached = !buffer_config.cache;
+
+    error = alloc_controller_->allocate(data, alloc_flags);
+    if (error != 0) {
+      DLOGE("Error allocating memory size %d uncached %d", data.size, data.uncached);
+      delete meta_buffer_info;
+      return kErrorMemory;
+    }
   }
 
   alloc_buffer_info->fd = data.fd;
@@ -111,6 +137,7 @@ DisplayError HWCBufferAllocator::AllocateBuffer(BufferInfo *buffer_info) {
 
   meta_buffer_info->base_addr = data.base;
   meta_buffer_info->alloc_type = data.allocType;
+  meta_buffer_info->alloc_flags = alloc_flags;
 
   buffer_info->private_data = meta_buffer_info;
 
@@ -122,21 +149,39 @@ DisplayError HWCBufferAllocator::FreeBuffer(BufferInfo *buffer_info) {
 
   AllocatedBufferInfo *alloc_buffer_info = &buffer_info->alloc_buffer_info;
 
-  // Deallocate the buffer, only if the buffer fd is valid.
+  // Return the buffer to the pool, only if the buffer fd is valid.
   if (alloc_buffer_info->fd > 0) {
     MetaBufferInfo *meta_buffer_info = static_cast<MetaBufferInfo *> (buffer_info->private_data);
-    gralloc::IMemAlloc *memalloc = alloc_controller_->getAllocator(meta_buffer_info->alloc_type);
-    if (memalloc == NULL) {
-      DLOGE("Memalloc handle is NULL, alloc type %d", meta_buffer_info->alloc_type);
-      return kErrorResources;
-    }
 
-    ret = memalloc->free_buffer(meta_buffer_info->base_addr, alloc_buffer_info->size, 0,
-                                alloc_buffer_info->fd);
-    if (ret != 0) {
-      DLOGE("Error freeing buffer base_addr %p size %d fd %d", meta_buffer_info->base_addr,
-            alloc_buffer_info->size, alloc_buffer_info->fd);
-      return kErrorMemory;
+    PooledBuffer pooled_buffer;
+    pooled_buffer.fd = alloc_buffer_info->fd;
+    pooled_buffer.alloc_type = meta_buffer_info->alloc_type;
+    pooled_buffer.alloc_flags = meta_buffer_info->alloc_flags;
+    pooled_buffer.base_addr = meta_buffer_info->base_addr;
+    pooled_buffer.size = alloc_buffer_info->size;
+
+    if (pooled_buffer.size > kPoolMaxBytes) {
+      ret = ReleaseBuffer(pooled_buffer);
+      if (ret != 0) {
+        return kErrorMemory;
+      }
+    } else {
+      SCOPE_LOCK(pool_locker_);
+      pooled_buffer.free_time_ms = GetTimeMs();
+      pool_.push_back(pooled_buffer);
+      pool_bytes_ += pooled_buffer.size;
+      ReleasePooledBuffers(kPoolIdleTimeoutMs, kPoolMaxBytes);
+
+      if (!trim_thread_started_) {
+        pthread_t trim_thread;
+        if (pthread_create(&trim_thread, NULL, &TrimThread, NULL) != 0) {
+          // Idle buffers are still released by later allocations and frees.
+          DLOGW("Failed to start pool trim thread. Error = %d (%s)", errno, strerror(errno));
+        } else {
+          pthread_detach(trim_thread);
+          trim_thread_started_ = true;
+        }
+      }
     }
 
     alloc_buffer_info->fd = -1;
@@ -155,6 +200,97 @@ DisplayError HWCBufferAllocator::FreeBuffer(BufferInfo *buffer_info) {
   return kErrorNone;
 }
 
+DisplayError HWCBufferAllocator::PurgeBuffers() {
+  SCOPE_LOCK(pool_locker_);
+  ReleasePooledBuffers(0, 0);
+
+  return kErrorNone;
+}
+
+void HWCBufferAllocator::GetDump(char *buffer, uint32_t length) {
+  SCOPE_LOCK(pool_locker_);
+
+  snprintf(buffer, length, "\nbuffer pool: %zu buffers %u KB (max %u KB) hits %" PRIu64
+           " misses %" PRIu64 " released %" PRIu64 "\n", pool_.size(), pool_bytes_ / 1024,
+           kPoolMaxBytes / 1024, pool_hits_, pool_misses_, pool_releases_);
+}
+
+bool HWCBufferAllocator::AcquirePooledBuffer(uint32_t size, int alloc_flags,
+                                             PooledBuffer *buffer) {
+  SCOPE_LOCK(pool_locker_);
+
+  ReleasePooledBuffers(kPoolIdleTimeoutMs, kPoolMaxBytes);
+
+  // Prefer the most recently freed match, it is the most likely to still be cache hot.
+  for (auto it = pool_.rbegin(); it != pool_.rend(); it++) {
+    if (it->size == size && it->alloc_flags == alloc_flags) {
+      *buffer = *it;
+      pool_bytes_ -= it->size;
+      pool_.erase(std::next(it).base());
+      pool_hits_++;
+      return true;
+    }
+  }
+
+  pool_misses_++;
+
+  return false;
+}
+
+void HWCBufferAllocator::ReleasePooledBuffers(uint64_t idle_time_ms, uint32_t max_bytes) {
+  uint64_t current_time_ms = GetTimeMs();
+  size_t count = 0;
+
+  // Entries are ordered by free time, so both the idle and the size limits trim from the front.
+  while (count < pool_.size()) {
+    const PooledBuffer &buffer = pool_.at(count);
+    if ((current_time_ms - buffer.free_time_ms) < idle_time_ms && pool_bytes_ <= max_bytes) {
+      break;
+    }
+    ReleaseBuffer(buffer);
+    pool_bytes_ -= buffer.size;
+    pool_releases_++;
+    count++;
+  }
+
+  pool_.erase(pool_.begin(), pool_.begin() + INT(count));
+}
+
+void *HWCBufferAllocator::TrimThread(void *context) {
+  SCOPE_LOCK(pool_locker_);
+
+  // Exit once the pool drains so that no thread lingers while nothing is pooled; FreeBuffer()
+  // starts a new one when needed.
+  while (!pool_.empty()) {
+    uint64_t idle_time_ms = GetTimeMs() - pool_.front().free_time_ms;
+    if (idle_time_ms < kPoolIdleTimeoutMs) {
+      pool_locker_.WaitFinite(INT(kPoolIdleTimeoutMs - idle_time_ms));
+    } else {
+      ReleasePooledBuffers(kPoolIdleTimeoutMs, kPoolMaxBytes);
+    }
+  }
+  trim_thread_started_ = false;
+
+  return NULL;
+}
+
+int HWCBufferAllocator::ReleaseBuffer(const PooledBuffer &buffer) {
+  gralloc::IAllocController *alloc_controller = gralloc::IAllocController::getInstance();
+  gralloc::IMemAlloc *memalloc = alloc_controller->getAllocator(buffer.alloc_type);
+  if (memalloc == NULL) {
+    DLOGE("Memalloc handle is NULL, alloc type %d", buffer.alloc_type);
+    return -EINVAL;
+  }
+
+  int ret = memalloc->free_buffer(buffer.base_addr, buffer.size, 0, buffer.fd);
+  if (ret != 0) {
+    DLOGE("Error freeing buffer base_addr %p size %d fd %d", buffer.base_addr, buffer.size,
+          buffer.fd);
+  }
+
+  return ret;
+}
+
 uint32_t HWCBufferAllocator::GetBufferSize(BufferInfo *buffer_info) {
   uint32_t align = UINT32(getpagesize());
 
@@ -33,6 +33,8 @@
 
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <utils/locker.h>
+#include <vector>
 
 namespace gralloc {
 
@@ -49,16 +51,47 @@ class HWCBufferAllocator : public BufferAllocator {
   DisplayError AllocateBuffer(BufferInfo *buffer_info);
   DisplayError FreeBuffer(BufferInfo *buffer_info);
   uint32_t GetBufferSize(BufferInfo *buffer_info);
+  DisplayError PurgeBuffers();
+  void GetDump(char *buffer, uint32_t length);
 
  private:
+  // Freed buffers are kept in a pool shared by all allocator instances, so that a later request
+  // with the same size and allocation flags is served without an ION allocation. Buffers idle
+  // for longer than kPoolIdleTimeoutMs are released by a trim thread, which runs while the pool
+  // holds buffers. The oldest buffers are also released once the pool exceeds kPoolMaxBytes.
+  static const uint64_t kPoolIdleTimeoutMs = 10000;
+  static const uint32_t kPoolMaxBytes = 64 * 1024 * 1024;
+
   struct MetaBufferInfo {
     int alloc_type;              //!< Specifies allocation type set by the buffer allocator.
+    int alloc_flags;             //!< Specifies allocation flags used for the buffer.
     void *base_addr;             //!< Specifies the base address of the allocated output buffer.
   };
 
+  struct PooledBuffer {
+    int fd = -1;
+    int alloc_type = 0;
+    int alloc_flags = 0;
+    void *base_addr = NULL;
+    uint32_t size = 0;
+    uint64_t free_time_ms = 0;
+  };
+
   int SetBufferInfo(LayerBufferFormat format, int *target, int *flags);
+  bool AcquirePooledBuffer(uint32_t size, int alloc_flags, PooledBuffer *buffer);
+  static void ReleasePooledBuffers(uint64_t idle_time_ms, uint32_t max_bytes);
+  static int ReleaseBuffer(const PooledBuffer &buffer);
+  static void *TrimThread(void *context);
 
   gralloc::IAllocController *alloc_controller_;
+
+  static Locker pool_locker_;
+  static std::vector<PooledBuffer> pool_;   // Ordered by free time, oldest first.
+  static uint32_t pool_bytes_;
+  static uint64_t pool_hits_;
+  static uint64_t pool_misses_;
+  static uint64_t pool_releases_;
+  static bool trim_thread_started_;
 };
 
 }  // namespace sdm
@@ -33,6 +33,7 @@
 #include <gr.h>
 #include <utils/constants.h>
 #include <utils/formats.h>
+#include <utils/frame_timing.h>
 #include <utils/rect.h>
 #include <utils/debug.h>
 #include <sync/sync.h>
@@ -44,6 +45,7 @@
 #include "hwc_display.h"
 #include "hwc_debugger.h"
 #include "blit_engine_c2d.h"
+#include "hwc_frame_dumper.h"
 
 #ifdef QTI_BSP
 #include <hardware/display_defs.h>
@@ -111,6 +113,15 @@ int HWCDisplay::Init() {
 
   disable_animation_ = Debug::IsExtAnimDisabled();
 
+  int trace_frames = 0;
+  HWCDebugHandler::Get()->GetProperty("sdm.debug.layer_trace_frames", &trace_frames);
+  if (trace_frames > 0) {
+    char trace_path[PATH_MAX];
+    snprintf(trace_path, sizeof(trace_path), "/data/misc/display/layer_trace_%s.bin",
+             GetDisplayString());
+    layer_trace_.Init(trace_path, UINT32(trace_frames));
+  }
+
   return 0;
 }
 
@@ -127,6 +138,8 @@ int HWCDisplay::Deinit() {
     blit_engine_ = NULL;
   }
 
+  layer_trace_.Deinit();
+
   return 0;
 }
 
@@ -276,6 +289,12 @@ void HWCDisplay::SetFrameDumpConfig(uint32_t count, uint32_t bit_mask_layer_type
   DLOGI("num_frame_dump %d, input_layer_dump_enable %d", dump_frame_count_, dump_input_layers_);
 }
 
+void HWCDisplay::GetBlitEngineDump(char *buffer, uint32_t length) {
+  if (blit_engine_) {
+    blit_engine_->GetDump(buffer, length);
+  }
+}
+
 uint32_t HWCDisplay::GetLastPowerMode() {
   return last_power_mode_;
 }
@@ -441,6 +460,8 @@ int HWCDisplay::PrePrepareLayerStack(hwc_display_contents_1_t *content_list) {
     return 0;
   }
 
+  FRAME_TIMING_SCOPE(type_, kFrameTimingBuildLayerStack);
+  layer_trace_.MarkStage(kTraceStageBuild);
   size_t num_hw_layers = content_list->numHwLayers;
 
   use_blit_comp_ = false;
@@ -610,6 +631,7 @@ int HWCDisplay::PrepareLayerStack(hwc_display_contents_1_t *content_list) {
 
   if (!skip_prepare_) {
     DisplayError error = display_intf_->Prepare(&layer_stack_);
+    layer_trace_.MarkStage(kTraceStagePrepare, error);
     if (error != kErrorNone) {
       if (error == kErrorShutDown) {
         shutdown_pending_ = true;
@@ -675,6 +697,8 @@ int HWCDisplay::CommitLayerStack(hwc_display_contents_1_t *content_list) {
 
   size_t num_hw_layers = content_list->numHwLayers;
 
+  // Buffers dumped for the previous frame may be reused once this frame is committed.
+  HWCFrameDumper::Get()->WaitForCaptures();
   DumpInputBuffers(content_list);
 
   if (!flush_) {
@@ -695,6 +719,7 @@ int HWCDisplay::CommitLayerStack(hwc_display_contents_1_t *content_list) {
     DisplayError error = kErrorUndefined;
     if (status == 0) {
       error = display_intf_->Commit(&layer_stack_);
+      layer_trace_.MarkStage(kTraceStageCommit, error);
       status = 0;
     }
 
@@ -782,6 +807,7 @@ int HWCDisplay::PostCommitLayerStack(hwc_display_contents_1_t *content_list) {
     }
   }
 
+  layer_trace_.Write(layer_stack_);
   flush_ = false;
 
   return status;
@@ -908,96 +934,56 @@ LayerBufferFormat HWCDisplay::GetSDMFormat(const int32_t &source, const int flag
 
 void HWCDisplay::DumpInputBuffers(hwc_display_contents_1_t *content_list) {
   size_t num_hw_layers = content_list->numHwLayers;
-  char dir_path[PATH_MAX];
 
   if (!dump_frame_count_ || flush_ || !dump_input_layers_) {
     return;
   }
 
-  snprintf(dir_path, sizeof(dir_path), "/data/misc/display/frame_dump_%s", GetDisplayString());
-
-  if (mkdir(dir_path, 0777) != 0 && errno != EEXIST) {
-    DLOGW("Failed to create %s directory errno = %d, desc = %s", dir_path, errno, strerror(errno));
-    return;
-  }
-
-  // if directory exists already, need to explicitly change the permission.
-  if (errno == EEXIST && chmod(dir_path, 0777) != 0) {
-    DLOGW("Failed to change permissions on %s directory", dir_path);
-    return;
-  }
-
   for (uint32_t i = 0; i < num_hw_layers; i++) {
     hwc_layer_1_t &hwc_layer = content_list->hwLayers[i];
     const private_handle_t *pvt_handle = static_cast<const private_handle_t *>(hwc_layer.handle);
 
-    if (hwc_layer.acquireFenceFd >= 0) {
-      int error = sync_wait(hwc_layer.acquireFenceFd, 1000);
-      if (error < 0) {
-        DLOGW("sync_wait error errno = %d, desc = %s", errno, strerror(errno));
-        return;
-      }
+    if (!pvt_handle || (pvt_handle->flags & private_handle_t::PRIV_FLAGS_SECURE_BUFFER)) {
+      continue;
     }
 
-    if (pvt_handle && pvt_handle->base) {
-      char dump_file_name[PATH_MAX];
-      size_t result = 0;
-
-      snprintf(dump_file_name, sizeof(dump_file_name), "%s/input_layer%d_%dx%d_%s_frame%d.raw",
-               dir_path, i, pvt_handle->width, pvt_handle->height,
-               GetHALPixelFormatString(pvt_handle->format), dump_frame_index_);
-
-      FILE* fp = fopen(dump_file_name, "w+");
-      if (fp) {
-        result = fwrite(reinterpret_cast<void *>(pvt_handle->base), pvt_handle->size, 1, fp);
-        fclose(fp);
-      }
-
-      DLOGI("Frame Dump %s: is %s", dump_file_name, result ? "Successful" : "Failed");
+    char name[32];
+    snprintf(name, sizeof(name), "input_layer%d", i);
+
+    HWCFrameDumpInfo info;
+    info.display = GetDisplayString();
+    info.name = name;
+    info.frame_index = dump_frame_index_;
+    info.format = GetHALPixelFormatString(pvt_handle->format);
+    info.width = UINT32(pvt_handle->width);
+    info.height = UINT32(pvt_handle->height);
+    info.unaligned_width = UINT32(pvt_handle->unaligned_width);
+    info.unaligned_height = UINT32(pvt_handle->unaligned_height);
+    if (i < layer_stack_.layers.size()) {
+      Layer *layer = layer_stack_.layers.at(i);
+      info.composition = HWCFrameDumper::GetCompositionString(layer->composition);
+      info.src_rect = layer->src_rect;
+      info.dst_rect = layer->dst_rect;
     }
-  }
-}
-
-void HWCDisplay::DumpOutputBuffer(const BufferInfo& buffer_info, void *base, int fence) {
-  char dir_path[PATH_MAX];
-
-  snprintf(dir_path, sizeof(dir_path), "/data/misc/display/frame_dump_%s", GetDisplayString());
-
-  if (mkdir(dir_path, 777) != 0 && errno != EEXIST) {
-    DLOGW("Failed to create %s directory errno = %d, desc = %s", dir_path, errno, strerror(errno));
-    return;
-  }
 
-  // if directory exists already, need to explicitly change the permission.
-  if (errno == EEXIST && chmod(dir_path, 0777) != 0) {
-    DLOGW("Failed to change permissions on %s directory", dir_path);
-    return;
+    HWCFrameDumper::Get()->Enqueue(info, pvt_handle->fd, pvt_handle->offset, pvt_handle->size,
+                                   hwc_layer.acquireFenceFd);
   }
+}
 
-  if (base) {
-    char dump_file_name[PATH_MAX];
-    size_t result = 0;
-
-    if (fence >= 0) {
-      int error = sync_wait(fence, 1000);
-      if (error < 0) {
-        DLOGW("sync_wait error errno = %d, desc = %s", errno,  strerror(errno));
-        return;
-      }
-    }
-
-    snprintf(dump_file_name, sizeof(dump_file_name), "%s/output_layer_%dx%d_%s_frame%d.raw",
-             dir_path, buffer_info.buffer_config.width, buffer_info.buffer_config.height,
-             GetFormatString(buffer_info.buffer_config.format), dump_frame_index_);
-
-    FILE* fp = fopen(dump_file_name, "w+");
-    if (fp) {
-      result = fwrite(base, buffer_info.alloc_buffer_info.size, 1, fp);
-      fclose(fp);
-    }
+void HWCDisplay::DumpOutputBuffer(const BufferInfo& buffer_info, int fence) {
+  HWCFrameDumpInfo info;
+  info.display = GetDisplayString();
+  info.name = "output_layer";
+  info.frame_index = dump_frame_index_;
+  info.format = GetFormatString(buffer_info.buffer_config.format);
+  info.width = buffer_info.alloc_buffer_info.aligned_width;
+  info.height = buffer_info.alloc_buffer_info.aligned_height;
+  info.unaligned_width = buffer_info.buffer_config.width;
+  info.unaligned_height = buffer_info.buffer_config.height;
 
-    DLOGI("Frame Dump of %s is %s", dump_file_name, result ? "Successful" : "Failed");
-  }
+  HWCFrameDumper::Get()->Enqueue(info, buffer_info.alloc_buffer_info.fd, 0,
+                                 buffer_info.alloc_buffer_info.size, fence);
 }
 
 const char *HWCDisplay::GetHALPixelFormatString(int format) {
@@ -30,6 +30,7 @@
 #include <qdMetaData.h>
 #include <QService.h>
 #include <private/color_params.h>
+#include <utils/layer_trace.h>
 #include <map>
 #include <vector>
 
@@ -74,6 +75,7 @@ class HWCDisplay : public DisplayEventHandler {
 
   virtual void SetIdleTimeoutMs(uint32_t timeout_ms);
   virtual void SetFrameDumpConfig(uint32_t count, uint32_t bit_mask_layer_type);
+  virtual void GetBlitEngineDump(char *buffer, uint32_t length);
   virtual DisplayError SetMaxMixerStages(uint32_t max_mixer_stages);
   virtual DisplayError ControlPartialUpdate(bool enable, uint32_t *pending) {
     return kErrorNotSupported;
@@ -151,7 +153,7 @@ class HWCDisplay : public DisplayEventHandler {
   virtual int PrepareLayerStack(hwc_display_contents_1_t *content_list);
   virtual int CommitLayerStack(hwc_display_contents_1_t *content_list);
   virtual int PostCommitLayerStack(hwc_display_contents_1_t *content_list);
-  virtual void DumpOutputBuffer(const BufferInfo& buffer_info, void *base, int fence);
+  virtual void DumpOutputBuffer(const BufferInfo& buffer_info, int fence);
   virtual uint32_t RoundToStandardFPS(float fps);
   virtual uint32_t SanitizeRefreshRate(uint32_t req_refresh_rate);
   virtual void PrepareDynamicRefreshRate(Layer *layer);
@@ -216,6 +218,7 @@ class HWCDisplay : public DisplayEventHandler {
   LayerRect display_rect_;
   std::map<int, LayerBufferS3DFormat> s3d_format_hwc_to_sdm_;
   bool animating_ = false;
+  LayerTraceWriter layer_trace_;
 
  private:
   void DumpInputBuffers(hwc_display_contents_1_t *content_list);
@@ -388,14 +388,9 @@ void HWCDisplayPrimary::HandleFrameCapture() {
 
 void HWCDisplayPrimary::HandleFrameDump() {
   if (dump_frame_count_ && output_buffer_.release_fence_fd >= 0) {
-    int ret = sync_wait(output_buffer_.release_fence_fd, 1000);
+    DumpOutputBuffer(output_buffer_info_, output_buffer_.release_fence_fd);
     ::close(output_buffer_.release_fence_fd);
     output_buffer_.release_fence_fd = -1;
-    if (ret < 0) {
-      DLOGE("sync_wait error errno = %d, desc = %s", errno,  strerror(errno));
-    } else {
-      DumpOutputBuffer(output_buffer_info_, output_buffer_base_, layer_stack_.retire_fence_fd);
-    }
   }
 
   if (0 == dump_frame_count_) {
@@ -182,12 +182,14 @@ int HWCDisplayVirtual::Commit(hwc_display_contents_1_t *content_list) {
     const private_handle_t *output_handle = (const private_handle_t *)(content_list->outbuf);
     if (output_handle && output_handle->base) {
       BufferInfo buffer_info;
-      buffer_info.buffer_config.width = static_cast<uint32_t>(output_handle->width);
-      buffer_info.buffer_config.height = static_cast<uint32_t>(output_handle->height);
+      buffer_info.buffer_config.width = static_cast<uint32_t>(output_handle->unaligned_width);
+      buffer_info.buffer_config.height = static_cast<uint32_t>(output_handle->unaligned_height);
       buffer_info.buffer_config.format = GetSDMFormat(output_handle->format, output_handle->flags);
+      buffer_info.alloc_buffer_info.fd = output_handle->fd;
+      buffer_info.alloc_buffer_info.aligned_width = static_cast<uint32_t>(output_handle->width);
+      buffer_info.alloc_buffer_info.aligned_height = static_cast<uint32_t>(output_handle->height);
       buffer_info.alloc_buffer_info.size = static_cast<uint32_t>(output_handle->size);
-      DumpOutputBuffer(buffer_info, reinterpret_cast<void *>(output_handle->base),
-                       layer_stack_.retire_fence_fd);
+      DumpOutputBuffer(buffer_info, layer_stack_.retire_fence_fd);
     }
   }
 
@@ -0,0 +1,345 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*  * Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*  * Redistributions in binary form must reproduce the above
+*    copyright notice, this list of conditions and the following
+*    disclaimer in the documentation and/or other materials provided
+*    with the distribution.
+*  * Neither the name of The Linux Foundation nor the names of its
+*    contributors may be used to endorse or promote products derived
+*    from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+* IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sync/sync.h>
+#include <zlib.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hwc_frame_dumper.h"
+#include "hwc_debugger.h"
+
+#define __CLASS__ "HWCFrameDumper"
+
+namespace sdm {
+
+HWCFrameDumper HWCFrameDumper::frame_dumper_;
+
+bool HWCFrameDumper::Enqueue(const HWCFrameDumpInfo &info, int buffer_fd, uint32_t offset,
+                             uint32_t size, int fence_fd) {
+  if (buffer_fd < 0 || !size) {
+    return false;
+  }
+
+  SCOPE_LOCK(locker_);
+
+  if ((capture_queue_.size() + write_queue_.size()) >= kMaxPendingDumps ||
+      (staging_bytes_ + size) > kMaxStagingBytes) {
+    dropped_count_++;
+    DLOGW("Dump queue full, dropped %s of frame %d", info.name, info.frame_index);
+    return false;
+  }
+
+  if (!capture_thread_started_) {
+    if (pthread_create(&capture_thread_, NULL, &CaptureThread, this) != 0) {
+      DLOGE("Failed to start frame capture thread. Error = %d (%s)", errno, strerror(errno));
+      return false;
+    }
+    pthread_detach(capture_thread_);
+    capture_thread_started_ = true;
+  }
+
+  DumpRequest request;
+  request.buffer_fd = dup(buffer_fd);
+  if (request.buffer_fd < 0) {
+    DLOGW("Failed to dup buffer fd %d. Error = %d (%s)", buffer_fd, errno, strerror(errno));
+    return false;
+  }
+  request.fence_fd = (fence_fd >= 0) ? dup(fence_fd) : -1;
+  request.offset = offset;
+  request.size = size;
+  request.dir_path = std::string("/data/misc/display/frame_dump_") + info.display;
+
+  char file_name[PATH_MAX];
+  snprintf(file_name, sizeof(file_name), "%s_%dx%d_%s_frame%d", info.name, info.width,
+           info.height, info.format, info.frame_index);
+  request.file_name = file_name;
+  request.info = GetInfoString(info, size);
+
+  capture_queue_.push_back(std::move(request));
+  staging_bytes_ += size;
+  queued_count_++;
+
+  return true;
+}
+
+void HWCFrameDumper::WaitForCaptures() {
+  SCOPE_LOCK(locker_);
+
+  while (!capture_queue_.empty() || capturing_) {
+    locker_.Wait();
+  }
+}
+
+void HWCFrameDumper::GetDump(char *buffer, uint32_t length) {
+  SCOPE_LOCK(locker_);
+
+  snprintf(buffer, length, "\nframe dump: queued %" PRIu64 " pending %zu written %" PRIu64
+           " failed %" PRIu64 " dropped %" PRIu64 " staging %u KB raw %" PRIu64 " KB compressed %"
+           PRIu64 " KB\n", queued_count_, capture_queue_.size() + write_queue_.size(),
+           written_count_, failed_count_, dropped_count_, staging_bytes_ / 1024, raw_bytes_ / 1024,
+           compressed_bytes_ / 1024);
+}
+
+const char *HWCFrameDumper::GetCompositionString(LayerComposition composition) {
+  switch (composition) {
+  case kCompositionGPU:         return "GPU";
+  case kCompositionGPUS3D:      return "GPU_S3D";
+  case kCompositionSDE:         return "SDE";
+  case kCompositionHWCursor:    return "CURSOR";
+  case kCompositionHybrid:      return "HYBRID";
+  case kCompositionBlit:        return "BLIT";
+  case kCompositionGPUTarget:   return "GPU_TARGET";
+  case kCompositionBlitTarget:  return "BLIT_TARGET";
+  default:                      return "UNKNOWN";
+  }
+}
+
+std::string HWCFrameDumper::GetInfoString(const HWCFrameDumpInfo &info, uint32_t size) {
+  char json[1024];
+  int filled = snprintf(json, sizeof(json),
+                        "{\n  \"display\": \"%s\",\n  \"name\": \"%s\",\n  \"frame\": %d,\n"
+                        "  \"format\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n"
+                        "  \"stride\": %d,\n  \"aligned_height\": %d,\n  \"size\": %d,\n"
+                        "  \"compression\": \"gzip\"", info.display, info.name, info.frame_index,
+                        info.format, info.unaligned_width, info.unaligned_height, info.width,
+                        info.height, size);
+
+  if (info.composition && filled > 0 && UINT32(filled) < sizeof(json)) {
+    const LayerRect &src = info.src_rect;
+    const LayerRect &dst = info.dst_rect;
+    filled += snprintf(json + filled, sizeof(json) - UINT32(filled),
+                       ",\n  \"composition\": \"%s\",\n"
+                       "  \"src_rect\": [%.1f, %.1f, %.1f, %.1f],\n"
+                       "  \"dst_rect\": [%.1f, %.1f, %.1f, %.1f]", info.composition,
+                       src.left, src.top, src.right, src.bottom,
+                       dst.left, dst.top, dst.right, dst.bottom);
+  }
+
+  return std::string(json) + "\n}\n";
+}
+
+void *HWCFrameDumper::CaptureThread(void *context) {
+  reinterpret_cast<HWCFrameDumper *>(context)->CaptureThreadLoop();
+  return NULL;
+}
+
+void *HWCFrameDumper::WriteThread(void *context) {
+  reinterpret_cast<HWCFrameDumper *>(context)->WriteThreadLoop();
+  return NULL;
+}
+
+void HWCFrameDumper::CaptureThreadLoop() {
+  while (true) {
+    DumpRequest request;
+    {
+      SCOPE_LOCK(locker_);
+      // Exit once the queue drains so that no thread lingers after the dump session; Enqueue()
+      // starts a new one when needed.
+      if (capture_queue_.empty()) {
+        capture_thread_started_ = false;
+        return;
+      }
+      request = std::move(capture_queue_.front());
+      capture_queue_.pop_front();
+      capturing_ = true;
+
+      // Reuse a staging buffer of an earlier dump, buffers of a session mostly share a size.
+      for (auto it = free_staging_.begin(); it != free_staging_.end(); it++) {
+        if (it->capacity() >= request.size) {
+          request.staging = std::move(*it);
+          free_staging_.erase(it);
+          break;
+        }
+      }
+    }
+
+    bool success = CaptureBuffer(&request);
+
+    ::close(request.buffer_fd);
+    request.buffer_fd = -1;
+    if (request.fence_fd >= 0) {
+      ::close(request.fence_fd);
+      request.fence_fd = -1;
+    }
+
+    SCOPE_LOCK(locker_);
+    capturing_ = false;
+    locker_.Broadcast();
+
+    if (!success) {
+      failed_count_++;
+      ReleaseStaging(&request);
+      continue;
+    }
+
+    write_queue_.push_back(std::move(request));
+    if (!write_thread_started_) {
+      if (pthread_create(&write_thread_, NULL, &WriteThread, this) != 0) {
+        DLOGE("Failed to start frame write thread. Error = %d (%s)", errno, strerror(errno));
+        failed_count_++;
+        ReleaseStaging(&write_queue_.back());
+        write_queue_.pop_back();
+        continue;
+      }
+      pthread_detach(write_thread_);
+      write_thread_started_ = true;
+    }
+  }
+}
+
+void HWCFrameDumper::WriteThreadLoop() {
+  while (true) {
+    DumpRequest request;
+    {
+      SCOPE_LOCK(locker_);
+      if (write_queue_.empty()) {
+        write_thread_started_ = false;
+        // Staging is only kept for reuse while a dump session is in progress.
+        if (capture_queue_.empty() && !capturing_) {
+          std::vector<std::vector<uint8_t>>().swap(free_staging_);
+        }
+        return;
+      }
+      request = std::move(write_queue_.front());
+      write_queue_.pop_front();
+    }
+
+    bool success = WriteDump(request);
+
+    SCOPE_LOCK(locker_);
+    if (success) {
+      written_count_++;
+      raw_bytes_ += request.size;
+    } else {
+      failed_count_++;
+    }
+    ReleaseStaging(&request);
+  }
+}
+
+// Must be called under locker_.
+void HWCFrameDumper::ReleaseStaging(DumpRequest *request) {
+  uint64_t free_bytes = 0;
+
+  staging_bytes_ -= request->size;
+  for (auto &staging : free_staging_) {
+    free_bytes += staging.capacity();
+  }
+
+  if (request->staging.capacity() &&
+      (staging_bytes_ + free_bytes + request->staging.capacity()) <= kMaxStagingBytes) {
+    free_staging_.push_back(std::move(request->staging));
+  }
+}
+
+bool HWCFrameDumper::CaptureBuffer(DumpRequest *request) {
+  if (request->fence_fd >= 0 && sync_wait(request->fence_fd, kFenceTimeoutMs) < 0) {
+    DLOGW("sync_wait error errno = %d, desc = %s", errno, strerror(errno));
+    return false;
+  }
+
+  size_t map_size = size_t(request->offset) + request->size;
+  void *base = mmap(NULL, map_size, PROT_READ, MAP_SHARED, request->buffer_fd, 0);
+  if (base == MAP_FAILED) {
+    DLOGW("mmap failed for %s. Error = %d (%s)", request->file_name.c_str(), errno,
+          strerror(errno));
+    return false;
+  }
+
+  request->staging.resize(request->size);
+  memcpy(request->staging.data(), reinterpret_cast<uint8_t *>(base) + request->offset,
+         request->size);
+
+  munmap(base, map_size);
+
+  return true;
+}
+
+bool HWCFrameDumper::WriteDump(const DumpRequest &request) {
+  const char *dir_path = request.dir_path.c_str();
+
+  if (mkdir(dir_path, 0777) != 0 && errno != EEXIST) {
+    DLOGW("Failed to create %s directory errno = %d, desc = %s", dir_path, errno, strerror(errno));
+    return false;
+  }
+
+  // if directory exists already, need to explicitly change the permission.
+  if (errno == EEXIST && chmod(dir_path, 0777) != 0) {
+    DLOGW("Failed to change permissions on %s directory", dir_path);
+    return false;
+  }
+
+  std::string path = request.dir_path + "/" + request.file_name;
+  std::string raw_path = path + ".raw.gz";
+  int result = 0;
+
+  // Level 1 keeps the worker close to raw write speed while still shrinking the mostly flat
+  // UI content that dominates these dumps several times over.
+  gzFile gz_file = gzopen(raw_path.c_str(), "wb1");
+  if (gz_file) {
+    result = gzwrite(gz_file, request.staging.data(), request.size);
+    if (gzclose(gz_file) != Z_OK) {
+      result = 0;
+    }
+  }
+
+  if (result != INT(request.size)) {
+    DLOGW("Frame Dump of %s failed", raw_path.c_str());
+    return false;
+  }
+
+  FILE *fp = fopen((path + ".json").c_str(), "w+");
+  if (fp) {
+    fputs(request.info.c_str(), fp);
+    fclose(fp);
+  }
+
+  struct stat file_stat;
+  if (stat(raw_path.c_str(), &file_stat) == 0) {
+    SCOPE_LOCK(locker_);
+    compressed_bytes_ += UINT64(file_stat.st_size);
+  }
+
+  DLOGI("Frame Dump of %s is Successful", raw_path.c_str());
+
+  return true;
+}
+
+}  // namespace sdm
@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are
+* met:
+*  * Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*  * Redistributions in binary form must reproduce the above
+*    copyright notice, this list of conditions and the following
+*    disclaimer in the documentation and/or other materials provided
+*    with the distribution.
+*  * Neither the name of The Linux Foundation nor the names of its
+*    contributors may be used to endorse or promote products derived
+*    from this software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+* ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+* BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+* OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+* IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __HWC_FRAME_DUMPER_H__
+#define __HWC_FRAME_DUMPER_H__
+
+#include <core/layer_stack.h>
+#include <utils/locker.h>
+#include <pthread.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace sdm {
+
+// Describes one buffer of a dumped frame. Written next to the compressed buffer contents as a
+// JSON sidecar so that the raw data can be interpreted offline.
+struct HWCFrameDumpInfo {
+  const char *display = "";         // Display name, e.g. "primary".
+  const char *name = "";            // Buffer name within the frame, e.g. "input_layer0".
+  uint32_t frame_index = 0;
+  const char *format = "";
+  uint32_t width = 0;               // Aligned width, i.e. the stride in pixels.
+  uint32_t height = 0;              // Aligned height.
+  uint32_t unaligned_width = 0;
+  uint32_t unaligned_height = 0;
+  const char *composition = NULL;   // Composition type, NULL for output buffers.
+  LayerRect src_rect;
+  LayerRect dst_rect;
+};
+
+// Writes frame dumps from background threads. The composition thread only duplicates the buffer
+// and fence fds and queues them. A capture thread waits on the fence and copies the buffer into a
+// bounded staging pool, and a write thread compresses the copy with gzip and writes it. Buffers
+// are returned to their producer or rewritten once the next frame is committed, so displays call
+// WaitForCaptures() before committing to keep each dump consistent with its frame index. When
+// the queue or the staging pool is full the dump is dropped and counted instead of stalling
+// composition.
+class HWCFrameDumper {
+ public:
+  static HWCFrameDumper *Get() { return &frame_dumper_; }
+
+  // Returns false if the buffer was dropped. buffer_fd and fence_fd stay owned by the caller.
+  bool Enqueue(const HWCFrameDumpInfo &info, int buffer_fd, uint32_t offset, uint32_t size,
+               int fence_fd);
+  // Blocks until every queued buffer has been copied to staging. Returns at once when no dump
+  // is in progress.
+  void WaitForCaptures();
+  void GetDump(char *buffer, uint32_t length);
+
+  static const char *GetCompositionString(LayerComposition composition);
+
+ private:
+  static const uint32_t kMaxPendingDumps = 16;
+  static const uint32_t kMaxStagingBytes = 128 * 1024 * 1024;
+  static const int kFenceTimeoutMs = 1000;
+
+  struct DumpRequest {
+    std::string dir_path;
+    std::string file_name;     // Without extension.
+    std::string info;          // JSON sidecar contents.
+    int buffer_fd = -1;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    int fence_fd = -1;
+    std::vector<uint8_t> staging;  // Buffer contents, filled in by the capture thread.
+  };
+
+  static void *CaptureThread(void *context);
+  static void *WriteThread(void *context);
+  static std::string GetInfoString(const HWCFrameDumpInfo &info, uint32_t size);
+  void CaptureThreadLoop();
+  void WriteThreadLoop();
+  bool CaptureBuffer(DumpRequest *request);
+  bool WriteDump(const DumpRequest &request);
+  void ReleaseStaging(DumpRequest *request);
+
+  static HWCFrameDumper frame_dumper_;
+  Locker locker_;
+  pthread_t capture_thread_;
+  pthread_t write_thread_;
+  bool capture_thread_started_ = false;
+  bool write_thread_started_ = false;
+  std::deque<DumpRequest> capture_queue_;  // Waiting to be copied to staging.
+  std::deque<DumpRequest> write_queue_;    // Copied, waiting to be written.
+  bool capturing_ = false;                 // A request is being copied to staging.
+  uint32_t staging_bytes_ = 0;             // Staging reserved by queued requests.
+  std::vector<std::vector<uint8_t>> free_staging_;  // Staging buffers kept for reuse.
+  uint64_t queued_count_ = 0;
+  uint64_t written_count_ = 0;
+  uint64_t failed_count_ = 0;
+  uint64_t dropped_count_ = 0;
+  uint64_t raw_bytes_ = 0;
+  uint64_t compressed_bytes_ = 0;
+};
+
+}  // namespace sdm
+
+#endif  // __HWC_FRAME_DUMPER_H__
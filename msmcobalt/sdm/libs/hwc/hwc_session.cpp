@@ -42,6 +42,7 @@
 #include <gralloc_priv.h>
 #include <display_config.h>
 #include <utils/debug.h>
+#include <utils/frame_timing.h>
 #include <sync/sync.h>
 #include <profiler.h>
 #include <bitset>
@@ -50,6 +51,7 @@
 #include "hwc_buffer_sync_handler.h"
 #include "hwc_session.h"
 #include "hwc_debugger.h"
+#include "hwc_frame_dumper.h"
 #include "hwc_display_null.h"
 #include "hwc_display_primary.h"
 #include "hwc_display_virtual.h"
@@ -477,6 +479,11 @@ int HWCSession::SetPowerMode(hwc_composer_device_1 *device, int disp, int mode)
     status = hwc_session->hwc_display_[disp]->SetPowerMode(mode);
   }
 
+  // Buffers retained for reuse are not needed while the primary display is off.
+  if (!status && disp == HWC_DISPLAY_PRIMARY && mode == HWC_POWER_MODE_OFF) {
+    hwc_session->buffer_allocator_.PurgeBuffers();
+  }
+
   return status;
 }
 
@@ -519,7 +526,31 @@ void HWCSession::Dump(hwc_composer_device_1 *device, char *buffer, int length) {
     return;
   }
 
+  HWCSession *hwc_session = static_cast<HWCSession *>(device);
   DumpInterface::GetDump(buffer, UINT32(length));
+
+  size_t filled = strlen(buffer);
+  if (filled < UINT32(length)) {
+    FrameTiming::GetDump(buffer + filled, UINT32(length) - UINT32(filled));
+  }
+
+  filled = strlen(buffer);
+  if (filled < UINT32(length)) {
+    HWCFrameDumper::Get()->GetDump(buffer + filled, UINT32(length) - UINT32(filled));
+  }
+
+  filled = strlen(buffer);
+  if (filled < UINT32(length)) {
+    hwc_session->buffer_allocator_.GetDump(buffer + filled, UINT32(length) - UINT32(filled));
+  }
+
+  for (uint32_t i = 0; i < HWC_NUM_DISPLAY_TYPES; i++) {
+    filled = strlen(buffer);
+    HWCDisplay *hwc_display = hwc_session->hwc_display_[i];
+    if (hwc_display && filled < UINT32(length)) {
+      hwc_display->GetBlitEngineDump(buffer + filled, UINT32(length) - UINT32(filled));
+    }
+  }
 }
 
 int HWCSession::GetDisplayConfigs(hwc_composer_device_1 *device, int disp, uint32_t *configs,
@@ -765,6 +796,10 @@ android::status_t HWCSession::notifyCallback(uint32_t command, const android::Pa
     status = GetBWTransactionStatus(input_parcel, output_parcel);
     break;
 
+  case qService::IQService::GET_FRAME_TIMING:
+    status = GetFrameTiming(input_parcel, output_parcel);
+    break;
+
   case qService::IQService::SET_LAYER_MIXER_RESOLUTION:
     status = SetMixerResolution(input_parcel);
     break;
@@ -1127,6 +1162,19 @@ android::status_t HWCSession::GetBWTransactionStatus(const android::Parcel *inpu
   return 0;
 }
 
+android::status_t HWCSession::GetFrameTiming(const android::Parcel *input_parcel,
+                                             android::Parcel *output_parcel) {
+  char timing_dump[4096];
+  FrameTiming::GetDump(timing_dump, sizeof(timing_dump));
+  output_parcel->writeCString(timing_dump);
+
+  if (input_parcel->readInt32() == 1) {
+    FrameTiming::Reset();
+  }
+
+  return 0;
+}
+
 void HWCSession::SetFrameDumpConfig(const android::Parcel *input_parcel) {
   uint32_t frame_dump_count = UINT32(input_parcel->readInt32());
   std::bitset<32> bit_mask_display_type = UINT32(input_parcel->readInt32());
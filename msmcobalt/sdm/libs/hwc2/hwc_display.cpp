@@ -26,6 +26,7 @@
 #include <utils/constants.h>
 #include <utils/debug.h>
 #include <utils/formats.h>
+#include <utils/frame_timing.h>
 #include <utils/rect.h>
 
 #include <algorithm>
@@ -38,6 +39,7 @@
 #include "hwc_display.h"
 #include "hwc_debugger.h"
 #include "blit_engine_c2d.h"
+#include "hwc_frame_dumper.h"
 
 #ifdef QTI_BSP
 #include <hardware/display_defs.h>
@@ -237,6 +239,12 @@ int HWCDisplay::Init() {
 
 
   client_target_ = new HWCLayer(id_);
+  // Size per frame layer storage upfront, so that frames within the limit do not allocate.
+  layer_set_.reserve(kMaxLayerCount);
+  layer_changes_.reserve(kMaxLayerCount);
+  layer_requests_.reserve(kMaxLayerCount);
+  layer_stack_.layers.reserve(kMaxLayerCount + 1);
+
   int blit_enabled = 0;
   HWCDebugHandler::Get()->GetProperty("persist.hwc.blit.comp", &blit_enabled);
   if (needs_blit_ && blit_enabled) {
@@ -252,6 +260,15 @@ int HWCDisplay::Init() {
     }
   }
 
+  int trace_frames = 0;
+  HWCDebugHandler::Get()->GetProperty("sdm.debug.layer_trace_frames", &trace_frames);
+  if (trace_frames > 0) {
+    char trace_path[PATH_MAX];
+    snprintf(trace_path, sizeof(trace_path), "/data/misc/display/layer_trace_%s.bin",
+             GetDisplayString());
+    layer_trace_.Init(trace_path, UINT32(trace_frames));
+  }
+
   display_intf_->GetRefreshRateRange(&min_refresh_rate_, &max_refresh_rate_);
   current_refresh_rate_ = max_refresh_rate_;
   DLOGI("Display created with id: %d", id_);
@@ -278,12 +295,16 @@ int HWCDisplay::Deinit() {
     delete color_mode_;
   }
 
+  layer_trace_.Deinit();
+
   return 0;
 }
 
 // LayerStack operations
 HWC2::Error HWCDisplay::CreateLayer(hwc2_layer_t *out_layer_id) {
-  HWCLayer *layer = *layer_set_.emplace(new HWCLayer(id_));
+  HWCLayer *layer = new HWCLayer(id_);
+  layer_set_.insert(std::upper_bound(layer_set_.begin(), layer_set_.end(), layer,
+                                     SortLayersByZ()), layer);
   layer_map_.emplace(std::make_pair(layer->GetId(), layer));
   *out_layer_id = layer->GetId();
   geometry_changes_ |= GeometryChanges::kAdded;
@@ -308,13 +329,10 @@ HWC2::Error HWCDisplay::DestroyLayer(hwc2_layer_t layer_id) {
   }
   const auto layer = map_layer->second;
   layer_map_.erase(map_layer);
-  const auto z_range = layer_set_.equal_range(layer);
-  for (auto current = z_range.first; current != z_range.second; ++current) {
-    if (*current == layer) {
-      current = layer_set_.erase(current);
-      delete layer;
-      break;
-    }
+  const auto current = std::find(layer_set_.begin(), layer_set_.end(), layer);
+  if (current != layer_set_.end()) {
+    layer_set_.erase(current);
+    delete layer;
   }
 
   geometry_changes_ |= GeometryChanges::kRemoved;
@@ -322,7 +340,10 @@ HWC2::Error HWCDisplay::DestroyLayer(hwc2_layer_t layer_id) {
 }
 
 void HWCDisplay::BuildLayerStack() {
-  layer_stack_ = LayerStack();
+  FRAME_TIMING_SCOPE(type_, kFrameTimingBuildLayerStack);
+  layer_trace_.MarkStage(kTraceStageBuild);
+  size_t layers_capacity = layer_stack_.layers.capacity();
+  ResetLayerStack();
   display_rect_ = LayerRect();
   metadata_refresh_rate_ = 0;
 
@@ -413,10 +434,22 @@ void HWCDisplay::BuildLayerStack() {
   layer_stack_.flags.geometry_changed = UINT32(geometry_changes_ > 0);
   // Append client target to the layer stack
   layer_stack_.layers.push_back(client_target_->GetSDMLayer());
+
+  if (layer_stack_.layers.capacity() != layers_capacity) {
+    layer_storage_growths_++;
+  }
+}
+
+void HWCDisplay::ResetLayerStack() {
+  // Clear the layer stack in place, so that the layer vector keeps its storage.
+  layer_stack_.layers.clear();
+  layer_stack_.retire_fence_fd = -1;
+  layer_stack_.output_buffer = NULL;
+  layer_stack_.flags = LayerStackFlags();
 }
 
 void HWCDisplay::BuildSolidFillStack() {
-  layer_stack_ = LayerStack();
+  ResetLayerStack();
   display_rect_ = LayerRect();
 
   layer_stack_.layers.push_back(solid_fill_layer_);
@@ -433,27 +466,21 @@ HWC2::Error HWCDisplay::SetLayerZOrder(hwc2_layer_t layer_id, uint32_t z) {
   }
 
   const auto layer = map_layer->second;
-  const auto z_range = layer_set_.equal_range(layer);
-  bool layer_on_display = false;
-  for (auto current = z_range.first; current != z_range.second; ++current) {
-    if (*current == layer) {
-      if ((*current)->GetZ() == z) {
-        // Don't change anything if the Z hasn't changed
-        return HWC2::Error::None;
-      }
-      current = layer_set_.erase(current);
-      layer_on_display = true;
-      break;
-    }
-  }
-
-  if (!layer_on_display) {
+  const auto current = std::find(layer_set_.begin(), layer_set_.end(), layer);
+  if (current == layer_set_.end()) {
     DLOGE("[%" PRIu64 "] updateLayerZ failed to find layer on display", id_);
     return HWC2::Error::BadLayer;
   }
 
+  if (layer->GetZ() == z) {
+    // Don't change anything if the Z hasn't changed
+    return HWC2::Error::None;
+  }
+
+  layer_set_.erase(current);
   layer->SetLayerZOrder(z);
-  layer_set_.emplace(layer);
+  layer_set_.insert(std::upper_bound(layer_set_.begin(), layer_set_.end(), layer,
+                                     SortLayersByZ()), layer);
   return HWC2::Error::None;
 }
 
@@ -716,6 +743,8 @@ DisplayError HWCDisplay::CECMessage(char *message) {
 }
 
 HWC2::Error HWCDisplay::PrepareLayerStack(uint32_t *out_num_types, uint32_t *out_num_requests) {
+  size_t changes_capacity = layer_changes_.capacity();
+  size_t requests_capacity = layer_requests_.capacity();
   layer_changes_.clear();
   layer_requests_.clear();
   if (shutdown_pending_) {
@@ -724,6 +753,7 @@ HWC2::Error HWCDisplay::PrepareLayerStack(uint32_t *out_num_types, uint32_t *out
 
   if (!skip_prepare_) {
     DisplayError error = display_intf_->Prepare(&layer_stack_);
+    layer_trace_.MarkStage(kTraceStagePrepare, error);
     if (error != kErrorNone) {
       if (error == kErrorShutDown) {
         shutdown_pending_ = true;
@@ -750,7 +780,8 @@ HWC2::Error HWCDisplay::PrepareLayerStack(uint32_t *out_num_types, uint32_t *out
 
     if ((composition == kCompositionSDE) || (composition == kCompositionHybrid) ||
         (composition == kCompositionBlit)) {
-      layer_requests_[hwc_layer->GetId()] = HWC2::LayerRequest::ClearClientTarget;
+      layer_requests_.push_back(std::make_pair(hwc_layer->GetId(),
+                                               HWC2::LayerRequest::ClearClientTarget));
     }
 
     HWC2::Composition requested_composition = hwc_layer->GetClientRequestedCompositionType();
@@ -760,9 +791,13 @@ HWC2::Error HWCDisplay::PrepareLayerStack(uint32_t *out_num_types, uint32_t *out
     // Update the changes list only if the requested composition is different from SDM comp type
     // TODO(user): Take Care of other comptypes(BLIT)
     if (requested_composition != device_composition) {
-      layer_changes_[hwc_layer->GetId()] = device_composition;
+      layer_changes_.push_back(std::make_pair(hwc_layer->GetId(), device_composition));
     }
   }
+  if ((layer_changes_.capacity() != changes_capacity) ||
+      (layer_requests_.capacity() != requests_capacity)) {
+    layer_storage_growths_++;
+  }
   *out_num_types = UINT32(layer_changes_.size());
   *out_num_requests = UINT32(layer_requests_.size());
   validated_ = true;
@@ -779,13 +814,13 @@ HWC2::Error HWCDisplay::AcceptDisplayChanges() {
   }
 
   for (const auto& change : layer_changes_) {
-    auto hwc_layer = layer_map_[change.first];
+    const auto map_layer = layer_map_.find(change.first);
     auto composition = change.second;
 
-    if (hwc_layer == nullptr) {
+    if (map_layer == layer_map_.end() || map_layer->second == nullptr) {
       DLOGI("Null layer in HWCDisplay::AcceptDisplayChanges.");
     } else {
-      hwc_layer->UpdateClientCompositionType(composition);
+      map_layer->second->UpdateClientCompositionType(composition);
     }
   }
   return HWC2::Error::None;
@@ -865,11 +900,14 @@ HWC2::Error HWCDisplay::CommitLayerStack(void) {
     return HWC2::Error::NotValidated;
   }
 
+  // Buffers dumped for the previous frame may be reused once this frame is committed.
+  HWCFrameDumper::Get()->WaitForCaptures();
   DumpInputBuffers();
 
   if (!flush_) {
     DisplayError error = kErrorUndefined;
     error = display_intf_->Commit(&layer_stack_);
+    layer_trace_.MarkStage(kTraceStageCommit, error);
     validated_ = false;
 
     if (error == kErrorNone) {
@@ -906,9 +944,11 @@ HWC2::Error HWCDisplay::PostCommitLayerStack(int32_t *out_retire_fence) {
     close(client_target_release_fence);
     client_target_release_fence = -1;
   }
+  client_target_->ReleaseStaleBuffers();
 
   for (auto hwc_layer : layer_set_) {
     hwc_layer->ResetGeometryChanges();
+    hwc_layer->ReleaseStaleBuffers();
     Layer *layer = hwc_layer->GetSDMLayer();
     LayerBuffer *layer_buffer = layer->input_buffer;
 
@@ -947,6 +987,7 @@ HWC2::Error HWCDisplay::PostCommitLayerStack(int32_t *out_retire_fence) {
     }
   }
 
+  layer_trace_.Write(layer_stack_);
   geometry_changes_ = GeometryChanges::kNone;
   flush_ = false;
 
@@ -1093,98 +1134,53 @@ LayerBufferFormat HWCDisplay::GetSDMFormat(const int32_t &source, const int flag
 }
 
 void HWCDisplay::DumpInputBuffers() {
-  char dir_path[PATH_MAX];
-
   if (!dump_frame_count_ || flush_ || !dump_input_layers_) {
     return;
   }
 
-  snprintf(dir_path, sizeof(dir_path), "/data/misc/display/frame_dump_%s", GetDisplayString());
-
-  if (mkdir(dir_path, 0777) != 0 && errno != EEXIST) {
-    DLOGW("Failed to create %s directory errno = %d, desc = %s", dir_path, errno, strerror(errno));
-    return;
-  }
-
-  // if directory exists already, need to explicitly change the permission.
-  if (errno == EEXIST && chmod(dir_path, 0777) != 0) {
-    DLOGW("Failed to change permissions on %s directory", dir_path);
-    return;
-  }
-
   for (uint32_t i = 0; i < layer_stack_.layers.size(); i++) {
     auto layer = layer_stack_.layers.at(i);
     const private_handle_t *pvt_handle =
         reinterpret_cast<const private_handle_t *>(layer->input_buffer->buffer_id);
-    auto acquire_fence_fd = layer->input_buffer->acquire_fence_fd;
 
-    if (acquire_fence_fd >= 0) {
-      int error = sync_wait(acquire_fence_fd, 1000);
-      if (error < 0) {
-        DLOGW("sync_wait error errno = %d, desc = %s", errno, strerror(errno));
-        return;
-      }
+    if (!pvt_handle || (pvt_handle->flags & private_handle_t::PRIV_FLAGS_SECURE_BUFFER)) {
+      continue;
     }
 
-    if (pvt_handle && pvt_handle->base) {
-      char dump_file_name[PATH_MAX];
-      size_t result = 0;
-
-      snprintf(dump_file_name, sizeof(dump_file_name), "%s/input_layer%d_%dx%d_%s_frame%d.raw",
-               dir_path, i, pvt_handle->width, pvt_handle->height,
-               GetHALPixelFormatString(pvt_handle->format), dump_frame_index_);
+    char name[32];
+    snprintf(name, sizeof(name), "input_layer%d", i);
 
-      FILE *fp = fopen(dump_file_name, "w+");
-      if (fp) {
-        result = fwrite(reinterpret_cast<void *>(pvt_handle->base), pvt_handle->size, 1, fp);
-        fclose(fp);
-      }
+    HWCFrameDumpInfo info;
+    info.display = GetDisplayString();
+    info.name = name;
+    info.frame_index = dump_frame_index_;
+    info.format = GetHALPixelFormatString(pvt_handle->format);
+    info.width = UINT32(pvt_handle->width);
+    info.height = UINT32(pvt_handle->height);
+    info.unaligned_width = UINT32(pvt_handle->unaligned_width);
+    info.unaligned_height = UINT32(pvt_handle->unaligned_height);
+    info.composition = HWCFrameDumper::GetCompositionString(layer->composition);
+    info.src_rect = layer->src_rect;
+    info.dst_rect = layer->dst_rect;
 
-      DLOGI("Frame Dump %s: is %s", dump_file_name, result ? "Successful" : "Failed");
-    }
+    HWCFrameDumper::Get()->Enqueue(info, pvt_handle->fd, pvt_handle->offset, pvt_handle->size,
+                                   layer->input_buffer->acquire_fence_fd);
   }
 }
 
-void HWCDisplay::DumpOutputBuffer(const BufferInfo &buffer_info, void *base, int fence) {
-  char dir_path[PATH_MAX];
-
-  snprintf(dir_path, sizeof(dir_path), "/data/misc/display/frame_dump_%s", GetDisplayString());
-
-  if (mkdir(dir_path, 777) != 0 && errno != EEXIST) {
-    DLOGW("Failed to create %s directory errno = %d, desc = %s", dir_path, errno, strerror(errno));
-    return;
-  }
+void HWCDisplay::DumpOutputBuffer(const BufferInfo &buffer_info, int fence) {
+  HWCFrameDumpInfo info;
+  info.display = GetDisplayString();
+  info.name = "output_layer";
+  info.frame_index = dump_frame_index_;
+  info.format = GetFormatString(buffer_info.buffer_config.format);
+  info.width = buffer_info.alloc_buffer_info.aligned_width;
+  info.height = buffer_info.alloc_buffer_info.aligned_height;
+  info.unaligned_width = buffer_info.buffer_config.width;
+  info.unaligned_height = buffer_info.buffer_config.height;
 
-  // if directory exists already, need to explicitly change the permission.
-  if (errno == EEXIST && chmod(dir_path, 0777) != 0) {
-    DLOGW("Failed to change permissions on %s directory", dir_path);
-    return;
-  }
-
-  if (base) {
-    char dump_file_name[PATH_MAX];
-    size_t result = 0;
-
-    if (fence >= 0) {
-      int error = sync_wait(fence, 1000);
-      if (error < 0) {
-        DLOGW("sync_wait error errno = %d, desc = %s", errno, strerror(errno));
-        return;
-      }
-    }
-
-    snprintf(dump_file_name, sizeof(dump_file_name), "%s/output_layer_%dx%d_%s_frame%d.raw",
-             dir_path, buffer_info.buffer_config.width, buffer_info.buffer_config.height,
-             GetFormatString(buffer_info.buffer_config.format), dump_frame_index_);
-
-    FILE *fp = fopen(dump_file_name, "w+");
-    if (fp) {
-      result = fwrite(base, buffer_info.alloc_buffer_info.size, 1, fp);
-      fclose(fp);
-    }
-
-    DLOGI("Frame Dump of %s is %s", dump_file_name, result ? "Successful" : "Failed");
-  }
+  HWCFrameDumper::Get()->Enqueue(info, buffer_info.alloc_buffer_info.fd, 0,
+                                 buffer_info.alloc_buffer_info.size, fence);
 }
 
 const char *HWCDisplay::GetHALPixelFormatString(int format) {
@@ -1639,6 +1635,7 @@ std::string HWCDisplay::Dump() {
   std::ostringstream os;
   os << "-------------------------------" << std::endl;
   os << "HWC2 LayerDump display_id: " << id_ << std::endl;
+  os << "layer storage growths: " << layer_storage_growths_ << std::endl;
   for (auto layer : layer_set_) {
     auto sdm_layer = layer->GetSDMLayer();
     auto transform = sdm_layer->transform;
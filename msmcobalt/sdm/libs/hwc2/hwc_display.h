@@ -25,9 +25,9 @@
 #include <hardware/hwcomposer.h>
 #include <private/color_params.h>
 #include <qdMetaData.h>
+#include <utils/layer_trace.h>
 #include <map>
 #include <queue>
-#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -140,6 +140,7 @@ class HWCDisplay : public DisplayEventHandler {
   int GetVisibleDisplayRect(hwc_rect_t *rect);
   void BuildLayerStack(void);
   void BuildSolidFillStack(void);
+  void ResetLayerStack(void);
   HWCLayer *GetHWCLayer(hwc2_layer_t layer);
 
   // HWC2 APIs
@@ -200,7 +201,7 @@ class HWCDisplay : public DisplayEventHandler {
   virtual DisplayError VSync(const DisplayEventVSync &vsync);
   virtual DisplayError Refresh();
   virtual DisplayError CECMessage(char *message);
-  virtual void DumpOutputBuffer(const BufferInfo &buffer_info, void *base, int fence);
+  virtual void DumpOutputBuffer(const BufferInfo &buffer_info, int fence);
   virtual HWC2::Error PrepareLayerStack(uint32_t *out_num_types, uint32_t *out_num_requests);
   virtual HWC2::Error CommitLayerStack(void);
   virtual HWC2::Error PostCommitLayerStack(int32_t *out_retire_fence);
@@ -233,9 +234,12 @@ class HWCDisplay : public DisplayEventHandler {
   LayerStack layer_stack_;
   HWCLayer *client_target_ = nullptr;                   // Also known as framebuffer target
   std::map<hwc2_layer_t, HWCLayer *> layer_map_;        // Look up by Id - TODO
-  std::multiset<HWCLayer *, SortLayersByZ> layer_set_;  // Maintain a set sorted by Z
-  std::map<hwc2_layer_t, HWC2::Composition> layer_changes_;
-  std::map<hwc2_layer_t, HWC2::LayerRequest> layer_requests_;
+  std::vector<HWCLayer *> layer_set_;                   // Maintain a vector sorted by Z
+  // Change and request lists are filled on every validate, hence kept as flat vectors which
+  // retain their storage across frames.
+  std::vector<std::pair<hwc2_layer_t, HWC2::Composition>> layer_changes_;
+  std::vector<std::pair<hwc2_layer_t, HWC2::LayerRequest>> layer_requests_;
+  uint64_t layer_storage_growths_ = 0;  // Times the layer stack or change lists grew storage
   bool flush_on_error_ = false;
   bool flush_ = false;
   uint32_t dump_frame_count_ = 0;
@@ -263,6 +267,7 @@ class HWCDisplay : public DisplayEventHandler {
   bool validated_ = false;
   bool color_tranform_failed_ = false;
   HWCColorMode *color_mode_ = NULL;
+  LayerTraceWriter layer_trace_;
 
  private:
   void DumpInputBuffers(void);
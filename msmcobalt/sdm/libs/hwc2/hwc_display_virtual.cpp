@@ -137,13 +137,15 @@ HWC2::Error HWCDisplayVirtual::Present(int32_t *out_retire_fence) {
           BufferInfo buffer_info;
           const private_handle_t *output_handle =
               reinterpret_cast<const private_handle_t *>(output_buffer_->buffer_id);
-          buffer_info.buffer_config.width = static_cast<uint32_t>(output_handle->width);
-          buffer_info.buffer_config.height = static_cast<uint32_t>(output_handle->height);
+          buffer_info.buffer_config.width = static_cast<uint32_t>(output_handle->unaligned_width);
+          buffer_info.buffer_config.height = static_cast<uint32_t>(output_handle->unaligned_height);
           buffer_info.buffer_config.format =
               GetSDMFormat(output_handle->format, output_handle->flags);
+          buffer_info.alloc_buffer_info.fd = output_handle->fd;
+          buffer_info.alloc_buffer_info.aligned_width = UINT32(output_handle->width);
+          buffer_info.alloc_buffer_info.aligned_height = UINT32(output_handle->height);
           buffer_info.alloc_buffer_info.size = static_cast<uint32_t>(output_handle->size);
-          DumpOutputBuffer(buffer_info, reinterpret_cast<void *>(output_handle->base),
-                           layer_stack_.retire_fence_fd);
+          DumpOutputBuffer(buffer_info, layer_stack_.retire_fence_fd);
         }
       }
 
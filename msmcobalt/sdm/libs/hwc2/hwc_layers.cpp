@@ -20,6 +20,10 @@
 #include "hwc_layers.h"
 #include <gr.h>
 #include <utils/debug.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
 #include <cmath>
 
 #define __CLASS__ "HWCLayer"
@@ -28,6 +32,40 @@ namespace sdm {
 
 std::atomic<hwc2_layer_t> HWCLayer::next_id_(1);
 
+// ION client shared by all layers, used only to tell buffers apart. ION hands out the same handle
+// for every import of a buffer into a client, and does not reuse the handle while an import is
+// held. It stays open for the life of the process.
+static int GetIonClient() {
+  static int ion_client = open("/dev/ion", O_RDONLY);
+  return ion_client;
+}
+
+static ion_user_handle_t ImportIonHandle(int fd) {
+  int ion_client = GetIonClient();
+  if (ion_client < 0) {
+    return 0;
+  }
+
+  struct ion_fd_data fd_data = {};
+  fd_data.fd = fd;
+  if (ioctl(ion_client, INT(ION_IOC_IMPORT), &fd_data)) {
+    DLOGE("ION_IOC_IMPORT failed for fd %d. Error = %s", fd, strerror(errno));
+    return 0;
+  }
+
+  return fd_data.handle;
+}
+
+static void FreeIonHandle(ion_user_handle_t ion_handle) {
+  if (!ion_handle) {
+    return;
+  }
+
+  struct ion_handle_data handle_data = {};
+  handle_data.handle = ion_handle;
+  ioctl(GetIonClient(), INT(ION_IOC_FREE), &handle_data);
+}
+
 // Layer operations
 HWCLayer::HWCLayer(hwc2_display_t display_id) : id_(next_id_++), display_id_(display_id) {
   layer_ = new Layer();
@@ -43,7 +81,9 @@ HWCLayer::~HWCLayer() {
     close(release_fences_.front());
     release_fences_.pop();
   }
-  close(ion_fd_);
+  for (auto &entry : buffer_cache_) {
+    ClearBufferCacheEntry(&entry);
+  }
   if (layer_) {
     if (layer_->input_buffer) {
       delete (layer_->input_buffer);
@@ -69,25 +109,21 @@ HWC2::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, int32_t acquire_fen
   // This works around bug 30281222
   if (handle->fd < 0) {
     return HWC2::Error::BadParameter;
-  } else {
-    close(ion_fd_);
-    ion_fd_ = dup(handle->fd);
   }
 
-  LayerBuffer *layer_buffer = layer_->input_buffer;
-  int aligned_width, aligned_height;
-  int unaligned_width, unaligned_height;
-
-  AdrenoMemInfo::getInstance().getAlignedWidthAndHeight(handle, aligned_width, aligned_height);
-  AdrenoMemInfo::getInstance().getUnalignedWidthAndHeight(handle, unaligned_width,
-                                                          unaligned_height);
+  BufferCacheEntry *entry = GetBufferCacheEntry(handle);
+  if (!entry) {
+    return HWC2::Error::NoResources;
+  }
 
-  layer_buffer->width = UINT32(aligned_width);
-  layer_buffer->height = UINT32(aligned_height);
-  layer_buffer->unaligned_width = UINT32(unaligned_width);
-  layer_buffer->unaligned_height = UINT32(unaligned_height);
+  LayerBuffer *layer_buffer = layer_->input_buffer;
+  layer_buffer->width = entry->aligned_width;
+  layer_buffer->height = entry->aligned_height;
+  layer_buffer->unaligned_width = entry->unaligned_width;
+  layer_buffer->unaligned_height = entry->unaligned_height;
 
-  layer_buffer->format = GetSDMFormat(handle->format, handle->flags);
+  layer_buffer->format = entry->sdm_format;
+  // Metadata may be updated by the producer on every frame, hence it is not cached.
   if (SetMetaData(handle, layer_) != kErrorNone) {
     return HWC2::Error::BadLayer;
   }
@@ -103,7 +139,7 @@ HWC2::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, int32_t acquire_fen
     layer_buffer->flags.secure_display = true;
   }
 
-  layer_buffer->planes[0].fd = ion_fd_;
+  layer_buffer->planes[0].fd = entry->ion_fd;
   layer_buffer->planes[0].offset = handle->offset;
   layer_buffer->planes[0].stride = UINT32(handle->width);
   layer_buffer->acquire_fence_fd = acquire_fence;
@@ -112,6 +148,116 @@ HWC2::Error HWCLayer::SetLayerBuffer(buffer_handle_t buffer, int32_t acquire_fen
   return HWC2::Error::None;
 }
 
+HWCLayer::BufferCacheEntry *HWCLayer::GetBufferCacheEntry(const private_handle_t *handle) {
+  // The import is kept by a new entry, or dropped again on a hit
+  ion_user_handle_t ion_handle = ImportIonHandle(handle->fd);
+
+  buffer_use_count_++;
+  for (auto &entry : buffer_cache_) {
+    if (IsSameBuffer(entry, handle, ion_handle)) {
+      FreeIonHandle(ion_handle);
+      entry.last_use = buffer_use_count_;
+      UpdateBufferGeometry(handle, &entry);
+      return &entry;
+    }
+    if ((entry.handle == handle) || (entry.fd == handle->fd)) {
+      // The cached buffer was freed and its handle address or fd reused. The driver holds its own
+      // references to buffers still on screen, so the dup'd fd can go now.
+      ClearBufferCacheEntry(&entry);
+    }
+  }
+
+  BufferCacheEntry *lru_entry = &buffer_cache_[0];
+  for (auto &entry : buffer_cache_) {
+    if (entry.last_use < lru_entry->last_use) {
+      lru_entry = &entry;
+    }
+  }
+
+  // Replace the least recently used entry. Its fd is not in use by the current or the previous
+  // frame, as those refer to more recently used entries.
+  int ion_fd = dup(handle->fd);
+  if (ion_fd < 0) {
+    DLOGE("Failed to dup ion fd %d on layer: %d. Error = %s", handle->fd, id_, strerror(errno));
+    FreeIonHandle(ion_handle);
+    return nullptr;
+  }
+
+  ClearBufferCacheEntry(lru_entry);
+  lru_entry->handle = handle;
+  lru_entry->fd = handle->fd;
+  lru_entry->flags = handle->flags;
+  lru_entry->format = handle->format;
+  lru_entry->buffer_type = handle->bufferType;
+  lru_entry->width = handle->width;
+  lru_entry->height = handle->height;
+  lru_entry->size = handle->size;
+  lru_entry->offset = handle->offset;
+  lru_entry->base = handle->base;
+  lru_entry->base_metadata = handle->base_metadata;
+  lru_entry->ion_fd = ion_fd;
+  lru_entry->ion_handle = ion_handle;
+  lru_entry->geometry_valid = false;
+  lru_entry->sdm_format = GetSDMFormat(handle->format, handle->flags);
+  lru_entry->last_use = buffer_use_count_;
+  lru_entry->last_present = present_count_;
+  UpdateBufferGeometry(handle, lru_entry);
+
+  return lru_entry;
+}
+
+void HWCLayer::UpdateBufferGeometry(const private_handle_t *handle, BufferCacheEntry *entry) {
+  const MetaData_t *meta_data = reinterpret_cast<MetaData_t *>(handle->base_metadata);
+  int slice_width = 0;
+  int slice_height = 0;
+
+  // Producers such as video decoders may update the buffer geometry in metadata on any frame.
+  if (meta_data && (meta_data->operation & UPDATE_BUFFER_GEOMETRY)) {
+    slice_width = meta_data->bufferDim.sliceWidth;
+    slice_height = meta_data->bufferDim.sliceHeight;
+  }
+
+  if (entry->geometry_valid && (entry->slice_width == slice_width) &&
+      (entry->slice_height == slice_height)) {
+    return;
+  }
+
+  int aligned_width, aligned_height;
+  int unaligned_width, unaligned_height;
+  AdrenoMemInfo::getInstance().getAlignedWidthAndHeight(handle, aligned_width, aligned_height);
+  AdrenoMemInfo::getInstance().getUnalignedWidthAndHeight(handle, unaligned_width,
+                                                          unaligned_height);
+
+  entry->aligned_width = UINT32(aligned_width);
+  entry->aligned_height = UINT32(aligned_height);
+  entry->unaligned_width = UINT32(unaligned_width);
+  entry->unaligned_height = UINT32(unaligned_height);
+  entry->slice_width = slice_width;
+  entry->slice_height = slice_height;
+  entry->geometry_valid = true;
+}
+
+bool HWCLayer::IsSameBuffer(const BufferCacheEntry &entry, const private_handle_t *handle,
+                            ion_user_handle_t ion_handle) {
+  // A freed handle may be reallocated at the same address with the same fd and attributes, only
+  // the ION handle tells such buffers apart. Without ION, the attributes are all there is.
+  return (entry.ion_fd >= 0) && (entry.ion_handle == ion_handle) &&
+         (entry.handle == handle) && (entry.fd == handle->fd) &&
+         (entry.flags == handle->flags) && (entry.format == handle->format) &&
+         (entry.buffer_type == handle->bufferType) && (entry.width == handle->width) &&
+         (entry.height == handle->height) && (entry.size == handle->size) &&
+         (entry.offset == handle->offset) && (entry.base == handle->base) &&
+         (entry.base_metadata == handle->base_metadata);
+}
+
+void HWCLayer::ClearBufferCacheEntry(BufferCacheEntry *entry) {
+  if (entry->ion_fd >= 0) {
+    close(entry->ion_fd);
+  }
+  FreeIonHandle(entry->ion_handle);
+  *entry = BufferCacheEntry();
+}
+
 HWC2::Error HWCLayer::SetLayerSurfaceDamage(hwc_region_t damage) {
   layer_->dirty_regions.clear();
   for (uint32_t i = 0; i < damage.numRects; i++) {
@@ -556,4 +702,22 @@ int32_t HWCLayer::PopReleaseFence(void) {
   return fence;
 }
 
+// Called once per presented frame. The buffer of the current frame is kept even if the client did
+// not set it again, the driver holds its own references to buffers of frames still on screen.
+void HWCLayer::ReleaseStaleBuffers() {
+  int current_fd = layer_->input_buffer->planes[0].fd;
+
+  present_count_++;
+  for (auto &entry : buffer_cache_) {
+    if (entry.ion_fd < 0) {
+      continue;
+    }
+    if (entry.ion_fd == current_fd) {
+      entry.last_present = present_count_;
+    } else if (present_count_ - entry.last_present > kBufferIdleFrames) {
+      ClearBufferCacheEntry(&entry);
+    }
+  }
+}
+
 }  // namespace sdm
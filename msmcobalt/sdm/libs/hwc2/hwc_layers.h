@@ -23,6 +23,7 @@
 /* This class translates HWC2 Layer functions to the SDM LayerStack
  */
 
+#include <linux/msm_ion.h>
 #include <gralloc_priv.h>
 #include <qdMetaData.h>
 #include <core/layer_stack.h>
@@ -78,15 +79,62 @@ class HWCLayer {
   void ResetGeometryChanges() { geometry_changes_ = GeometryChanges::kNone; }
   void PushReleaseFence(int32_t fence);
   int32_t PopReleaseFence(void);
+  void ReleaseStaleBuffers();
 
  private:
+  // Buffers of a layer come from a small set of BufferQueue slots. Attributes derived from a
+  // gralloc handle, along with the dup of its ion fd, are retained for the most recently used
+  // handles so that a recycled slot does not repeat the syscalls and format lookups. Handle
+  // addresses and fd numbers are reused once a buffer is freed, so each entry also holds an ION
+  // import of its buffer, which is compared on every lookup. An entry not
+  // presented for kBufferIdleFrames frames is dropped, as its buffer has likely been released and
+  // the dup'd fd would keep the memory alive.
+  enum { kBufferCacheSize = 4 };
+  enum { kBufferIdleFrames = 16 };
+
+  struct BufferCacheEntry {
+    const private_handle_t *handle = nullptr;
+    // Handle fields, which identify the generation of the buffer behind a reused handle address.
+    int fd = -1;
+    int flags = 0;
+    int format = 0;
+    int buffer_type = 0;
+    int width = 0;
+    int height = 0;
+    unsigned int size = 0;
+    unsigned int offset = 0;
+    uint64_t base = 0;
+    uint64_t base_metadata = 0;
+    // Attributes derived from the handle
+    int ion_fd = -1;
+    ion_user_handle_t ion_handle = 0;  // Import of the buffer, 0 if ION is unavailable
+    bool geometry_valid = false;
+    int slice_width = 0;   // Buffer geometry from metadata, the dimensions below are derived for
+    int slice_height = 0;  // these.
+    uint32_t aligned_width = 0;
+    uint32_t aligned_height = 0;
+    uint32_t unaligned_width = 0;
+    uint32_t unaligned_height = 0;
+    LayerBufferFormat sdm_format = kFormatInvalid;
+    uint64_t last_use = 0;
+    uint64_t last_present = 0;
+  };
+
+  BufferCacheEntry *GetBufferCacheEntry(const private_handle_t *handle);
+  bool IsSameBuffer(const BufferCacheEntry &entry, const private_handle_t *handle,
+                    ion_user_handle_t ion_handle);
+  void ClearBufferCacheEntry(BufferCacheEntry *entry);
+  void UpdateBufferGeometry(const private_handle_t *handle, BufferCacheEntry *entry);
+
   Layer *layer_ = nullptr;
   uint32_t z_ = 0;
   const hwc2_layer_t id_;
   const hwc2_display_t display_id_;
   static std::atomic<hwc2_layer_t> next_id_;
   std::queue<int32_t> release_fences_;
-  int ion_fd_ = -1;
+  BufferCacheEntry buffer_cache_[kBufferCacheSize];
+  uint64_t buffer_use_count_ = 0;
+  uint64_t present_count_ = 0;
 
   // Composition requested by client(SF)
   HWC2::Composition client_requested_ = HWC2::Composition::Device;
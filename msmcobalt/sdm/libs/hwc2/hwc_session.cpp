@@ -32,15 +32,18 @@
 #include <gralloc_priv.h>
 #include <display_config.h>
 #include <utils/debug.h>
+#include <utils/frame_timing.h>
 #include <sync/sync.h>
 #include <profiler.h>
 #include <string>
 #include <bitset>
+#include <algorithm>
 
 #include "hwc_buffer_allocator.h"
 #include "hwc_buffer_sync_handler.h"
 #include "hwc_session.h"
 #include "hwc_debugger.h"
+#include "hwc_frame_dumper.h"
 #include "hwc_display_primary.h"
 #include "hwc_display_virtual.h"
 
@@ -66,7 +69,7 @@ hwc_module_t HAL_MODULE_INFO_SYM = {
 };
 
 namespace sdm {
-Locker HWCSession::locker_;
+Locker HWCSession::locker_[HWC_NUM_DISPLAY_TYPES];
 
 HWCSession::HWCSession(const hw_module_t *module) {
   hwc2_device_t::common.tag = HARDWARE_DEVICE_TAG;
@@ -156,7 +159,7 @@ int HWCSession::Deinit() {
 }
 
 int HWCSession::Open(const hw_module_t *module, const char *name, hw_device_t **device) {
-  SEQUENCE_WAIT_SCOPE_LOCK(locker_);
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_PRIMARY]);
 
   if (!module || !name || !device) {
     DLOGE("Invalid parameters.");
@@ -183,7 +186,7 @@ int HWCSession::Open(const hw_module_t *module, const char *name, hw_device_t **
 }
 
 int HWCSession::Close(hw_device_t *device) {
-  SEQUENCE_WAIT_SCOPE_LOCK(locker_);
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_PRIMARY]);
 
   if (!device) {
     return -EINVAL;
@@ -221,14 +224,18 @@ static int32_t AcceptDisplayChanges(hwc2_device_t *device, hwc2_display_t displa
 
 int32_t HWCSession::CreateLayer(hwc2_device_t *device, hwc2_display_t display,
                                 hwc2_layer_t *out_layer_id) {
-  SCOPE_LOCK(locker_);
+  if (display >= HWC_NUM_DISPLAY_TYPES) {
+    return HWC2_ERROR_BAD_DISPLAY;
+  }
+
+  SCOPE_LOCK(locker_[display]);
   return CallDisplayFunction(device, display, &HWCDisplay::CreateLayer, out_layer_id);
 }
 
 int32_t HWCSession::CreateVirtualDisplay(hwc2_device_t *device, uint32_t width, uint32_t height,
                                          int32_t *format, hwc2_display_t *out_display_id) {
   // TODO(user): Handle concurrency with HDMI
-  SCOPE_LOCK(locker_);
+  SCOPE_LOCK(locker_[HWC_DISPLAY_VIRTUAL]);
   if (!device) {
     return HWC2_ERROR_BAD_DISPLAY;
   }
@@ -247,16 +254,20 @@ int32_t HWCSession::CreateVirtualDisplay(hwc2_device_t *device, uint32_t width,
 
 int32_t HWCSession::DestroyLayer(hwc2_device_t *device, hwc2_display_t display,
                                  hwc2_layer_t layer) {
-  SCOPE_LOCK(locker_);
+  if (display >= HWC_NUM_DISPLAY_TYPES) {
+    return HWC2_ERROR_BAD_DISPLAY;
+  }
+
+  SCOPE_LOCK(locker_[display]);
   return CallDisplayFunction(device, display, &HWCDisplay::DestroyLayer, layer);
 }
 
 int32_t HWCSession::DestroyVirtualDisplay(hwc2_device_t *device, hwc2_display_t display) {
-  SCOPE_LOCK(locker_);
-  if (!device) {
+  if (!device || display != HWC_DISPLAY_VIRTUAL) {
     return HWC2_ERROR_BAD_DISPLAY;
   }
 
+  SCOPE_LOCK(locker_[display]);
   DLOGI("Destroying virtual display id:%" PRIu64, display);
   auto *hwc_session = static_cast<HWCSession *>(device);
 
@@ -270,27 +281,44 @@ int32_t HWCSession::DestroyVirtualDisplay(hwc2_device_t *device, hwc2_display_t
 }
 
 void HWCSession::Dump(hwc2_device_t *device, uint32_t *out_size, char *out_buffer) {
-  SEQUENCE_WAIT_SCOPE_LOCK(locker_);
-
   if (!device) {
     return;
   }
   auto *hwc_session = static_cast<HWCSession *>(device);
 
   if (out_buffer == nullptr) {
-    *out_size = 8192;  // TODO(user): Adjust required dump size
+    // Display dumps and the sdm dump, plus frame timing, frame dumper and buffer pool stats
+    *out_size = 20480;  // TODO(user): Adjust required dump size
   } else {
     char sdm_dump[4096];
     DumpInterface::GetDump(sdm_dump, 4096);  // TODO(user): Fix this workaround
     std::string s("");
     for (int id = HWC_DISPLAY_PRIMARY; id <= HWC_DISPLAY_VIRTUAL; id++) {
+      SEQUENCE_WAIT_SCOPE_LOCK(locker_[id]);
       if (hwc_session->hwc_display_[id]) {
         s += hwc_session->hwc_display_[id]->Dump();
       }
     }
     s += sdm_dump;
-    s.copy(out_buffer, s.size(), 0);
-    *out_size = sizeof(out_buffer);
+    for (int id = HWC_DISPLAY_PRIMARY; id <= HWC_DISPLAY_VIRTUAL; id++) {
+      char contention[64];
+      snprintf(contention, sizeof(contention), "\nlock contention display %d: %" PRIu64, id,
+               locker_[id].GetContentionCount());
+      s += contention;
+    }
+    char timing_dump[4096];
+    FrameTiming::GetDump(timing_dump, sizeof(timing_dump));
+    s += "\n\nframe timing:\n";
+    s += timing_dump;
+    char frame_dump[256];
+    HWCFrameDumper::Get()->GetDump(frame_dump, sizeof(frame_dump));
+    s += frame_dump;
+    char pool_dump[256];
+    hwc_session->buffer_allocator_.GetDump(pool_dump, sizeof(pool_dump));
+    s += pool_dump;
+    // The caller's buffer holds the size reported by the first call, truncate to it
+    size_t copied = s.copy(out_buffer, std::min(s.size(), size_t(*out_size)), 0);
+    *out_size = UINT32(copied);
   }
 }
 
@@ -384,11 +412,12 @@ int32_t HWCSession::PresentDisplay(hwc2_device_t *device, hwc2_display_t display
                                    int32_t *out_retire_fence) {
   HWCSession *hwc_session = static_cast<HWCSession *>(device);
   DTRACE_SCOPED();
-  SEQUENCE_EXIT_SCOPE_LOCK(locker_);
-  if (!device) {
+  if (!device || display >= HWC_NUM_DISPLAY_TYPES) {
     return HWC2_ERROR_BAD_DISPLAY;
   }
 
+  SEQUENCE_EXIT_SCOPE_LOCK(locker_[display]);
+
   auto status = HWC2::Error::BadDisplay;
   // TODO(user): Handle virtual display/HDMI concurrency
   if (hwc_session->hwc_display_[display]) {
@@ -431,14 +460,22 @@ static int32_t SetClientTarget(hwc2_device_t *device, hwc2_display_t display,
 int32_t HWCSession::SetColorMode(hwc2_device_t *device, hwc2_display_t display,
                                  int32_t /*android_color_mode_t*/ int_mode) {
   auto mode = static_cast<android_color_mode_t>(int_mode);
-  SEQUENCE_WAIT_SCOPE_LOCK(locker_);
+  if (display >= HWC_NUM_DISPLAY_TYPES) {
+    return HWC2_ERROR_BAD_DISPLAY;
+  }
+
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[display]);
   return HWCSession::CallDisplayFunction(device, display, &HWCDisplay::SetColorMode, mode);
 }
 
 int32_t HWCSession::SetColorTransform(hwc2_device_t *device, hwc2_display_t display,
                                       const float *matrix,
                                       int32_t /*android_color_transform_t*/ hint) {
-  SEQUENCE_WAIT_SCOPE_LOCK(locker_);
+  if (display >= HWC_NUM_DISPLAY_TYPES) {
+    return HWC2_ERROR_BAD_DISPLAY;
+  }
+
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[display]);
   android_color_transform_t transform_hint = static_cast<android_color_transform_t>(hint);
   return HWCSession::CallDisplayFunction(device, display, &HWCDisplay::SetColorTransform, matrix,
                                          transform_hint);
@@ -518,7 +555,11 @@ static int32_t SetLayerVisibleRegion(hwc2_device_t *device, hwc2_display_t displ
 
 int32_t HWCSession::SetLayerZOrder(hwc2_device_t *device, hwc2_display_t display,
                                    hwc2_layer_t layer, uint32_t z) {
-  SCOPE_LOCK(locker_);
+  if (display >= HWC_NUM_DISPLAY_TYPES) {
+    return HWC2_ERROR_BAD_DISPLAY;
+  }
+
+  SCOPE_LOCK(locker_[display]);
   return CallDisplayFunction(device, display, &HWCDisplay::SetLayerZOrder, layer, z);
 }
 
@@ -540,8 +581,20 @@ int32_t HWCSession::SetOutputBuffer(hwc2_device_t *device, hwc2_display_t displa
 
 int32_t HWCSession::SetPowerMode(hwc2_device_t *device, hwc2_display_t display, int32_t int_mode) {
   auto mode = static_cast<HWC2::PowerMode>(int_mode);
-  SEQUENCE_WAIT_SCOPE_LOCK(locker_);
-  return CallDisplayFunction(device, display, &HWCDisplay::SetPowerMode, mode);
+  if (display >= HWC_NUM_DISPLAY_TYPES) {
+    return HWC2_ERROR_BAD_DISPLAY;
+  }
+
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[display]);
+  auto status = CallDisplayFunction(device, display, &HWCDisplay::SetPowerMode, mode);
+
+  // Buffers retained for reuse are not needed while the primary display is off.
+  if (status == HWC2_ERROR_NONE && display == HWC_DISPLAY_PRIMARY &&
+      mode == HWC2::PowerMode::Off) {
+    static_cast<HWCSession *>(device)->buffer_allocator_.PurgeBuffers();
+  }
+
+  return status;
 }
 
 static int32_t SetVsyncEnabled(hwc2_device_t *device, hwc2_display_t display, int32_t int_enabled) {
@@ -553,7 +606,7 @@ int32_t HWCSession::ValidateDisplay(hwc2_device_t *device, hwc2_display_t displa
                                     uint32_t *out_num_types, uint32_t *out_num_requests) {
   DTRACE_SCOPED();
   HWCSession *hwc_session = static_cast<HWCSession *>(device);
-  if (!device) {
+  if (!device || display >= HWC_NUM_DISPLAY_TYPES) {
     return HWC2_ERROR_BAD_DISPLAY;
   }
 
@@ -561,7 +614,7 @@ int32_t HWCSession::ValidateDisplay(hwc2_device_t *device, hwc2_display_t displa
   // Handle external_pending_connect_ in CreateVirtualDisplay
   auto status = HWC2::Error::BadDisplay;
   if (hwc_session->hwc_display_[display]) {
-    SEQUENCE_ENTRY_SCOPE_LOCK(locker_);
+    SEQUENCE_ENTRY_SCOPE_LOCK(locker_[display]);
     if (display == HWC_DISPLAY_PRIMARY) {
       // TODO(user): This can be moved to HWCDisplayPrimary
       if (hwc_session->reset_panel_) {
@@ -579,7 +632,7 @@ int32_t HWCSession::ValidateDisplay(hwc2_device_t *device, hwc2_display_t displa
   // If validate fails, cancel the sequence lock so that other operations
   // (such as Dump or SetPowerMode) may succeed without blocking on the condition
   if (status == HWC2::Error::BadDisplay) {
-    SEQUENCE_CANCEL_SCOPE_LOCK(locker_);
+    SEQUENCE_CANCEL_SCOPE_LOCK(locker_[display]);
   }
   return INT32(status);
 }
@@ -743,10 +796,9 @@ int HWCSession::DisconnectDisplay(int disp) {
 // Qclient methods
 android::status_t HWCSession::notifyCallback(uint32_t command, const android::Parcel *input_parcel,
                                              android::Parcel *output_parcel) {
-  SEQUENCE_WAIT_SCOPE_LOCK(locker_);
-
   android::status_t status = 0;
 
+  // Commands which address a particular display take the lock of that display in their handlers.
   switch (command) {
     case qService::IQService::DYNAMIC_DEBUG:
       DynamicDebug(input_parcel);
@@ -756,13 +808,6 @@ android::status_t HWCSession::notifyCallback(uint32_t command, const android::Pa
       callbacks_.Refresh(HWC_DISPLAY_PRIMARY);
       break;
 
-    case qService::IQService::SET_IDLE_TIMEOUT:
-      if (hwc_display_[HWC_DISPLAY_PRIMARY]) {
-        uint32_t timeout = UINT32(input_parcel->readInt32());
-        hwc_display_[HWC_DISPLAY_PRIMARY]->SetIdleTimeoutMs(timeout);
-      }
-      break;
-
     case qService::IQService::SET_FRAME_DUMP_CONFIG:
       SetFrameDumpConfig(input_parcel);
       break;
@@ -771,37 +816,14 @@ android::status_t HWCSession::notifyCallback(uint32_t command, const android::Pa
       status = SetMaxMixerStages(input_parcel);
       break;
 
-    case qService::IQService::SET_DISPLAY_MODE:
-      status = SetDisplayMode(input_parcel);
-      break;
-
     case qService::IQService::SET_SECONDARY_DISPLAY_STATUS:
       status = SetSecondaryDisplayStatus(input_parcel, output_parcel);
       break;
 
-    case qService::IQService::CONFIGURE_DYN_REFRESH_RATE:
-      status = ConfigureRefreshRate(input_parcel);
-      break;
-
-    case qService::IQService::SET_VIEW_FRAME:
-      break;
-
-    case qService::IQService::TOGGLE_SCREEN_UPDATES:
-      status = ToggleScreenUpdates(input_parcel, output_parcel);
-      break;
-
-    case qService::IQService::QDCM_SVC_CMDS:
-      status = QdcmCMDHandler(input_parcel, output_parcel);
-      break;
-
     case qService::IQService::MIN_HDCP_ENCRYPTION_LEVEL_CHANGED:
       status = OnMinHdcpEncryptionLevelChange(input_parcel, output_parcel);
       break;
 
-    case qService::IQService::CONTROL_PARTIAL_UPDATE:
-      status = ControlPartialUpdate(input_parcel, output_parcel);
-      break;
-
     case qService::IQService::SET_ACTIVE_CONFIG:
       status = HandleSetActiveDisplayConfig(input_parcel, output_parcel);
       break;
@@ -818,6 +840,60 @@ android::status_t HWCSession::notifyCallback(uint32_t command, const android::Pa
       status = HandleGetDisplayAttributesForConfig(input_parcel, output_parcel);
       break;
 
+    case qService::IQService::GET_DISPLAY_VISIBLE_REGION:
+      status = GetVisibleDisplayRect(input_parcel, output_parcel);
+      break;
+
+    case qService::IQService::SET_COLOR_MODE:
+      status = SetColorModeOverride(input_parcel);
+      break;
+
+    default:
+      status = HandlePrimaryDisplayCommand(command, input_parcel, output_parcel);
+      break;
+  }
+
+  return status;
+}
+
+android::status_t HWCSession::HandlePrimaryDisplayCommand(uint32_t command,
+                                                          const android::Parcel *input_parcel,
+                                                          android::Parcel *output_parcel) {
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_PRIMARY]);
+
+  android::status_t status = 0;
+
+  switch (command) {
+    case qService::IQService::SET_IDLE_TIMEOUT:
+      if (hwc_display_[HWC_DISPLAY_PRIMARY]) {
+        uint32_t timeout = UINT32(input_parcel->readInt32());
+        hwc_display_[HWC_DISPLAY_PRIMARY]->SetIdleTimeoutMs(timeout);
+      }
+      break;
+
+    case qService::IQService::SET_DISPLAY_MODE:
+      status = SetDisplayMode(input_parcel);
+      break;
+
+    case qService::IQService::CONFIGURE_DYN_REFRESH_RATE:
+      status = ConfigureRefreshRate(input_parcel);
+      break;
+
+    case qService::IQService::SET_VIEW_FRAME:
+      break;
+
+    case qService::IQService::TOGGLE_SCREEN_UPDATES:
+      status = ToggleScreenUpdates(input_parcel, output_parcel);
+      break;
+
+    case qService::IQService::QDCM_SVC_CMDS:
+      status = QdcmCMDHandler(input_parcel, output_parcel);
+      break;
+
+    case qService::IQService::CONTROL_PARTIAL_UPDATE:
+      status = ControlPartialUpdate(input_parcel, output_parcel);
+      break;
+
     case qService::IQService::GET_PANEL_BRIGHTNESS:
       status = GetPanelBrightness(input_parcel, output_parcel);
       break;
@@ -826,10 +902,6 @@ android::status_t HWCSession::notifyCallback(uint32_t command, const android::Pa
       status = SetPanelBrightness(input_parcel, output_parcel);
       break;
 
-    case qService::IQService::GET_DISPLAY_VISIBLE_REGION:
-      status = GetVisibleDisplayRect(input_parcel, output_parcel);
-      break;
-
     case qService::IQService::SET_CAMERA_STATUS:
       status = SetDynamicBWForCamera(input_parcel, output_parcel);
       break;
@@ -838,12 +910,12 @@ android::status_t HWCSession::notifyCallback(uint32_t command, const android::Pa
       status = GetBWTransactionStatus(input_parcel, output_parcel);
       break;
 
-    case qService::IQService::SET_LAYER_MIXER_RESOLUTION:
-      status = SetMixerResolution(input_parcel);
+    case qService::IQService::GET_FRAME_TIMING:
+      status = GetFrameTiming(input_parcel, output_parcel);
       break;
 
-    case qService::IQService::SET_COLOR_MODE:
-      status = SetColorModeOverride(input_parcel);
+    case qService::IQService::SET_LAYER_MIXER_RESOLUTION:
+      status = SetMixerResolution(input_parcel);
       break;
 
     default:
@@ -945,7 +1017,7 @@ android::status_t HWCSession::ControlPartialUpdate(const android::Parcel *input_
   callbacks_.Refresh(HWC_DISPLAY_PRIMARY);
 
   // Wait until partial update control is complete
-  ret = locker_.WaitFinite(kPartialUpdateControlTimeoutMs);
+  ret = locker_[HWC_DISPLAY_PRIMARY].WaitFinite(kPartialUpdateControlTimeoutMs);
 
   out->writeInt32(ret);
 
@@ -962,6 +1034,8 @@ android::status_t HWCSession::HandleSetActiveDisplayConfig(const android::Parcel
     return android::BAD_VALUE;
   }
 
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[dpy]);
+
   if (hwc_display_[dpy]) {
     error = hwc_display_[dpy]->SetActiveDisplayConfig(config);
     if (error == 0) {
@@ -981,6 +1055,8 @@ android::status_t HWCSession::HandleGetActiveDisplayConfig(const android::Parcel
     return android::BAD_VALUE;
   }
 
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[dpy]);
+
   if (hwc_display_[dpy]) {
     uint32_t config = 0;
     error = hwc_display_[dpy]->GetActiveDisplayConfig(&config);
@@ -1001,6 +1077,8 @@ android::status_t HWCSession::HandleGetDisplayConfigCount(const android::Parcel
     return android::BAD_VALUE;
   }
 
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[dpy]);
+
   uint32_t count = 0;
   if (hwc_display_[dpy]) {
     error = hwc_display_[dpy]->GetDisplayConfigCount(&count);
@@ -1024,6 +1102,8 @@ android::status_t HWCSession::HandleGetDisplayAttributesForConfig(const android:
     return android::BAD_VALUE;
   }
 
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[dpy]);
+
   if (hwc_display_[dpy]) {
     error = hwc_display_[dpy]->GetDisplayAttributesForConfig(config, &display_attributes);
     if (error == 0) {
@@ -1055,6 +1135,7 @@ android::status_t HWCSession::SetSecondaryDisplayStatus(const android::Parcel *i
   } else if (!hwc_display_[display_id]) {
     DLOGW("Display is not connected");
   } else {
+    SEQUENCE_WAIT_SCOPE_LOCK(locker_[display_id]);
     ret = hwc_display_[display_id]->SetDisplayStatus(display_status);
   }
 
@@ -1096,6 +1177,7 @@ android::status_t HWCSession::SetMaxMixerStages(const android::Parcel *input_par
   uint32_t max_mixer_stages = UINT32(input_parcel->readInt32());
 
   if (bit_mask_display_type[HWC_DISPLAY_PRIMARY]) {
+    SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_PRIMARY]);
     if (hwc_display_[HWC_DISPLAY_PRIMARY]) {
       error = hwc_display_[HWC_DISPLAY_PRIMARY]->SetMaxMixerStages(max_mixer_stages);
       if (error != kErrorNone) {
@@ -1105,6 +1187,7 @@ android::status_t HWCSession::SetMaxMixerStages(const android::Parcel *input_par
   }
 
   if (bit_mask_display_type[HWC_DISPLAY_EXTERNAL]) {
+    SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_EXTERNAL]);
     if (hwc_display_[HWC_DISPLAY_EXTERNAL]) {
       error = hwc_display_[HWC_DISPLAY_EXTERNAL]->SetMaxMixerStages(max_mixer_stages);
       if (error != kErrorNone) {
@@ -1114,6 +1197,7 @@ android::status_t HWCSession::SetMaxMixerStages(const android::Parcel *input_par
   }
 
   if (bit_mask_display_type[HWC_DISPLAY_VIRTUAL]) {
+    SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_VIRTUAL]);
     if (hwc_display_[HWC_DISPLAY_VIRTUAL]) {
       error = hwc_display_[HWC_DISPLAY_VIRTUAL]->SetMaxMixerStages(max_mixer_stages);
       if (error != kErrorNone) {
@@ -1160,24 +1244,40 @@ android::status_t HWCSession::GetBWTransactionStatus(const android::Parcel *inpu
   return 0;
 }
 
+android::status_t HWCSession::GetFrameTiming(const android::Parcel *input_parcel,
+                                             android::Parcel *output_parcel) {
+  char timing_dump[4096];
+  FrameTiming::GetDump(timing_dump, sizeof(timing_dump));
+  output_parcel->writeCString(timing_dump);
+
+  if (input_parcel->readInt32() == 1) {
+    FrameTiming::Reset();
+  }
+
+  return 0;
+}
+
 void HWCSession::SetFrameDumpConfig(const android::Parcel *input_parcel) {
   uint32_t frame_dump_count = UINT32(input_parcel->readInt32());
   std::bitset<32> bit_mask_display_type = UINT32(input_parcel->readInt32());
   uint32_t bit_mask_layer_type = UINT32(input_parcel->readInt32());
 
   if (bit_mask_display_type[HWC_DISPLAY_PRIMARY]) {
+    SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_PRIMARY]);
     if (hwc_display_[HWC_DISPLAY_PRIMARY]) {
       hwc_display_[HWC_DISPLAY_PRIMARY]->SetFrameDumpConfig(frame_dump_count, bit_mask_layer_type);
     }
   }
 
   if (bit_mask_display_type[HWC_DISPLAY_EXTERNAL]) {
+    SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_EXTERNAL]);
     if (hwc_display_[HWC_DISPLAY_EXTERNAL]) {
       hwc_display_[HWC_DISPLAY_EXTERNAL]->SetFrameDumpConfig(frame_dump_count, bit_mask_layer_type);
     }
   }
 
   if (bit_mask_display_type[HWC_DISPLAY_VIRTUAL]) {
+    SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_VIRTUAL]);
     if (hwc_display_[HWC_DISPLAY_VIRTUAL]) {
       hwc_display_[HWC_DISPLAY_VIRTUAL]->SetFrameDumpConfig(frame_dump_count, bit_mask_layer_type);
     }
@@ -1213,6 +1313,11 @@ android::status_t HWCSession::SetColorModeOverride(const android::Parcel *input_
   auto display = static_cast<hwc2_display_t >(input_parcel->readInt32());
   auto mode = static_cast<android_color_mode_t>(input_parcel->readInt32());
   auto device = static_cast<hwc2_device_t *>(this);
+  if (display >= HWC_NUM_DISPLAY_TYPES) {
+    return -EINVAL;
+  }
+
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[display]);
   auto err = CallDisplayFunction(device, display, &HWCDisplay::SetColorMode, mode);
   if (err != HWC2_ERROR_NONE)
     return -EINVAL;
@@ -1280,9 +1385,12 @@ android::status_t HWCSession::QdcmCMDHandler(const android::Parcel *input_parcel
       ret = hwc_display_[HWC_DISPLAY_PRIMARY]->ColorSVCRequestRoute(req_payload, &resp_payload,
                                                                     &pending_action);
 
-    if (HWC_DISPLAY_EXTERNAL == display_id && hwc_display_[HWC_DISPLAY_EXTERNAL])
-      ret = hwc_display_[HWC_DISPLAY_EXTERNAL]->ColorSVCRequestRoute(req_payload, &resp_payload,
-                                                                     &pending_action);
+    if (HWC_DISPLAY_EXTERNAL == display_id) {
+      SEQUENCE_WAIT_SCOPE_LOCK(locker_[HWC_DISPLAY_EXTERNAL]);
+      if (hwc_display_[HWC_DISPLAY_EXTERNAL])
+        ret = hwc_display_[HWC_DISPLAY_EXTERNAL]->ColorSVCRequestRoute(req_payload, &resp_payload,
+                                                                       &pending_action);
+    }
   }
 
   if (ret) {
@@ -1366,6 +1474,7 @@ android::status_t HWCSession::OnMinHdcpEncryptionLevelChange(const android::Parc
   } else if (!hwc_display_[display_id]) {
     DLOGW("Display is not connected");
   } else {
+    SEQUENCE_WAIT_SCOPE_LOCK(locker_[display_id]);
     ret = hwc_display_[display_id]->OnMinHdcpEncryptionLevelChange(min_enc_level);
   }
 
@@ -1465,7 +1574,9 @@ int HWCSession::HotPlugHandler(bool connected) {
   // To prevent sending events to client while a lock is held, acquire scope locks only within
   // below scope so that those get automatically unlocked after the scope ends.
   {
-    SEQUENCE_WAIT_SCOPE_LOCK(locker_);
+    Locker::SequenceWaitScopeLock primary_lock(locker_[HWC_DISPLAY_PRIMARY]);
+    Locker::SequenceWaitScopeLock external_lock(locker_[HWC_DISPLAY_EXTERNAL]);
+    Locker::SequenceWaitScopeLock virtual_lock(locker_[HWC_DISPLAY_VIRTUAL]);
 
     if (!hwc_display_[HWC_DISPLAY_PRIMARY]) {
       DLOGE("Primary display is not connected.");
@@ -1547,11 +1658,17 @@ int HWCSession::HotPlugHandler(bool connected) {
 }
 
 int HWCSession::GetVsyncPeriod(int disp) {
-  SCOPE_LOCK(locker_);
   // default value
   int32_t vsync_period = 1000000000l / 60;
   auto attribute = HWC2::Attribute::VsyncPeriod;
 
+  if (disp < 0 || disp >= HWC_NUM_DISPLAY_TYPES) {
+    DLOGE("Invalid display = %d", disp);
+    return vsync_period;
+  }
+
+  SCOPE_LOCK(locker_[disp]);
+
   if (hwc_display_[disp]) {
     hwc_display_[disp]->GetDisplayAttribute(0, attribute, &vsync_period);
   }
@@ -1567,6 +1684,7 @@ android::status_t HWCSession::GetVisibleDisplayRect(const android::Parcel *input
     return android::BAD_VALUE;
   }
 
+  SEQUENCE_WAIT_SCOPE_LOCK(locker_[dpy]);
   if (!hwc_display_[dpy]) {
     return android::NO_INIT;
   }
@@ -164,11 +164,18 @@ class HWCSession : hwc2_device_t, public qClient::BnQClient {
                                           android::Parcel *output_parcel);
   android::status_t GetBWTransactionStatus(const android::Parcel *input_parcel,
                                            android::Parcel *output_parcel);
+  android::status_t GetFrameTiming(const android::Parcel *input_parcel,
+                                   android::Parcel *output_parcel);
   android::status_t SetMixerResolution(const android::Parcel *input_parcel);
 
   android::status_t SetColorModeOverride(const android::Parcel *input_parcel);
+  android::status_t HandlePrimaryDisplayCommand(uint32_t command,
+                                                const android::Parcel *input_parcel,
+                                                android::Parcel *output_parcel);
 
-  static Locker locker_;
+  // One lock per display, so that displays validate and present independent of each other.
+  // Whenever more than one of these is held, they are acquired in increasing display order.
+  static Locker locker_[HWC_NUM_DISPLAY_TYPES];
   CoreInterface *core_intf_ = NULL;
   HWCDisplay *hwc_display_[HWC_NUM_DISPLAY_TYPES] = {NULL};
   HWCCallbacks callbacks_;
@@ -8,8 +8,11 @@ LOCAL_C_INCLUDES              := $(common_includes)
 LOCAL_CFLAGS                  := -DLOG_TAG=\"SDM\" $(common_flags)
 LOCAL_SRC_FILES               := debug.cpp \
                                  rect.cpp \
+                                 region.cpp \
                                  sys.cpp \
-                                 formats.cpp
+                                 formats.cpp \
+                                 layer_trace.cpp \
+                                 frame_timing.cpp
 
 include $(BUILD_SHARED_LIBRARY)
 
@@ -19,7 +22,10 @@ LOCAL_COPY_HEADERS_TO         := $(common_header_export_path)/sdm/utils
 LOCAL_COPY_HEADERS             = $(SDM_HEADER_PATH)/utils/constants.h \
                                  $(SDM_HEADER_PATH)/utils/debug.h \
                                  $(SDM_HEADER_PATH)/utils/formats.h \
+                                 $(SDM_HEADER_PATH)/utils/frame_timing.h \
+                                 $(SDM_HEADER_PATH)/utils/layer_trace.h \
                                  $(SDM_HEADER_PATH)/utils/locker.h \
                                  $(SDM_HEADER_PATH)/utils/rect.h \
+                                 $(SDM_HEADER_PATH)/utils/region.h \
                                  $(SDM_HEADER_PATH)/utils/sys.h
 include $(BUILD_COPY_HEADERS)
\ No newline at end of file
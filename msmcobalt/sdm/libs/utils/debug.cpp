@@ -161,6 +161,20 @@ bool Debug::IsExtAnimDisabled() {
   return (value == 1);
 }
 
+bool Debug::IsCompositionCacheDisabled() {
+  int value = 0;
+  debug_.debug_handler_->GetProperty("sdm.debug.disable_comp_cache", &value);
+
+  return (value == 1);
+}
+
+bool Debug::IsValidateReuseEnabled() {
+  int value = 0;
+  debug_.debug_handler_->GetProperty("sdm.validate_reuse", &value);
+
+  return (value == 1);
+}
+
 bool Debug::GetProperty(const char* property_name, char* value) {
   if (debug_.debug_handler_->GetProperty(property_name, value) != kErrorNone) {
     return false;
@@ -0,0 +1,160 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <utils/constants.h>
+#include <utils/frame_timing.h>
+
+namespace sdm {
+
+FrameTiming::Histogram FrameTiming::histograms_[FrameTiming::kMaxDisplays][kFrameTimingMax];
+
+static const char *GetStageName(uint32_t stage) {
+  switch (stage) {
+  case kFrameTimingBuildLayerStack:   return "build_layer_stack";
+  case kFrameTimingPrepare:           return "prepare";
+  case kFrameTimingStrategy:          return "strategy";
+  case kFrameTimingStrategyAttempts:  return "strategy_attempts";
+  case kFrameTimingRotatorPrepare:    return "rotator_prepare";
+  case kFrameTimingValidate:          return "validate";
+  case kFrameTimingCommit:            return "commit";
+  case kFrameTimingFenceDup:          return "fence_dup";
+  case kFrameTimingPostCommit:        return "post_commit";
+  default:                            return "unknown";
+  }
+}
+
+void FrameTiming::Record(uint32_t display, FrameTimingStage stage, uint64_t value) {
+  if (display >= kMaxDisplays || stage >= kFrameTimingMax) {
+    return;
+  }
+
+  Histogram &histogram = histograms_[display][stage];
+  histogram.buckets[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+  histogram.count.fetch_add(1, std::memory_order_relaxed);
+  histogram.sum.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t max = histogram.max.load(std::memory_order_relaxed);
+  while (value > max &&
+         !histogram.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) { }
+}
+
+void FrameTiming::Reset() {
+  for (uint32_t display = 0; display < kMaxDisplays; display++) {
+    for (uint32_t stage = 0; stage < kFrameTimingMax; stage++) {
+      Histogram &histogram = histograms_[display][stage];
+      for (uint32_t i = 0; i < kNumBuckets; i++) {
+        histogram.buckets[i].store(0, std::memory_order_relaxed);
+      }
+      histogram.count.store(0, std::memory_order_relaxed);
+      histogram.sum.store(0, std::memory_order_relaxed);
+      histogram.max.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+// A value with its highest set bit at msb >= kSubBucketBits lands in the sub-bucket picked by the
+// kSubBucketBits bits below msb. Smaller values are their own bucket.
+uint32_t FrameTiming::GetBucket(uint64_t value) {
+  if (value < kSubBuckets) {
+    return UINT32(value);
+  }
+
+  uint32_t msb = UINT32(63 - __builtin_clzll(value));
+  if (msb >= kMaxValueBits) {
+    return kNumBuckets - 1;
+  }
+
+  uint32_t shift = msb - kSubBucketBits;
+  return ((shift + 1) << kSubBucketBits) + UINT32((value >> shift) & (kSubBuckets - 1));
+}
+
+uint64_t FrameTiming::GetBucketUpperBound(uint32_t bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+
+  uint32_t shift = (bucket >> kSubBucketBits) - 1;
+  uint64_t sub_bucket = bucket & (kSubBuckets - 1);
+  return ((kSubBuckets + sub_bucket + 1) << shift) - 1;
+}
+
+// Returns the upper bound of the bucket which holds the requested percentile.
+uint64_t FrameTiming::GetPercentile(const uint64_t *buckets, uint64_t count, uint32_t percent) {
+  uint64_t target = (count * percent + 99) / 100;
+  uint64_t accumulated = 0;
+
+  for (uint32_t i = 0; i < kNumBuckets; i++) {
+    accumulated += buckets[i];
+    if (accumulated >= target) {
+      return GetBucketUpperBound(i);
+    }
+  }
+
+  return GetBucketUpperBound(kNumBuckets - 1);
+}
+
+void FrameTiming::GetDump(char *buffer, uint32_t length) {
+  if (!buffer || !length) {
+    return;
+  }
+
+  uint32_t filled = 0;
+  buffer[0] = '\0';
+
+  for (uint32_t display = 0; display < kMaxDisplays; display++) {
+    for (uint32_t stage = 0; stage < kFrameTimingMax && filled < length; stage++) {
+      Histogram &histogram = histograms_[display][stage];
+      uint64_t buckets[kNumBuckets];
+      uint64_t count = 0;
+
+      // Take a snapshot so that the percentiles are consistent with the count they are based on.
+      for (uint32_t i = 0; i < kNumBuckets; i++) {
+        buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+        count += buckets[i];
+      }
+      if (!count) {
+        continue;
+      }
+
+      const char *unit = (stage == kFrameTimingStrategyAttempts) ? "" : "us";
+      int written = snprintf(buffer + filled, length - filled,
+                             "display %u %-18s count %-8" PRIu64 " avg %" PRIu64 "%s"
+                             " p50 <=%" PRIu64 "%s p99 <=%" PRIu64 "%s max %" PRIu64 "%s\n",
+                             display, GetStageName(stage), count,
+                             histogram.sum.load(std::memory_order_relaxed) / count, unit,
+                             GetPercentile(buckets, count, 50), unit,
+                             GetPercentile(buckets, count, 99), unit,
+                             histogram.max.load(std::memory_order_relaxed), unit);
+      if (written < 0) {
+        return;
+      }
+      filled += UINT32(written);
+    }
+  }
+}
+
+}  // namespace sdm
+
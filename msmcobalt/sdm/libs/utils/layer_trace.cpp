@@ -0,0 +1,291 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <utils/constants.h>
+#include <utils/debug.h>
+#include <utils/layer_trace.h>
+#include <utils/rect.h>
+#include <algorithm>
+
+#define __CLASS__ "LayerTrace"
+
+namespace sdm {
+
+static const uint32_t kLayerTraceMagic = 0x544d4453;  // "SDMT"
+static const uint32_t kLayerTraceVersion = 1;
+
+static uint64_t GetTimeNs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UINT64(ts.tv_sec) * 1000000000ULL) + UINT64(ts.tv_nsec);
+}
+
+static bool WriteAt(int fd, const void *data, size_t size, off_t offset) {
+  return (pwrite(fd, data, size, offset) == static_cast<ssize_t>(size));
+}
+
+static bool ReadAt(int fd, void *data, size_t size, off_t offset) {
+  return (pread(fd, data, size, offset) == static_cast<ssize_t>(size));
+}
+
+DisplayError LayerTraceWriter::Init(const char *path, uint32_t max_frames) {
+  Deinit();
+
+  if (!max_frames) {
+    return kErrorParameters;
+  }
+
+  fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    DLOGW("Failed to open %s", path);
+    return kErrorFileDescriptor;
+  }
+
+  header_ = LayerTraceHeader();
+  header_.magic = kLayerTraceMagic;
+  header_.version = kLayerTraceVersion;
+  header_.max_frames = max_frames;
+  header_.slot_size = UINT32(sizeof(LayerTraceFrameRecord) +
+                             kMaxLayers * sizeof(LayerTraceLayerRecord));
+  if (!WriteAt(fd_, &header_, sizeof(header_), 0)) {
+    Deinit();
+    return kErrorUndefined;
+  }
+
+  frame_ = LayerTraceFrameRecord();
+  layers_.resize(kMaxLayers);
+  DLOGI("Tracing %d frames to %s", max_frames, path);
+
+  return kErrorNone;
+}
+
+void LayerTraceWriter::Deinit() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+void LayerTraceWriter::MarkStage(LayerTraceStage stage, DisplayError error) {
+  if (fd_ < 0) {
+    return;
+  }
+
+  frame_.timestamp_ns[stage] = GetTimeNs();
+  frame_.error[stage] = error;
+}
+
+DisplayError LayerTraceWriter::Write(const LayerStack &layer_stack) {
+  if (fd_ < 0) {
+    return kErrorNotSupported;
+  }
+
+  uint32_t layer_count = std::min(UINT32(layer_stack.layers.size()), UINT32(kMaxLayers));
+  frame_.frame_index = header_.frame_count;
+  frame_.stack_flags = layer_stack.flags.flags;
+  frame_.layer_count = layer_count;
+  frame_.has_output_buffer = (layer_stack.output_buffer != NULL);
+  if (layer_stack.output_buffer) {
+    frame_.output_format = layer_stack.output_buffer->format;
+    frame_.output_width = layer_stack.output_buffer->width;
+    frame_.output_height = layer_stack.output_buffer->height;
+  }
+
+  for (uint32_t i = 0; i < layer_count; i++) {
+    const Layer &layer = *layer_stack.layers.at(i);
+    LayerTraceLayerRecord &record = layers_.at(i);
+    const uint32_t max_dirty_rects = UINT32(sizeof(record.dirty_rects) / sizeof(LayerRect));
+
+    record = LayerTraceLayerRecord();
+    record.src_rect = layer.src_rect;
+    record.dst_rect = layer.dst_rect;
+    record.dirty_count = std::min(UINT32(layer.dirty_regions.size()), max_dirty_rects);
+    for (uint32_t j = 0; j < layer.dirty_regions.size(); j++) {
+      uint32_t slot = std::min(j, max_dirty_rects - 1);
+      record.dirty_rects[slot] = Union(record.dirty_rects[slot], layer.dirty_regions.at(j));
+    }
+    record.visible_count = UINT32(layer.visible_regions.size());
+    record.composition = layer.composition;
+    record.blending = layer.blending;
+    record.rotation = layer.transform.rotation;
+    record.flip_flags = (layer.transform.flip_horizontal ? 0x1 : 0) |
+                        (layer.transform.flip_vertical ? 0x2 : 0);
+    record.layer_flags = layer.flags.flags;
+    record.plane_alpha = layer.plane_alpha;
+    record.frame_rate = layer.frame_rate;
+    record.solid_fill_color = layer.solid_fill_color;
+
+    const LayerBuffer *buffer = layer.input_buffer;
+    record.has_buffer = (buffer != NULL);
+    if (buffer) {
+      record.width = buffer->width;
+      record.height = buffer->height;
+      record.unaligned_width = buffer->unaligned_width;
+      record.unaligned_height = buffer->unaligned_height;
+      record.format = buffer->format;
+      record.csc = buffer->csc;
+      record.igc = buffer->igc;
+      record.buffer_flags = buffer->flags.flags;
+      record.s3d_format = buffer->s3d_format;
+      record.buffer_id = buffer->buffer_id;
+    }
+  }
+
+  // Layer records are written ahead of the frame record, so that a reader never finds a frame
+  // record pointing to stale layer records.
+  off_t offset = static_cast<off_t>(sizeof(header_) + (header_.frame_count % header_.max_frames) *
+                                    header_.slot_size);
+  size_t layers_size = layer_count * sizeof(LayerTraceLayerRecord);
+  bool written = WriteAt(fd_, layers_.data(), layers_size,
+                         offset + static_cast<off_t>(sizeof(frame_))) &&
+                 WriteAt(fd_, &frame_, sizeof(frame_), offset);
+
+  header_.frame_count++;
+  written = written && WriteAt(fd_, &header_, sizeof(header_), 0);
+  frame_ = LayerTraceFrameRecord();
+
+  if (!written) {
+    DLOGW("Failed to write frame, tracing stopped");
+    Deinit();
+    return kErrorUndefined;
+  }
+
+  return kErrorNone;
+}
+
+DisplayError LayerTraceReader::Open(const char *path) {
+  Close();
+
+  fd_ = open(path, O_RDONLY);
+  if (fd_ < 0) {
+    DLOGE("Failed to open %s", path);
+    return kErrorFileDescriptor;
+  }
+
+  if (!ReadAt(fd_, &header_, sizeof(header_), 0) || header_.magic != kLayerTraceMagic ||
+      header_.version != kLayerTraceVersion || !header_.max_frames ||
+      header_.slot_size < sizeof(LayerTraceFrameRecord)) {
+    DLOGE("%s is not a valid layer trace", path);
+    Close();
+    return kErrorParameters;
+  }
+
+  return kErrorNone;
+}
+
+void LayerTraceReader::Close() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  header_ = LayerTraceHeader();
+}
+
+uint32_t LayerTraceReader::GetFrameCount() {
+  return UINT32(std::min(header_.frame_count, UINT64(header_.max_frames)));
+}
+
+DisplayError LayerTraceReader::ReadFrame(uint32_t index, LayerTraceFrame *frame) {
+  if (fd_ < 0 || index >= GetFrameCount()) {
+    return kErrorParameters;
+  }
+
+  uint64_t first = header_.frame_count - GetFrameCount();
+  off_t offset = static_cast<off_t>(sizeof(header_) + ((first + index) % header_.max_frames) *
+                                    header_.slot_size);
+  LayerTraceFrameRecord &record = frame->record;
+  if (!ReadAt(fd_, &record, sizeof(record), offset) ||
+      (sizeof(record) + record.layer_count * sizeof(LayerTraceLayerRecord)) > header_.slot_size) {
+    return kErrorUndefined;
+  }
+
+  std::vector<LayerTraceLayerRecord> records(record.layer_count);
+  if (!ReadAt(fd_, records.data(), records.size() * sizeof(LayerTraceLayerRecord),
+              offset + static_cast<off_t>(sizeof(record)))) {
+    return kErrorUndefined;
+  }
+
+  // Vectors are sized upfront, layer stack keeps pointers to their elements.
+  frame->layers.assign(record.layer_count, Layer());
+  frame->buffers.assign(record.layer_count, LayerBuffer());
+  frame->compositions.resize(record.layer_count);
+  frame->layer_stack = LayerStack();
+  frame->layer_stack.flags.flags = record.stack_flags;
+
+  frame->output_buffer = LayerBuffer();
+  if (record.has_output_buffer) {
+    frame->output_buffer.format = static_cast<LayerBufferFormat>(record.output_format);
+    frame->output_buffer.width = record.output_width;
+    frame->output_buffer.height = record.output_height;
+    frame->output_buffer.unaligned_width = record.output_width;
+    frame->output_buffer.unaligned_height = record.output_height;
+    frame->layer_stack.output_buffer = &frame->output_buffer;
+  }
+
+  for (uint32_t i = 0; i < record.layer_count; i++) {
+    const LayerTraceLayerRecord &layer_record = records.at(i);
+    Layer &layer = frame->layers.at(i);
+    LayerBuffer &buffer = frame->buffers.at(i);
+
+    layer.src_rect = layer_record.src_rect;
+    layer.dst_rect = layer_record.dst_rect;
+    for (uint32_t j = 0; j < layer_record.dirty_count; j++) {
+      layer.dirty_regions.push_back(layer_record.dirty_rects[j]);
+    }
+    // Visible region is not traced; the display frame is the best approximation.
+    layer.visible_regions.assign(layer_record.visible_count, layer_record.dst_rect);
+    layer.composition = static_cast<LayerComposition>(layer_record.composition);
+    layer.blending = static_cast<LayerBlending>(layer_record.blending);
+    layer.transform.rotation = layer_record.rotation;
+    layer.transform.flip_horizontal = (layer_record.flip_flags & 0x1);
+    layer.transform.flip_vertical = (layer_record.flip_flags & 0x2);
+    layer.flags.flags = layer_record.layer_flags;
+    layer.plane_alpha = UINT8(layer_record.plane_alpha);
+    layer.frame_rate = layer_record.frame_rate;
+    layer.solid_fill_color = layer_record.solid_fill_color;
+
+    buffer.width = layer_record.width;
+    buffer.height = layer_record.height;
+    buffer.unaligned_width = layer_record.unaligned_width;
+    buffer.unaligned_height = layer_record.unaligned_height;
+    buffer.format = static_cast<LayerBufferFormat>(layer_record.format);
+    buffer.csc = static_cast<LayerCSC>(layer_record.csc);
+    buffer.igc = static_cast<LayerIGC>(layer_record.igc);
+    buffer.flags.flags = layer_record.buffer_flags;
+    buffer.s3d_format = static_cast<LayerBufferS3DFormat>(layer_record.s3d_format);
+    buffer.buffer_id = layer_record.buffer_id;
+    layer.input_buffer = &buffer;
+
+    frame->compositions.at(i) = layer.composition;
+    frame->layer_stack.layers.push_back(&layer);
+  }
+
+  return kErrorNone;
+}
+
+}  // namespace sdm
+
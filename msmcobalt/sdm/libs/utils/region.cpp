@@ -0,0 +1,298 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <math.h>
+#include <utils/constants.h>
+#include <utils/rect.h>
+#include <utils/region.h>
+#include <algorithm>
+#include <vector>
+
+#define __CLASS__ "Region"
+
+namespace sdm {
+
+Region::Region(const LayerRect &rect) {
+  if (IsValid(rect)) {
+    rects_.push_back(RegionRect(INT32(floorf(rect.left)), INT32(floorf(rect.top)),
+                                INT32(ceilf(rect.right)), INT32(ceilf(rect.bottom))));
+  }
+}
+
+Region::Region(const LayerRectArray &rect_array) {
+  for (uint32_t i = 0; i < rect_array.count; i++) {
+    Union(rect_array.rect[i]);
+  }
+}
+
+void Region::GetLayerRects(std::vector<LayerRect> *rects) const {
+  rects->clear();
+  for (const RegionRect &rect : rects_) {
+    rects->push_back(LayerRect(FLOAT(rect.left), FLOAT(rect.top), FLOAT(rect.right),
+                               FLOAT(rect.bottom)));
+  }
+}
+
+LayerRect Region::GetBounds() const {
+  if (rects_.empty()) {
+    return LayerRect();
+  }
+
+  int32_t left = rects_.front().left;
+  int32_t right = rects_.front().right;
+  for (const RegionRect &rect : rects_) {
+    left = std::min(left, rect.left);
+    right = std::max(right, rect.right);
+  }
+
+  return LayerRect(FLOAT(left), FLOAT(rects_.front().top), FLOAT(right),
+                   FLOAT(rects_.back().bottom));
+}
+
+uint64_t Region::GetArea() const {
+  uint64_t area = 0;
+
+  for (const RegionRect &rect : rects_) {
+    area += UINT64(rect.right - rect.left) * UINT64(rect.bottom - rect.top);
+  }
+
+  return area;
+}
+
+void Region::Union(const Region &region) {
+  if (region.rects_.empty()) {
+    return;
+  }
+
+  if (rects_.empty()) {
+    rects_ = region.rects_;
+    return;
+  }
+
+  Combine(*this, region, kOperationUnion, this);
+}
+
+void Region::Intersect(const Region &region) {
+  if (rects_.empty() || region.rects_.empty()) {
+    rects_.clear();
+    return;
+  }
+
+  Combine(*this, region, kOperationIntersect, this);
+}
+
+void Region::Subtract(const Region &region) {
+  if (rects_.empty() || region.rects_.empty()) {
+    return;
+  }
+
+  Combine(*this, region, kOperationSubtract, this);
+}
+
+void Region::Translate(int32_t x_offset, int32_t y_offset) {
+  // Offsets keep the bands intact.
+  for (RegionRect &rect : rects_) {
+    rect.left += x_offset;
+    rect.top += y_offset;
+    rect.right += x_offset;
+    rect.bottom += y_offset;
+  }
+}
+
+void Region::Transform(const LayerTransform &transform, int32_t width, int32_t height) {
+  bool rotate90 = (transform.rotation == 90.0f);
+  if (!rotate90 && !transform.flip_horizontal && !transform.flip_vertical) {
+    return;
+  }
+
+  // Mapped rects no longer form bands in order, so the region is built again from them.
+  std::vector<RegionRect> rects;
+  rects.swap(rects_);
+
+  for (const RegionRect &rect : rects) {
+    RegionRect mapped = rect;
+    if (transform.flip_horizontal) {
+      mapped.left = width - rect.right;
+      mapped.right = width - rect.left;
+    }
+    if (transform.flip_vertical) {
+      mapped.top = height - rect.bottom;
+      mapped.bottom = height - rect.top;
+    }
+    if (rotate90) {
+      mapped = RegionRect(height - mapped.bottom, mapped.left, height - mapped.top, mapped.right);
+    }
+
+    Region region;
+    region.rects_.push_back(mapped);
+    Union(region);
+  }
+}
+
+bool Region::IsInside(Operation operation, bool in_first, bool in_second) {
+  switch (operation) {
+  case kOperationUnion:
+    return (in_first || in_second);
+  case kOperationIntersect:
+    return (in_first && in_second);
+  case kOperationSubtract:
+    return (in_first && !in_second);
+  }
+
+  return false;
+}
+
+uint32_t Region::GetBandEnd(const std::vector<RegionRect> &rects, uint32_t band_begin) {
+  uint32_t band_end = band_begin + 1;
+  while (band_end < rects.size() && rects[band_end].top == rects[band_begin].top) {
+    band_end++;
+  }
+
+  return band_end;
+}
+
+// Merges the band starting at band_begin, the last one of rects, into the band before it if both
+// have the same spans and touch. Returns the begin of the band which is now the last one.
+uint32_t Region::CoalesceBand(std::vector<RegionRect> *rects, uint32_t last_band,
+                              uint32_t band_begin) {
+  uint32_t band_size = UINT32(rects->size()) - band_begin;
+  if (band_begin == last_band || (band_begin - last_band) != band_size) {
+    return band_begin;
+  }
+
+  RegionRect *previous = rects->data() + last_band;
+  RegionRect *current = rects->data() + band_begin;
+  if (previous[0].bottom != current[0].top) {
+    return band_begin;
+  }
+
+  for (uint32_t i = 0; i < band_size; i++) {
+    if (previous[i].left != current[i].left || previous[i].right != current[i].right) {
+      return band_begin;
+    }
+  }
+
+  for (uint32_t i = 0; i < band_size; i++) {
+    previous[i].bottom = current[i].bottom;
+  }
+  rects->resize(band_begin);
+
+  return last_band;
+}
+
+// Appends the spans of one strip [top, bottom), given the spans of both regions in it.
+void Region::CombineSpans(const RegionRect *first, uint32_t first_count,
+                          const RegionRect *second, uint32_t second_count, Operation operation,
+                          int32_t top, int32_t bottom, std::vector<RegionRect> *rects) {
+  size_t band_begin = rects->size();
+  uint32_t i = 0;
+  uint32_t j = 0;
+  int32_t x = INT32_MIN;
+
+  // Sweeps left to right from one span edge of either region to the next.
+  while (i < first_count || j < second_count) {
+    int32_t first_left = (i < first_count) ? first[i].left : INT32_MAX;
+    int32_t second_left = (j < second_count) ? second[j].left : INT32_MAX;
+    int32_t left = std::max(x, std::min(first_left, second_left));
+    bool in_first = (first_left <= left);
+    bool in_second = (second_left <= left);
+
+    int32_t right = std::min(in_first ? first[i].right : first_left,
+                             in_second ? second[j].right : second_left);
+
+    if (IsInside(operation, in_first, in_second)) {
+      if (rects->size() > band_begin && rects->back().right == left) {
+        rects->back().right = right;
+      } else {
+        rects->push_back(RegionRect(left, top, right, bottom));
+      }
+    }
+
+    x = right;
+    if (in_first && first[i].right == right) {
+      i++;
+    }
+    if (in_second && second[j].right == right) {
+      j++;
+    }
+  }
+}
+
+void Region::Combine(const Region &first, const Region &second, Operation operation,
+                     Region *result) {
+  const std::vector<RegionRect> &first_rects = first.rects_;
+  const std::vector<RegionRect> &second_rects = second.rects_;
+  uint32_t first_size = UINT32(first_rects.size());
+  uint32_t second_size = UINT32(second_rects.size());
+  std::vector<RegionRect> rects;
+  uint32_t i = 0;
+  uint32_t j = 0;
+  uint32_t last_band = 0;
+  int32_t y = INT32_MIN;
+
+  rects.reserve(first_size + second_size);
+
+  // Sweeps top to bottom from one band edge of either region to the next. Each strip in between
+  // is covered by at most one band of each region.
+  while (i < first_size || j < second_size) {
+    if ((operation == kOperationIntersect && (i == first_size || j == second_size)) ||
+        (operation == kOperationSubtract && i == first_size)) {
+      break;
+    }
+
+    int32_t first_top = (i < first_size) ? first_rects[i].top : INT32_MAX;
+    int32_t second_top = (j < second_size) ? second_rects[j].top : INT32_MAX;
+    int32_t top = std::max(y, std::min(first_top, second_top));
+    bool in_first = (first_top <= top);
+    bool in_second = (second_top <= top);
+
+    int32_t bottom = std::min(in_first ? first_rects[i].bottom : first_top,
+                              in_second ? second_rects[j].bottom : second_top);
+    uint32_t first_end = in_first ? GetBandEnd(first_rects, i) : i;
+    uint32_t second_end = in_second ? GetBandEnd(second_rects, j) : j;
+
+    if ((operation == kOperationUnion) || (in_first && (operation == kOperationSubtract ||
+                                                       in_second))) {
+      uint32_t band_begin = UINT32(rects.size());
+      CombineSpans(first_rects.data() + i, first_end - i, second_rects.data() + j,
+                   second_end - j, operation, top, bottom, &rects);
+      if (rects.size() > band_begin) {
+        last_band = CoalesceBand(&rects, last_band, band_begin);
+      }
+    }
+
+    y = bottom;
+    if (in_first && first_rects[i].bottom == bottom) {
+      i = first_end;
+    }
+    if (in_second && second_rects[j].bottom == bottom) {
+      j = second_end;
+    }
+  }
+
+  result->rects_.swap(rects);
+}
+
+}  // namespace sdm
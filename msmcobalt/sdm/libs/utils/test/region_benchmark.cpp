@@ -0,0 +1,148 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Measures Region operations on dirty region shaped inputs, i.e. a few scattered rects per layer
+// on a 1080x1920 screen, and compares union with the bounding box union of rect.h.
+//
+// usage: region_benchmark [<iterations>] [<rects per region>]
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <utils/constants.h>
+#include <utils/rect.h>
+#include <utils/region.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace sdm;  // NOLINT
+
+static const uint32_t kRegionCount = 64;
+
+static uint64_t GetTimeNs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UINT64(ts.tv_sec) * 1000000000ULL) + UINT64(ts.tv_nsec);
+}
+
+static std::vector<LayerRect> GetRandomRects(std::mt19937 *engine, uint32_t count) {
+  std::uniform_int_distribution<int32_t> x_distribution(0, 1000);
+  std::uniform_int_distribution<int32_t> y_distribution(0, 1800);
+  std::uniform_int_distribution<int32_t> size_distribution(16, 400);
+  std::vector<LayerRect> rects;
+
+  for (uint32_t i = 0; i < count; i++) {
+    float left = FLOAT(x_distribution(*engine));
+    float top = FLOAT(y_distribution(*engine));
+    float right = std::min(left + FLOAT(size_distribution(*engine)), 1080.0f);
+    float bottom = std::min(top + FLOAT(size_distribution(*engine)), 1920.0f);
+    rects.push_back(LayerRect(left, top, right, bottom));
+  }
+
+  return rects;
+}
+
+static void Report(const char *operation, uint64_t elapsed_ns, uint32_t operations,
+                   uint64_t checksum) {
+  printf("%-18s %8.1f ns/op  (checksum %" PRIu64 ")\n", operation,
+         FLOAT(elapsed_ns) / FLOAT(operations), checksum);
+}
+
+int main(int argc, char **argv) {
+  uint32_t iterations = (argc > 1) ? UINT32(strtoul(argv[1], NULL, 0)) : 20000;
+  uint32_t rect_count = (argc > 2) ? UINT32(strtoul(argv[2], NULL, 0)) : 4;
+  std::mt19937 engine(1);
+
+  std::vector<std::vector<LayerRect>> inputs;
+  std::vector<Region> regions;
+  for (uint32_t i = 0; i < kRegionCount; i++) {
+    inputs.push_back(GetRandomRects(&engine, rect_count));
+    Region region;
+    for (const LayerRect &rect : inputs.back()) {
+      region.Union(rect);
+    }
+    regions.push_back(region);
+  }
+
+  uint32_t operations = iterations * kRegionCount;
+  uint64_t checksum = 0;
+  uint64_t start = GetTimeNs();
+  for (uint32_t i = 0; i < iterations; i++) {
+    for (uint32_t j = 0; j < kRegionCount; j++) {
+      LayerRect bounds;
+      for (const LayerRect &rect : inputs.at(j)) {
+        bounds = Union(bounds, rect);
+      }
+      checksum += UINT64(bounds.right - bounds.left);
+    }
+  }
+  Report("bounding box union", GetTimeNs() - start, operations, checksum);
+
+  checksum = 0;
+  start = GetTimeNs();
+  for (uint32_t i = 0; i < iterations; i++) {
+    for (uint32_t j = 0; j < kRegionCount; j++) {
+      Region region;
+      for (const LayerRect &rect : inputs.at(j)) {
+        region.Union(rect);
+      }
+      checksum += region.GetCount();
+    }
+  }
+  Report("region build", GetTimeNs() - start, operations, checksum);
+
+  const char *names[] = { "region union", "region intersect", "region subtract" };
+  for (uint32_t operation = 0; operation < 3; operation++) {
+    checksum = 0;
+    start = GetTimeNs();
+    for (uint32_t i = 0; i < iterations; i++) {
+      for (uint32_t j = 0; j < kRegionCount; j++) {
+        Region region = regions.at(j);
+        const Region &other = regions.at((j + 1) % kRegionCount);
+        if (operation == 0) {
+          region.Union(other);
+        } else if (operation == 1) {
+          region.Intersect(other);
+        } else {
+          region.Subtract(other);
+        }
+        checksum += region.GetCount();
+      }
+    }
+    Report(names[operation], GetTimeNs() - start, operations, checksum);
+  }
+
+  checksum = 0;
+  start = GetTimeNs();
+  for (uint32_t i = 0; i < iterations; i++) {
+    for (uint32_t j = 0; j < kRegionCount; j++) {
+      checksum += regions.at(j).GetArea();
+    }
+  }
+  Report("region area", GetTimeNs() - start, operations, checksum);
+
+  return 0;
+}
@@ -0,0 +1,277 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Checks Region operations pixel by pixel against bitmaps of randomly generated regions, and
+// checks that every result is in the canonical banded form.
+//
+// usage: region_test [<cases>] [<seed>]
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utils/constants.h>
+#include <utils/region.h>
+#include <algorithm>
+#include <bitset>
+#include <random>
+
+using namespace sdm;  // NOLINT
+
+// Regions are generated within kDomain x kDomain pixels. Bitmaps have a margin around the domain,
+// so that translated regions and rects out of the domain are still caught.
+static const int32_t kDomain = 32;
+static const int32_t kMaxOffset = 8;
+static const int32_t kMapSize = kDomain + 2 * kMaxOffset;
+
+typedef std::bitset<kMapSize * kMapSize> Bitmap;
+
+static std::mt19937 random_engine;
+
+static int32_t GetRandom(int32_t min, int32_t max) {
+  return std::uniform_int_distribution<int32_t>(min, max)(random_engine);
+}
+
+static void SetPixel(int32_t x, int32_t y, Bitmap *bitmap) {
+  bitmap->set(UINT32((y + kMaxOffset) * kMapSize + (x + kMaxOffset)));
+}
+
+static bool GetPixel(const Bitmap &bitmap, int32_t x, int32_t y) {
+  return bitmap.test(UINT32((y + kMaxOffset) * kMapSize + (x + kMaxOffset)));
+}
+
+// Fractional coordinates now and then, to cover growing rects to whole pixels.
+static LayerRect GetRandomRect() {
+  LayerRect rect;
+  rect.left = FLOAT(GetRandom(0, kDomain - 1));
+  rect.top = FLOAT(GetRandom(0, kDomain - 1));
+  rect.right = FLOAT(GetRandom(INT32(rect.left), kDomain));
+  rect.bottom = FLOAT(GetRandom(INT32(rect.top), kDomain));
+  if (GetRandom(0, 3) == 0) {
+    rect.left += 0.5f;
+    rect.bottom = std::min(rect.bottom + 0.25f, FLOAT(kDomain));
+  }
+  return rect;
+}
+
+static void GetRandomRegion(Region *region, Bitmap *bitmap) {
+  region->Clear();
+  bitmap->reset();
+
+  int32_t count = GetRandom(0, 5);
+  for (int32_t i = 0; i < count; i++) {
+    LayerRect rect = GetRandomRect();
+    region->Union(rect);
+    for (int32_t y = INT32(floorf(rect.top)); y < INT32(ceilf(rect.bottom)); y++) {
+      for (int32_t x = INT32(floorf(rect.left)); x < INT32(ceilf(rect.right)); x++) {
+        SetPixel(x, y, bitmap);
+      }
+    }
+  }
+}
+
+static bool Rasterize(const Region &region, Bitmap *bitmap) {
+  bitmap->reset();
+  const RegionRect *rects = region.GetRects();
+  for (uint32_t i = 0; i < region.GetCount(); i++) {
+    const RegionRect &rect = rects[i];
+    if (rect.left < -kMaxOffset || rect.top < -kMaxOffset ||
+        rect.right > kDomain + kMaxOffset || rect.bottom > kDomain + kMaxOffset) {
+      return false;
+    }
+    for (int32_t y = rect.top; y < rect.bottom; y++) {
+      for (int32_t x = rect.left; x < rect.right; x++) {
+        SetPixel(x, y, bitmap);
+      }
+    }
+  }
+  return true;
+}
+
+// Rects are non empty, sorted into bands, neither overlap nor touch within a band, and vertically
+// adjacent bands differ in their spans.
+static bool IsCanonical(const Region &region) {
+  const RegionRect *rects = region.GetRects();
+  uint32_t count = region.GetCount();
+  uint32_t prev_band = count;
+  uint32_t band = 0;
+
+  while (band < count) {
+    uint32_t band_end = band;
+    while (band_end < count && rects[band_end].top == rects[band].top) {
+      const RegionRect &rect = rects[band_end];
+      if (rect.left >= rect.right || rect.top >= rect.bottom || rect.bottom != rects[band].bottom) {
+        return false;
+      }
+      if (band_end > band && rects[band_end - 1].right >= rect.left) {
+        return false;
+      }
+      band_end++;
+    }
+
+    if (prev_band < count) {
+      const RegionRect &prev = rects[prev_band];
+      if (prev.bottom > rects[band].top) {
+        return false;
+      }
+      if (prev.bottom == rects[band].top && (band - prev_band) == (band_end - band)) {
+        bool same_spans = true;
+        for (uint32_t i = 0; i < band_end - band; i++) {
+          same_spans &= (rects[prev_band + i].left == rects[band + i].left &&
+                         rects[prev_band + i].right == rects[band + i].right);
+        }
+        if (same_spans) {
+          return false;
+        }
+      }
+    }
+
+    prev_band = band;
+    band = band_end;
+  }
+
+  return true;
+}
+
+static bool Check(const char *operation, uint32_t test_case, const Region &region,
+                  const Bitmap &expected) {
+  Bitmap actual;
+  if (!Rasterize(region, &actual)) {
+    fprintf(stderr, "case %u: %s result out of bounds\n", test_case, operation);
+    return false;
+  }
+  if (actual != expected) {
+    Bitmap difference = actual ^ expected;
+    size_t pixel = 0;
+    while (!difference.test(pixel)) {
+      pixel++;
+    }
+    fprintf(stderr, "case %u: %s %s pixel (%d, %d)\n", test_case, operation,
+            actual.test(pixel) ? "wrongly covers" : "misses",
+            INT(pixel % kMapSize) - kMaxOffset, INT(pixel / kMapSize) - kMaxOffset);
+    return false;
+  }
+  if (region.GetArea() != expected.count()) {
+    fprintf(stderr, "case %u: %s area %" PRIu64 ", expected %zu\n", test_case, operation,
+            region.GetArea(), expected.count());
+    return false;
+  }
+  if (!IsCanonical(region)) {
+    fprintf(stderr, "case %u: %s result is not canonical\n", test_case, operation);
+    return false;
+  }
+  return true;
+}
+
+static bool TestCase(uint32_t test_case) {
+  Region first, second;
+  Bitmap first_bitmap, second_bitmap;
+  GetRandomRegion(&first, &first_bitmap);
+  GetRandomRegion(&second, &second_bitmap);
+
+  bool passed = Check("build", test_case, first, first_bitmap);
+
+  Region result = first;
+  result.Union(second);
+  passed &= Check("union", test_case, result, first_bitmap | second_bitmap);
+
+  result = first;
+  result.Intersect(second);
+  passed &= Check("intersect", test_case, result, first_bitmap & second_bitmap);
+
+  result = first;
+  result.Subtract(second);
+  passed &= Check("subtract", test_case, result, first_bitmap & ~second_bitmap);
+
+  int32_t x_offset = GetRandom(-kMaxOffset, kMaxOffset);
+  int32_t y_offset = GetRandom(-kMaxOffset, kMaxOffset);
+  Bitmap expected;
+  for (int32_t y = 0; y < kDomain; y++) {
+    for (int32_t x = 0; x < kDomain; x++) {
+      if (GetPixel(first_bitmap, x, y)) {
+        SetPixel(x + x_offset, y + y_offset, &expected);
+      }
+    }
+  }
+  result = first;
+  result.Translate(x_offset, y_offset);
+  passed &= Check("translate", test_case, result, expected);
+
+  // Non square domain, so that a rotation which mixes up width and height is caught.
+  int32_t width = GetRandom(kDomain / 2, kDomain);
+  int32_t height = kDomain;
+  LayerTransform transform;
+  transform.rotation = GetRandom(0, 1) ? 90.0f : 0.0f;
+  transform.flip_horizontal = GetRandom(0, 1);
+  transform.flip_vertical = GetRandom(0, 1);
+
+  Region clipped = first;
+  LayerRect domain(0.0f, 0.0f, FLOAT(width), FLOAT(height));
+  clipped.Intersect(domain);
+  expected.reset();
+  for (int32_t y = 0; y < height; y++) {
+    for (int32_t x = 0; x < width; x++) {
+      if (!GetPixel(first_bitmap, x, y)) {
+        continue;
+      }
+      int32_t mapped_x = transform.flip_horizontal ? (width - 1 - x) : x;
+      int32_t mapped_y = transform.flip_vertical ? (height - 1 - y) : y;
+      if (transform.rotation == 90.0f) {
+        int32_t rotated_x = height - 1 - mapped_y;
+        mapped_y = mapped_x;
+        mapped_x = rotated_x;
+      }
+      SetPixel(mapped_x, mapped_y, &expected);
+    }
+  }
+  result = clipped;
+  result.Transform(transform, width, height);
+  passed &= Check("transform", test_case, result, expected);
+
+  // Regions covering the same pixels hold the same rects, however they were built.
+  Region rebuilt = second;
+  rebuilt.Union(first);
+  result = first;
+  result.Union(second);
+  if (!result.IsCongruent(rebuilt)) {
+    fprintf(stderr, "case %u: union is not commutative\n", test_case);
+    passed = false;
+  }
+
+  return passed;
+}
+
+int main(int argc, char **argv) {
+  uint32_t cases = (argc > 1) ? UINT32(strtoul(argv[1], NULL, 0)) : 200000;
+  uint32_t seed = (argc > 2) ? UINT32(strtoul(argv[2], NULL, 0)) : 1;
+  uint32_t failures = 0;
+
+  random_engine.seed(seed);
+  for (uint32_t i = 0; i < cases && failures < 10; i++) {
+    failures += TestCase(i) ? 0 : 1;
+  }
+
+  printf("region_test: %u cases, seed %u, %u failed\n", cases, seed, failures);
+  return failures ? 1 : 0;
+}
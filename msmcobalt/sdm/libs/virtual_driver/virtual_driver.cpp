@@ -0,0 +1,767 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <linux/fb.h>
+#include <linux/msm_mdp.h>
+#include <linux/msm_mdp_ext.h>
+#include <utils/constants.h>
+#include <utils/sys.h>
+#include <algorithm>
+#include <string>
+
+#include "virtual_driver.h"
+
+namespace sdm {
+
+static const char *kFBPath = "/sys/devices/virtual/graphics/fb";
+static const char *kDevicePath = "/dev/graphics/fb";
+static const char *kBacklightPath = "/sys/class/leds/lcd-backlight/";
+static const char *kEventNodes[] = { "vsync_event", "show_blank_event", "idle_notify",
+                                     "msm_fb_thermal_level" };
+
+#define DECIMATED_DIMENSION(src, deci) (((src) + ((1U << (deci)) - 1)) >> (deci))
+
+void VirtualFStream::open(const std::string &path, std::ios_base::openmode /*mode*/) {
+  std::string content;
+
+  close();
+  is_open_ = VirtualDriver::GetInstance()->GetNodeContent(path, &content);
+  stream_.str(content);
+}
+
+void VirtualFStream::close() {
+  stream_.str("");
+  stream_.clear();
+  is_open_ = false;
+}
+
+bool VirtualFStream::getline(std::string &line) {  // NOLINT
+  return std::getline(stream_, line) ? true : false;
+}
+
+VirtualDriver *VirtualDriver::GetInstance() {
+  static VirtualDriver virtual_driver;
+
+  return &virtual_driver;
+}
+
+VirtualDriver::VirtualDriver() {
+  PopulateNodes();
+}
+
+VirtualDriver::~VirtualDriver() {
+  if (driver_thread_running_) {
+    locker_.Lock();
+    exit_threads_ = true;
+    locker_.Unlock();
+    pthread_join(driver_thread_, NULL);
+  }
+
+  for (auto &open_fd : open_fds_) {
+    ::close(open_fd.first);
+  }
+}
+
+void VirtualDriver::SetPanelConfig(const VirtualPanelConfig &panel_config) {
+  SCOPE_LOCK(locker_);
+
+  panel_config_ = panel_config;
+  PopulateNodes();
+}
+
+void VirtualDriver::NotifyIdle(int fb_node) {
+  SCOPE_LOCK(locker_);
+
+  UpdateEventNode(fb_node, "idle_notify", "idle");
+}
+
+void VirtualDriver::NotifyThermalLevel(int fb_node, int thermal_level) {
+  SCOPE_LOCK(locker_);
+
+  UpdateEventNode(fb_node, "msm_fb_thermal_level",
+                  "thermal_level=" + std::to_string(thermal_level));
+}
+
+void VirtualDriver::GetStats(VirtualDriverStats *stats) {
+  SCOPE_LOCK(locker_);
+
+  *stats = stats_;
+}
+
+std::string VirtualDriver::GetFBPath(int fb_node, const char *node_name) {
+  return kFBPath + std::to_string(fb_node) + "/" + node_name;
+}
+
+void VirtualDriver::PopulateNodes() {
+  const VirtualPanelConfig &config = panel_config_;
+  std::string mode = "U:" + std::to_string(config.x_pixels) + "x" +
+                     std::to_string(config.y_pixels) + "p-0\n";
+
+  pipes_.clear();
+  nodes_.clear();
+
+  for (int fb_node = 0; fb_node < kFBNodeMax; fb_node++) {
+    const char *fb_type = "mipi dsi video panel";
+    bool primary = (fb_node == kFBNodePrimary);
+    bool pluggable = (fb_node == kFBNodeHDMI);
+
+    if (primary && config.command_mode) {
+      fb_type = "mipi dsi cmd panel";
+    } else if (fb_node == kFBNodeWriteBack) {
+      fb_type = "writeback panel";
+    } else if (pluggable) {
+      fb_type = "dtv panel";
+    }
+
+    std::string panel_info;
+    panel_info += "pu_en=" + std::to_string(primary && config.partial_update) + "\n";
+    panel_info += "xstart=0\nwalign=1\nystart=0\nhalign=1\nmin_w=1\nmin_h=1\nroi_merge=0\n";
+    panel_info += "dyn_fps_en=" + std::to_string(primary) + "\n";
+    panel_info += "min_fps=" + std::to_string(config.fps) + "\n";
+    panel_info += "max_fps=" + std::to_string(config.fps) + "\n";
+    panel_info += "primary_panel=" + std::to_string(primary) + "\n";
+    panel_info += "is_pluggable=" + std::to_string(pluggable) + "\n";
+    panel_info += "panel_name=virtual " + std::string(fb_type) + "\n";
+
+    nodes_[kDevicePath + std::to_string(fb_node)] = "";
+    nodes_[GetFBPath(fb_node, "msm_fb_type")] = std::string(fb_type) + "\n";
+    nodes_[GetFBPath(fb_node, "msm_fb_panel_info")] = panel_info;
+    nodes_[GetFBPath(fb_node, "msm_fb_split")] = "0 0\n";
+    nodes_[GetFBPath(fb_node, "idle_time")] = "0\n";
+    nodes_[GetFBPath(fb_node, "dynamic_fps")] = std::to_string(config.fps) + "\n";
+    nodes_[GetFBPath(fb_node, "vsync_event")] = "VSYNC=0";
+    nodes_[GetFBPath(fb_node, "show_blank_event")] = "panel_power_on = 0";
+    nodes_[GetFBPath(fb_node, "idle_notify")] = "";
+    nodes_[GetFBPath(fb_node, "msm_fb_thermal_level")] = "thermal_level=0";
+
+    if (primary) {
+      nodes_[GetFBPath(fb_node, "mode")] = mode;
+      nodes_[GetFBPath(fb_node, "modes")] = mode;
+    }
+
+    // External display is never reported as connected, so that only primary and virtual displays
+    // are created.
+    if (pluggable) {
+      nodes_[GetFBPath(fb_node, "connected")] = "0\n";
+      nodes_[GetFBPath(fb_node, "hpd")] = "0\n";
+    }
+  }
+
+  nodes_[std::string(kBacklightPath) + "max_brightness"] = "255\n";
+  nodes_[std::string(kBacklightPath) + "brightness"] = "255\n";
+
+  uint32_t pipe_count[] = { config.num_vig_pipes, config.num_rgb_pipes, config.num_dma_pipes,
+                            config.num_cursor_pipes };
+  for (uint32_t type = 0; type < 4; type++) {
+    for (uint32_t i = 0; i < pipe_count[type]; i++) {
+      PipeInfo pipe;
+      pipe.pipe_ndx = 1U << pipes_.size();
+      pipe.scalar = (type == 0 || type == 1);  // VIG and RGB pipes have a scalar
+      pipes_.push_back(pipe);
+    }
+  }
+
+  nodes_[GetFBPath(kFBNodePrimary, "mdp/caps")] = GetCapsNode();
+}
+
+std::string VirtualDriver::GetCapsNode() {
+  const VirtualPanelConfig &config = panel_config_;
+  const char *pipe_types[] = { "vig", "rgb", "dma", "cursor" };
+  uint32_t pipe_count[] = { config.num_vig_pipes, config.num_rgb_pipes, config.num_dma_pipes,
+                            config.num_cursor_pipes };
+  std::string caps;
+
+  caps += "hw_rev=0\n";
+  caps += "blending_stages=" + std::to_string(config.blending_stages) + "\n";
+  caps += "max_downscale_ratio=" + std::to_string(config.max_downscale) + "\n";
+  caps += "max_upscale_ratio=" + std::to_string(config.max_upscale) + "\n";
+  caps += "max_bandwidth_low=9600000\n";
+  caps += "max_bandwidth_high=9600000\n";
+  caps += "max_mixer_width=" + std::to_string(config.max_mixer_width) + "\n";
+  caps += "max_pipe_width=" + std::to_string(config.max_pipe_width) + "\n";
+  caps += "max_cursor_size=" + std::to_string(config.max_cursor_size) + "\n";
+  caps += "max_pipe_bw=4500000\n";
+  caps += "max_mdp_clk=412500000\n";
+  caps += "clk_fudge_factor=105,100\n";
+  caps += "features=decimation,src_split,tile_format\n";
+  caps += "pipe_count=" + std::to_string(pipes_.size()) + "\n";
+
+  uint32_t pipe_num = 0;
+  for (uint32_t type = 0; type < 4; type++) {
+    for (uint32_t i = 0; i < pipe_count[type]; i++, pipe_num++) {
+      caps += "pipe_num:" + std::to_string(pipe_num) + " pipe_type:" + pipe_types[type] +
+              " pipe_ndx:" + std::to_string(pipes_.at(pipe_num).pipe_ndx) + " rects:1\n";
+    }
+  }
+
+  return caps;
+}
+
+bool VirtualDriver::GetNodeContent(const std::string &path, std::string *content) {
+  SCOPE_LOCK(locker_);
+
+  auto it = nodes_.find(path);
+  if (it == nodes_.end()) {
+    return false;
+  }
+
+  *content = it->second;
+
+  return true;
+}
+
+bool VirtualDriver::IsEventNode(const std::string &path) {
+  for (const char *event_node : kEventNodes) {
+    size_t length = strlen(event_node);
+    if (path.size() > length && !path.compare(path.size() - length, length, event_node)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int VirtualDriver::GetFBNode(int fd) {
+  auto it = open_fds_.find(fd);
+  if (it == open_fds_.end() || it->second.compare(0, strlen(kDevicePath), kDevicePath)) {
+    return -1;
+  }
+
+  return atoi(it->second.c_str() + strlen(kDevicePath));
+}
+
+void VirtualDriver::UpdateEventNode(int fb_node, const char *node_name,
+                                    const std::string &content) {
+  std::string path = GetFBPath(fb_node, node_name);
+  uint64_t value = 1;
+
+  nodes_[path] = content;
+
+  // Signal every listener of the node, as sysfs_notify() does.
+  for (auto &open_fd : open_fds_) {
+    if (open_fd.second == path && ::write(open_fd.first, &value, sizeof(value)) < 0) {
+      continue;
+    }
+  }
+}
+
+void VirtualDriver::StoreNode(const std::string &path, const std::string &content) {
+  nodes_[path] = content;
+
+  for (int fb_node = 0; fb_node < kFBNodeMax; fb_node++) {
+    if (path == GetFBPath(fb_node, "idle_time")) {
+      fb_nodes_[fb_node].idle_time_ms = UINT32(atoi(content.c_str()));
+      fb_nodes_[fb_node].idle_notified = false;
+    } else if (path == GetFBPath(fb_node, "dynamic_fps") && fb_node == kFBNodePrimary) {
+      uint32_t fps = UINT32(atoi(content.c_str()));
+      panel_config_.fps = fps ? fps : panel_config_.fps;
+    }
+  }
+}
+
+int VirtualDriver::CreateFence() {
+  // Composition completes as soon as it is committed, so fences are created in signaled state.
+  return ::eventfd(1, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+int VirtualDriver::ValidateCommit(int fb_node, void *arg) {
+  mdp_layer_commit *commit = reinterpret_cast<mdp_layer_commit *>(arg);
+  const VirtualPanelConfig &config = panel_config_;
+
+  if (commit->version != MDP_COMMIT_VERSION_1_0) {
+    return -EINVAL;
+  }
+
+  mdp_layer_commit_v1 &commit_v1 = commit->commit_v1;
+  uint32_t staged_pipes = 0;
+
+  if (commit_v1.input_layer_cnt > pipes_.size()) {
+    return -E2BIG;
+  }
+
+  if (fb_node == kFBNodeWriteBack && !commit_v1.output_layer) {
+    return -EINVAL;
+  }
+
+  for (uint32_t i = 0; i < commit_v1.input_layer_cnt; i++) {
+    mdp_input_layer &layer = commit_v1.input_layers[i];
+    mdp_rect &src = layer.src_rect;
+    mdp_rect &dst = layer.dst_rect;
+    const PipeInfo *pipe = NULL;
+
+    layer.error_code = 0;
+
+    for (const PipeInfo &pipe_info : pipes_) {
+      if (pipe_info.pipe_ndx == layer.pipe_ndx) {
+        pipe = &pipe_info;
+      }
+    }
+
+    if (!pipe || (staged_pipes & layer.pipe_ndx)) {
+      layer.error_code = -ENODEV;
+      return layer.error_code;
+    }
+    staged_pipes |= layer.pipe_ndx;
+
+    if (layer.z_order >= config.blending_stages || !src.w || !src.h || !dst.w || !dst.h) {
+      layer.error_code = -EINVAL;
+      return layer.error_code;
+    }
+
+    if (fb_node == kFBNodePrimary &&
+        ((dst.x + dst.w) > config.x_pixels || (dst.y + dst.h) > config.y_pixels)) {
+      layer.error_code = -EOVERFLOW;
+      return layer.error_code;
+    }
+
+    if (layer.buffer.width && layer.buffer.height &&
+        ((src.x + src.w) > layer.buffer.width || (src.y + src.h) > layer.buffer.height)) {
+      layer.error_code = -EOVERFLOW;
+      return layer.error_code;
+    }
+
+    uint32_t src_w = DECIMATED_DIMENSION(src.w, layer.horz_deci);
+    uint32_t src_h = DECIMATED_DIMENSION(src.h, layer.vert_deci);
+    if (src_w == dst.w && src_h == dst.h) {
+      continue;
+    }
+
+    if (!pipe->scalar || (src_w > dst.w * config.max_downscale) ||
+        (src_h > dst.h * config.max_downscale) || (dst.w > src_w * config.max_upscale) ||
+        (dst.h > src_h * config.max_upscale)) {
+      layer.error_code = -E2BIG;
+      return layer.error_code;
+    }
+  }
+
+  return 0;
+}
+
+int VirtualDriver::AtomicCommit(int fb_node, void *arg) {
+  mdp_layer_commit *commit = reinterpret_cast<mdp_layer_commit *>(arg);
+  bool validate = (commit->commit_v1.flags & MDP_VALIDATE_LAYER);
+
+  int error = ValidateCommit(fb_node, arg);
+
+  if (validate) {
+    stats_.validate_count++;
+    stats_.validate_failures += (error ? 1 : 0);
+  } else {
+    stats_.commit_count++;
+    stats_.commit_failures += (error ? 1 : 0);
+  }
+
+  if (error) {
+    errno = -error;
+    return -1;
+  }
+
+  if (validate) {
+    return 0;
+  }
+
+  FBNode &node = fb_nodes_[fb_node];
+  node.last_commit_ns = GetTimeNs();
+  node.idle_notified = false;
+
+  commit->commit_v1.release_fence = CreateFence();
+  commit->commit_v1.retire_fence = CreateFence();
+
+  return 0;
+}
+
+int VirtualDriver::Ioctl(int fd, uint32_t request, void *arg) {
+  SCOPE_LOCK(locker_);
+
+  const VirtualPanelConfig &config = panel_config_;
+  int fb_node = GetFBNode(fd);
+
+  if (fb_node < 0 || fb_node >= kFBNodeMax) {
+    errno = ENOTTY;
+    return -1;
+  }
+
+  FBNode &node = fb_nodes_[fb_node];
+
+  switch (request) {
+  case UINT32(MSMFB_ATOMIC_COMMIT):
+    return AtomicCommit(fb_node, arg);
+
+  case UINT32(FBIOGET_VSCREENINFO): {
+      fb_var_screeninfo *var_screeninfo = reinterpret_cast<fb_var_screeninfo *>(arg);
+      *var_screeninfo = {};
+      var_screeninfo->xres = config.x_pixels;
+      var_screeninfo->yres = config.y_pixels;
+      var_screeninfo->xres_virtual = config.x_pixels;
+      var_screeninfo->yres_virtual = config.y_pixels;
+      var_screeninfo->bits_per_pixel = 32;
+      var_screeninfo->left_margin = 16;
+      var_screeninfo->right_margin = 16;
+      var_screeninfo->hsync_len = 8;
+      var_screeninfo->upper_margin = 4;
+      var_screeninfo->lower_margin = 8;
+      var_screeninfo->vsync_len = 2;
+    }
+    return 0;
+
+  case UINT32(FBIOPUT_VSCREENINFO):
+    return 0;
+
+  case UINT32(MSMFB_METADATA_GET): {
+      msmfb_metadata *metadata = reinterpret_cast<msmfb_metadata *>(arg);
+      if (metadata->op == metadata_op_frame_rate) {
+        metadata->data.panel_frame_rate = config.fps;
+      }
+    }
+    return 0;
+
+  case UINT32(MSMFB_OVERLAY_VSYNC_CTRL):
+    node.vsync_enable = (*reinterpret_cast<int *>(arg) != 0);
+    if (node.vsync_enable) {
+      StartDriverThread();
+    }
+    return 0;
+
+  case UINT32(FBIOBLANK): {
+      // Blank mode is passed by value.
+      int blank = static_cast<int>(reinterpret_cast<intptr_t>(arg));
+      node.power_on = (blank != FB_BLANK_POWERDOWN);
+      UpdateEventNode(fb_node, "show_blank_event",
+                      "panel_power_on = " + std::to_string(node.power_on));
+    }
+    return 0;
+
+  default:
+    // Rest of the driver configuration (post processing, LPM, cursor position, etc.) has no effect
+    // on the emulated composition.
+    return 0;
+  }
+}
+
+int VirtualDriver::Access(const char *path, int /*mode*/) {
+  SCOPE_LOCK(locker_);
+
+  if (nodes_.find(path) == nodes_.end()) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  return 0;
+}
+
+int VirtualDriver::Open(const char *path, int /*flags*/) {
+  SCOPE_LOCK(locker_);
+
+  if (nodes_.find(path) == nodes_.end()) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  int fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (fd >= 0) {
+    open_fds_[fd] = path;
+  }
+
+  return fd;
+}
+
+int VirtualDriver::Close(int fd) {
+  SCOPE_LOCK(locker_);
+
+  open_fds_.erase(fd);
+
+  return ::close(fd);
+}
+
+int VirtualDriver::Dup(int fd) {
+  SCOPE_LOCK(locker_);
+
+  int dup_fd = ::dup(fd);
+  auto it = open_fds_.find(fd);
+  if (dup_fd >= 0 && it != open_fds_.end()) {
+    open_fds_[dup_fd] = it->second;
+  }
+
+  return dup_fd;
+}
+
+int VirtualDriver::Poll(struct pollfd *fds, nfds_t nfds, int timeout) {
+  std::vector<bool> event_node(nfds, false);
+
+  // sysfs nodes notify with POLLPRI, whereas the eventfd backing the node notifies with POLLIN.
+  locker_.Lock();
+  for (nfds_t i = 0; i < nfds; i++) {
+    auto it = open_fds_.find(fds[i].fd);
+    if (it != open_fds_.end() && IsEventNode(it->second)) {
+      event_node[i] = true;
+      fds[i].events = static_cast<int16_t>((fds[i].events & ~POLLPRI) | POLLIN);
+    }
+  }
+  locker_.Unlock();
+
+  int ret = ::poll(fds, nfds, timeout);
+
+  for (nfds_t i = 0; i < nfds; i++) {
+    if (event_node[i]) {
+      fds[i].events = static_cast<int16_t>((fds[i].events & ~POLLIN) | POLLPRI);
+      if (fds[i].revents & POLLIN) {
+        fds[i].revents = static_cast<int16_t>((fds[i].revents & ~POLLIN) | POLLPRI);
+      }
+    }
+  }
+
+  return ret;
+}
+
+int VirtualDriver::EpollCtl(int epoll_fd, int op, int fd, struct epoll_event *event) {
+  struct epoll_event node_event = {};
+
+  // As in Poll(), wait for POLLIN of the eventfd backing an event node in place of POLLPRI.
+  if (event && op != EPOLL_CTL_DEL) {
+    SCOPE_LOCK(locker_);
+    auto it = open_fds_.find(fd);
+    if (it != open_fds_.end() && IsEventNode(it->second) && (event->events & EPOLLPRI)) {
+      node_event = *event;
+      node_event.events = (node_event.events & ~UINT32(EPOLLPRI)) | EPOLLIN;
+      event = &node_event;
+    }
+  }
+
+  return ::epoll_ctl(epoll_fd, op, fd, event);
+}
+
+ssize_t VirtualDriver::Pread(int fd, void *buf, size_t count, off_t offset) {
+  SCOPE_LOCK(locker_);
+
+  auto it = open_fds_.find(fd);
+  if (it == open_fds_.end()) {
+    return ::pread(fd, buf, count, offset);
+  }
+
+  // Reading the node acknowledges the pending notification.
+  uint64_t value = 0;
+  if (::read(fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+    return -1;
+  }
+
+  const std::string &content = nodes_[it->second];
+  if (offset < 0 || size_t(offset) >= content.size()) {
+    return 0;
+  }
+
+  size_t length = std::min(count, content.size() - size_t(offset));
+  memcpy(buf, content.data() + offset, length);
+
+  return ssize_t(length);
+}
+
+ssize_t VirtualDriver::Pwrite(int fd, const void *buf, size_t count, off_t offset) {
+  SCOPE_LOCK(locker_);
+
+  auto it = open_fds_.find(fd);
+  if (it == open_fds_.end()) {
+    return ::pwrite(fd, buf, count, offset);
+  }
+
+  StoreNode(it->second, std::string(reinterpret_cast<const char *>(buf), count));
+
+  return ssize_t(count);
+}
+
+ssize_t VirtualDriver::Read(int fd, void *buf, size_t count) {
+  locker_.Lock();
+  bool node = (open_fds_.find(fd) != open_fds_.end());
+  locker_.Unlock();
+
+  return node ? Pread(fd, buf, count, 0) : ::read(fd, buf, count);
+}
+
+ssize_t VirtualDriver::Write(int fd, const void *buf, size_t count) {
+  locker_.Lock();
+  bool node = (open_fds_.find(fd) != open_fds_.end());
+  locker_.Unlock();
+
+  return node ? Pwrite(fd, buf, count, 0) : ::write(fd, buf, count);
+}
+
+void VirtualDriver::StartDriverThread() {
+  if (driver_thread_running_) {
+    return;
+  }
+
+  driver_thread_running_ = (pthread_create(&driver_thread_, NULL, &DriverThread, this) == 0);
+}
+
+void *VirtualDriver::DriverThread(void *context) {
+  if (context) {
+    return reinterpret_cast<VirtualDriver *>(context)->DriverThreadHandler();
+  }
+
+  return NULL;
+}
+
+// Emulates the panel refresh. On every vsync, it notifies vsync to the displays which have enabled
+// it, and idle to the displays which have not been committed for their idle time.
+void *VirtualDriver::DriverThreadHandler() {
+  struct timespec next_vsync = {};
+  clock_gettime(CLOCK_MONOTONIC, &next_vsync);
+
+  while (true) {
+    locker_.Lock();
+    bool exit = exit_threads_;
+    int64_t vsync_period_ns = 1000000000LL / (panel_config_.fps ? panel_config_.fps : 60);
+    locker_.Unlock();
+
+    if (exit) {
+      break;
+    }
+
+    next_vsync.tv_nsec += vsync_period_ns;
+    next_vsync.tv_sec += next_vsync.tv_nsec / 1000000000LL;
+    next_vsync.tv_nsec %= 1000000000LL;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_vsync, NULL);
+
+    SCOPE_LOCK(locker_);
+    int64_t timestamp = GetTimeNs();
+    for (int fb_node = 0; fb_node < kFBNodeMax; fb_node++) {
+      FBNode &node = fb_nodes_[fb_node];
+      if (!node.power_on) {
+        continue;
+      }
+
+      if (node.vsync_enable) {
+        UpdateEventNode(fb_node, "vsync_event", "VSYNC=" + std::to_string(timestamp));
+        stats_.vsync_count++;
+      }
+
+      int64_t idle_time_ns = static_cast<int64_t>(node.idle_time_ms) * 1000000LL;
+      if (idle_time_ns && !node.idle_notified && node.last_commit_ns &&
+          (timestamp - node.last_commit_ns) >= idle_time_ns) {
+        UpdateEventNode(fb_node, "idle_notify", "idle");
+        node.idle_notified = true;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+int64_t VirtualDriver::GetTimeNs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+// Sys system call hooks routed to the virtual driver.
+#ifdef TARGET_HEADLESS
+static int VirtualIoctl(int fd, unsigned long int request, ...) {  // NOLINT
+#else
+static int VirtualIoctl(int fd, int request, ...) {
+#endif
+  va_list args;
+  va_start(args, request);
+  void *arg = va_arg(args, void *);
+  va_end(args);
+
+  return VirtualDriver::GetInstance()->Ioctl(fd, static_cast<uint32_t>(request), arg);
+}
+
+static int VirtualAccess(const char *path, int mode) {
+  return VirtualDriver::GetInstance()->Access(path, mode);
+}
+
+static int VirtualOpen(const char *path, int flags, ...) {
+  return VirtualDriver::GetInstance()->Open(path, flags);
+}
+
+static int VirtualClose(int fd) {
+  return VirtualDriver::GetInstance()->Close(fd);
+}
+
+static int VirtualPoll(struct pollfd *fds, nfds_t nfds, int timeout) {
+  return VirtualDriver::GetInstance()->Poll(fds, nfds, timeout);
+}
+
+static int VirtualEpollCtl(int epoll_fd, int op, int fd, struct epoll_event *event) {
+  return VirtualDriver::GetInstance()->EpollCtl(epoll_fd, op, fd, event);
+}
+
+static ssize_t VirtualPread(int fd, void *buf, size_t count, off_t offset) {
+  return VirtualDriver::GetInstance()->Pread(fd, buf, count, offset);
+}
+
+static ssize_t VirtualPwrite(int fd, const void *buf, size_t count, off_t offset) {
+  return VirtualDriver::GetInstance()->Pwrite(fd, buf, count, offset);
+}
+
+static int VirtualPthreadCancel(pthread_t /* thread */) {
+  return 0;
+}
+
+static int VirtualDup(int fd) {
+  return VirtualDriver::GetInstance()->Dup(fd);
+}
+
+static ssize_t VirtualRead(int fd, void *buf, size_t count) {
+  return VirtualDriver::GetInstance()->Read(fd, buf, count);
+}
+
+static ssize_t VirtualWrite(int fd, const void *buf, size_t count) {
+  return VirtualDriver::GetInstance()->Write(fd, buf, count);
+}
+
+Sys::ioctl Sys::ioctl_ = VirtualIoctl;
+Sys::access Sys::access_ = VirtualAccess;
+Sys::open Sys::open_ = VirtualOpen;
+Sys::close Sys::close_ = VirtualClose;
+Sys::poll Sys::poll_ = VirtualPoll;
+Sys::pread Sys::pread_ = VirtualPread;
+Sys::pwrite Sys::pwrite_ = VirtualPwrite;
+Sys::pthread_cancel Sys::pthread_cancel_ = VirtualPthreadCancel;
+Sys::dup Sys::dup_ = VirtualDup;
+Sys::read Sys::read_ = VirtualRead;
+Sys::write Sys::write_ = VirtualWrite;
+Sys::eventfd Sys::eventfd_ = ::eventfd;
+Sys::epoll_create1 Sys::epoll_create1_ = ::epoll_create1;
+Sys::epoll_ctl Sys::epoll_ctl_ = VirtualEpollCtl;
+Sys::epoll_wait Sys::epoll_wait_ = ::epoll_wait;
+Sys::timerfd_create Sys::timerfd_create_ = ::timerfd_create;
+Sys::timerfd_settime Sys::timerfd_settime_ = ::timerfd_settime;
+
+bool Sys::getline_(fstream &fs, std::string &line) {
+  return fs.getline(line);
+}
+
+}  // namespace sdm
@@ -0,0 +1,163 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __VIRTUAL_DRIVER_H__
+#define __VIRTUAL_DRIVER_H__
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/locker.h>
+#include <ios>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace sdm {
+
+// Replacement of std::fstream for Sys, which reads the content of an emulated sysfs node.
+class VirtualFStream {
+ public:
+  VirtualFStream() { }
+  VirtualFStream(const std::string &path, std::ios_base::openmode mode) { open(path, mode); }
+  void open(const std::string &path, std::ios_base::openmode mode);
+  bool is_open() const { return is_open_; }
+  void close();
+  bool getline(std::string &line);  // NOLINT
+
+ private:
+  std::istringstream stream_;
+  bool is_open_ = false;
+};
+
+// Panel and MDSS configuration emulated by the virtual driver. It shall be set before the display
+// core is created.
+struct VirtualPanelConfig {
+  uint32_t x_pixels = 1080;
+  uint32_t y_pixels = 1920;
+  uint32_t fps = 60;
+  bool command_mode = false;
+  bool partial_update = false;
+  uint32_t num_vig_pipes = 4;
+  uint32_t num_rgb_pipes = 0;
+  uint32_t num_dma_pipes = 4;
+  uint32_t num_cursor_pipes = 2;
+  uint32_t blending_stages = 7;
+  uint32_t max_mixer_width = 2560;
+  uint32_t max_pipe_width = 2560;
+  uint32_t max_downscale = 4;
+  uint32_t max_upscale = 20;
+  uint32_t max_cursor_size = 128;
+};
+
+struct VirtualDriverStats {
+  uint64_t validate_count = 0;
+  uint64_t validate_failures = 0;
+  uint64_t commit_count = 0;
+  uint64_t commit_failures = 0;
+  uint64_t vsync_count = 0;
+};
+
+// User space emulation of the MDSS framebuffer driver. Sys system call hooks are routed here when
+// SDM_VIRTUAL_DRIVER is defined, so that display core can run on a host without display hardware.
+// Every emulated node is backed by an eventfd, which gives it a real file descriptor that can be
+// polled, duplicated and closed like any other. Event nodes are signaled through that eventfd.
+class VirtualDriver {
+ public:
+  static VirtualDriver *GetInstance();
+
+  void SetPanelConfig(const VirtualPanelConfig &panel_config);
+  void NotifyIdle(int fb_node);
+  void NotifyThermalLevel(int fb_node, int thermal_level);
+  void GetStats(VirtualDriverStats *stats);
+
+  int Ioctl(int fd, uint32_t request, void *arg);
+  int Access(const char *path, int mode);
+  int Open(const char *path, int flags);
+  int Close(int fd);
+  int Poll(struct pollfd *fds, nfds_t nfds, int timeout);
+  int EpollCtl(int epoll_fd, int op, int fd, struct epoll_event *event);
+  ssize_t Pread(int fd, void *buf, size_t count, off_t offset);
+  ssize_t Pwrite(int fd, const void *buf, size_t count, off_t offset);
+  ssize_t Read(int fd, void *buf, size_t count);
+  ssize_t Write(int fd, const void *buf, size_t count);
+  int Dup(int fd);
+  bool GetNodeContent(const std::string &path, std::string *content);
+
+ private:
+  enum {
+    kFBNodePrimary,
+    kFBNodeWriteBack,
+    kFBNodeHDMI,
+    kFBNodeMax,
+  };
+
+  struct PipeInfo {
+    uint32_t pipe_ndx = 0;
+    bool scalar = false;
+  };
+
+  struct FBNode {
+    bool power_on = false;
+    bool vsync_enable = false;
+    uint32_t idle_time_ms = 0;
+    bool idle_notified = false;
+    int64_t last_commit_ns = 0;
+  };
+
+  VirtualDriver();
+  ~VirtualDriver();
+  void PopulateNodes();
+  std::string GetCapsNode();
+  std::string GetFBPath(int fb_node, const char *node_name);
+  int GetFBNode(int fd);
+  bool IsEventNode(const std::string &path);
+  void UpdateEventNode(int fb_node, const char *node_name, const std::string &content);
+  void StoreNode(const std::string &path, const std::string &content);
+  int AtomicCommit(int fb_node, void *arg);
+  int ValidateCommit(int fb_node, void *arg);
+  int CreateFence();
+  void StartDriverThread();
+  static void *DriverThread(void *context);
+  void *DriverThreadHandler();
+  static int64_t GetTimeNs();
+
+  Locker locker_;
+  VirtualPanelConfig panel_config_;
+  VirtualDriverStats stats_;
+  std::map<std::string, std::string> nodes_;  // Emulated sysfs nodes and their content
+  std::map<int, std::string> open_fds_;       // Open file descriptors and their node path
+  std::vector<PipeInfo> pipes_;
+  FBNode fb_nodes_[kFBNodeMax];
+  pthread_t driver_thread_ = 0;
+  bool driver_thread_running_ = false;
+  bool exit_threads_ = false;
+};
+
+}  // namespace sdm
+
+#endif  // __VIRTUAL_DRIVER_H__
@@ -0,0 +1,335 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Replays a layer stack trace captured by the display HAL (sdm.debug.layer_trace_frames) through
+// the display core on a workstation. The core drives the user space emulation of the MDSS driver,
+// so that strategy and resource decisions can be reproduced and compared with the ones taken on
+// the device.
+//
+// usage: layer_replay [-r <width>x<height>] [-n <iterations>] [-v] <trace file>
+
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <core/buffer_allocator.h>
+#include <core/buffer_sync_handler.h>
+#include <core/core_interface.h>
+#include <core/debug_interface.h>
+#include <core/display_interface.h>
+#include <utils/constants.h>
+#include <utils/layer_trace.h>
+#include <virtual_driver.h>
+#include <algorithm>
+
+#define REPLAY_LOG(enabled, format) \
+  do { \
+    if (enabled) { \
+      va_list list; \
+      va_start(list, format); \
+      vfprintf(stderr, format, list); \
+      va_end(list); \
+      fprintf(stderr, "\n"); \
+    } \
+  } while (0)
+
+using namespace sdm;  // NOLINT
+
+class ReplayDebugHandler : public DebugHandler {
+ public:
+  explicit ReplayDebugHandler(bool verbose) : verbose_(verbose) { }
+
+  virtual void Error(DebugTag /*tag*/, const char *format, ...) { REPLAY_LOG(true, format); }
+  virtual void Warning(DebugTag /*tag*/, const char *format, ...) { REPLAY_LOG(true, format); }
+  virtual void Info(DebugTag /*tag*/, const char *format, ...) { REPLAY_LOG(verbose_, format); }
+  virtual void Debug(DebugTag /*tag*/, const char *format, ...) { REPLAY_LOG(verbose_, format); }
+  virtual void Verbose(DebugTag /*tag*/, const char *format, ...) { REPLAY_LOG(verbose_, format); }
+  virtual void BeginTrace(const char * /*class_name*/, const char * /*function_name*/,
+                          const char * /*custom_string*/) { }
+  virtual void EndTrace() { }
+  virtual DisplayError GetProperty(const char * /*property_name*/, int * /*value*/) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError GetProperty(const char * /*property_name*/, char * /*value*/) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError SetProperty(const char * /*property_name*/, const char * /*value*/) {
+    return kErrorNotSupported;
+  }
+
+ private:
+  bool verbose_;
+};
+
+// Buffers are never touched by the emulated driver, only their geometry is used.
+class ReplayBufferAllocator : public BufferAllocator {
+ public:
+  virtual DisplayError AllocateBuffer(BufferInfo *buffer_info) {
+    AllocatedBufferInfo &alloc_buffer_info = buffer_info->alloc_buffer_info;
+    const BufferConfig &buffer_config = buffer_info->buffer_config;
+
+    alloc_buffer_info.fd = -1;
+    alloc_buffer_info.aligned_width = buffer_config.width;
+    alloc_buffer_info.aligned_height = buffer_config.height;
+    alloc_buffer_info.stride = buffer_config.width * 4;
+    alloc_buffer_info.size = GetBufferSize(buffer_info) * buffer_config.buffer_count;
+
+    return kErrorNone;
+  }
+
+  virtual DisplayError FreeBuffer(BufferInfo *buffer_info) {
+    buffer_info->alloc_buffer_info = AllocatedBufferInfo();
+    return kErrorNone;
+  }
+
+  virtual uint32_t GetBufferSize(BufferInfo *buffer_info) {
+    return buffer_info->buffer_config.width * buffer_info->buffer_config.height * 4;
+  }
+};
+
+class ReplayBufferSyncHandler : public BufferSyncHandler {
+ public:
+  virtual DisplayError SyncWait(int fd) {
+    if (fd >= 0) {
+      struct pollfd poll_fd = { fd, POLLIN, 0 };
+      poll(&poll_fd, 1, 1000);
+    }
+    return kErrorNone;
+  }
+
+  virtual DisplayError SyncMerge(int fd1, int fd2, int *merged_fd) {
+    // Fences of the emulated driver are signaled at creation, either one stands for both.
+    *merged_fd = dup((fd1 >= 0) ? fd1 : fd2);
+    return kErrorNone;
+  }
+
+  virtual bool IsSyncSignaled(int /*fd*/) { return true; }
+};
+
+class ReplayEventHandler : public DisplayEventHandler {
+ public:
+  virtual DisplayError VSync(const DisplayEventVSync & /*vsync*/) { return kErrorNone; }
+  virtual DisplayError Refresh() { return kErrorNone; }
+  virtual DisplayError CECMessage(char * /*message*/) { return kErrorNone; }
+};
+
+struct ReplayStats {
+  uint32_t frames = 0;
+  uint32_t traced_prepare_failures = 0;
+  uint32_t prepare_failures = 0;
+  uint32_t commit_failures = 0;
+  uint32_t composition_mismatches = 0;   // Frames composed differently than on the device.
+  uint32_t traced_gpu_frames = 0;        // Frames with at least one layer composed by GPU.
+  uint32_t gpu_frames = 0;
+  uint64_t traced_prepare_ns = 0;
+  uint64_t prepare_ns = 0;
+  uint64_t commit_ns = 0;
+};
+
+static uint64_t GetTimeNs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UINT64(ts.tv_sec) * 1000000000ULL) + UINT64(ts.tv_nsec);
+}
+
+static bool HasGPUComposition(const LayerStack &layer_stack) {
+  for (Layer *layer : layer_stack.layers) {
+    if (layer->composition == kCompositionGPU || layer->composition == kCompositionGPUS3D) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void CloseFences(LayerStack *layer_stack) {
+  for (Layer *layer : layer_stack->layers) {
+    LayerBuffer *buffer = layer->input_buffer;
+    if (buffer && buffer->release_fence_fd >= 0) {
+      close(buffer->release_fence_fd);
+      buffer->release_fence_fd = -1;
+    }
+  }
+  if (layer_stack->retire_fence_fd >= 0) {
+    close(layer_stack->retire_fence_fd);
+    layer_stack->retire_fence_fd = -1;
+  }
+}
+
+static void ReplayFrame(DisplayInterface *display_intf, LayerTraceFrame *frame,
+                        ReplayStats *stats) {
+  const LayerTraceFrameRecord &record = frame->record;
+  LayerStack &layer_stack = frame->layer_stack;
+
+  stats->frames++;
+  if (record.error[kTraceStagePrepare] != kErrorNone) {
+    stats->traced_prepare_failures++;
+  }
+  if (record.timestamp_ns[kTraceStagePrepare] > record.timestamp_ns[kTraceStageBuild]) {
+    stats->traced_prepare_ns += record.timestamp_ns[kTraceStagePrepare] -
+                                record.timestamp_ns[kTraceStageBuild];
+  }
+
+  // Composition types are decided by the display core, start over from the client defaults.
+  for (Layer *layer : layer_stack.layers) {
+    if (layer->composition != kCompositionGPUTarget &&
+        layer->composition != kCompositionBlitTarget) {
+      layer->composition = kCompositionGPU;
+    }
+  }
+  bool traced_gpu = false;
+  for (LayerComposition composition : frame->compositions) {
+    traced_gpu |= (composition == kCompositionGPU || composition == kCompositionGPUS3D);
+  }
+  stats->traced_gpu_frames += traced_gpu ? 1 : 0;
+
+  uint64_t start = GetTimeNs();
+  DisplayError error = display_intf->Prepare(&layer_stack);
+  stats->prepare_ns += GetTimeNs() - start;
+  if (error != kErrorNone) {
+    stats->prepare_failures++;
+    display_intf->Flush();
+    return;
+  }
+
+  for (uint32_t i = 0; i < layer_stack.layers.size(); i++) {
+    if (layer_stack.layers.at(i)->composition != frame->compositions.at(i)) {
+      stats->composition_mismatches++;
+      break;
+    }
+  }
+  stats->gpu_frames += HasGPUComposition(layer_stack) ? 1 : 0;
+
+  start = GetTimeNs();
+  error = display_intf->Commit(&layer_stack);
+  stats->commit_ns += GetTimeNs() - start;
+  if (error != kErrorNone) {
+    stats->commit_failures++;
+    display_intf->Flush();
+  }
+  CloseFences(&layer_stack);
+}
+
+static void PrintStats(const ReplayStats &stats) {
+  uint64_t frames = std::max(stats.frames, 1U);
+
+  printf("frames replayed:         %u\n", stats.frames);
+  printf("prepare failures:        %u (traced %u)\n", stats.prepare_failures,
+         stats.traced_prepare_failures);
+  printf("commit failures:         %u\n", stats.commit_failures);
+  printf("gpu composed frames:     %u (traced %u)\n", stats.gpu_frames, stats.traced_gpu_frames);
+  printf("composition mismatches:  %u\n", stats.composition_mismatches);
+  printf("avg prepare:             %.1f us (traced build to prepare %.1f us)\n",
+         FLOAT(stats.prepare_ns / frames) / 1000.0f,
+         FLOAT(stats.traced_prepare_ns / frames) / 1000.0f);
+  printf("avg commit:              %.1f us\n", FLOAT(stats.commit_ns / frames) / 1000.0f);
+}
+
+static void Usage(const char *name) {
+  fprintf(stderr, "usage: %s [-r <width>x<height>] [-n <iterations>] [-v] <trace file>\n", name);
+}
+
+int main(int argc, char **argv) {
+  VirtualPanelConfig panel_config;
+  uint32_t iterations = 1;
+  bool verbose = false;
+  int opt = -1;
+
+  while ((opt = getopt(argc, argv, "r:n:v")) != -1) {
+    switch (opt) {
+    case 'r':
+      if (sscanf(optarg, "%ux%u", &panel_config.x_pixels, &panel_config.y_pixels) != 2) {
+        Usage(argv[0]);
+        return -1;
+      }
+      break;
+    case 'n':
+      iterations = UINT32(strtoul(optarg, NULL, 0));
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      Usage(argv[0]);
+      return -1;
+    }
+  }
+
+  if (optind >= argc) {
+    Usage(argv[0]);
+    return -1;
+  }
+
+  LayerTraceReader reader;
+  if (reader.Open(argv[optind]) != kErrorNone) {
+    fprintf(stderr, "Failed to open trace %s\n", argv[optind]);
+    return -1;
+  }
+
+  VirtualDriver::GetInstance()->SetPanelConfig(panel_config);
+
+  ReplayDebugHandler debug_handler(verbose);
+  ReplayBufferAllocator buffer_allocator;
+  ReplayBufferSyncHandler buffer_sync_handler;
+  ReplayEventHandler event_handler;
+  CoreInterface *core_intf = NULL;
+  DisplayInterface *display_intf = NULL;
+
+  DisplayError error = CoreInterface::CreateCore(&debug_handler, &buffer_allocator,
+                                                 &buffer_sync_handler, &core_intf);
+  if (error != kErrorNone) {
+    fprintf(stderr, "Failed to create display core. Error = %d\n", error);
+    return -1;
+  }
+
+  error = core_intf->CreateDisplay(kPrimary, &event_handler, &display_intf);
+  if (error != kErrorNone) {
+    fprintf(stderr, "Failed to create primary display. Error = %d\n", error);
+    CoreInterface::DestroyCore();
+    return -1;
+  }
+  display_intf->SetDisplayState(kStateOn);
+
+  ReplayStats stats;
+  LayerTraceFrame frame;
+  for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+    for (uint32_t i = 0; i < reader.GetFrameCount(); i++) {
+      if (reader.ReadFrame(i, &frame) != kErrorNone) {
+        fprintf(stderr, "Failed to read frame %u\n", i);
+        break;
+      }
+      ReplayFrame(display_intf, &frame, &stats);
+    }
+  }
+
+  PrintStats(stats);
+
+  display_intf->SetDisplayState(kStateOff);
+  core_intf->DestroyDisplay(display_intf);
+  CoreInterface::DestroyCore();
+
+  return 0;
+}
+
@@ -0,0 +1,432 @@
+/*
+* Copyright (c) 2016, The Linux Foundation. All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without modification, are permitted
+* provided that the following conditions are met:
+*    * Redistributions of source code must retain the above copyright notice, this list of
+*      conditions and the following disclaimer.
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of
+*      conditions and the following disclaimer in the documentation and/or other materials provided
+*      with the distribution.
+*    * Neither the name of The Linux Foundation nor the names of its contributors may be used to
+*      endorse or promote products derived from this software without specific prior written
+*      permission.
+*
+* THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+* LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+* FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+* BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+* STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+* OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Drives synthetic layer stacks through the display core on top of the user space emulation of
+// the MDSS driver and reports per stage latency percentiles of the composition path.
+//
+// usage: sdm_benchmark [-r <width>x<height>] [-l <app layers>] [-n <frames>] [-g <frames>]
+//                      [-y] [-v]
+//   -l  Number of application layers, in addition to the GPU target. Default 4.
+//   -n  Number of frames to compose. Default 1000.
+//   -g  Change the layer geometry every given number of frames. Default 0, i.e. only once.
+//   -y  Make the bottom layer a NV12 video layer.
+
+#include <inttypes.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <core/buffer_allocator.h>
+#include <core/buffer_sync_handler.h>
+#include <core/core_interface.h>
+#include <core/debug_interface.h>
+#include <core/display_interface.h>
+#include <utils/constants.h>
+#include <virtual_driver.h>
+#include <algorithm>
+#include <vector>
+
+#define BENCHMARK_LOG(enabled, format) \
+  do { \
+    if (enabled) { \
+      va_list list; \
+      va_start(list, format); \
+      vfprintf(stderr, format, list); \
+      va_end(list); \
+      fprintf(stderr, "\n"); \
+    } \
+  } while (0)
+
+using namespace sdm;  // NOLINT
+
+class BenchmarkDebugHandler : public DebugHandler {
+ public:
+  explicit BenchmarkDebugHandler(bool verbose) : verbose_(verbose) { }
+
+  virtual void Error(DebugTag /*tag*/, const char *format, ...) { BENCHMARK_LOG(true, format); }
+  virtual void Warning(DebugTag /*tag*/, const char *format, ...) {
+    BENCHMARK_LOG(verbose_, format);
+  }
+  virtual void Info(DebugTag /*tag*/, const char *format, ...) { BENCHMARK_LOG(verbose_, format); }
+  virtual void Debug(DebugTag /*tag*/, const char *format, ...) { BENCHMARK_LOG(verbose_, format); }
+  virtual void Verbose(DebugTag /*tag*/, const char *format, ...) {
+    BENCHMARK_LOG(verbose_, format);
+  }
+  virtual void BeginTrace(const char * /*class_name*/, const char * /*function_name*/,
+                          const char * /*custom_string*/) { }
+  virtual void EndTrace() { }
+  virtual DisplayError GetProperty(const char * /*property_name*/, int * /*value*/) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError GetProperty(const char * /*property_name*/, char * /*value*/) {
+    return kErrorNotSupported;
+  }
+  virtual DisplayError SetProperty(const char * /*property_name*/, const char * /*value*/) {
+    return kErrorNotSupported;
+  }
+
+ private:
+  bool verbose_;
+};
+
+// Buffers are never touched by the emulated driver, only their geometry is used.
+class BenchmarkBufferAllocator : public BufferAllocator {
+ public:
+  virtual DisplayError AllocateBuffer(BufferInfo *buffer_info) {
+    AllocatedBufferInfo &alloc_buffer_info = buffer_info->alloc_buffer_info;
+    const BufferConfig &buffer_config = buffer_info->buffer_config;
+
+    alloc_buffer_info.fd = -1;
+    alloc_buffer_info.aligned_width = buffer_config.width;
+    alloc_buffer_info.aligned_height = buffer_config.height;
+    alloc_buffer_info.stride = buffer_config.width * 4;
+    alloc_buffer_info.size = GetBufferSize(buffer_info) * buffer_config.buffer_count;
+
+    return kErrorNone;
+  }
+
+  virtual DisplayError FreeBuffer(BufferInfo *buffer_info) {
+    buffer_info->alloc_buffer_info = AllocatedBufferInfo();
+    return kErrorNone;
+  }
+
+  virtual uint32_t GetBufferSize(BufferInfo *buffer_info) {
+    return buffer_info->buffer_config.width * buffer_info->buffer_config.height * 4;
+  }
+};
+
+class BenchmarkBufferSyncHandler : public BufferSyncHandler {
+ public:
+  virtual DisplayError SyncWait(int fd) {
+    if (fd >= 0) {
+      struct pollfd poll_fd = { fd, POLLIN, 0 };
+      poll(&poll_fd, 1, 1000);
+    }
+    return kErrorNone;
+  }
+
+  virtual DisplayError SyncMerge(int fd1, int fd2, int *merged_fd) {
+    // Fences of the emulated driver are signaled at creation, either one stands for both.
+    *merged_fd = dup((fd1 >= 0) ? fd1 : fd2);
+    return kErrorNone;
+  }
+
+  virtual bool IsSyncSignaled(int /*fd*/) { return true; }
+};
+
+class BenchmarkEventHandler : public DisplayEventHandler {
+ public:
+  virtual DisplayError VSync(const DisplayEventVSync & /*vsync*/) { return kErrorNone; }
+  virtual DisplayError Refresh() { return kErrorNone; }
+  virtual DisplayError CECMessage(char * /*message*/) { return kErrorNone; }
+};
+
+struct BenchmarkConfig {
+  uint32_t app_layers = 4;
+  uint32_t frames = 1000;
+  uint32_t geometry_interval = 0;
+  bool video = false;
+  bool verbose = false;
+};
+
+// Layer stack as the display HAL would build it: application layers followed by the GPU target.
+// Vectors are sized upfront, layer stack keeps pointers to their elements.
+struct BenchmarkStack {
+  std::vector<Layer> layers;
+  std::vector<LayerBuffer> buffers;
+  LayerStack layer_stack;
+};
+
+struct BenchmarkStats {
+  uint32_t prepare_failures = 0;
+  uint32_t commit_failures = 0;
+  uint32_t gpu_frames = 0;             // Frames with at least one layer composed by GPU.
+  std::vector<uint64_t> prepare_ns;
+  std::vector<uint64_t> commit_ns;
+  std::vector<uint64_t> frame_ns;
+};
+
+static uint64_t GetTimeNs() {
+  struct timespec ts = {};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (UINT64(ts.tv_sec) * 1000000000ULL) + UINT64(ts.tv_nsec);
+}
+
+static void SetBuffer(uint32_t width, uint32_t height, LayerBufferFormat format,
+                      LayerBuffer *buffer) {
+  buffer->width = width;
+  buffer->height = height;
+  buffer->unaligned_width = width;
+  buffer->unaligned_height = height;
+  buffer->format = format;
+}
+
+static void SetRect(float left, float top, float right, float bottom, LayerRect *rect) {
+  rect->left = left;
+  rect->top = top;
+  rect->right = right;
+  rect->bottom = bottom;
+}
+
+// Application layers are full width windows cascading down the screen, shifted by a few pixels
+// for every geometry generation so that the strategy has to be recomputed.
+static void BuildStack(const BenchmarkConfig &config, uint32_t width, uint32_t height,
+                       uint32_t generation, BenchmarkStack *stack) {
+  uint32_t layer_count = config.app_layers + 1;
+
+  stack->layers.assign(layer_count, Layer());
+  stack->buffers.assign(layer_count, LayerBuffer());
+  stack->layer_stack = LayerStack();
+  stack->layer_stack.flags.geometry_changed = true;
+
+  float step = FLOAT(height) / FLOAT(config.app_layers + 1);
+  float shift = FLOAT((generation * 8) % 64);
+  for (uint32_t i = 0; i < layer_count; i++) {
+    Layer &layer = stack->layers.at(i);
+    LayerBuffer &buffer = stack->buffers.at(i);
+    bool gpu_target = (i == config.app_layers);
+    bool video = (config.video && i == 0);
+
+    if (gpu_target) {
+      SetBuffer(width, height, kFormatRGBA8888, &buffer);
+      SetRect(0.0f, 0.0f, FLOAT(width), FLOAT(height), &layer.dst_rect);
+      layer.composition = kCompositionGPUTarget;
+    } else if (video) {
+      // Scaled up video behind the application windows.
+      SetBuffer((width / 2) & ~1U, (height / 2) & ~1U, kFormatYCbCr420SemiPlanar, &buffer);
+      SetRect(0.0f, 0.0f, FLOAT(width), FLOAT(height), &layer.dst_rect);
+      layer.blending = kBlendingOpaque;
+      stack->layer_stack.flags.video_present = true;
+    } else {
+      float top = std::min(FLOAT(i) * step + shift, FLOAT(height) - step);
+      SetBuffer(width, height - UINT32(top), kFormatRGBA8888, &buffer);
+      SetRect(0.0f, top, FLOAT(width), FLOAT(height), &layer.dst_rect);
+      layer.blending = (i == 0) ? kBlendingOpaque : kBlendingPremultiplied;
+    }
+
+    SetRect(0.0f, 0.0f, FLOAT(buffer.width), FLOAT(buffer.height), &layer.src_rect);
+    layer.visible_regions.push_back(layer.dst_rect);
+    layer.dirty_regions.push_back(layer.dst_rect);
+    layer.frame_rate = 60;
+    layer.input_buffer = &buffer;
+    stack->layer_stack.layers.push_back(&layer);
+  }
+}
+
+// Every application layer posts a new buffer on every frame, as while scrolling.
+static void UpdateStack(const BenchmarkConfig &config, uint32_t frame, BenchmarkStack *stack) {
+  for (uint32_t i = 0; i < config.app_layers; i++) {
+    Layer &layer = stack->layers.at(i);
+    layer.composition = kCompositionGPU;
+    layer.flags.updating = true;
+    layer.input_buffer->buffer_id = (UINT64(i) << 32) | frame;
+  }
+}
+
+static void CloseFences(LayerStack *layer_stack) {
+  for (Layer *layer : layer_stack->layers) {
+    LayerBuffer *buffer = layer->input_buffer;
+    if (buffer && buffer->release_fence_fd >= 0) {
+      close(buffer->release_fence_fd);
+      buffer->release_fence_fd = -1;
+    }
+  }
+  if (layer_stack->retire_fence_fd >= 0) {
+    close(layer_stack->retire_fence_fd);
+    layer_stack->retire_fence_fd = -1;
+  }
+}
+
+static bool HasGPUComposition(const LayerStack &layer_stack) {
+  for (Layer *layer : layer_stack.layers) {
+    if (layer->composition == kCompositionGPU || layer->composition == kCompositionGPUS3D) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void ComposeFrame(DisplayInterface *display_intf, BenchmarkStack *stack,
+                         BenchmarkStats *stats) {
+  LayerStack &layer_stack = stack->layer_stack;
+
+  uint64_t start = GetTimeNs();
+  DisplayError error = display_intf->Prepare(&layer_stack);
+  uint64_t prepared = GetTimeNs();
+  stats->prepare_ns.push_back(prepared - start);
+  if (error != kErrorNone) {
+    stats->prepare_failures++;
+    display_intf->Flush();
+    return;
+  }
+  stats->gpu_frames += HasGPUComposition(layer_stack) ? 1 : 0;
+
+  error = display_intf->Commit(&layer_stack);
+  uint64_t committed = GetTimeNs();
+  stats->commit_ns.push_back(committed - prepared);
+  stats->frame_ns.push_back(committed - start);
+  if (error != kErrorNone) {
+    stats->commit_failures++;
+    display_intf->Flush();
+  }
+  CloseFences(&layer_stack);
+  layer_stack.flags.geometry_changed = false;
+}
+
+static void PrintPercentiles(const char *stage, std::vector<uint64_t> *samples) {
+  if (samples->empty()) {
+    printf("%-8s no samples\n", stage);
+    return;
+  }
+
+  std::sort(samples->begin(), samples->end());
+  uint64_t total = 0;
+  for (uint64_t sample : *samples) {
+    total += sample;
+  }
+
+  size_t count = samples->size();
+  auto percentile = [&](uint32_t p) {
+    return FLOAT(samples->at(std::min(count - 1, (count * p) / 100))) / 1000.0f;
+  };
+  printf("%-8s avg %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f us\n", stage,
+         FLOAT(total / count) / 1000.0f, percentile(50), percentile(90), percentile(99),
+         FLOAT(samples->back()) / 1000.0f);
+}
+
+static void PrintStats(BenchmarkStats *stats, uint64_t elapsed_ns) {
+  VirtualDriverStats driver_stats;
+  VirtualDriver::GetInstance()->GetStats(&driver_stats);
+
+  uint32_t frames = UINT32(stats->frame_ns.size());
+  printf("frames composed:         %u\n", frames);
+  printf("prepare failures:        %u\n", stats->prepare_failures);
+  printf("commit failures:         %u\n", stats->commit_failures);
+  printf("gpu composed frames:     %u\n", stats->gpu_frames);
+  printf("driver validate/commit:  %" PRIu64 " (%" PRIu64 " failed) / %" PRIu64 " (%" PRIu64
+         " failed)\n", driver_stats.validate_count, driver_stats.validate_failures,
+         driver_stats.commit_count, driver_stats.commit_failures);
+  if (elapsed_ns) {
+    printf("throughput:              %.1f frames/s\n",
+           FLOAT(frames) * 1000000000.0f / FLOAT(elapsed_ns));
+  }
+  PrintPercentiles("prepare", &stats->prepare_ns);
+  PrintPercentiles("commit", &stats->commit_ns);
+  PrintPercentiles("frame", &stats->frame_ns);
+}
+
+static void Usage(const char *name) {
+  fprintf(stderr, "usage: %s [-r <width>x<height>] [-l <app layers>] [-n <frames>] "
+          "[-g <frames>] [-y] [-v]\n", name);
+}
+
+int main(int argc, char **argv) {
+  VirtualPanelConfig panel_config;
+  BenchmarkConfig config;
+  int opt = -1;
+
+  while ((opt = getopt(argc, argv, "r:l:n:g:yv")) != -1) {
+    switch (opt) {
+    case 'r':
+      if (sscanf(optarg, "%ux%u", &panel_config.x_pixels, &panel_config.y_pixels) != 2) {
+        Usage(argv[0]);
+        return -1;
+      }
+      break;
+    case 'l':
+      config.app_layers = UINT32(strtoul(optarg, NULL, 0));
+      break;
+    case 'n':
+      config.frames = UINT32(strtoul(optarg, NULL, 0));
+      break;
+    case 'g':
+      config.geometry_interval = UINT32(strtoul(optarg, NULL, 0));
+      break;
+    case 'y':
+      config.video = true;
+      break;
+    case 'v':
+      config.verbose = true;
+      break;
+    default:
+      Usage(argv[0]);
+      return -1;
+    }
+  }
+
+  if (!config.app_layers || !panel_config.x_pixels || !panel_config.y_pixels) {
+    Usage(argv[0]);
+    return -1;
+  }
+
+  VirtualDriver::GetInstance()->SetPanelConfig(panel_config);
+
+  BenchmarkDebugHandler debug_handler(config.verbose);
+  BenchmarkBufferAllocator buffer_allocator;
+  BenchmarkBufferSyncHandler buffer_sync_handler;
+  BenchmarkEventHandler event_handler;
+  CoreInterface *core_intf = NULL;
+  DisplayInterface *display_intf = NULL;
+
+  DisplayError error = CoreInterface::CreateCore(&debug_handler, &buffer_allocator,
+                                                 &buffer_sync_handler, &core_intf);
+  if (error != kErrorNone) {
+    fprintf(stderr, "Failed to create display core. Error = %d\n", error);
+    return -1;
+  }
+
+  error = core_intf->CreateDisplay(kPrimary, &event_handler, &display_intf);
+  if (error != kErrorNone) {
+    fprintf(stderr, "Failed to create primary display. Error = %d\n", error);
+    CoreInterface::DestroyCore();
+    return -1;
+  }
+  display_intf->SetDisplayState(kStateOn);
+
+  BenchmarkStack stack;
+  BenchmarkStats stats;
+  stats.prepare_ns.reserve(config.frames);
+  stats.commit_ns.reserve(config.frames);
+  stats.frame_ns.reserve(config.frames);
+
+  uint64_t start = GetTimeNs();
+  for (uint32_t frame = 0; frame < config.frames; frame++) {
+    if (!frame || (config.geometry_interval && !(frame % config.geometry_interval))) {
+      uint32_t generation = config.geometry_interval ? (frame / config.geometry_interval) : 0;
+      BuildStack(config, panel_config.x_pixels, panel_config.y_pixels, generation, &stack);
+    }
+    UpdateStack(config, frame, &stack);
+    ComposeFrame(display_intf, &stack, &stats);
+  }
+
+  PrintStats(&stats, GetTimeNs() - start);
+
+  display_intf->SetDisplayState(kStateOff);
+  core_intf->DestroyDisplay(display_intf);
+  CoreInterface::DestroyCore();
+
+  return 0;
+}